@@ -0,0 +1,208 @@
+#include "alu.h"
+#include "register_file.h"
+#include "error_handling.h"
+#include "utils.h"
+
+// A mask used to convert signed values to unsigned
+#define MASK_32 0xFFFFFFFFLL
+
+// The ALU operations. Note that since we store the complete target address for
+// jumps and branches, no address computation needs to be done here (this
+// is what is done by the extra ALU described in the course book).
+// All functions take the same three operands so that they fit in the operation
+// table, and cast the operands they do not use to void.
+
+static long long AluNone(long long rs_value, long long rt_value, long long imm_value)
+{
+	(void) rs_value;
+	(void) rt_value;
+	(void) imm_value;
+	return DONT_CARE;
+}
+
+static long long AluAdd(long long rs_value, long long rt_value, long long imm_value)
+{
+	(void) imm_value;
+	return rs_value + rt_value;
+}
+
+static long long AluAddImm(long long rs_value, long long rt_value, long long imm_value)
+{
+	(void) rt_value;
+	return rs_value + imm_value;
+}
+
+static long long AluSub(long long rs_value, long long rt_value, long long imm_value)
+{
+	(void) imm_value;
+	return rs_value - rt_value;
+}
+
+static long long AluAnd(long long rs_value, long long rt_value, long long imm_value)
+{
+	(void) imm_value;
+	return rs_value & rt_value;
+}
+
+static long long AluAndImm(long long rs_value, long long rt_value, long long imm_value)
+{
+	(void) rt_value;
+	return rs_value & imm_value;
+}
+
+static long long AluOr(long long rs_value, long long rt_value, long long imm_value)
+{
+	(void) imm_value;
+	return rs_value | rt_value;
+}
+
+static long long AluOrImm(long long rs_value, long long rt_value, long long imm_value)
+{
+	(void) rt_value;
+	return rs_value | imm_value;
+}
+
+static long long AluNor(long long rs_value, long long rt_value, long long imm_value)
+{
+	(void) imm_value;
+	return ~(rs_value | rt_value);
+}
+
+static long long AluSll(long long rs_value, long long rt_value, long long imm_value)
+{
+	long long sign_bit_mask = 1LL << 31;
+	long long result = rs_value << imm_value;
+
+	(void) rt_value;
+
+	// Remove the shifted-out bits, while trying to preserve the sign in the result.
+	// This means that if the left operand was negative, and the result from the shift
+	// also has its sign bit set, we copy the sign into the result
+	if (rs_value < 0 && (result & sign_bit_mask) != 0)
+		return result | ~MASK_32;
+	return result & MASK_32;
+}
+
+static long long AluSrl(long long rs_value, long long rt_value, long long imm_value)
+{
+	(void) rt_value;
+	if (imm_value != 0)
+		return (rs_value & MASK_32) >> imm_value;
+	return DONT_CARE;
+}
+
+static long long AluSlt(long long rs_value, long long rt_value, long long imm_value)
+{
+	(void) imm_value;
+	return rs_value < rt_value;
+}
+
+static long long AluSltImm(long long rs_value, long long rt_value, long long imm_value)
+{
+	(void) rt_value;
+	return rs_value < imm_value;
+}
+
+static long long AluSltu(long long rs_value, long long rt_value, long long imm_value)
+{
+	(void) imm_value;
+	return (rs_value & MASK_32) < (rt_value & MASK_32);
+}
+
+static long long AluSltuImm(long long rs_value, long long rt_value, long long imm_value)
+{
+	(void) rt_value;
+	return (rs_value & MASK_32) < (imm_value & MASK_32);
+}
+
+static long long AluLui(long long rs_value, long long rt_value, long long imm_value)
+{
+	(void) rs_value;
+	(void) rt_value;
+	return imm_value << 16;
+}
+
+typedef long long (*AluFunction)(long long rs_value, long long rt_value, long long imm_value);
+
+// The ALU's operation table, indexed by AluOp. ALU_INVALID has no entry.
+static const AluFunction alu_functions[NR_OF_ALU_OPS] =
+{
+	AluNone,	// ALU_NONE
+	AluAdd,		// ALU_ADD
+	AluAddImm,	// ALU_ADD_IMM
+	AluSub,		// ALU_SUB
+	AluAnd,		// ALU_AND
+	AluAndImm,	// ALU_AND_IMM
+	AluOr,		// ALU_OR
+	AluOrImm,	// ALU_OR_IMM
+	AluNor,		// ALU_NOR
+	AluSll,		// ALU_SLL
+	AluSrl,		// ALU_SRL
+	AluSlt,		// ALU_SLT
+	AluSltImm,	// ALU_SLT_IMM
+	AluSltu,	// ALU_SLTU
+	AluSltuImm,	// ALU_SLTU_IMM
+	AluLui,		// ALU_LUI
+	NULL		// ALU_INVALID
+};
+
+long long ComputeALUResult(AluOp op, const Instr* instr, long long rs_value,
+	long long rt_value, long long imm_value)
+{
+	long long result;
+
+	if (op == ALU_INVALID)
+		STATIC_MIPS_ERROR("ComputeALUResult(): unhandled instruction from program line %d: %s", instr->line_nr, StringRepOfInstrType(instr->type));
+
+	result = alu_functions[op](rs_value, rt_value, imm_value);
+	ValidateALUResult(result);
+	return result;
+}
+
+// Apply the ALU function FUNC to the lanes [first, end). The function is called
+// directly rather than through the operation table, so that the compiler can
+// inline it and vectorize the loop.
+#define ALU_LANE_LOOP(FUNC) \
+	for (l = first; l < end; ++l) \
+		results[l] = FUNC(rs_values[l], rt_values[l], imm_value); \
+	break;
+
+void ComputeALUResults(AluOp op, const Instr* instr, const long long* rs_values,
+	const long long* rt_values, long long imm_value, long long* results, int first, int end)
+{
+	int l;
+
+	switch (op)
+	{
+	case ALU_NONE: ALU_LANE_LOOP(AluNone)
+	case ALU_ADD: ALU_LANE_LOOP(AluAdd)
+	case ALU_ADD_IMM: ALU_LANE_LOOP(AluAddImm)
+	case ALU_SUB: ALU_LANE_LOOP(AluSub)
+	case ALU_AND: ALU_LANE_LOOP(AluAnd)
+	case ALU_AND_IMM: ALU_LANE_LOOP(AluAndImm)
+	case ALU_OR: ALU_LANE_LOOP(AluOr)
+	case ALU_OR_IMM: ALU_LANE_LOOP(AluOrImm)
+	case ALU_NOR: ALU_LANE_LOOP(AluNor)
+	case ALU_SLL: ALU_LANE_LOOP(AluSll)
+	case ALU_SRL: ALU_LANE_LOOP(AluSrl)
+	case ALU_SLT: ALU_LANE_LOOP(AluSlt)
+	case ALU_SLT_IMM: ALU_LANE_LOOP(AluSltImm)
+	case ALU_SLTU: ALU_LANE_LOOP(AluSltu)
+	case ALU_SLTU_IMM: ALU_LANE_LOOP(AluSltuImm)
+	case ALU_LUI: ALU_LANE_LOOP(AluLui)
+	default:
+		STATIC_MIPS_ERROR("ComputeALUResults(): unhandled instruction from program line %d: %s", instr->line_nr, StringRepOfInstrType(instr->type));
+	}
+}
+
+#undef ALU_LANE_LOOP
+
+void ValidateALUResult(long long result)
+{
+	// Do some error checking. In a real CPU, arithmetic underflow or overflow would cause an exception,
+	// but we just terminate the simulator with an error message.
+	if (result < MIN_32_BIT_REGVALUE)
+		MIPS_RUNTIME_ERROR("Arithmetic underflow: %lld (value does not fit in 32 bits)", result);
+	if (result >= (1LL << 32))
+		MIPS_RUNTIME_ERROR("Arithmetic overflow: %lld (value does not fit in 32 bits)", result);
+}
@@ -0,0 +1,37 @@
+/** @file alu.h
+	The ALU. Shared by the Ex stage of the pipeline and by the functional
+	(instruction-set level) execution of programs. */
+
+#ifndef ALU_H_INCL
+#define ALU_H_INCL
+
+#include "instructions.h"
+
+/** Perform the ALU operation @a op on the given operand values.
+	Terminates the simulation with a MIPS runtime error if the result does not fit
+	in 32 bits.
+	@param op The operation to perform, normally taken from the predecoded instruction
+	@param instr The instruction that the operation is performed for. Only used for
+		error messages.
+	@param rs_value The value of the rs operand
+	@param rt_value The value of the rt operand
+	@param imm_value The value of the immediate operand
+	@return The ALU result, or DONT_CARE for instructions that do not use the ALU */
+long long ComputeALUResult(AluOp op, const Instr* instr, long long rs_value,
+	long long rt_value, long long imm_value);
+
+/** Perform the ALU operation @a op for each of the lanes [@a first, @a end) of a batch
+	of simulations (see batch.h). Lane l uses the operand values @a rs_values[l] and
+	@a rt_values[l], and its result is returned in @a results[l]. Unlike
+	ComputeALUResult(), results that do not fit in 32 bits are not checked.
+	@param instr The instruction that the operation is performed for. Only used for
+		error messages. */
+void ComputeALUResults(AluOp op, const Instr* instr, const long long* rs_values,
+	const long long* rt_values, long long imm_value, long long* results, int first, int end);
+
+/** Terminate the simulation with a MIPS runtime error if the ALU result @a result
+	does not fit in 32 bits. This is done by ComputeALUResult(), and is only needed
+	by code that computes ALU results by itself. */
+void ValidateALUResult(long long result);
+
+#endif // ifndef ALU_H_INCL
@@ -0,0 +1,515 @@
+#include "aot.h"
+#include "instr_memory.h"
+#include "data_memory.h"
+#include "register_file.h"
+#include "alu.h"
+#include <stdlib.h>
+#include <string.h>
+#ifndef _WIN32
+#	include <unistd.h>
+#	include <sys/types.h>
+#	include <sys/wait.h>
+#else
+#	include <process.h>
+#endif
+
+// The maximum number of words in the CC environment variable
+#define MAX_CC_WORDS 16
+
+// Support code that is put at the top of every generated program. It mirrors the
+// overflow checks in alu.c and the address checks and big-endian byte order of
+// data_memory.c.
+static const char* prelude =
+	"#include <stdio.h>\n"
+	"#include <stdlib.h>\n"
+	"#include <stdarg.h>\n"
+	"\n"
+	"#define MASK_32 0xFFFFFFFFLL\n"
+	"\n"
+	"static long long retired;\n"
+	"static unsigned char* pages[1 << 20];\n"
+	"\n"
+	"static void Error(const char* format, ...)\n"
+	"{\n"
+	"\tva_list args;\n"
+	"\tva_start(args, format);\n"
+	"\tfprintf(stderr, \"MIPS runtime error: \");\n"
+	"\tvfprintf(stderr, format, args);\n"
+	"\tfprintf(stderr, \".\\n\");\n"
+	"\tva_end(args);\n"
+	"\texit(EXIT_FAILURE);\n"
+	"}\n"
+	"\n"
+	"static long long Check(long long value)\n"
+	"{\n"
+	"\tif (value < -2147483648LL)\n"
+	"\t\tError(\"Arithmetic underflow: %lld (value does not fit in 32 bits)\", value);\n"
+	"\tif (value >= (1LL << 32))\n"
+	"\t\tError(\"Arithmetic overflow: %lld (value does not fit in 32 bits)\", value);\n"
+	"\treturn value;\n"
+	"}\n"
+	"\n"
+	"static long long Sll(long long value, long long shift)\n"
+	"{\n"
+	"\tlong long result = value << shift;\n"
+	"\tif (value < 0 && (result & (1LL << 31)) != 0)\n"
+	"\t\treturn result | ~MASK_32;\n"
+	"\treturn result & MASK_32;\n"
+	"}\n"
+	"\n"
+	"static unsigned char* Byte(long long address)\n"
+	"{\n"
+	"\tunsigned char** page = &pages[(address >> 12) & 0xFFFFF];\n"
+	"\tif (*page == NULL)\n"
+	"\t\t*page = (unsigned char*) calloc(4096, 1);\n"
+	"\treturn *page + (address & 4095);\n"
+	"}\n"
+	"\n"
+	"static void ValidateAddress(long long address, int nr_bytes)\n"
+	"{\n"
+	"\tif (address < DATA_SEG_START)\n"
+	"\t\tError(\"The address 0x%llx points below the data segment\", address);\n"
+	"\tif (address + nr_bytes >= STACK_SEG_END)\n"
+	"\t\tError(\"The address 0x%llx points above the stack segment\", address);\n"
+	"\tif (address % nr_bytes != 0)\n"
+	"\t\tError(\"Address 0x%llx is not %d-byte aligned\", address, nr_bytes);\n"
+	"}\n"
+	"\n"
+	"// Big-endian load, with sign extension unless read_unsigned is set\n"
+	"static long long Load(long long address, int nr_bytes, int read_unsigned)\n"
+	"{\n"
+	"\tlong long value = 0;\n"
+	"\tint b;\n"
+	"\tValidateAddress(address, nr_bytes);\n"
+	"\tfor (b = 0; b < nr_bytes; ++b)\n"
+	"\t\tvalue = (value << 8) | *Byte(address + b);\n"
+	"\tif (!read_unsigned && (value & (1LL << (8*nr_bytes - 1))) != 0)\n"
+	"\t\tvalue |= -1LL << (8*nr_bytes);\n"
+	"\treturn value;\n"
+	"}\n"
+	"\n"
+	"// Big-endian store\n"
+	"static void Store(long long address, long long value, int nr_bytes)\n"
+	"{\n"
+	"\tint b;\n"
+	"\tValidateAddress(address, nr_bytes);\n"
+	"\tfor (b = nr_bytes - 1; b >= 0; --b)\n"
+	"\t{\n"
+	"\t\t*Byte(address + b) = (unsigned char) (value & 0xFF);\n"
+	"\t\tvalue >>= 8;\n"
+	"\t}\n"
+	"}\n"
+	"\n"
+	"// Set register d to the value v. Writes to $zero are ignored.\n"
+	"#define SET(d, v) do { long long v_ = (v); if ((d) != 0) r[d] = v_; } while (0)\n"
+	"\n";
+
+// Support code for printing the results, in the same format as PrintRegisterFile()
+static const char* postlude =
+	"static void PrintResults()\n"
+	"{\n"
+	"\tint l, c;\n"
+	"\tprintf(\"Number of retired instructions: %lld\\n\", retired);\n"
+	"\tfor (l = 0; l < 8; ++l)\n"
+	"\t{\n"
+	"\t\tfor (c = 0; c < 4; ++c)\n"
+	"\t\t{\n"
+	"\t\t\tint i = l + 8*c;\n"
+	"\t\t\tprintf(\"R%d%s (%s) %s= %-11lld \", i, (i == 8 || i == 9) ? \" \" : \"\",\n"
+	"\t\t\t\treg_names[i], (c == 0 && l != 0) ? \"  \" : \"\", r[i]);\n"
+	"\t\t}\n"
+	"\t\tprintf(\"\\n\");\n"
+	"\t}\n"
+	"}\n"
+	"\n";
+
+// Used while writing the initial contents of the data memory
+typedef struct DataRegions
+{
+	FILE* file;
+	int nr_regions;
+	int capacity;
+	long long* addresses;
+	long* sizes;
+}
+DataRegions;
+
+static void WriteDataRegion(long long address, const unsigned char* bytes, long nr_bytes, void* context)
+{
+	DataRegions* regions = (DataRegions*) context;
+	long first = 0, last = nr_bytes - 1, i;
+
+	// Only the part between the first and last non-zero bytes needs to be stored
+	while (first < nr_bytes && bytes[first] == 0)
+		++first;
+	while (last >= first && bytes[last] == 0)
+		--last;
+	if (first > last)
+		return;
+
+	if (regions->nr_regions == regions->capacity)
+	{
+		regions->capacity = 2*regions->capacity + 4;
+		regions->addresses = (long long*) realloc(regions->addresses, regions->capacity * sizeof(long long));
+		regions->sizes = (long*) realloc(regions->sizes, regions->capacity * sizeof(long));
+	}
+	regions->addresses[regions->nr_regions] = address + first;
+	regions->sizes[regions->nr_regions] = last - first + 1;
+
+	fprintf(regions->file, "static const unsigned char data_%d[] =\n{", regions->nr_regions);
+	for (i = first; i <= last; ++i)
+		fprintf(regions->file, "%s%u,", (i - first) % 16 == 0 ? "\n\t" : " ", (unsigned) bytes[i]);
+	fprintf(regions->file, "\n};\n\n");
+
+	++regions->nr_regions;
+}
+
+static void WriteInitialData(FILE* file)
+{
+	DataRegions regions;
+	int i;
+
+	regions.file = file;
+	regions.nr_regions = regions.capacity = 0;
+	regions.addresses = NULL;
+	regions.sizes = NULL;
+	VisitDataMemory(WriteDataRegion, &regions);
+
+	fprintf(file, "static void InitDataMemory()\n{\n\tlong i;\n");
+	for (i = 0; i < regions.nr_regions; ++i)
+		fprintf(file, "\tfor (i = 0; i < %ld; ++i)\n\t\t*Byte(0x%llxLL + i) = data_%d[i];\n",
+			regions.sizes[i], regions.addresses[i], i);
+	fprintf(file, "}\n\n");
+
+	free(regions.addresses);
+	free(regions.sizes);
+}
+
+static void WriteRegisters(FILE* file)
+{
+	int reg;
+
+	fprintf(file, "static long long r[32] =\n{\n");
+	for (reg = 0; reg < 32; ++reg)
+		fprintf(file, "\t%lldLL,\n", ReadFromRegisterFile(reg));
+	fprintf(file, "};\n\n");
+
+	fprintf(file, "static const char* reg_names[32] =\n{\n");
+	for (reg = 0; reg < 32; ++reg)
+		fprintf(file, "\t\"%s\",\n", RegNameAsString(reg));
+	fprintf(file, "};\n\n");
+}
+
+// Write a statement that transfers control to the address target
+static void WriteGoto(FILE* file, long long target, long nr_instr)
+{
+	long long text_start = GetTextSegmentStartingAddress();
+
+	if (target < text_start)
+		fprintf(file, "Error(\"The address 0x%%llx points below the text segment\", 0x%llxLL);", target);
+	else if (target % 4 != 0)
+		fprintf(file, "Error(\"Instruction address 0x%%llx is not 4-byte aligned\", 0x%llxLL);", target);
+	else if (target >= text_start + 4*nr_instr)
+		fprintf(file, "goto L_past_end;");
+	else
+		fprintf(file, "goto L_%llx;", target);
+}
+
+// Return a C expression for the value of the register operand reg
+static const char* Operand(int reg, char* buf)
+{
+	if (reg == DONT_CARE)
+		sprintf(buf, "(-1LL)");
+	else
+		sprintf(buf, "r[%d]", reg);
+	return buf;
+}
+
+static void WriteInstr(FILE* file, const DecodedInstr* decoded, long long pc, long nr_instr)
+{
+	const Instr* instr = &decoded->instr;
+	char rs_buf[16], rt_buf[16];
+	const char* rs = Operand(instr->rs, rs_buf);
+	const char* rt = Operand(instr->rt, rt_buf);
+	int d = decoded->dest;
+	long long imm = instr->imm;
+
+	fprintf(file, "\t/* ");
+	PrintInstruction_LineNr(instr, file);
+	fprintf(file, " */\n\t");
+
+	switch (instr->type)
+	{
+	case NOP:
+		fprintf(file, ";");
+		break;
+	case SYSCALL:
+		fprintf(file, "goto L_exit;");
+		break;
+	case J:
+		WriteGoto(file, imm, nr_instr);
+		break;
+	case JAL:
+		fprintf(file, "SET(%d, %lldLL); ", d, pc + 4);
+		WriteGoto(file, imm, nr_instr);
+		break;
+	case JR:
+	case JALR:
+		fprintf(file, "target = %s; ", rs);
+		if (instr->type == JALR)
+			fprintf(file, "SET(%d, %lldLL); ", d, pc + 4);
+		fprintf(file, "goto L_indirect;");
+		break;
+	case BEQ:
+	case BNE:
+		fprintf(file, "if (Check(%s - %s) %s 0) ", rs, rt, instr->type == BEQ ? "==" : "!=");
+		WriteGoto(file, imm, nr_instr);
+		break;
+	case ADD:
+		fprintf(file, "SET(%d, Check(%s + %s));", d, rs, rt);
+		break;
+	case ADDI:
+		fprintf(file, "SET(%d, Check(%s + %lldLL));", d, rs, imm);
+		break;
+	case SUB:
+		fprintf(file, "SET(%d, Check(%s - %s));", d, rs, rt);
+		break;
+	case AND:
+		fprintf(file, "SET(%d, Check(%s & %s));", d, rs, rt);
+		break;
+	case ANDI:
+		fprintf(file, "SET(%d, Check(%s & %lldLL));", d, rs, imm);
+		break;
+	case OR:
+		fprintf(file, "SET(%d, Check(%s | %s));", d, rs, rt);
+		break;
+	case ORI:
+		fprintf(file, "SET(%d, Check(%s | %lldLL));", d, rs, imm);
+		break;
+	case NOR:
+		fprintf(file, "SET(%d, Check(~(%s | %s)));", d, rs, rt);
+		break;
+	case SLL:
+		fprintf(file, "SET(%d, Check(Sll(%s, %lldLL)));", d, rs, imm);
+		break;
+	case SRL:
+		if (imm != 0)
+			fprintf(file, "SET(%d, Check((%s & MASK_32) >> %lldLL));", d, rs, imm);
+		else
+			fprintf(file, "SET(%d, %lldLL);", d, (long long) DONT_CARE);
+		break;
+	case SLT:
+		fprintf(file, "SET(%d, %s < %s);", d, rs, rt);
+		break;
+	case SLTI:
+		fprintf(file, "SET(%d, %s < %lldLL);", d, rs, imm);
+		break;
+	case SLTU:
+		fprintf(file, "SET(%d, (%s & MASK_32) < (%s & MASK_32));", d, rs, rt);
+		break;
+	case SLTIU:
+		fprintf(file, "SET(%d, (%s & MASK_32) < (%lldLL & MASK_32));", d, rs, imm);
+		break;
+	case LUI:
+		fprintf(file, "SET(%d, %lldLL);", d, ComputeALUResult(ALU_LUI, instr, DONT_CARE, DONT_CARE, imm));
+		break;
+	case LW:
+	case LH:
+	case LHU:
+	case LB:
+	case LBU:
+		fprintf(file, "SET(%d, Load(Check(%s + %lldLL), %d, %d));", d, rs, imm,
+			instr->type == LW ? 4 : (instr->type == LH || instr->type == LHU) ? 2 : 1,
+			instr->type == LHU || instr->type == LBU);
+		break;
+	case SW:
+	case SH:
+	case SB:
+		fprintf(file, "Store(Check(%s + %lldLL), %s, %d);", rs, imm, rt,
+			instr->type == SW ? 4 : instr->type == SH ? 2 : 1);
+		break;
+	default:
+		fprintf(file, "fprintf(stderr, \"Static MIPS error: ComputeALUResult(): unhandled instruction "
+			"from program line %d: %s.\\n\"); exit(EXIT_FAILURE);",
+			instr->line_nr, StringRepOfInstrType(instr->type));
+	}
+	fprintf(file, "\n");
+}
+
+static int EndsBlock(InstrType type)
+{
+	return type == BEQ || type == BNE || IsJump(type) || type == SYSCALL;
+}
+
+// Run the compiler with the arguments argv. The compiler is started directly rather than
+// through a shell, so that the file names are passed on as they are. Returns the exit
+// status of the compiler, or -1 if it could not be run.
+static int RunCompiler(char** argv)
+{
+#ifdef _WIN32
+	return (int) _spawnvp(_P_WAIT, argv[0], (const char* const*) argv);
+#else
+	int status;
+	pid_t pid;
+
+	fflush(stdout);
+	fflush(stderr);
+	pid = fork();
+	if (pid < 0)
+		return -1;
+	if (pid == 0)
+	{
+		execvp(argv[0], argv);
+		fprintf(stderr, "Could not run the compiler %s\n", argv[0]);
+		_exit(127);
+	}
+	if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status))
+		return -1;
+	return WEXITSTATUS(status);
+#endif
+}
+
+// Public functions -----------------------------------------------------
+
+void WriteProgramAsC(FILE* file, long long start_pc)
+{
+	long nr_instr, i;
+	const DecodedInstr* instrs = GetDecodedInstrBuffer(&nr_instr);
+	long long text_start = GetTextSegmentStartingAddress();
+	char* is_leader = (char*) calloc(nr_instr + 1, sizeof(char));
+	int has_indirect_jumps = 0;
+
+	// Find the first instruction of each basic block: the entry point, branch and
+	// jump targets, and the instructions following branches, jumps and syscalls.
+	// Any instruction can be the target of jr or jalr, so with those all are leaders.
+	if (start_pc >= text_start && start_pc < text_start + 4*nr_instr && start_pc % 4 == 0)
+		is_leader[(start_pc - text_start) / 4] = 1;
+	for (i = 0; i < nr_instr; ++i)
+	{
+		const Instr* instr = &instrs[i].instr;
+		if (IsIndirectJump(instr->type))
+			has_indirect_jumps = 1;
+		else if (instr->type == BEQ || instr->type == BNE || IsJump(instr->type))
+		{
+			long long target = instr->imm;
+			if (target >= text_start && target < text_start + 4*nr_instr && target % 4 == 0)
+				is_leader[(target - text_start) / 4] = 1;
+		}
+		if (EndsBlock(instr->type))
+			is_leader[i + 1] = 1;
+	}
+	if (has_indirect_jumps)
+		memset(is_leader, 1, nr_instr);
+
+	fprintf(file, "/* Generated from a MIPS program. Start address: 0x%llx */\n\n", start_pc);
+	fprintf(file, "#define DATA_SEG_START 0x%llxLL\n", GetDataSegmentStartingAddress());
+	fprintf(file, "#define STACK_SEG_END 0x%llxLL\n\n", GetStackSegmentEndAddress());
+	fprintf(file, "%s", prelude);
+	WriteRegisters(file);
+	WriteInitialData(file);
+	fprintf(file, "%s", postlude);
+
+	fprintf(file, "int main()\n{\n");
+	if (has_indirect_jumps)
+		fprintf(file, "\tlong long target;\n\n");
+	fprintf(file, "\tInitDataMemory();\n\t");
+	WriteGoto(file, start_pc, nr_instr);
+	fprintf(file, "\n\n");
+
+	for (i = 0; i < nr_instr; ++i)
+	{
+		if (i == 0 || is_leader[i])
+		{
+			// Count the retired (non-nop) instructions of the whole block up front
+			long j, nr_retired = 0;
+			for (j = i; j < nr_instr && (j == i || !is_leader[j]); ++j)
+			{
+				if (instrs[j].instr.type != NOP)
+					++nr_retired;
+				if (EndsBlock(instrs[j].instr.type))
+					break;
+			}
+
+			fprintf(file, "L_%llx:\n", text_start + 4*i);
+			if (nr_retired > 0)
+				fprintf(file, "\tretired += %ld;\n", nr_retired);
+		}
+		WriteInstr(file, &instrs[i], text_start + 4*i, nr_instr);
+	}
+
+	fprintf(file,
+		"L_past_end:\n"
+		"\tError(\"Execution ran past the end of the program at 0x%%llx\", 0x%llxLL);\n"
+		"L_exit:\n"
+		"\tPrintResults();\n"
+		"\treturn EXIT_SUCCESS;\n", text_start + 4*nr_instr);
+
+	// The targets of jr and jalr are only known at run time
+	if (has_indirect_jumps)
+	{
+		fprintf(file, "\nL_indirect:\n\tswitch (target)\n\t{\n");
+		for (i = 0; i < nr_instr; ++i)
+			fprintf(file, "\tcase 0x%llxLL: goto L_%llx;\n", text_start + 4*i, text_start + 4*i);
+		fprintf(file,
+			"\tdefault:\n"
+			"\t\tif (target < 0x%llxLL)\n"
+			"\t\t\tError(\"The address 0x%%llx points below the text segment\", target);\n"
+			"\t\tif (target %% 4 != 0)\n"
+			"\t\t\tError(\"Instruction address 0x%%llx is not 4-byte aligned\", target);\n"
+			"\t\tgoto L_past_end;\n"
+			"\t}\n", text_start);
+	}
+	fprintf(file, "}\n");
+
+	free(is_leader);
+}
+
+int CompileProgramToNative(const char* exe_filename, long long start_pc)
+{
+	const char* cc = getenv("CC");
+	char* c_filename = (char*) malloc(strlen(exe_filename) + 3);
+	char* cc_words, * word;
+	char* argv[MAX_CC_WORDS + 5];
+	FILE* c_file;
+	int argc = 0, status;
+
+	sprintf(c_filename, "%s.c", exe_filename);
+	c_file = fopen(c_filename, "w");
+	if (c_file == NULL)
+	{
+		fprintf(stderr, "Could not open file %s for writing\n", c_filename);
+		free(c_filename);
+		return 1;
+	}
+	WriteProgramAsC(c_file, start_pc);
+	fclose(c_file);
+
+	// CC holds the compiler, optionally followed by options, separated by blanks
+	if (cc == NULL)
+		cc = "cc";
+	cc_words = (char*) malloc(strlen(cc) + 1);
+	strcpy(cc_words, cc);
+	word = strtok(cc_words, " \t");
+	while (word != NULL && argc < MAX_CC_WORDS)
+	{
+		argv[argc++] = word;
+		word = strtok(NULL, " \t");
+	}
+	if (argc == 0 || word != NULL)
+	{
+		fprintf(stderr, "Invalid compiler in CC: %s\n", cc);
+		free(cc_words);
+		free(c_filename);
+		return 1;
+	}
+	argv[argc++] = "-O2";
+	argv[argc++] = "-o";
+	argv[argc++] = (char*) exe_filename;
+	argv[argc++] = c_filename;
+	argv[argc] = NULL;
+	status = RunCompiler(argv);
+
+	free(cc_words);
+	free(c_filename);
+	return status != 0;
+}
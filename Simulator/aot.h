@@ -0,0 +1,32 @@
+/** @file aot.h
+	Ahead-of-time translation of the program in the instruction memory to C.
+	Each basic block of the program becomes a labelled block of C code, and branches
+	and jumps become gotos. The generated program contains the initial contents of the
+	data memory and the register file, and performs the same 32-bit overflow checks and
+	big-endian memory accesses as the simulator. When compiled and run, it prints the
+	retired instruction count and the final contents of the register file. */
+
+#ifndef AOT_H_INCL
+#define AOT_H_INCL
+
+#include <stdio.h>
+
+/** Write a standalone C program that executes the program in the instruction memory,
+	starting at the address @a start_pc from the current contents of the register file
+	and the data memory
+	@param file The file to write the C code to
+	@param start_pc The address of the first instruction to execute */
+void WriteProgramAsC(FILE* file, long long start_pc);
+
+/** Translate the program in the instruction memory to C with WriteProgramAsC(),
+	and compile it into a native executable with the host's C compiler. The C code is
+	written to a file with the same name as the executable, with ".c" appended. The
+	compiler can be selected with the CC environment variable, which holds the compiler
+	and optionally its options separated by blanks, and defaults to "cc". It is run
+	directly rather than through a shell, so the file names may contain any characters.
+	@param exe_filename The name of the executable to create
+	@param start_pc The address of the first instruction to execute
+	@return 0 if the compilation went fine, 1 otherwise */
+int CompileProgramToNative(const char* exe_filename, long long start_pc);
+
+#endif // ifndef AOT_H_INCL
@@ -0,0 +1,681 @@
+#include "batch.h"
+#include "alu.h"
+#include "instr_memory.h"
+#include "data_memory.h"
+#include "register_file.h"
+#include "symbol_table.h"
+#include "update.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdint.h>
+
+// The maximum length of a line in the input file
+#define MAX_LINE_LENGTH 4096
+
+// The maximum length of the error message of a lane
+#define MAX_ERROR_LENGTH 128
+
+typedef struct Lane
+{
+	LaneStatus status;
+
+	// The group that the lane belongs to
+	int group;
+
+	// The state of the lane when its group starts to run, or when the lane has
+	// finished: the address of the next instruction, the counters, and the register
+	// loaded by the previous instruction (DONT_CARE if it was not a load). For early
+	// branch resolution, also the register written by the previous instruction, and
+	// the one loaded by the instruction before it if no bubble separates them.
+	long long pc;
+	long long cycles, nr_retired;
+	int load_dest, ex_dest, mem_load_dest;
+
+	char error[MAX_ERROR_LENGTH];
+}
+Lane;
+
+// The data memory of all lanes is divided into pages, which are allocated when they
+// are first accessed. Like in the data memory, the pages are found through a two-level
+// page table. The value in lane l of word w of a page is page[w*nr_lanes + l], and
+// like in the data memory, the bytes of a word are in big-endian order.
+#define LANE_PAGE_BITS 10
+#define LANE_PAGE_SIZE (1 << LANE_PAGE_BITS)
+#define LANE_TABLE_BITS 11
+#define LANE_TABLE_SIZE (1 << LANE_TABLE_BITS)
+#define NR_OF_LANE_TABLES (1 << (32 - LANE_PAGE_BITS - LANE_TABLE_BITS))
+
+static int nr_lanes;
+static Lane* lanes;
+
+// The value of register r in lane l is regs[r*nr_lanes + l]
+static long long* regs;
+
+static uint32_t** lane_page_tables[NR_OF_LANE_TABLES];
+
+// The most recently accessed page
+static long long last_lane_page_nr = -1;
+static uint32_t* last_lane_page;
+
+// Per-lane work arrays: whether the lane belongs to the running group, the results of
+// the current instruction, the branch outcomes, and the operand values used for
+// instructions that lack an operand
+static unsigned char* active;
+static long long* results;
+static unsigned char* taken;
+static long long* dont_care_values;
+
+// The groups that have been split off but not run yet
+static int* pending_groups;
+static int nr_pending_groups, nr_groups;
+
+// The state shared by the lanes of the running group
+static long long group_pc, group_cycles, group_retired;
+static int group_load_dest, group_ex_dest, group_mem_load_dest;
+
+// Lane memory -----------------------------------------------------------------
+
+// Return the values that all lanes hold in the word containing the address
+// @a address. The page holding the word is allocated if it has not been yet.
+static uint32_t* GetLaneWords(long long address)
+{
+	long long page_nr = address >> LANE_PAGE_BITS;
+	uint32_t*** table;
+	uint32_t** page;
+
+	if (page_nr != last_lane_page_nr)
+	{
+		table = &lane_page_tables[page_nr >> LANE_TABLE_BITS];
+		if (*table == NULL)
+			*table = (uint32_t**) calloc(LANE_TABLE_SIZE, sizeof(uint32_t*));
+		page = &(*table)[page_nr & (LANE_TABLE_SIZE - 1)];
+		if (*page == NULL)
+			*page = (uint32_t*) calloc((size_t) (LANE_PAGE_SIZE / 4) * nr_lanes, sizeof(uint32_t));
+		last_lane_page_nr = page_nr;
+		last_lane_page = *page;
+	}
+	return last_lane_page + ((address & (LANE_PAGE_SIZE - 1)) >> 2) * nr_lanes;
+}
+
+static void FreeLaneMemory()
+{
+	int t, p;
+
+	for (t = 0; t < NR_OF_LANE_TABLES; ++t)
+		if (lane_page_tables[t] != NULL)
+		{
+			for (p = 0; p < LANE_TABLE_SIZE; ++p)
+				free(lane_page_tables[t][p]);
+			free(lane_page_tables[t]);
+			lane_page_tables[t] = NULL;
+		}
+	last_lane_page_nr = -1;
+	last_lane_page = NULL;
+}
+
+// Return how far a value of nr_bytes bytes at the address is shifted in its word
+static int GetByteShift(long long address, int nr_bytes)
+{
+	return 8*(4 - nr_bytes - (int) (address & 3));
+}
+
+// Copy a region of the data memory into all lanes
+static void CopyDataMemoryToLanes(long long address, const unsigned char* bytes,
+	long nr_bytes, void* context)
+{
+	long i;
+	int l;
+
+	(void) context;
+	for (i = 0; i < nr_bytes; ++i)
+	{
+		uint32_t* words;
+		uint32_t value;
+
+		if (bytes[i] == 0)
+			continue;
+		words = GetLaneWords(address + i);
+		value = (uint32_t) bytes[i] << GetByteShift(address + i, 1);
+		for (l = 0; l < nr_lanes; ++l)
+			words[l] |= value;
+	}
+}
+
+// Execution -------------------------------------------------------------------
+
+// Take the lane out of the running group
+static void FinishLane(int lane, LaneStatus status)
+{
+	lanes[lane].status = status;
+	lanes[lane].pc = group_pc;
+	lanes[lane].cycles = group_cycles;
+	lanes[lane].nr_retired = group_retired;
+	active[lane] = 0;
+}
+
+static void FailLane(int lane, const char* format, ...)
+{
+	va_list args;
+
+	va_start(args, format);
+	vsnprintf(lanes[lane].error, MAX_ERROR_LENGTH, format, args);
+	va_end(args);
+	FinishLane(lane, LANE_FAILED);
+}
+
+// Fail the lanes in [first, end) whose results do not fit in 32 bits. Returns the
+// number of failed lanes.
+static int ValidateResults(int first, int end)
+{
+	int l, nr_invalid = 0;
+
+	// The common case, that all results are valid, is checked without branches
+	for (l = first; l < end; ++l)
+		nr_invalid += active[l] & ((results[l] < MIN_32_BIT_REGVALUE) | (results[l] >= (1LL << 32)));
+	if (nr_invalid == 0)
+		return 0;
+
+	for (l = first; l < end; ++l)
+	{
+		if (!active[l])
+			continue;
+		if (results[l] < MIN_32_BIT_REGVALUE)
+			FailLane(l, "Arithmetic underflow: %lld (value does not fit in 32 bits)", results[l]);
+		else if (results[l] >= (1LL << 32))
+			FailLane(l, "Arithmetic overflow: %lld (value does not fit in 32 bits)", results[l]);
+	}
+	return nr_invalid;
+}
+
+// Write the results to the register @a dest in the lanes of the running group
+static void WriteResults(int dest, int first, int end)
+{
+	long long* values;
+	int l;
+
+	// Register 0 is hardwired to 0
+	if (dest <= 0)
+		return;
+	values = &regs[dest*nr_lanes];
+	for (l = first; l < end; ++l)
+		values[l] = active[l] ? results[l] : values[l];
+}
+
+// Execute a branch whose ALU results have been computed. If the lanes disagree on
+// its outcome, the lanes that take the less common direction are split off into a
+// new group. Returns the number of lanes that were split off.
+static int ExecuteBranch(const Instr* instr, int first, int end, int nr_active)
+{
+	int taken_if_zero = instr->type == BEQ;
+	int penalty = IsEarlyBranchResolutionOn() ? 1 : 3;
+	int l, nr_taken = 0, nr_split = 0, group_taken;
+
+	for (l = first; l < end; ++l)
+	{
+		taken[l] = (results[l] == 0) == taken_if_zero;
+		nr_taken += active[l] & taken[l];
+	}
+
+	group_taken = nr_taken > 0;
+	if (nr_taken > 0 && nr_taken < nr_active)
+	{
+		// The group continues in the more common direction
+		group_taken = 2*nr_taken >= nr_active;
+		for (l = first; l < end; ++l)
+			if (active[l] && taken[l] != group_taken)
+			{
+				lanes[l].group = nr_groups;
+				lanes[l].pc = taken[l] ? instr->imm : group_pc + 4;
+				lanes[l].cycles = group_cycles + (taken[l] ? penalty : 0);
+				lanes[l].nr_retired = group_retired;
+				lanes[l].load_dest = DONT_CARE;
+				lanes[l].ex_dest = DONT_CARE;
+				lanes[l].mem_load_dest = taken[l] ? DONT_CARE : group_mem_load_dest;
+				active[l] = 0;
+				++nr_split;
+			}
+		pending_groups[nr_pending_groups++] = nr_groups++;
+	}
+
+	// The branch is resolved in the Mem stage, so a taken branch flushes the three
+	// instructions fetched after it. With early branch resolution, it is resolved in
+	// the ID stage, and only the instruction fetched after it is squashed.
+	if (group_taken)
+	{
+		group_cycles += penalty;
+		group_mem_load_dest = DONT_CARE;
+		group_pc = instr->imm;
+	}
+	else
+		group_pc += 4;
+	return nr_split;
+}
+
+// Execute jr or jalr. The lanes whose target differs from that of the first lane are
+// split off into new groups, where consecutive lanes with the same target share a
+// group. Returns the number of lanes that were split off.
+static int ExecuteIndirectJump(const DecodedInstr* decoded, int first, int end)
+{
+	const long long* targets = &regs[decoded->instr.rs*nr_lanes];
+	long long group_target = targets[first], split_target = DONT_CARE;
+	int l, nr_split = 0;
+
+	// jalr may link to the register that holds its target
+	for (l = first; l < end; ++l)
+		results[l] = targets[l];
+	for (l = first; l < end; ++l)
+		if (active[l] && decoded->dest > 0)
+			regs[decoded->dest*nr_lanes + l] = group_pc + 4;
+
+	for (l = first; l < end; ++l)
+		if (active[l] && results[l] != group_target)
+		{
+			if (nr_split == 0 || results[l] != split_target)
+			{
+				split_target = results[l];
+				pending_groups[nr_pending_groups++] = nr_groups++;
+			}
+			lanes[l].group = nr_groups - 1;
+			lanes[l].pc = results[l];
+			lanes[l].cycles = group_cycles + (results[l] != group_pc + 4 ? 3 : 0);
+			lanes[l].nr_retired = group_retired;
+			lanes[l].load_dest = DONT_CARE;
+			lanes[l].ex_dest = results[l] != group_pc + 4 ? DONT_CARE : group_ex_dest;
+			lanes[l].mem_load_dest = results[l] != group_pc + 4 ? DONT_CARE : group_mem_load_dest;
+			active[l] = 0;
+			++nr_split;
+		}
+
+	// The target is only known in the Mem stage, so the three instructions fetched
+	// after the jump are flushed unless they follow it
+	if (group_target != group_pc + 4)
+	{
+		group_cycles += 3;
+		group_ex_dest = group_mem_load_dest = DONT_CARE;
+	}
+	group_pc = group_target;
+	return nr_split;
+}
+
+// Return the number of cycles that the instruction @a decoded waits in the ID stage for
+// its operands. With early branch resolution, a branch waits until the comparator can
+// read them, which is one cycle for a result of the previous instruction, two if it
+// was loaded, and one for a value loaded by the instruction before it.
+static int GetStallCycles(const DecodedInstr* decoded)
+{
+	unsigned int read_mask = decoded->read_mask;
+
+	if (IsEarlyBranchResolutionOn() && (decoded->instr.type == BEQ || decoded->instr.type == BNE))
+	{
+		if (group_ex_dest != DONT_CARE && (read_mask & (1u << group_ex_dest)))
+			return group_load_dest == group_ex_dest ? 2 : 1;
+		return group_mem_load_dest != DONT_CARE && (read_mask & (1u << group_mem_load_dest)) ? 1 : 0;
+	}
+	return group_load_dest != DONT_CARE && (read_mask & (1u << group_load_dest)) ? 1 : 0;
+}
+
+// Execute a load or a store whose addresses have been computed by the ALU. Returns
+// the number of lanes that failed.
+static int ExecuteMemoryAccess(const DecodedInstr* decoded, int first, int end)
+{
+	InstrType type = decoded->instr.type;
+	int nr_bytes = type == LW || type == SW ? 4 : (type == LH || type == LHU || type == SH ? 2 : 1);
+	uint32_t mask = nr_bytes == 4 ? 0xFFFFFFFFu : (1u << 8*nr_bytes) - 1;
+	long long ds_start = GetDataSegmentStartingAddress(), ss_end = GetStackSegmentEndAddress();
+	int l, nr_failed = 0;
+
+	for (l = first; l < end; ++l)
+	{
+		long long address = results[l];
+
+		if (!active[l])
+			continue;
+		if (address < ds_start)
+			FailLane(l, "The address 0x%llx points below the data segment", address);
+		else if (address + nr_bytes >= ss_end)
+			FailLane(l, "The address 0x%llx points above the stack segment", address);
+		else if (address % nr_bytes != 0)
+			FailLane(l, "Address 0x%llx is not %d-byte aligned", address, nr_bytes);
+		else
+			continue;
+		++nr_failed;
+	}
+
+	if (decoded->category == STORE)
+	{
+		const long long* values = &regs[decoded->instr.rt*nr_lanes];
+		for (l = first; l < end; ++l)
+			if (active[l])
+			{
+				uint32_t* word = &GetLaneWords(results[l])[l];
+				int shift = GetByteShift(results[l], nr_bytes);
+				*word = (*word & ~(mask << shift)) | (((uint32_t) values[l] & mask) << shift);
+			}
+	}
+	else
+	{
+		int read_unsigned = type == LHU || type == LBU;
+		long long sign_bit = 1LL << (8*nr_bytes - 1);
+		for (l = first; l < end; ++l)
+			if (active[l])
+			{
+				long long value = (GetLaneWords(results[l])[l] >> GetByteShift(results[l], nr_bytes)) & mask;
+				if (!read_unsigned && (value & sign_bit) != 0)
+					value -= sign_bit << 1;
+				results[l] = value;
+			}
+		WriteResults(decoded->dest, first, end);
+	}
+	return nr_failed;
+}
+
+// Take the lanes of the running group out of it
+static void FinishGroup(LaneStatus status, int first, int end)
+{
+	int l;
+	for (l = first; l < end; ++l)
+		if (active[l])
+			FinishLane(l, status);
+}
+
+// Run the lanes of the group @a group until they have finished or been split off
+static void RunGroup(int group, long long max_cycles)
+{
+	long nr_instr;
+	const DecodedInstr* buf = GetDecodedInstrBuffer(&nr_instr);
+	long long text_start = GetTextSegmentStartingAddress();
+	int l, first = nr_lanes, end = 0, nr_active = 0;
+
+	for (l = 0; l < nr_lanes; ++l)
+	{
+		active[l] = lanes[l].group == group && lanes[l].status == LANE_RUNNING;
+		if (active[l])
+		{
+			if (first > l)
+				first = l;
+			end = l + 1;
+			++nr_active;
+		}
+	}
+	if (nr_active == 0)
+		return;
+	group_pc = lanes[first].pc;
+	group_cycles = lanes[first].cycles;
+	group_retired = lanes[first].nr_retired;
+	group_load_dest = lanes[first].load_dest;
+	group_ex_dest = lanes[first].ex_dest;
+	group_mem_load_dest = lanes[first].mem_load_dest;
+
+	while (nr_active > 0)
+	{
+		long long buf_ind = (group_pc - text_start) >> 2;
+		const DecodedInstr* decoded;
+		const Instr* instr;
+		int stall_cycles;
+
+		if (max_cycles > 0 && group_cycles >= max_cycles)
+		{
+			FinishGroup(LANE_STOPPED, first, end);
+			break;
+		}
+
+		// Addresses outside the buffer are validated by ReadDecodedFromInstrMemory()
+		if (buf_ind >= 0 && buf_ind < nr_instr && (group_pc & 3) == 0)
+			decoded = &buf[buf_ind];
+		else
+			decoded = ReadDecodedFromInstrMemory(group_pc);
+		instr = &decoded->instr;
+
+		// Each instruction takes one cycle, plus the cycles it waits for its operands.
+		// If it waited, a bubble separates it from the instruction before it.
+		stall_cycles = GetStallCycles(decoded);
+		group_cycles += 1 + stall_cycles;
+		group_mem_load_dest = stall_cycles > 0 ? DONT_CARE : group_load_dest;
+		group_load_dest = decoded->category == LOAD ? decoded->dest : DONT_CARE;
+		group_ex_dest = decoded->dest;
+
+		if (instr->type == NOP)
+		{
+			group_pc += 4;
+			continue;
+		}
+		++group_retired;
+		if (instr->type == SYSCALL)
+		{
+			// The syscall terminates the program when it reaches the WB stage
+			group_cycles += 4;
+			FinishGroup(LANE_TERMINATED, first, end);
+			break;
+		}
+		if (instr->type == J || instr->type == JAL)
+		{
+			// The instruction fetched after the jump is squashed
+			++group_cycles;
+			group_ex_dest = group_mem_load_dest = DONT_CARE;
+			if (instr->type == JAL)
+			{
+				for (l = first; l < end; ++l)
+					results[l] = group_pc + 4;
+				WriteResults(RA, first, end);
+			}
+			group_pc = instr->imm;
+			continue;
+		}
+		if (IsIndirectJump(instr->type))
+		{
+			nr_active -= ExecuteIndirectJump(decoded, first, end);
+			continue;
+		}
+
+		ComputeALUResults(decoded->alu_op, instr,
+			instr->rs != DONT_CARE ? &regs[instr->rs*nr_lanes] : dont_care_values,
+			instr->rt != DONT_CARE ? &regs[instr->rt*nr_lanes] : dont_care_values,
+			instr->imm, results, first, end);
+		nr_active -= ValidateResults(first, end);
+		if (nr_active == 0)
+			break;
+
+		if (instr->type == BEQ || instr->type == BNE)
+		{
+			nr_active -= ExecuteBranch(instr, first, end, nr_active);
+			continue;
+		}
+		// lui is in the load category, but does not access the memory
+		if ((decoded->category == LOAD && instr->type != LUI) || decoded->category == STORE)
+			nr_active -= ExecuteMemoryAccess(decoded, first, end);
+		else
+			WriteResults(decoded->dest, first, end);
+		group_pc += 4;
+	}
+}
+
+// Input -----------------------------------------------------------------------
+
+// Return whether the line holds a data set, and remove any comment from it
+static int IsDataSet(char* line)
+{
+	char* comment = strchr(line, '#');
+	if (comment == line)
+		return 0;
+	if (comment != NULL)
+		*comment = '\0';
+	return 1;
+}
+
+static int ParseNumber(const char* str, long long* value)
+{
+	char* str_end;
+	if (*str == '\0')
+		return 0;
+	*value = strtoll(str, &str_end, 0);
+	return *str_end == '\0';
+}
+
+// Parse an assignment of an input value to the lane @a lane. Returns 0 on success.
+static int ParseAssignment(char* assignment, int lane)
+{
+	char* value_str = strchr(assignment, '=');
+	long long value, address;
+	int r;
+
+	if (value_str == NULL)
+		return 1;
+	*value_str++ = '\0';
+	if (!ParseNumber(value_str, &value) || value < MIN_32_BIT_REGVALUE || value >= (1LL << 32))
+		return 1;
+
+	if (assignment[0] == '$')
+	{
+		const char* name = assignment + 1;
+		long long nr;
+
+		if (ParseNumber(name, &nr))
+			r = IsValidRegisterNr((int) nr) && nr == (int) nr ? (int) nr : DONT_CARE;
+		else
+			for (r = 31; r >= 0 && strcmp(name, RegNameAsString(r)) != 0; --r)
+				;
+		// Register 0 is hardwired to 0
+		if (r <= 0)
+			return 1;
+		regs[r*nr_lanes + lane] = value;
+		return 0;
+	}
+
+	if (!ParseNumber(assignment, &address))
+	{
+		if (!SymbolTableHasSymbol(assignment))
+			return 1;
+		address = LookupInSymbolTable(assignment);
+	}
+	if (address < GetDataSegmentStartingAddress() || address + 4 >= GetStackSegmentEndAddress()
+		|| address % 4 != 0)
+		return 1;
+	GetLaneWords(address)[lane] = (uint32_t) value;
+	return 0;
+}
+
+// Public functions -------------------------------------------------------------------
+
+int InitBatch(const char* filename)
+{
+	FILE* file = fopen(filename, "r");
+	char line[MAX_LINE_LENGTH];
+	long long initial_regs[32];
+	int l, r, line_nr;
+
+	if (file == NULL)
+	{
+		fprintf(stderr, "Could not open file %s for reading\n", filename);
+		return 1;
+	}
+
+	// There is one lane per data set
+	nr_lanes = 0;
+	while (fgets(line, MAX_LINE_LENGTH, file) != NULL)
+		if (IsDataSet(line))
+			++nr_lanes;
+	if (nr_lanes == 0)
+	{
+		fprintf(stderr, "There are no input data sets in %s\n", filename);
+		fclose(file);
+		return 1;
+	}
+
+	free(lanes);
+	free(regs);
+	free(active);
+	free(results);
+	free(taken);
+	free(dont_care_values);
+	free(pending_groups);
+	FreeLaneMemory();
+	lanes = (Lane*) calloc(nr_lanes, sizeof(Lane));
+	regs = (long long*) calloc(32 * (size_t) nr_lanes, sizeof(long long));
+	active = (unsigned char*) calloc(nr_lanes, 1);
+	results = (long long*) calloc(nr_lanes, sizeof(long long));
+	taken = (unsigned char*) calloc(nr_lanes, 1);
+	dont_care_values = (long long*) malloc(nr_lanes * sizeof(long long));
+	pending_groups = (int*) malloc(nr_lanes * sizeof(int));
+
+	// All lanes start with the program's initial state
+	ReadAllFromRegisterFile(initial_regs);
+	for (l = 0; l < nr_lanes; ++l)
+	{
+		lanes[l].status = LANE_RUNNING;
+		lanes[l].pc = LookupInSymbolTable("__start");
+		lanes[l].load_dest = lanes[l].ex_dest = lanes[l].mem_load_dest = DONT_CARE;
+		dont_care_values[l] = DONT_CARE;
+		for (r = 0; r < 32; ++r)
+			regs[r*nr_lanes + l] = initial_regs[r];
+	}
+	VisitDataMemory(CopyDataMemoryToLanes, NULL);
+
+	rewind(file);
+	for (l = 0, line_nr = 1; fgets(line, MAX_LINE_LENGTH, file) != NULL; ++line_nr)
+	{
+		char* assignment;
+
+		if (!IsDataSet(line))
+			continue;
+		for (assignment = strtok(line, " \t\r\n"); assignment != NULL; assignment = strtok(NULL, " \t\r\n"))
+			if (ParseAssignment(assignment, l) != 0)
+			{
+				fprintf(stderr, "%s, line %d: invalid input value %s\n", filename, line_nr, assignment);
+				fclose(file);
+				return 1;
+			}
+		++l;
+	}
+	fclose(file);
+	nr_groups = 0;
+	return 0;
+}
+
+void RunBatch(long long max_cycles)
+{
+	// All lanes start in the same group
+	nr_groups = 1;
+	nr_pending_groups = 0;
+	RunGroup(0, max_cycles);
+	while (nr_pending_groups > 0)
+		RunGroup(pending_groups[--nr_pending_groups], max_cycles);
+}
+
+int GetNrOfLanes()
+{
+	return nr_lanes;
+}
+
+int GetNrOfLaneGroups()
+{
+	return nr_groups;
+}
+
+LaneStatus GetLaneStatus(int lane)
+{
+	return lanes[lane].status;
+}
+
+const char* GetLaneError(int lane)
+{
+	return lanes[lane].error;
+}
+
+long long GetLaneCycles(int lane)
+{
+	return lanes[lane].cycles;
+}
+
+long long GetLaneRetiredInstructions(int lane)
+{
+	return lanes[lane].nr_retired;
+}
+
+void ReadAllFromLaneRegisters(int lane, long long values[32])
+{
+	int r;
+	for (r = 0; r < 32; ++r)
+		values[r] = regs[r*nr_lanes + lane];
+}
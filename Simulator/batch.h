@@ -0,0 +1,80 @@
+/** @file batch.h
+	Lock-step simulation of one program over many input data sets.
+
+	Each input data set is simulated in its own lane, which has its own registers and
+	data memory. The registers and the data memory of all lanes are stored in
+	structure-of-arrays layout: the values that the lanes hold in the same register or
+	the same memory word are next to each other. A group of lanes that are at the same
+	instruction executes it together, with loops over the lanes that the compiler can
+	vectorize. All lanes start in one group. When the lanes of a group disagree on the
+	outcome of a branch, the lanes that take the less common direction are split off
+	into a new group, which is run when the current group has finished. A group of a
+	single lane is plain scalar execution.
+
+	The timing of the pipeline only depends on the path that the program takes, so the
+	cycle count of each lane is computed from its path with the rules of the pipeline:
+	one cycle per instruction, one more for a load-use stall and for the instruction
+	squashed after a jump, three more for the instructions flushed after a taken
+	branch, and four for draining the pipeline after the final syscall. With early
+	branch resolution, a taken branch costs one more cycle instead of three, and a branch
+	waits for its operands like in the pipeline. See SetEarlyBranchResolution(). */
+
+#ifndef BATCH_H_INCL
+#define BATCH_H_INCL
+
+/** The state of a lane */
+typedef enum LaneStatus
+{
+	/** The lane has not finished yet */
+	LANE_RUNNING,
+
+	/** The program terminated with a syscall */
+	LANE_TERMINATED,
+
+	/** The lane reached the cycle limit before the program terminated */
+	LANE_STOPPED,
+
+	/** The program caused a runtime error */
+	LANE_FAILED
+}
+LaneStatus;
+
+/** Read the input data sets from the text file @a filename, and set up one lane per
+	data set, starting with the program's initial registers and data memory. Each
+	line holds a data set, as assignments separated by whitespace, and an empty line
+	runs the program unchanged. $name=value or $number=value sets a register, and
+	address=value sets the word at an address in the data memory, where the address
+	may also be a data label. Text after a # is a comment, and lines that start with
+	a # are skipped.
+	@pre InitPipeline() has been called
+	@return 0 if the file was read, 1 otherwise */
+int InitBatch(const char* filename);
+
+/** Run all lanes until their programs have terminated
+	@param max_cycles A lane is stopped when its cycle count reaches this, unless it
+		is 0 */
+void RunBatch(long long max_cycles);
+
+/** Return the number of lanes */
+int GetNrOfLanes();
+
+/** Return the number of groups of lanes that were run, which is one more than the
+	number of times that lanes were split off at a branch */
+int GetNrOfLaneGroups();
+
+/** Return the status of the lane @a lane */
+LaneStatus GetLaneStatus(int lane);
+
+/** Return the error message of the lane @a lane, if its status is LANE_FAILED */
+const char* GetLaneError(int lane);
+
+/** Return the number of clock cycles that the pipeline takes for the lane @a lane */
+long long GetLaneCycles(int lane);
+
+/** Return the number of instructions retired by the lane @a lane */
+long long GetLaneRetiredInstructions(int lane);
+
+/** Copy the contents of the registers of the lane @a lane into @a values */
+void ReadAllFromLaneRegisters(int lane, long long values[32]);
+
+#endif // ifndef BATCH_H_INCL
@@ -0,0 +1,235 @@
+#include "branch_predictor.h"
+#include <stdlib.h>
+#include <string.h>
+
+// The state of a 2-bit saturating counter from which a branch is predicted taken
+#define WEAKLY_TAKEN 2
+
+// The state of the predictor that changes as branches are resolved
+typedef struct PredictorState
+{
+	// The last outcomes (1-bit) or the counters of the branches (bimodal and tournament)
+	unsigned char local[MAX_PREDICTOR_TABLE_SIZE];
+
+	// The counters of gshare, indexed with the global history
+	unsigned char global[MAX_PREDICTOR_TABLE_SIZE];
+
+	// The counters of the tournament predictor that choose gshare from WEAKLY_TAKEN on
+	unsigned char chooser[MAX_PREDICTOR_TABLE_SIZE];
+
+	// The outcomes of the last branches, with the last one in bit 0
+	unsigned int history;
+
+	BranchPredictorStats stats;
+}
+PredictorState;
+
+static const char* const PREDICTOR_NAMES[] = { "not-taken", "btfn", "1-bit", "bimodal", "gshare", "tournament" };
+
+static const BranchPredictorConfig DEFAULT_PREDICTOR_CONFIG = { PREDICT_NOT_TAKEN, 4096, 12 };
+
+static int configured;
+static BranchPredictorConfig config = { PREDICT_NOT_TAKEN, 4096, 12 };
+static PredictorState state, saved_state;
+
+static int IsPowerOf2(long long n)
+{
+	return n > 0 && (n & (n - 1)) == 0;
+}
+
+static int ParseParameter(const char* name, const char* value, BranchPredictorConfig* parsed)
+{
+	char* end;
+	long n = strtol(value, &end, 10);
+
+	if (end == value || *end != '\0')
+		return 1;
+	if (strcmp(name, "entries") == 0 && IsPowerOf2(n) && n <= MAX_PREDICTOR_TABLE_SIZE)
+		parsed->table_size = (int) n;
+	else if (strcmp(name, "history") == 0 && n >= 0 && n <= 16)
+		parsed->history_bits = (int) n;
+	else
+		return 1;
+	return 0;
+}
+
+static int LocalIndex(long long pc)
+{
+	return (int) ((pc >> 2) & (config.table_size - 1));
+}
+
+static int GlobalIndex(long long pc)
+{
+	unsigned int history = state.history & ((1u << config.history_bits) - 1);
+	return (int) (((pc >> 2) ^ history) & (config.table_size - 1));
+}
+
+static void UpdateCounter(unsigned char* counter, int taken)
+{
+	if (taken && *counter < 3)
+		++*counter;
+	else if (!taken && *counter > 0)
+		--*counter;
+}
+
+// Public functions -------------------------------------------------------------------
+
+void GetDefaultBranchPredictorConfig(BranchPredictorConfig* default_config)
+{
+	*default_config = DEFAULT_PREDICTOR_CONFIG;
+}
+
+int ParseBranchPredictorConfig(const char* description, BranchPredictorConfig* predictor_config)
+{
+	BranchPredictorConfig parsed = *predictor_config;
+	char* copy = (char*) malloc(strlen(description) + 1);
+	char* parameter;
+	int failed = 1;
+	int k;
+
+	strcpy(copy, description);
+	parameter = strtok(copy, ",");
+	for (k = PREDICT_NOT_TAKEN; k <= PREDICT_TOURNAMENT && parameter != NULL; ++k)
+		if (strcmp(parameter, PREDICTOR_NAMES[k]) == 0)
+		{
+			parsed.kind = (BranchPredictorKind) k;
+			failed = 0;
+		}
+	for (parameter = strtok(NULL, ","); parameter != NULL && !failed; parameter = strtok(NULL, ","))
+	{
+		char* value = strchr(parameter, '=');
+		if (value == NULL)
+			failed = 1;
+		else
+		{
+			*value++ = '\0';
+			failed = ParseParameter(parameter, value, &parsed);
+		}
+	}
+	free(copy);
+
+	if (!failed)
+		*predictor_config = parsed;
+	return failed;
+}
+
+void ConfigureBranchPredictor(const BranchPredictorConfig* predictor_config)
+{
+	configured = 1;
+	config = *predictor_config;
+	InitBranchPredictor();
+}
+
+const BranchPredictorConfig* GetBranchPredictorConfig()
+{
+	return &config;
+}
+
+int IsBranchPredictorConfigured()
+{
+	return configured;
+}
+
+const char* GetBranchPredictorName(BranchPredictorKind kind)
+{
+	return PREDICTOR_NAMES[kind];
+}
+
+void InitBranchPredictor()
+{
+	// The counters start out weakly not taken, and the chooser weakly prefers bimodal
+	memset(state.local, config.kind == PREDICT_ONE_BIT ? 0 : WEAKLY_TAKEN - 1, sizeof(state.local));
+	memset(state.global, WEAKLY_TAKEN - 1, sizeof(state.global));
+	memset(state.chooser, WEAKLY_TAKEN - 1, sizeof(state.chooser));
+	state.history = 0;
+	memset(&state.stats, 0, sizeof(state.stats));
+}
+
+int PredictBranch(long long pc, long long target)
+{
+	switch (config.kind)
+	{
+	case PREDICT_BTFN:
+		return target <= pc;
+	case PREDICT_ONE_BIT:
+		return state.local[LocalIndex(pc)];
+	case PREDICT_BIMODAL:
+		return state.local[LocalIndex(pc)] >= WEAKLY_TAKEN;
+	case PREDICT_GSHARE:
+		return state.global[GlobalIndex(pc)] >= WEAKLY_TAKEN;
+	case PREDICT_TOURNAMENT:
+		if (state.chooser[LocalIndex(pc)] >= WEAKLY_TAKEN)
+			return state.global[GlobalIndex(pc)] >= WEAKLY_TAKEN;
+		return state.local[LocalIndex(pc)] >= WEAKLY_TAKEN;
+	default:
+		return 0;
+	}
+}
+
+void ResolveBranch(long long pc, int taken, int mispredicted)
+{
+	unsigned char* local = &state.local[LocalIndex(pc)];
+	unsigned char* global = &state.global[GlobalIndex(pc)];
+
+	++state.stats.branches;
+	if (taken)
+		++state.stats.taken;
+	if (mispredicted)
+		++state.stats.mispredictions;
+
+	switch (config.kind)
+	{
+	case PREDICT_ONE_BIT:
+		*local = (unsigned char) taken;
+		break;
+	case PREDICT_BIMODAL:
+		UpdateCounter(local, taken);
+		break;
+	case PREDICT_GSHARE:
+		UpdateCounter(global, taken);
+		break;
+	case PREDICT_TOURNAMENT:
+	{
+		// The chooser moves towards the component that was right, if only one was
+		int local_right = (*local >= WEAKLY_TAKEN) == taken;
+		int global_right = (*global >= WEAKLY_TAKEN) == taken;
+		if (local_right != global_right)
+			UpdateCounter(&state.chooser[LocalIndex(pc)], global_right);
+		UpdateCounter(local, taken);
+		UpdateCounter(global, taken);
+		break;
+	}
+	default:
+		break;
+	}
+	state.history = (state.history << 1) | (unsigned int) taken;
+}
+
+const BranchPredictorStats* GetBranchPredictorStats()
+{
+	return &state.stats;
+}
+
+void SaveBranchPredictorState()
+{
+	saved_state = state;
+}
+
+void RestoreBranchPredictorState()
+{
+	state = saved_state;
+}
+
+void WriteBranchPredictorCheckpoint(CheckpointState* checkpoint)
+{
+	PutCheckpointState(checkpoint, &configured, sizeof(configured));
+	PutCheckpointState(checkpoint, &config, sizeof(config));
+	PutCheckpointState(checkpoint, &state, sizeof(state));
+}
+
+void ReadBranchPredictorCheckpoint(CheckpointState* checkpoint)
+{
+	CheckCheckpointConfig(checkpoint, &configured, sizeof(configured));
+	CheckCheckpointConfig(checkpoint, &config, sizeof(config));
+	GetCheckpointState(checkpoint, &state, sizeof(state));
+}
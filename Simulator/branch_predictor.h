@@ -0,0 +1,124 @@
+/** @file branch_predictor.h
+	Branch direction predictors for the conditional branches BEQ and BNE.
+
+	The predictor is looked up when a branch is fetched. A branch that is predicted
+	taken redirects the fetch to its target when it reaches the ID stage, where its
+	target is known, so the instruction fetched after it is squashed. A branch is
+	resolved in the Mem stage, and only a misprediction flushes the ID, Ex and Mem
+	stages and restarts the fetch on the right path. The predictor is updated when the
+	branch resolves, and so is the global history of gshare and the tournament
+	predictor: the predictions are not made with a speculative history.
+
+	The static not-taken predictor, which is the default, is the behaviour of the
+	pipeline without branch prediction. */
+
+#ifndef BRANCH_PREDICTOR_H_INCL
+#define BRANCH_PREDICTOR_H_INCL
+
+#include "checkpoint.h"
+
+/** The predictors */
+typedef enum BranchPredictorKind
+{
+	/** Predict every branch not taken */
+	PREDICT_NOT_TAKEN,
+
+	/** Predict backward branches taken and forward branches not taken */
+	PREDICT_BTFN,
+
+	/** A table of the last outcome of the branches */
+	PREDICT_ONE_BIT,
+
+	/** A table of 2-bit saturating counters, indexed by the address of the branch */
+	PREDICT_BIMODAL,
+
+	/** A table of 2-bit saturating counters, indexed by the address of the branch
+		exclusive-ored with the global history of branch outcomes */
+	PREDICT_GSHARE,
+
+	/** A bimodal and a gshare predictor, with a table of 2-bit counters, indexed by
+		the address of the branch, that chooses between them */
+	PREDICT_TOURNAMENT
+}
+BranchPredictorKind;
+
+/** The maximum number of entries in a table of a predictor */
+#define MAX_PREDICTOR_TABLE_SIZE 65536
+
+/** The parameters of a predictor */
+typedef struct BranchPredictorConfig
+{
+	BranchPredictorKind kind;
+
+	/** The number of entries in each table */
+	int table_size;
+
+	/** The number of branch outcomes in the global history */
+	int history_bits;
+}
+BranchPredictorConfig;
+
+/** The event counts of the predictor */
+typedef struct BranchPredictorStats
+{
+	/** The number of branches that were resolved */
+	long long branches;
+
+	long long taken;
+	long long mispredictions;
+}
+BranchPredictorStats;
+
+/** Set @a config to the default parameters of a predictor: the static not-taken
+	predictor, tables of 4096 entries and 12 bits of history */
+void GetDefaultBranchPredictorConfig(BranchPredictorConfig* config);
+
+/** Parse a predictor description, the kind (not-taken, btfn, 1-bit, bimodal, gshare or
+	tournament) optionally followed by a comma-separated list of parameters such as
+	"gshare,entries=4096,history=12", into @a config. The parameters that are not given
+	keep their values in @a config. The number of entries must be a power of 2.
+	@return 0 if the description is valid, 1 otherwise */
+int ParseBranchPredictorConfig(const char* description, BranchPredictorConfig* config);
+
+/** Use the predictor @a config. It starts out untrained. */
+void ConfigureBranchPredictor(const BranchPredictorConfig* config);
+
+/** Return the parameters of the predictor */
+const BranchPredictorConfig* GetBranchPredictorConfig();
+
+/** Return whether a predictor was set with ConfigureBranchPredictor() */
+int IsBranchPredictorConfigured();
+
+/** Return the name of the predictor @a kind, e.g. "gshare" */
+const char* GetBranchPredictorName(BranchPredictorKind kind);
+
+/** Reset the tables, the history and the statistics of the predictor */
+void InitBranchPredictor();
+
+/** Return whether the branch at the address @a pc to the address @a target is predicted
+	taken */
+int PredictBranch(long long pc, long long target);
+
+/** Train the predictor with the outcome of the branch at the address @a pc, which was
+	@a taken and was @a mispredicted or not */
+void ResolveBranch(long long pc, int taken, int mispredicted);
+
+/** Return the event counts of the predictor */
+const BranchPredictorStats* GetBranchPredictorStats();
+
+/** Save the tables, the history and the statistics of the predictor. Used by
+	SaveSnapshot(). */
+void SaveBranchPredictorState();
+
+/** Restore the state saved by SaveBranchPredictorState() */
+void RestoreBranchPredictorState();
+
+/** Append the configuration, the tables, the history and the statistics of the
+	predictor to the state of a checkpoint. Used by SaveCheckpoint(). */
+void WriteBranchPredictorCheckpoint(CheckpointState* state);
+
+/** Restore the state written by WriteBranchPredictorCheckpoint(). Sets state->failed
+	if the predictor was configured differently. */
+void ReadBranchPredictorCheckpoint(CheckpointState* state);
+
+#endif // ifndef BRANCH_PREDICTOR_H_INCL
@@ -0,0 +1,214 @@
+#include "btb.h"
+#include "branch_predictor.h"
+#include "instructions.h"
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct BTBEntry
+{
+	int valid;
+
+	/** The address of the branch or jump */
+	long long pc;
+
+	long long target;
+	int conditional;
+
+	/** When the entry was last used */
+	long long stamp;
+}
+BTBEntry;
+
+static const BTBConfig DEFAULT_BTB_CONFIG = { 64, 4 };
+
+static int configured;
+static BTBConfig config = { 64, 4 };
+static int nr_sets = 16;
+
+// The entries of set s are entries[s*associativity] to entries[(s + 1)*associativity - 1]
+static BTBEntry entries[MAX_BTB_SIZE];
+static long long use_clock;
+static BTBStats stats;
+
+// The state saved by SaveBTBState()
+static BTBEntry saved_entries[MAX_BTB_SIZE];
+static long long saved_clock;
+static BTBStats saved_stats;
+
+static int IsPowerOf2(long long n)
+{
+	return n > 0 && (n & (n - 1)) == 0;
+}
+
+static int ParseParameter(const char* name, const char* value, BTBConfig* parsed)
+{
+	char* end;
+	long n = strtol(value, &end, 10);
+
+	if (strcmp(name, "assoc") == 0 && strcmp(value, "full") == 0)
+		parsed->associativity = 0;
+	else if (end == value || *end != '\0')
+		return 1;
+	else if (strcmp(name, "entries") == 0 && IsPowerOf2(n) && n <= MAX_BTB_SIZE)
+		parsed->nr_entries = (int) n;
+	else if (strcmp(name, "assoc") == 0 && IsPowerOf2(n) && n <= MAX_BTB_SIZE)
+		parsed->associativity = (int) n;
+	else
+		return 1;
+	return 0;
+}
+
+// Return the entry of the instruction at the address pc, or NULL if it is not in the BTB
+static BTBEntry* FindEntry(long long pc)
+{
+	BTBEntry* set = &entries[((pc >> 2) & (nr_sets - 1)) * config.associativity];
+	int e;
+
+	for (e = 0; e < config.associativity; ++e)
+		if (set[e].valid && set[e].pc == pc)
+			return &set[e];
+	return NULL;
+}
+
+// Public functions -------------------------------------------------------------------
+
+void GetDefaultBTBConfig(BTBConfig* default_config)
+{
+	*default_config = DEFAULT_BTB_CONFIG;
+}
+
+int ParseBTBConfig(const char* description, BTBConfig* btb_config)
+{
+	BTBConfig parsed = *btb_config;
+	char* copy = (char*) malloc(strlen(description) + 1);
+	char* parameter;
+	int failed = 0;
+
+	strcpy(copy, description);
+	for (parameter = strtok(copy, ","); parameter != NULL && !failed; parameter = strtok(NULL, ","))
+	{
+		char* value = strchr(parameter, '=');
+		if (value == NULL)
+			failed = 1;
+		else
+		{
+			*value++ = '\0';
+			failed = ParseParameter(parameter, value, &parsed);
+		}
+	}
+	free(copy);
+	if (failed)
+		return 1;
+
+	if (parsed.associativity == 0 || parsed.associativity > parsed.nr_entries)
+		parsed.associativity = parsed.nr_entries;
+	*btb_config = parsed;
+	return 0;
+}
+
+void ConfigureBTB(const BTBConfig* btb_config)
+{
+	configured = 1;
+	config = *btb_config;
+	nr_sets = config.nr_entries / config.associativity;
+	InitBTB();
+}
+
+int IsBTBConfigured()
+{
+	return configured;
+}
+
+void InitBTB()
+{
+	memset(entries, 0, sizeof(entries));
+	use_clock = 0;
+	memset(&stats, 0, sizeof(stats));
+}
+
+long long LookupBTB(long long pc)
+{
+	BTBEntry* entry;
+
+	if (!configured)
+		return DONT_CARE;
+
+	entry = FindEntry(pc);
+	if (entry == NULL)
+	{
+		++stats.misses;
+		return DONT_CARE;
+	}
+	++stats.hits;
+	entry->stamp = ++use_clock;
+
+	// The target of a branch is only used if the branch is predicted taken
+	if (entry->conditional && !PredictBranch(pc, entry->target))
+		return DONT_CARE;
+	++stats.redirects;
+	return entry->target;
+}
+
+void UpdateBTB(long long pc, long long target, int conditional)
+{
+	BTBEntry* set;
+	BTBEntry* victim;
+	int e;
+
+	if (!configured || FindEntry(pc) != NULL)
+		return;
+
+	// Replace the least recently used entry of the set
+	set = &entries[((pc >> 2) & (nr_sets - 1)) * config.associativity];
+	victim = set;
+	for (e = 0; e < config.associativity; ++e)
+		if (!set[e].valid || (victim->valid && set[e].stamp < victim->stamp))
+			victim = &set[e];
+	victim->valid = 1;
+	victim->pc = pc;
+	victim->target = target;
+	victim->conditional = conditional;
+	victim->stamp = ++use_clock;
+}
+
+void CountEliminatedBubble()
+{
+	++stats.bubbles_eliminated;
+}
+
+const BTBStats* GetBTBStats()
+{
+	return &stats;
+}
+
+void SaveBTBState()
+{
+	memcpy(saved_entries, entries, sizeof(entries));
+	saved_clock = use_clock;
+	saved_stats = stats;
+}
+
+void RestoreBTBState()
+{
+	memcpy(entries, saved_entries, sizeof(entries));
+	use_clock = saved_clock;
+	stats = saved_stats;
+}
+
+void WriteBTBCheckpoint(CheckpointState* state)
+{
+	PutCheckpointState(state, &configured, sizeof(configured));
+	PutCheckpointState(state, &config, sizeof(config));
+	PutCheckpointState(state, entries, sizeof(entries));
+	PutCheckpointState(state, &use_clock, sizeof(use_clock));
+	PutCheckpointState(state, &stats, sizeof(stats));
+}
+
+void ReadBTBCheckpoint(CheckpointState* state)
+{
+	CheckCheckpointConfig(state, &configured, sizeof(configured));
+	CheckCheckpointConfig(state, &config, sizeof(config));
+	GetCheckpointState(state, entries, sizeof(entries));
+	GetCheckpointState(state, &use_clock, sizeof(use_clock));
+	GetCheckpointState(state, &stats, sizeof(stats));
+}
@@ -0,0 +1,96 @@
+/** @file btb.h
+	A branch target buffer, which lets the IF stage redirect the fetch after jumps and
+	taken branches in the cycle they are fetched.
+
+	Without a BTB, a jump or a branch predicted taken is only recognized in the ID
+	stage, so the instruction fetched after it is squashed. The BTB is looked up with
+	the address of every instruction that is fetched. It holds the targets of the jumps
+	that were decoded and of the branches that were taken. On a hit for a jump, the next
+	instruction is fetched from the target. On a hit for a branch, the branch predictor
+	is consulted, and the next instruction is fetched from the target if it predicts the
+	branch taken. The targets in the BTB are the ones the instructions really have, since
+	the code never changes. */
+
+#ifndef BTB_H_INCL
+#define BTB_H_INCL
+
+#include "checkpoint.h"
+
+/** The maximum number of entries in the BTB */
+#define MAX_BTB_SIZE 4096
+
+/** The parameters of the BTB */
+typedef struct BTBConfig
+{
+	/** The number of entries */
+	int nr_entries;
+
+	/** The number of entries in a set */
+	int associativity;
+}
+BTBConfig;
+
+/** The event counts of the BTB */
+typedef struct BTBStats
+{
+	long long hits;
+	long long misses;
+
+	/** The number of hits after which the fetch continued at the target */
+	long long redirects;
+
+	/** The number of those jumps and branches that were neither flushed on the wrong
+		path nor mispredicted, each of which saved the bubble of a redirect from the ID
+		stage */
+	long long bubbles_eliminated;
+}
+BTBStats;
+
+/** Set @a config to the default parameters of the BTB: 64 entries, 4-way set
+	associative */
+void GetDefaultBTBConfig(BTBConfig* config);
+
+/** Parse a comma-separated list of parameters, such as "entries=256,assoc=full", into
+	@a config. The parameters that are not given keep their values in @a config.
+	@return 0 if the description is valid, 1 otherwise */
+int ParseBTBConfig(const char* description, BTBConfig* config);
+
+/** Add the BTB @a config to the pipeline. It starts out empty. */
+void ConfigureBTB(const BTBConfig* config);
+
+/** Return whether the BTB has been added with ConfigureBTB() */
+int IsBTBConfigured();
+
+/** Empty the BTB and reset its statistics */
+void InitBTB();
+
+/** Look up the instruction fetched from the address @a pc
+	@return The address to fetch the next instruction from, if the BTB redirects the
+		fetch, and DONT_CARE otherwise */
+long long LookupBTB(long long pc);
+
+/** Record that the instruction at the address @a pc, which is a @a conditional branch
+	or a jump, continued at the address @a target */
+void UpdateBTB(long long pc, long long target, int conditional);
+
+/** Record that a jump or branch that the BTB redirected the fetch for has completed */
+void CountEliminatedBubble();
+
+/** Return the event counts of the BTB */
+const BTBStats* GetBTBStats();
+
+/** Save the contents and the statistics of the BTB. Used by SaveSnapshot(). */
+void SaveBTBState();
+
+/** Restore the state saved by SaveBTBState() */
+void RestoreBTBState();
+
+/** Append the configuration, the contents and the statistics of the BTB to the state
+	of a checkpoint. Used by SaveCheckpoint(). */
+void WriteBTBCheckpoint(CheckpointState* state);
+
+/** Restore the state written by WriteBTBCheckpoint(). Sets state->failed if the BTB
+	was configured differently. */
+void ReadBTBCheckpoint(CheckpointState* state);
+
+#endif // ifndef BTB_H_INCL
@@ -0,0 +1,906 @@
+#include "cache.h"
+#include "dram.h"
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+typedef struct CacheLine
+{
+	/** The address of the line divided by the line size */
+	long long line_nr;
+
+	int valid;
+	int dirty;
+
+	/** When the line was last used (LRU) or brought in (FIFO) */
+	long long stamp;
+
+	/** Whether the line was brought in by a prefetch and has not been used since */
+	int prefetched;
+
+	/** The cycle in which the data of a prefetched line arrives */
+	long long ready_cycle;
+}
+CacheLine;
+
+// The state of an instruction in the reference prediction table of a stride prefetcher
+typedef enum StrideState
+{
+	STRIDE_INITIAL,
+	STRIDE_TRANSIENT,
+	STRIDE_STEADY,
+	STRIDE_NO_PREDICTION
+}
+StrideState;
+
+typedef struct StrideEntry
+{
+	int valid;
+
+	/** The address of the load or store */
+	long long pc;
+
+	long long last_address;
+	long long stride;
+	StrideState state;
+}
+StrideEntry;
+
+typedef struct StreamBuffer
+{
+	/** The lines in the buffer, with the head first, and the cycles in which they arrive */
+	long long line_nrs[MAX_STREAM_BUFFER_DEPTH];
+	long long ready_cycles[MAX_STREAM_BUFFER_DEPTH];
+	int count;
+
+	/** The line that is prefetched next */
+	long long next_line_nr;
+
+	/** When the buffer was last used */
+	long long stamp;
+}
+StreamBuffer;
+
+// The size of the table of lines that were evicted by prefetches
+#define POLLUTION_FILTER_SIZE 1024
+
+typedef struct Prefetcher
+{
+	PrefetcherConfig config;
+	StrideEntry table[MAX_STRIDE_TABLE_SIZE];
+	StreamBuffer buffers[MAX_NR_OF_STREAM_BUFFERS];
+
+	// For each entry, 1 plus the number of the last line that mapped to it and was
+	// evicted by a prefetch before it was missed on again, or 0
+	long long polluted[POLLUTION_FILTER_SIZE];
+
+	PrefetchStats stats;
+}
+Prefetcher;
+
+typedef struct Cache
+{
+	int configured;
+	CacheConfig config;
+	int line_bits;
+	int nr_sets;
+
+	// The lines of set s are lines[s*associativity] to lines[(s + 1)*associativity - 1]
+	CacheLine* lines;
+	long long clock;
+	unsigned int random_state;
+	CacheStats stats;
+	Prefetcher prefetcher;
+
+	// The state saved by SaveCacheState()
+	CacheLine* saved_lines;
+	long long saved_clock;
+	unsigned int saved_random_state;
+	CacheStats saved_stats;
+	Prefetcher saved_prefetcher;
+}
+Cache;
+
+// A miss status holding register of the L1 data cache
+typedef struct MSHR
+{
+	/** The line being fetched, as in CacheLine */
+	long long line_nr;
+
+	/** The first cycle in which the loads waiting for the line can use their data.
+		The MSHR is busy before this cycle. */
+	long long ready_cycle;
+
+	/** A mask of the destination registers of the loads waiting for the line */
+	unsigned int target_registers;
+}
+MSHR;
+
+// The access function of the level behind a cache. The access starts in the clock cycle
+// @a cycle.
+typedef int (*NextLevel)(long long address, int is_write, long long cycle);
+
+static const char* const CACHE_NAMES[NR_OF_CACHES] = { "L1 instruction cache", "L1 data cache", "L2 cache" };
+static const char* const PREFETCHER_NAMES[] = { "none", "next-line", "stride", "stream" };
+
+static const CacheConfig DEFAULT_L1_CONFIG = { 8 * 1024, 32, 2, REPLACE_LRU, 1, 1, 1 };
+static const CacheConfig DEFAULT_L2_CONFIG = { 256 * 1024, 64, 8, REPLACE_LRU, 1, 1, 10 };
+static const PrefetcherConfig DEFAULT_PREFETCHER_CONFIG = { NO_PREFETCHER, 1, 64, 4, 4 };
+static const int DEFAULT_MEMORY_LATENCY = 100;
+
+static Cache caches[NR_OF_CACHES];
+static int memory_latency = DEFAULT_MEMORY_LATENCY;
+
+static int nr_of_mshrs;
+static MSHR mshrs[MAX_NR_OF_MSHRS];
+static MSHRStats mshr_stats;
+
+// The end of the last cycle in which a miss was known to be outstanding
+static long long mshrs_busy_until;
+
+// The state saved by SaveCacheState()
+static MSHR saved_mshrs[MAX_NR_OF_MSHRS];
+static MSHRStats saved_mshr_stats;
+static long long saved_mshrs_busy_until;
+
+static int IsPowerOf2(long long n)
+{
+	return n > 0 && (n & (n - 1)) == 0;
+}
+
+// Parse a number with an optional K or M suffix. Returns -1 if it is invalid.
+static long long ParseSize(const char* text)
+{
+	char* end;
+	long long n = strtoll(text, &end, 10);
+
+	if (end == text)
+		return -1;
+	if (toupper((unsigned char) *end) == 'K')
+	{
+		n *= 1024;
+		++end;
+	}
+	else if (toupper((unsigned char) *end) == 'M')
+	{
+		n *= 1024 * 1024;
+		++end;
+	}
+	return *end == '\0' ? n : -1;
+}
+
+static int ParseParameter(const char* name, const char* value, CacheConfig* config)
+{
+	long long n = ParseSize(value);
+
+	if (strcmp(name, "size") == 0 && IsPowerOf2(n) && n <= (1 << 30))
+		config->size = (int) n;
+	else if (strcmp(name, "line") == 0 && IsPowerOf2(n) && n >= 4 && n <= 4096)
+		config->line_size = (int) n;
+	else if (strcmp(name, "assoc") == 0 && IsPowerOf2(n) && n <= 1024)
+		config->associativity = (int) n;
+	else if (strcmp(name, "latency") == 0 && n >= 1 && n <= 10000)
+		config->hit_latency = (int) n;
+	else if (strcmp(name, "repl") == 0 && strcmp(value, "lru") == 0)
+		config->replacement = REPLACE_LRU;
+	else if (strcmp(name, "repl") == 0 && strcmp(value, "fifo") == 0)
+		config->replacement = REPLACE_FIFO;
+	else if (strcmp(name, "repl") == 0 && strcmp(value, "random") == 0)
+		config->replacement = REPLACE_RANDOM;
+	else if (strcmp(name, "write") == 0 && (strcmp(value, "back") == 0 || strcmp(value, "through") == 0))
+		config->write_back = strcmp(value, "back") == 0;
+	else if (strcmp(name, "alloc") == 0 && (strcmp(value, "yes") == 0 || strcmp(value, "no") == 0))
+		config->write_allocate = strcmp(value, "yes") == 0;
+	else
+		return 1;
+	return 0;
+}
+
+static int ParsePrefetcherParameter(const char* name, const char* value, PrefetcherConfig* config)
+{
+	long long n = ParseSize(value);
+
+	if (strcmp(name, "degree") == 0 && n >= 1 && n <= 16)
+		config->degree = (int) n;
+	else if (strcmp(name, "table") == 0 && IsPowerOf2(n) && n <= MAX_STRIDE_TABLE_SIZE)
+		config->table_size = (int) n;
+	else if (strcmp(name, "buffers") == 0 && n >= 1 && n <= MAX_NR_OF_STREAM_BUFFERS)
+		config->nr_buffers = (int) n;
+	else if (strcmp(name, "depth") == 0 && n >= 1 && n <= MAX_STREAM_BUFFER_DEPTH)
+		config->buffer_depth = (int) n;
+	else
+		return 1;
+	return 0;
+}
+
+// Empty the prefetcher @a prefetcher and reset its statistics, keeping its parameters
+static void EmptyPrefetcher(Prefetcher* prefetcher)
+{
+	PrefetcherConfig config = prefetcher->config;
+
+	memset(prefetcher, 0, sizeof(*prefetcher));
+	prefetcher->config = config;
+}
+
+static void EmptyCache(Cache* cache)
+{
+	memset(cache->lines, 0, (size_t) cache->nr_sets * cache->config.associativity * sizeof(CacheLine));
+	memset(&cache->stats, 0, sizeof(cache->stats));
+	cache->clock = 0;
+	cache->random_state = 1;
+	EmptyPrefetcher(&cache->prefetcher);
+}
+
+// Return the first line of the set that the line @a line_nr maps to
+static CacheLine* GetSet(Cache* cache, long long line_nr)
+{
+	return &cache->lines[(line_nr & (cache->nr_sets - 1)) * cache->config.associativity];
+}
+
+// Return the line @a line_nr in the set @a set, or NULL if it is not in the cache
+static CacheLine* FindLine(Cache* cache, CacheLine* set, long long line_nr)
+{
+	int w;
+
+	for (w = 0; w < cache->config.associativity; ++w)
+		if (set[w].valid && set[w].line_nr == line_nr)
+			return &set[w];
+	return NULL;
+}
+
+// Return the line of the set @a set that is replaced when a line is brought in
+static CacheLine* ChooseVictim(Cache* cache, CacheLine* set)
+{
+	CacheLine* victim = set;
+	int w;
+
+	for (w = 0; w < cache->config.associativity; ++w)
+		if (!set[w].valid)
+			return &set[w];
+
+	if (cache->config.replacement == REPLACE_RANDOM)
+	{
+		cache->random_state = cache->random_state * 1103515245u + 12345u;
+		return &set[(cache->random_state >> 16) % cache->config.associativity];
+	}
+	for (w = 1; w < cache->config.associativity; ++w)
+		if (set[w].stamp < victim->stamp)
+			victim = &set[w];
+	return victim;
+}
+
+// Replace the line @a line by the line @a line_nr, writing it back to @a next_level in
+// the clock cycle @a cycle if it is dirty
+static void ReplaceLine(Cache* cache, CacheLine* line, long long line_nr, long long cycle,
+	NextLevel next_level)
+{
+	if (line->valid && line->dirty)
+	{
+		// The writeback is buffered, so it does not add to the latency
+		++cache->stats.writebacks;
+		next_level(line->line_nr << cache->line_bits, 1, cycle);
+	}
+	line->line_nr = line_nr;
+	line->valid = 1;
+	line->dirty = 0;
+	line->stamp = cache->clock;
+	line->prefetched = 0;
+	line->ready_cycle = 0;
+}
+
+// Prefetch the line @a line_nr into the cache @a cache in the clock cycle @a cycle,
+// unless it is there already
+static void PrefetchLine(Cache* cache, long long line_nr, long long cycle, NextLevel next_level)
+{
+	Prefetcher* prefetcher = &cache->prefetcher;
+	CacheLine* set;
+	CacheLine* victim;
+	long long* polluted;
+
+	line_nr &= 0xFFFFFFFFLL >> cache->line_bits;
+	set = GetSet(cache, line_nr);
+	if (FindLine(cache, set, line_nr) != NULL)
+		return;
+
+	// Remember the line that is pushed out, unless it was itself an unused prefetch
+	victim = ChooseVictim(cache, set);
+	if (victim->valid && !victim->prefetched)
+		prefetcher->polluted[victim->line_nr & (POLLUTION_FILTER_SIZE - 1)] = victim->line_nr + 1;
+	polluted = &prefetcher->polluted[line_nr & (POLLUTION_FILTER_SIZE - 1)];
+	if (*polluted == line_nr + 1)
+		*polluted = 0;
+
+	ReplaceLine(cache, victim, line_nr, cycle, next_level);
+	victim->prefetched = 1;
+	victim->ready_cycle = cycle + next_level(line_nr << cache->line_bits, 0, cycle);
+	++prefetcher->stats.issued;
+}
+
+// Prefetch the next line of the stream buffer @a buffer into it
+static void FillStreamBuffer(Cache* cache, StreamBuffer* buffer, long long cycle, NextLevel next_level)
+{
+	long long line_nr = buffer->next_line_nr++ & (0xFFFFFFFFLL >> cache->line_bits);
+
+	buffer->line_nrs[buffer->count] = line_nr;
+	buffer->ready_cycles[buffer->count] = cycle + next_level(line_nr << cache->line_bits, 0, cycle);
+	++buffer->count;
+	++cache->prefetcher.stats.issued;
+}
+
+// Look for the line @a line_nr, which has missed in the cache @a cache, at the heads of
+// its stream buffers. If it is there, it is taken out of its buffer, which prefetches
+// another line, and the number of cycles until it arrives is added to *latency.
+// Returns whether the line was found.
+static int TakeFromStreamBuffers(Cache* cache, long long line_nr, long long cycle, NextLevel next_level,
+	int* latency)
+{
+	Prefetcher* prefetcher = &cache->prefetcher;
+	int b;
+
+	for (b = 0; b < prefetcher->config.nr_buffers; ++b)
+	{
+		StreamBuffer* buffer = &prefetcher->buffers[b];
+
+		if (buffer->count > 0 && buffer->line_nrs[0] == line_nr)
+		{
+			++prefetcher->stats.useful;
+			if (buffer->ready_cycles[0] > cycle)
+			{
+				++prefetcher->stats.late;
+				*latency += (int) (buffer->ready_cycles[0] - cycle);
+			}
+			--buffer->count;
+			memmove(buffer->line_nrs, buffer->line_nrs + 1, buffer->count * sizeof(long long));
+			memmove(buffer->ready_cycles, buffer->ready_cycles + 1, buffer->count * sizeof(long long));
+			FillStreamBuffer(cache, buffer, cycle, next_level);
+			buffer->stamp = cache->clock;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+// Start a stream after the line @a line_nr in the least recently used stream buffer
+static void StartStream(Cache* cache, long long line_nr, long long cycle, NextLevel next_level)
+{
+	Prefetcher* prefetcher = &cache->prefetcher;
+	StreamBuffer* buffer = &prefetcher->buffers[0];
+	int b;
+
+	for (b = 1; b < prefetcher->config.nr_buffers; ++b)
+		if (prefetcher->buffers[b].stamp < buffer->stamp)
+			buffer = &prefetcher->buffers[b];
+
+	buffer->count = 0;
+	buffer->next_line_nr = line_nr + 1;
+	buffer->stamp = cache->clock;
+	while (buffer->count < prefetcher->config.buffer_depth)
+		FillStreamBuffer(cache, buffer, cycle, next_level);
+}
+
+// Update the entry of the instruction at the address @a pc in the reference prediction
+// table with its access to the address @a address
+// @return The stride to prefetch with, or 0 if the stride cannot be predicted
+static long long UpdateStrideTable(Prefetcher* prefetcher, long long pc, long long address)
+{
+	StrideEntry* entry = &prefetcher->table[(pc >> 2) & (prefetcher->config.table_size - 1)];
+	long long stride = address - entry->last_address;
+	int correct = stride == entry->stride;
+
+	if (!entry->valid || entry->pc != pc)
+	{
+		entry->valid = 1;
+		entry->pc = pc;
+		entry->last_address = address;
+		entry->stride = 0;
+		entry->state = STRIDE_INITIAL;
+		return 0;
+	}
+
+	// A steady stride is kept through a single irregular access
+	if (!correct && entry->state != STRIDE_STEADY)
+		entry->stride = stride;
+	switch (entry->state)
+	{
+	case STRIDE_INITIAL:
+		entry->state = correct ? STRIDE_STEADY : STRIDE_TRANSIENT;
+		break;
+	case STRIDE_TRANSIENT:
+		entry->state = correct ? STRIDE_STEADY : STRIDE_NO_PREDICTION;
+		break;
+	case STRIDE_STEADY:
+		if (!correct)
+			entry->state = STRIDE_INITIAL;
+		break;
+	case STRIDE_NO_PREDICTION:
+		if (correct)
+			entry->state = STRIDE_TRANSIENT;
+		break;
+	}
+	entry->last_address = address;
+	return entry->state == STRIDE_STEADY ? entry->stride : 0;
+}
+
+// Let the prefetcher of the cache @a cache see the access of the instruction at the
+// address @a pc to the address @a address. @a trigger is whether the access missed,
+// without being served by a stream buffer, or was the first use of a prefetched line.
+static void RunPrefetcher(Cache* cache, long long pc, long long address, int trigger, long long cycle,
+	NextLevel next_level)
+{
+	Prefetcher* prefetcher = &cache->prefetcher;
+	long long line_nr = (address & 0xFFFFFFFFLL) >> cache->line_bits;
+	long long stride;
+	int d;
+
+	switch (prefetcher->config.kind)
+	{
+	case NEXT_LINE_PREFETCHER:
+		if (trigger)
+			for (d = 1; d <= prefetcher->config.degree; ++d)
+				PrefetchLine(cache, line_nr + d, cycle, next_level);
+		break;
+	case STRIDE_PREFETCHER:
+		stride = UpdateStrideTable(prefetcher, pc, address);
+		if (stride != 0)
+			for (d = 1; d <= prefetcher->config.degree; ++d)
+				PrefetchLine(cache, ((address + d * stride) & 0xFFFFFFFFLL) >> cache->line_bits, cycle,
+					next_level);
+		break;
+	case STREAM_BUFFERS:
+		if (trigger)
+			StartStream(cache, line_nr, cycle, next_level);
+		break;
+	default:
+		break;
+	}
+}
+
+// Access the cache @a cache, which misses to @a next_level, for the instruction at the
+// address @a pc in the clock cycle @a cycle, and return the number of clock cycles the
+// access takes. Sets *hit to whether the access hit.
+static int AccessCache(Cache* cache, long long pc, long long address, int is_write, long long cycle,
+	NextLevel next_level, int* hit)
+{
+	Prefetcher* prefetcher = &cache->prefetcher;
+	long long line_nr = (address & 0xFFFFFFFFLL) >> cache->line_bits;
+	CacheLine* set = GetSet(cache, line_nr);
+	CacheLine* line = FindLine(cache, set, line_nr);
+	int latency = cache->config.hit_latency;
+	int trigger = 0;
+
+	// An access goes to the next level after the lookup
+	long long miss_cycle = cycle + cache->config.hit_latency;
+
+	++cache->clock;
+	*hit = line != NULL;
+	if (line != NULL)
+	{
+		++cache->stats.hits;
+		if (cache->config.replacement == REPLACE_LRU)
+			line->stamp = cache->clock;
+		if (line->prefetched)
+		{
+			line->prefetched = 0;
+			trigger = 1;
+			++prefetcher->stats.useful;
+			if (line->ready_cycle > cycle)
+			{
+				++prefetcher->stats.late;
+				latency += (int) (line->ready_cycle - cycle);
+			}
+		}
+	}
+	else
+	{
+		long long* polluted = &prefetcher->polluted[line_nr & (POLLUTION_FILTER_SIZE - 1)];
+
+		++cache->stats.misses;
+		if (*polluted == line_nr + 1)
+		{
+			++prefetcher->stats.polluting;
+			*polluted = 0;
+		}
+		if (!is_write || cache->config.write_allocate)
+		{
+			line = ChooseVictim(cache, set);
+			ReplaceLine(cache, line, line_nr, miss_cycle, next_level);
+			if (prefetcher->config.kind != STREAM_BUFFERS
+				|| !TakeFromStreamBuffers(cache, line_nr, cycle, next_level, &latency))
+			{
+				latency += next_level(line_nr << cache->line_bits, 0, miss_cycle);
+				trigger = 1;
+			}
+		}
+		else
+			trigger = 1;
+	}
+
+	if (is_write)
+	{
+		if (line != NULL && cache->config.write_back)
+			line->dirty = 1;
+		else
+			latency += next_level(address, 1, miss_cycle);
+	}
+	RunPrefetcher(cache, pc, address, trigger, cycle, next_level);
+	return latency;
+}
+
+static int AccessMainMemory(long long address, int is_write, long long cycle)
+{
+	if (IsDramEnabled())
+		return AccessDram(address, is_write, cycle);
+	return memory_latency;
+}
+
+static int AccessL2Cache(long long address, int is_write, long long cycle)
+{
+	int hit;
+
+	if (!caches[L2_CACHE].configured)
+		return AccessMainMemory(address, is_write, cycle);
+	return AccessCache(&caches[L2_CACHE], 0, address, is_write, cycle, AccessMainMemory, &hit);
+}
+
+static void EmptyMSHRs()
+{
+	memset(mshrs, 0, sizeof(mshrs));
+	memset(&mshr_stats, 0, sizeof(mshr_stats));
+	mshrs_busy_until = 0;
+}
+
+// Public functions -------------------------------------------------------------------
+
+void GetDefaultCacheConfig(CacheId cache, CacheConfig* config)
+{
+	*config = cache == L2_CACHE ? DEFAULT_L2_CONFIG : DEFAULT_L1_CONFIG;
+}
+
+int ParseCacheConfig(const char* description, CacheConfig* config)
+{
+	CacheConfig parsed = *config;
+	char* copy = (char*) malloc(strlen(description) + 1);
+	char* parameter;
+	int failed = 0;
+
+	strcpy(copy, description);
+	for (parameter = strtok(copy, ","); parameter != NULL && !failed; parameter = strtok(NULL, ","))
+	{
+		char* value = strchr(parameter, '=');
+		if (value == NULL)
+			failed = 1;
+		else
+		{
+			*value++ = '\0';
+			failed = ParseParameter(parameter, value, &parsed);
+		}
+	}
+	free(copy);
+
+	if (parsed.size < parsed.line_size * parsed.associativity)
+		failed = 1;
+	if (!failed)
+		*config = parsed;
+	return failed;
+}
+
+void ConfigureCache(CacheId id, const CacheConfig* config)
+{
+	Cache* cache = &caches[id];
+
+	cache->configured = 1;
+	cache->config = *config;
+	for (cache->line_bits = 0; (1 << cache->line_bits) < config->line_size; ++cache->line_bits)
+		;
+	cache->nr_sets = config->size / (config->line_size * config->associativity);
+	free(cache->lines);
+	free(cache->saved_lines);
+	cache->lines = (CacheLine*) malloc((size_t) cache->nr_sets * config->associativity * sizeof(CacheLine));
+	cache->saved_lines = NULL;
+	EmptyCache(cache);
+}
+
+void GetDefaultPrefetcherConfig(PrefetcherConfig* config)
+{
+	*config = DEFAULT_PREFETCHER_CONFIG;
+}
+
+int ParsePrefetcherConfig(const char* description, PrefetcherConfig* config)
+{
+	PrefetcherConfig parsed = *config;
+	char* copy = (char*) malloc(strlen(description) + 1);
+	char* parameter;
+	int failed = 0;
+
+	strcpy(copy, description);
+	parameter = strtok(copy, ",");
+	if (parameter != NULL && strcmp(parameter, "next-line") == 0)
+		parsed.kind = NEXT_LINE_PREFETCHER;
+	else if (parameter != NULL && strcmp(parameter, "stride") == 0)
+		parsed.kind = STRIDE_PREFETCHER;
+	else if (parameter != NULL && strcmp(parameter, "stream") == 0)
+		parsed.kind = STREAM_BUFFERS;
+	else
+		failed = 1;
+	for (parameter = strtok(NULL, ","); parameter != NULL && !failed; parameter = strtok(NULL, ","))
+	{
+		char* value = strchr(parameter, '=');
+		if (value == NULL)
+			failed = 1;
+		else
+		{
+			*value++ = '\0';
+			failed = ParsePrefetcherParameter(parameter, value, &parsed);
+		}
+	}
+	free(copy);
+
+	if (!failed)
+		*config = parsed;
+	return failed;
+}
+
+void ConfigurePrefetcher(CacheId cache, const PrefetcherConfig* config)
+{
+	memset(&caches[cache].prefetcher, 0, sizeof(caches[cache].prefetcher));
+	caches[cache].prefetcher.config = *config;
+}
+
+const PrefetcherConfig* GetPrefetcherConfig(CacheId cache)
+{
+	return &caches[cache].prefetcher.config;
+}
+
+const char* GetPrefetcherName(PrefetcherKind kind)
+{
+	return PREFETCHER_NAMES[kind];
+}
+
+void SetMemoryLatency(int cycles)
+{
+	memory_latency = cycles;
+}
+
+void SetNrOfMSHRs(int nr_mshrs)
+{
+	nr_of_mshrs = nr_mshrs < MAX_NR_OF_MSHRS ? nr_mshrs : MAX_NR_OF_MSHRS;
+	EmptyMSHRs();
+}
+
+int GetNrOfMSHRs()
+{
+	return nr_of_mshrs;
+}
+
+int AreCachesEnabled()
+{
+	return caches[L1_INSTRUCTION_CACHE].configured || caches[L1_DATA_CACHE].configured
+		|| caches[L2_CACHE].configured;
+}
+
+int IsCacheConfigured(CacheId cache)
+{
+	return caches[cache].configured;
+}
+
+void InitCaches()
+{
+	int c;
+
+	for (c = 0; c < NR_OF_CACHES; ++c)
+		if (caches[c].configured)
+			EmptyCache(&caches[c]);
+	EmptyMSHRs();
+	InitDram();
+}
+
+int AccessInstructionCache(long long address, long long cycle)
+{
+	int hit;
+
+	if (!caches[L1_INSTRUCTION_CACHE].configured)
+		return 1;
+	return AccessCache(&caches[L1_INSTRUCTION_CACHE], address, address, 0, cycle, AccessL2Cache, &hit);
+}
+
+int AccessDataCache(long long pc, long long address, int is_write, long long cycle)
+{
+	int hit;
+
+	if (!caches[L1_DATA_CACHE].configured)
+		return 1;
+	return AccessCache(&caches[L1_DATA_CACHE], pc, address, is_write, cycle, AccessL2Cache, &hit);
+}
+
+int AccessPageTableEntry(long long address, long long cycle)
+{
+	return AccessL2Cache(address, 0, cycle);
+}
+
+int StartDataCacheLoad(long long pc, long long address, int dest, long long cycle)
+{
+	Cache* cache = &caches[L1_DATA_CACHE];
+	unsigned int target = dest > 0 ? 1u << dest : 0;
+	MSHR* mshr = NULL;
+	long long line_nr, start;
+	int latency, hit, wait, m;
+
+	if (!cache->configured || nr_of_mshrs == 0)
+		return AccessDataCache(pc, address, 0, cycle) - 1;
+
+	// The tags of a line are filled in when its miss starts, so a load from a line that
+	// is still being fetched has to be caught before the lookup
+	line_nr = (address & 0xFFFFFFFFLL) >> cache->line_bits;
+	for (m = 0; m < nr_of_mshrs; ++m)
+		if (mshrs[m].ready_cycle > cycle && mshrs[m].line_nr == line_nr)
+		{
+			mshrs[m].target_registers |= target;
+			++mshr_stats.secondary_misses;
+			RunPrefetcher(cache, pc, address, 0, cycle, AccessL2Cache);
+			return cache->config.hit_latency - 1;
+		}
+
+	latency = AccessCache(cache, pc, address, 0, cycle, AccessL2Cache, &hit);
+	if (hit)
+		return latency - 1;
+
+	// Take a free MSHR, or wait for the one that becomes free first
+	for (m = 0; m < nr_of_mshrs; ++m)
+		if (mshr == NULL || mshrs[m].ready_cycle < mshr->ready_cycle)
+			mshr = &mshrs[m];
+	start = mshr->ready_cycle > cycle ? mshr->ready_cycle : cycle;
+	wait = (int) (start - cycle);
+	mshr_stats.full_stall_cycles += wait;
+
+	mshr->line_nr = line_nr;
+	mshr->ready_cycle = start + latency - 1;
+	mshr->target_registers = target;
+
+	++mshr_stats.primary_misses;
+	mshr_stats.outstanding_cycles += latency - 1;
+	if (start < mshrs_busy_until)
+		start = mshrs_busy_until;
+	if (mshr->ready_cycle > start)
+	{
+		mshr_stats.busy_cycles += mshr->ready_cycle - start;
+		mshrs_busy_until = mshr->ready_cycle;
+	}
+	mshr_stats.blocking_stall_cycles += latency - 1;
+
+	return wait + cache->config.hit_latency - 1;
+}
+
+unsigned int GetPendingLoadRegisters(long long cycle)
+{
+	unsigned int pending = 0;
+	int m;
+
+	for (m = 0; m < nr_of_mshrs; ++m)
+		if (mshrs[m].ready_cycle > cycle)
+			pending |= mshrs[m].target_registers;
+	return pending;
+}
+
+const MSHRStats* GetMSHRStats()
+{
+	return &mshr_stats;
+}
+
+const CacheStats* GetCacheStats(CacheId cache)
+{
+	return &caches[cache].stats;
+}
+
+const PrefetchStats* GetPrefetchStats(CacheId cache)
+{
+	return &caches[cache].prefetcher.stats;
+}
+
+const char* GetCacheName(CacheId cache)
+{
+	return CACHE_NAMES[cache];
+}
+
+void SaveCacheState()
+{
+	int c;
+
+	for (c = 0; c < NR_OF_CACHES; ++c)
+	{
+		Cache* cache = &caches[c];
+		size_t size = (size_t) cache->nr_sets * cache->config.associativity * sizeof(CacheLine);
+
+		if (!cache->configured)
+			continue;
+		if (cache->saved_lines == NULL)
+			cache->saved_lines = (CacheLine*) malloc(size);
+		memcpy(cache->saved_lines, cache->lines, size);
+		cache->saved_clock = cache->clock;
+		cache->saved_random_state = cache->random_state;
+		cache->saved_stats = cache->stats;
+		cache->saved_prefetcher = cache->prefetcher;
+	}
+	memcpy(saved_mshrs, mshrs, sizeof(mshrs));
+	saved_mshr_stats = mshr_stats;
+	saved_mshrs_busy_until = mshrs_busy_until;
+	SaveDramState();
+}
+
+void RestoreCacheState()
+{
+	int c;
+
+	for (c = 0; c < NR_OF_CACHES; ++c)
+	{
+		Cache* cache = &caches[c];
+
+		if (!cache->configured || cache->saved_lines == NULL)
+			continue;
+		memcpy(cache->lines, cache->saved_lines,
+			(size_t) cache->nr_sets * cache->config.associativity * sizeof(CacheLine));
+		cache->clock = cache->saved_clock;
+		cache->random_state = cache->saved_random_state;
+		cache->stats = cache->saved_stats;
+		cache->prefetcher = cache->saved_prefetcher;
+	}
+	memcpy(mshrs, saved_mshrs, sizeof(mshrs));
+	mshr_stats = saved_mshr_stats;
+	mshrs_busy_until = saved_mshrs_busy_until;
+	RestoreDramState();
+}
+
+void WriteCacheCheckpoint(CheckpointState* state)
+{
+	int c;
+
+	for (c = 0; c < NR_OF_CACHES; ++c)
+	{
+		Cache* cache = &caches[c];
+
+		PutCheckpointState(state, &cache->configured, sizeof(cache->configured));
+		PutCheckpointState(state, &cache->config, sizeof(cache->config));
+		PutCheckpointState(state, &cache->prefetcher.config, sizeof(cache->prefetcher.config));
+		if (cache->configured)
+			PutCheckpointState(state, cache->lines,
+				(size_t) cache->nr_sets * cache->config.associativity * sizeof(CacheLine));
+		PutCheckpointState(state, &cache->clock, sizeof(cache->clock));
+		PutCheckpointState(state, &cache->random_state, sizeof(cache->random_state));
+		PutCheckpointState(state, &cache->stats, sizeof(cache->stats));
+		PutCheckpointState(state, &cache->prefetcher, sizeof(cache->prefetcher));
+	}
+	PutCheckpointState(state, &memory_latency, sizeof(memory_latency));
+	PutCheckpointState(state, &nr_of_mshrs, sizeof(nr_of_mshrs));
+	PutCheckpointState(state, mshrs, sizeof(mshrs));
+	PutCheckpointState(state, &mshr_stats, sizeof(mshr_stats));
+	PutCheckpointState(state, &mshrs_busy_until, sizeof(mshrs_busy_until));
+	WriteDramCheckpoint(state);
+}
+
+void ReadCacheCheckpoint(CheckpointState* state)
+{
+	int c;
+
+	for (c = 0; c < NR_OF_CACHES; ++c)
+	{
+		Cache* cache = &caches[c];
+
+		CheckCheckpointConfig(state, &cache->configured, sizeof(cache->configured));
+		CheckCheckpointConfig(state, &cache->config, sizeof(cache->config));
+		CheckCheckpointConfig(state, &cache->prefetcher.config, sizeof(cache->prefetcher.config));
+		if (state->failed)
+			return;
+		if (cache->configured)
+			GetCheckpointState(state, cache->lines,
+				(size_t) cache->nr_sets * cache->config.associativity * sizeof(CacheLine));
+		GetCheckpointState(state, &cache->clock, sizeof(cache->clock));
+		GetCheckpointState(state, &cache->random_state, sizeof(cache->random_state));
+		GetCheckpointState(state, &cache->stats, sizeof(cache->stats));
+		GetCheckpointState(state, &cache->prefetcher, sizeof(cache->prefetcher));
+	}
+	CheckCheckpointConfig(state, &memory_latency, sizeof(memory_latency));
+	CheckCheckpointConfig(state, &nr_of_mshrs, sizeof(nr_of_mshrs));
+	GetCheckpointState(state, mshrs, sizeof(mshrs));
+	GetCheckpointState(state, &mshr_stats, sizeof(mshr_stats));
+	GetCheckpointState(state, &mshrs_busy_until, sizeof(mshrs_busy_until));
+	ReadDramCheckpoint(state);
+}
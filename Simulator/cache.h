@@ -0,0 +1,291 @@
+/** @file cache.h
+	Timing models of an L1 instruction cache, an L1 data cache and a unified L2 cache
+	behind both of them, in front of a main memory with a fixed latency or, if it has
+	been configured, the DRAM model of dram.h.
+
+	The caches only model timing: the instructions and data always come from the
+	instruction and data memories. Each access returns the number of clock cycles it
+	takes, which is the hit latency of every level that is looked up, plus the latency
+	of the main memory if the L2 cache misses as well. The pipeline stages take one
+	cycle for an access, and are stalled for the remaining cycles.
+
+	An L1 cache that has not been configured is perfect: every access to it takes a
+	single cycle. When no L2 cache has been configured, the L1 caches miss straight to
+	the main memory. Writebacks of dirty lines that are evicted go to the next level
+	through a buffer, so they do not add to the latency of the access that evicts them.
+	With write-through, a write waits for the next level to complete it.
+
+	The L1 data cache can be made non-blocking by giving it miss status holding
+	registers (MSHRs). A load that misses then allocates an MSHR and leaves the Mem
+	stage after the hit latency, and only the instructions that use its destination
+	register wait for the data. Further loads from a line that is being fetched merge
+	into its MSHR. When all MSHRs are busy, a load that misses waits in the Mem stage
+	until one becomes free. Stores are not affected by the MSHRs.
+
+	Each L1 cache can have a prefetcher. The next-line prefetcher fetches the lines
+	after a line that misses, or that is used for the first time after it was
+	prefetched. The stride prefetcher keeps a reference prediction table, indexed by
+	the address of the load or store, and prefetches ahead once an instruction has
+	accessed memory twice in a row with the same stride. Both bring the lines into the
+	cache, where they may evict lines that are still needed. Stream buffers hold the
+	lines after a miss outside the cache, and move the line at the head of a buffer into
+	the cache when it is missed on. A prefetch takes the latency of the next level, so a
+	prefetched line that is used before it has arrived is late, and the access waits for
+	it. Prefetches do not occupy the MSHRs.
+
+	Only the detailed pipeline simulation uses the caches; functional execution,
+	native executables and batch simulation do not model them. */
+
+#ifndef CACHE_H_INCL
+#define CACHE_H_INCL
+
+#include "checkpoint.h"
+
+/** The caches */
+typedef enum CacheId
+{
+	L1_INSTRUCTION_CACHE,
+	L1_DATA_CACHE,
+	L2_CACHE,
+	NR_OF_CACHES
+}
+CacheId;
+
+/** The line that is evicted when a line must be brought into a full set */
+typedef enum ReplacementPolicy
+{
+	/** The least recently used line */
+	REPLACE_LRU,
+
+	/** The line that was brought in first */
+	REPLACE_FIFO,
+
+	/** A pseudo-random line. The sequence is the same in every run. */
+	REPLACE_RANDOM
+}
+ReplacementPolicy;
+
+/** The parameters of a cache */
+typedef struct CacheConfig
+{
+	/** The capacity in bytes */
+	int size;
+
+	/** The size of a line in bytes */
+	int line_size;
+
+	/** The number of lines in a set */
+	int associativity;
+
+	ReplacementPolicy replacement;
+
+	/** 1 for a write-back cache, 0 for a write-through cache */
+	int write_back;
+
+	/** Whether a write miss brings the line into the cache */
+	int write_allocate;
+
+	/** The number of clock cycles of a hit */
+	int hit_latency;
+}
+CacheConfig;
+
+/** The event counts of a cache */
+typedef struct CacheStats
+{
+	long long hits;
+	long long misses;
+
+	/** The number of dirty lines that were written back to the next level */
+	long long writebacks;
+}
+CacheStats;
+
+/** The maximum number of MSHRs */
+#define MAX_NR_OF_MSHRS 64
+
+/** The event counts of the MSHRs */
+typedef struct MSHRStats
+{
+	/** The number of load misses that allocated an MSHR */
+	long long primary_misses;
+
+	/** The number of load misses that merged into a busy MSHR */
+	long long secondary_misses;
+
+	/** The number of cycles loads waited for an MSHR to become free */
+	long long full_stall_cycles;
+
+	/** The sum over all primary misses of the number of cycles they were outstanding */
+	long long outstanding_cycles;
+
+	/** The number of cycles during which at least one miss was outstanding */
+	long long busy_cycles;
+
+	/** The number of cycles that a blocking cache would have stalled the pipeline for
+		the same misses */
+	long long blocking_stall_cycles;
+}
+MSHRStats;
+
+/** The prefetchers */
+typedef enum PrefetcherKind
+{
+	NO_PREFETCHER,
+	NEXT_LINE_PREFETCHER,
+	STRIDE_PREFETCHER,
+	STREAM_BUFFERS
+}
+PrefetcherKind;
+
+/** The maximum number of entries in the reference prediction table of a stride prefetcher */
+#define MAX_STRIDE_TABLE_SIZE 256
+
+/** The maximum number of stream buffers, and of lines in a stream buffer */
+#define MAX_NR_OF_STREAM_BUFFERS 16
+#define MAX_STREAM_BUFFER_DEPTH 16
+
+/** The parameters of a prefetcher */
+typedef struct PrefetcherConfig
+{
+	PrefetcherKind kind;
+
+	/** The number of lines that the next-line and the stride prefetcher fetch ahead */
+	int degree;
+
+	/** The number of entries in the reference prediction table */
+	int table_size;
+
+	int nr_buffers;
+
+	/** The number of lines in a stream buffer */
+	int buffer_depth;
+}
+PrefetcherConfig;
+
+/** The event counts of a prefetcher */
+typedef struct PrefetchStats
+{
+	/** The number of lines that were prefetched */
+	long long issued;
+
+	/** The number of prefetched lines that were used */
+	long long useful;
+
+	/** The number of prefetched lines that were used before they had arrived */
+	long long late;
+
+	/** The number of misses on lines that were evicted by a prefetch */
+	long long polluting;
+}
+PrefetchStats;
+
+/** Set @a config to the default parameters of the cache @a cache */
+void GetDefaultCacheConfig(CacheId cache, CacheConfig* config);
+
+/** Parse a cache description, a comma-separated list of parameters such as
+	"size=16K,line=32,assoc=4,repl=lru,write=back,alloc=yes,latency=1", into
+	@a config. The parameters that are not given keep their values in @a config.
+	The values of repl are lru, fifo and random, and those of write are back and
+	through. The size, the line size and the associativity must be powers of 2.
+	@return 0 if the description is valid, 1 otherwise */
+int ParseCacheConfig(const char* description, CacheConfig* config);
+
+/** Add the cache @a cache, with the parameters @a config, to the hierarchy. The cache
+	starts out empty. */
+void ConfigureCache(CacheId cache, const CacheConfig* config);
+
+/** Set @a config to the default parameters of a prefetcher: a degree of 1, a table of
+	64 entries and 4 stream buffers of 4 lines, with no kind */
+void GetDefaultPrefetcherConfig(PrefetcherConfig* config);
+
+/** Parse a prefetcher description, the kind (next-line, stride or stream) optionally
+	followed by a comma-separated list of parameters such as "stride,degree=2,table=64"
+	or "stream,buffers=4,depth=8", into @a config. The parameters that are not given keep
+	their values in @a config. The table size must be a power of 2.
+	@return 0 if the description is valid, 1 otherwise */
+int ParsePrefetcherConfig(const char* description, PrefetcherConfig* config);
+
+/** Give the L1 cache @a cache the prefetcher @a config */
+void ConfigurePrefetcher(CacheId cache, const PrefetcherConfig* config);
+
+/** Return the parameters of the prefetcher of the cache @a cache. Its kind is
+	NO_PREFETCHER if it has none. */
+const PrefetcherConfig* GetPrefetcherConfig(CacheId cache);
+
+/** Return the name of the prefetcher @a kind, e.g. "stride" */
+const char* GetPrefetcherName(PrefetcherKind kind);
+
+/** Set the number of clock cycles of an access to the main memory */
+void SetMemoryLatency(int cycles);
+
+/** Give the L1 data cache @a nr_mshrs MSHRs, at most MAX_NR_OF_MSHRS. With 0 MSHRs,
+	which is the default, the cache is blocking. */
+void SetNrOfMSHRs(int nr_mshrs);
+
+/** Return the number of MSHRs of the L1 data cache */
+int GetNrOfMSHRs();
+
+/** Return whether any cache has been configured */
+int AreCachesEnabled();
+
+/** Return whether the cache @a cache has been configured */
+int IsCacheConfigured(CacheId cache);
+
+/** Empty all caches, reset their statistics and initialize the DRAM */
+void InitCaches();
+
+/** Fetch the instruction at the address @a address, starting in the clock cycle @a cycle
+	@return The number of clock cycles the fetch takes */
+int AccessInstructionCache(long long address, long long cycle);
+
+/** Read (if @a is_write is 0) or write the data at the address @a address for the
+	instruction at the address @a pc, starting in the clock cycle @a cycle
+	@return The number of clock cycles the access takes */
+int AccessDataCache(long long pc, long long address, int is_write, long long cycle);
+
+/** Read the page table entry at the address @a address for a page-table walk, starting
+	in the clock cycle @a cycle. The walk bypasses the L1 caches.
+	@return The number of clock cycles the read takes */
+int AccessPageTableEntry(long long address, long long cycle);
+
+/** Start the load of the register @a dest from the address @a address by the
+	instruction at the address @a pc in the clock cycle @a cycle, through the MSHRs of
+	the L1 data cache
+	@return The number of cycles the load has to wait in the Mem stage after its first
+		cycle there: for the hit latency, and for an MSHR if all are busy */
+int StartDataCacheLoad(long long pc, long long address, int dest, long long cycle);
+
+/** Return a mask with a bit set for each register that is waiting for the data of a
+	load miss in the clock cycle @a cycle */
+unsigned int GetPendingLoadRegisters(long long cycle);
+
+/** Return the event counts of the MSHRs */
+const MSHRStats* GetMSHRStats();
+
+/** Return the event counts of the cache @a cache */
+const CacheStats* GetCacheStats(CacheId cache);
+
+/** Return the event counts of the prefetcher of the cache @a cache */
+const PrefetchStats* GetPrefetchStats(CacheId cache);
+
+/** Return the name of the cache @a cache, e.g. "L1 data cache" */
+const char* GetCacheName(CacheId cache);
+
+/** Save the contents and the statistics of the caches, their prefetchers, the MSHRs
+	and the DRAM. Used by SaveSnapshot(). */
+void SaveCacheState();
+
+/** Restore the state saved by SaveCacheState() */
+void RestoreCacheState();
+
+/** Append the configuration, the contents and the statistics of the caches, their
+	prefetchers, the MSHRs and the DRAM to the state of a checkpoint. Used by
+	SaveCheckpoint(). */
+void WriteCacheCheckpoint(CheckpointState* state);
+
+/** Restore the state written by WriteCacheCheckpoint(). Sets state->failed if the
+	caches, the MSHRs or the main memory were configured differently. */
+void ReadCacheCheckpoint(CheckpointState* state);
+
+#endif // ifndef CACHE_H_INCL
@@ -0,0 +1,639 @@
+#include "checkpoint.h"
+#include "pipeline.h"
+#include "instr_memory.h"
+#include "data_memory.h"
+#include "register_file.h"
+#include "update.h"
+#include "mips_parser.h"
+#include "cache.h"
+#include "tlb.h"
+#include "store_buffer.h"
+#include "branch_predictor.h"
+#include "btb.h"
+#include "ras.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#ifndef _WIN32
+#	include <fcntl.h>
+#	include <unistd.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#endif
+
+// The size of the data memory chunks, and the alignment of the chunk data in the file
+#define CHUNK_SIZE 4096
+
+static const char CHECKPOINT_MAGIC[8] = { 'M', 'I', 'P', 'S', 'C', 'K', 'P', 'T' };
+
+// Used to detect checkpoints written on a host with another byte order
+static const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+typedef struct CheckpointHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t byte_order_mark;
+
+	int64_t nr_cycles;
+	int64_t nr_instr_retired;
+	int64_t nr_instr_fast_forwarded;
+	int64_t load_use_stalls;
+	int64_t branch_flushes;
+	int64_t jump_flushes;
+	int64_t jump_squashes;
+	int64_t branch_squashes;
+	int64_t fetch_stalls;
+	int64_t memory_stalls;
+	int64_t load_miss_stalls;
+	int64_t comparator_stalls;
+	int64_t early_branch_squashes;
+	int64_t registers[32];
+
+	// Whether the delay slots and the early branch resolution were turned on. They
+	// must be set in the same way when the checkpoint is restored.
+	int32_t delay_slots;
+	int32_t early_branch_resolution;
+
+	// The delay slots that the assembler filled, for the statistics
+	int32_t nr_moved_into_slots;
+	int32_t nr_nops_in_slots;
+
+	// The instruction memory, as an array of CheckpointInstr
+	uint64_t instrs_offset;
+	uint64_t nr_instrs;
+
+	// The pipeline registers, as an array of five CheckpointLatch
+	uint64_t latches_offset;
+
+	// The state of the timing models, as written by the models
+	uint64_t models_offset;
+	uint64_t models_size;
+
+	// The data memory, as an array of CheckpointChunk
+	uint64_t chunks_offset;
+	uint64_t nr_chunks;
+
+	uint64_t file_size;
+}
+CheckpointHeader;
+
+typedef struct CheckpointInstr
+{
+	int64_t type, line_nr, rd, rs, rt, imm;
+}
+CheckpointInstr;
+
+// A pipeline register. The meaning of the values depends on the stage.
+typedef struct CheckpointLatch
+{
+	int64_t pc;
+	CheckpointInstr instr;
+
+	// For a branch in ID, Ex or Mem, the address predicted to follow it
+	int64_t predicted_pc;
+	int64_t values[6];
+}
+CheckpointLatch;
+
+typedef struct CheckpointChunk
+{
+	// The address of the first byte of the chunk
+	int64_t address;
+
+	// The file offset of the chunk's CHUNK_SIZE bytes
+	uint64_t data_offset;
+}
+CheckpointChunk;
+
+// The non-zero chunks of the data memory, collected when writing a checkpoint
+typedef struct ChunkList
+{
+	long nr_chunks;
+	long capacity;
+	int64_t* addresses;
+	unsigned char* data;
+}
+ChunkList;
+
+// The functions that write and read the state of a timing model, in the order in
+// which the states are stored
+typedef struct ModelCheckpoint
+{
+	const char* name;
+	void (*write)(CheckpointState* state);
+	void (*read)(CheckpointState* state);
+}
+ModelCheckpoint;
+
+static const ModelCheckpoint MODEL_CHECKPOINTS[] =
+{
+	{ "caches, MSHRs or DRAM", WriteCacheCheckpoint, ReadCacheCheckpoint },
+	{ "TLBs", WriteTLBCheckpoint, ReadTLBCheckpoint },
+	{ "store buffer", WriteStoreBufferCheckpoint, ReadStoreBufferCheckpoint },
+	{ "branch predictor", WriteBranchPredictorCheckpoint, ReadBranchPredictorCheckpoint },
+	{ "BTB", WriteBTBCheckpoint, ReadBTBCheckpoint },
+	{ "return address stack", WriteRASCheckpoint, ReadRASCheckpoint }
+};
+
+#define NR_OF_MODEL_CHECKPOINTS ((int) (sizeof(MODEL_CHECKPOINTS) / sizeof(MODEL_CHECKPOINTS[0])))
+
+static uint64_t Align(uint64_t offset, uint64_t alignment)
+{
+	return (offset + alignment - 1) / alignment * alignment;
+}
+
+// Conversion between instructions and their checkpointed form ------------------------
+
+static void SaveInstr(const Instr* instr, CheckpointInstr* saved)
+{
+	saved->type = instr->type;
+	saved->line_nr = instr->line_nr;
+	saved->rd = instr->rd;
+	saved->rs = instr->rs;
+	saved->rt = instr->rt;
+	saved->imm = instr->imm;
+}
+
+static Instr RestoreInstr(const CheckpointInstr* saved)
+{
+	Instr instr = CreateInstr_Empty((InstrType) saved->type, (int) saved->line_nr);
+	instr.rd = (int) saved->rd;
+	instr.rs = (int) saved->rs;
+	instr.rt = (int) saved->rt;
+	instr.imm = saved->imm;
+	return instr;
+}
+
+// The predecoded instruction for a pipeline register holding the instruction at pc
+static const DecodedInstr* RestoreDecoded(long long pc)
+{
+	if (pc == DONT_CARE)
+		return GetDecodedNop();
+	return ReadDecodedFromInstrMemory(pc);
+}
+
+static void SaveLatches(CheckpointLatch latches[5])
+{
+	memset(latches, 0, 5 * sizeof(CheckpointLatch));
+
+	latches[0].pc = if_stage.pc;
+	SaveInstr(&if_stage.instr, &latches[0].instr);
+	latches[0].values[0] = if_stage.wait_cycles;
+	latches[0].values[1] = if_stage.btb_target;
+	latches[0].values[2] = if_stage.after_slot_pc;
+
+	latches[1].pc = id_stage.pc;
+	SaveInstr(&id_stage.instr, &latches[1].instr);
+	latches[1].predicted_pc = id_stage.predicted_pc;
+	latches[1].values[0] = id_stage.redirected;
+
+	latches[2].pc = ex_stage.pc;
+	SaveInstr(&ex_stage.instr, &latches[2].instr);
+	latches[2].predicted_pc = ex_stage.predicted_pc;
+	latches[2].values[0] = ex_stage.rs_value;
+	latches[2].values[1] = ex_stage.rt_value;
+	latches[2].values[2] = ex_stage.imm_value;
+	latches[2].values[3] = ex_stage.redirected;
+
+	latches[3].pc = mem_stage.pc;
+	SaveInstr(&mem_stage.instr, &latches[3].instr);
+	latches[3].predicted_pc = mem_stage.predicted_pc;
+	latches[3].values[0] = mem_stage.rt_value;
+	latches[3].values[1] = mem_stage.alu_result;
+	latches[3].values[2] = mem_stage.zero;
+	latches[3].values[3] = mem_stage.branch_target;
+	latches[3].values[4] = mem_stage.wait_cycles;
+	latches[3].values[5] = mem_stage.redirected;
+
+	latches[4].pc = wb_stage.pc;
+	SaveInstr(&wb_stage.instr, &latches[4].instr);
+	latches[4].values[0] = wb_stage.result;
+}
+
+static void RestoreLatches(const CheckpointLatch latches[5])
+{
+	if_stage.pc = latches[0].pc;
+	if_stage.instr = RestoreInstr(&latches[0].instr);
+	if_stage.decoded = ReadDecodedFromInstrMemory(if_stage.pc);
+	if_stage.wait_cycles = (int) latches[0].values[0];
+	if_stage.btb_target = latches[0].values[1];
+	if_stage.after_slot_pc = latches[0].values[2];
+
+	id_stage.pc = latches[1].pc;
+	id_stage.instr = RestoreInstr(&latches[1].instr);
+	id_stage.decoded = RestoreDecoded(id_stage.pc);
+	id_stage.predicted_pc = latches[1].predicted_pc;
+	id_stage.redirected = (int) latches[1].values[0];
+
+	ex_stage.pc = latches[2].pc;
+	ex_stage.instr = RestoreInstr(&latches[2].instr);
+	ex_stage.decoded = RestoreDecoded(ex_stage.pc);
+	ex_stage.predicted_pc = latches[2].predicted_pc;
+	ex_stage.rs_value = latches[2].values[0];
+	ex_stage.rt_value = latches[2].values[1];
+	ex_stage.imm_value = latches[2].values[2];
+	ex_stage.redirected = (int) latches[2].values[3];
+
+	mem_stage.pc = latches[3].pc;
+	mem_stage.instr = RestoreInstr(&latches[3].instr);
+	mem_stage.decoded = RestoreDecoded(mem_stage.pc);
+	mem_stage.predicted_pc = latches[3].predicted_pc;
+	mem_stage.rt_value = latches[3].values[0];
+	mem_stage.alu_result = latches[3].values[1];
+	mem_stage.zero = (int) latches[3].values[2];
+	mem_stage.branch_target = latches[3].values[3];
+	mem_stage.wait_cycles = (int) latches[3].values[4];
+	mem_stage.redirected = (int) latches[3].values[5];
+
+	wb_stage.pc = latches[4].pc;
+	wb_stage.instr = RestoreInstr(&latches[4].instr);
+	wb_stage.decoded = RestoreDecoded(wb_stage.pc);
+	wb_stage.result = latches[4].values[0];
+}
+
+// Collecting the non-zero chunks of the data memory --------------------------------
+
+static unsigned char* GetChunk(ChunkList* chunks, int64_t address)
+{
+	// Regions are visited in increasing address order, so a chunk shared by two
+	// regions is always the last one in the list
+	if (chunks->nr_chunks > 0 && chunks->addresses[chunks->nr_chunks - 1] == address)
+		return chunks->data + (chunks->nr_chunks - 1) * CHUNK_SIZE;
+
+	if (chunks->nr_chunks == chunks->capacity)
+	{
+		chunks->capacity = 2*chunks->capacity + 16;
+		chunks->addresses = (int64_t*) realloc(chunks->addresses, chunks->capacity * sizeof(int64_t));
+		chunks->data = (unsigned char*) realloc(chunks->data, chunks->capacity * CHUNK_SIZE);
+	}
+	chunks->addresses[chunks->nr_chunks] = address;
+	memset(chunks->data + chunks->nr_chunks * CHUNK_SIZE, 0, CHUNK_SIZE);
+	return chunks->data + chunks->nr_chunks++ * CHUNK_SIZE;
+}
+
+static void CollectChunks(long long address, const unsigned char* bytes, long nr_bytes, void* context)
+{
+	ChunkList* chunks = (ChunkList*) context;
+	long i = 0;
+
+	while (i < nr_bytes)
+	{
+		long long chunk_address = (address + i) / CHUNK_SIZE * CHUNK_SIZE;
+		long in_chunk = (long) (chunk_address + CHUNK_SIZE - (address + i));
+		long n = in_chunk < nr_bytes - i ? in_chunk : nr_bytes - i;
+		long j;
+
+		for (j = 0; j < n && bytes[i + j] == 0; ++j)
+			;
+		if (j < n)
+			memcpy(GetChunk(chunks, chunk_address) + (address + i - chunk_address), bytes + i, n);
+		i += n;
+	}
+}
+
+// Return whether nr_items items of item_size bytes at offset lie inside a file of
+// file_size bytes, and are aligned to 8 bytes
+static int IsInFile(uint64_t offset, uint64_t nr_items, uint64_t item_size, uint64_t file_size)
+{
+	return offset % 8 == 0 && offset <= file_size && nr_items <= (file_size - offset) / item_size;
+}
+
+// Return whether all the sections and chunks of the checkpoint lie inside the file,
+// and the chunks inside the data memory
+static int AreSectionsValid(const unsigned char* contents, uint64_t size)
+{
+	const CheckpointHeader* header = (const CheckpointHeader*) contents;
+	const CheckpointChunk* chunks;
+	uint64_t i;
+
+	if (!IsInFile(header->instrs_offset, header->nr_instrs, sizeof(CheckpointInstr), size)
+		|| !IsInFile(header->latches_offset, 5, sizeof(CheckpointLatch), size)
+		|| !IsInFile(header->models_offset, header->models_size, 1, size)
+		|| !IsInFile(header->chunks_offset, header->nr_chunks, sizeof(CheckpointChunk), size))
+		return 0;
+
+	chunks = (const CheckpointChunk*) (contents + header->chunks_offset);
+	for (i = 0; i < header->nr_chunks; ++i)
+		if (!IsInFile(chunks[i].data_offset, 1, CHUNK_SIZE, size)
+			|| chunks[i].address < GetDataSegmentStartingAddress()
+			|| chunks[i].address > GetStackSegmentEndAddress() - CHUNK_SIZE)
+			return 0;
+	return 1;
+}
+
+// Public functions -------------------------------------------------------------------
+
+void PutCheckpointState(CheckpointState* state, const void* data, size_t size)
+{
+	if (state->size + size > state->capacity)
+	{
+		state->capacity = 2*state->capacity + size + 256;
+		state->bytes = (unsigned char*) realloc(state->bytes, state->capacity);
+	}
+	memcpy(state->bytes + state->size, data, size);
+	state->size += size;
+}
+
+void GetCheckpointState(CheckpointState* state, void* data, size_t size)
+{
+	if (!state->failed && size > state->size - state->position)
+		state->truncated = 1;
+	if (state->failed || state->truncated)
+	{
+		state->failed = 1;
+		return;
+	}
+	memcpy(data, state->bytes + state->position, size);
+	state->position += size;
+}
+
+void CheckCheckpointConfig(CheckpointState* state, const void* config, size_t size)
+{
+	if (!state->failed && size > state->size - state->position)
+		state->truncated = 1;
+	if (state->failed || state->truncated
+		|| memcmp(state->bytes + state->position, config, size) != 0)
+	{
+		state->failed = 1;
+		return;
+	}
+	state->position += size;
+}
+
+int SaveCheckpoint(const char* filename)
+{
+	CheckpointHeader header;
+	CheckpointLatch latches[5];
+	CheckpointState models = { NULL, 0, 0, 0, 0, 0 };
+	ChunkList chunks = { 0, 0, NULL, NULL };
+	long nr_instrs, i;
+	int nr_moved_into_slots, nr_nops_in_slots;
+	const DecodedInstr* instrs = GetDecodedInstrBuffer(&nr_instrs);
+	long long registers[32];
+	uint64_t data_offset;
+	char* tmp_filename;
+	FILE* file;
+	int failed = 0;
+
+	for (i = 0; i < NR_OF_MODEL_CHECKPOINTS; ++i)
+		MODEL_CHECKPOINTS[i].write(&models);
+	VisitDataMemory(CollectChunks, &chunks);
+
+	// Lay out the file
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+	header.version = CHECKPOINT_VERSION;
+	header.byte_order_mark = BYTE_ORDER_MARK;
+	header.nr_cycles = GetElapsedCycles();
+	header.nr_instr_retired = GetNrOfRetiredInstructions();
+	header.nr_instr_fast_forwarded = GetNrOfFastForwardedInstructions();
+	header.load_use_stalls = stall_counts.load_use_stalls;
+	header.branch_flushes = stall_counts.branch_flushes;
+	header.jump_flushes = stall_counts.jump_flushes;
+	header.jump_squashes = stall_counts.jump_squashes;
+	header.branch_squashes = stall_counts.branch_squashes;
+	header.fetch_stalls = stall_counts.fetch_stalls;
+	header.memory_stalls = stall_counts.memory_stalls;
+	header.load_miss_stalls = stall_counts.load_miss_stalls;
+	header.comparator_stalls = stall_counts.comparator_stalls;
+	header.early_branch_squashes = stall_counts.early_branch_squashes;
+	ReadAllFromRegisterFile(registers);
+	for (i = 0; i < 32; ++i)
+		header.registers[i] = registers[i];
+	header.delay_slots = AreDelaySlotsOn();
+	header.early_branch_resolution = IsEarlyBranchResolutionOn();
+	GetDelaySlotFillingCounts(&nr_moved_into_slots, &nr_nops_in_slots);
+	header.nr_moved_into_slots = nr_moved_into_slots;
+	header.nr_nops_in_slots = nr_nops_in_slots;
+	header.instrs_offset = Align(sizeof(header), 8);
+	header.nr_instrs = nr_instrs;
+	header.latches_offset = header.instrs_offset + nr_instrs * sizeof(CheckpointInstr);
+	header.models_offset = header.latches_offset + 5 * sizeof(CheckpointLatch);
+	header.models_size = models.size;
+	header.chunks_offset = Align(header.models_offset + models.size, 8);
+	header.nr_chunks = chunks.nr_chunks;
+	data_offset = header.chunks_offset + chunks.nr_chunks * sizeof(CheckpointChunk);
+	if (chunks.nr_chunks > 0)
+		data_offset = Align(data_offset, CHUNK_SIZE);
+	header.file_size = data_offset + chunks.nr_chunks * (uint64_t) CHUNK_SIZE;
+
+	tmp_filename = (char*) malloc(strlen(filename) + 5);
+	sprintf(tmp_filename, "%s.tmp", filename);
+	file = fopen(tmp_filename, "wb");
+	if (file == NULL)
+	{
+		fprintf(stderr, "Could not open file %s for writing\n", tmp_filename);
+		free(tmp_filename);
+		free(models.bytes);
+		free(chunks.addresses);
+		free(chunks.data);
+		return 1;
+	}
+
+	fwrite(&header, sizeof(header), 1, file);
+
+	fseek(file, (long) header.instrs_offset, SEEK_SET);
+	for (i = 0; i < nr_instrs; ++i)
+	{
+		CheckpointInstr saved;
+		SaveInstr(&instrs[i].instr, &saved);
+		fwrite(&saved, sizeof(saved), 1, file);
+	}
+
+	SaveLatches(latches);
+	fwrite(latches, sizeof(CheckpointLatch), 5, file);
+
+	if (models.size > 0)
+		fwrite(models.bytes, 1, models.size, file);
+
+	// Pad the state of the models up to the table of chunks, which may end the file
+	for (i = (long) (header.models_offset + models.size); i < (long) header.chunks_offset; ++i)
+		fputc(0, file);
+	for (i = 0; i < chunks.nr_chunks; ++i)
+	{
+		CheckpointChunk chunk;
+		chunk.address = chunks.addresses[i];
+		chunk.data_offset = data_offset + i * (uint64_t) CHUNK_SIZE;
+		fwrite(&chunk, sizeof(chunk), 1, file);
+	}
+
+	fseek(file, (long) data_offset, SEEK_SET);
+	if (chunks.nr_chunks > 0)
+		fwrite(chunks.data, CHUNK_SIZE, chunks.nr_chunks, file);
+
+	if (ferror(file))
+		failed = 1;
+	if (fclose(file) != 0)
+		failed = 1;
+
+	if (!failed)
+	{
+		remove(filename);
+		failed = rename(tmp_filename, filename) != 0;
+	}
+	if (failed)
+		fprintf(stderr, "Could not write checkpoint %s\n", filename);
+
+	free(tmp_filename);
+	free(models.bytes);
+	free(chunks.addresses);
+	free(chunks.data);
+	return failed;
+}
+
+int RestoreCheckpoint(const char* filename)
+{
+	const unsigned char* contents;
+	const CheckpointHeader* header;
+	const CheckpointInstr* instrs;
+	const CheckpointChunk* chunks;
+	CheckpointState models = { NULL, 0, 0, 0, 0, 0 };
+	long long registers[32];
+	uint64_t size, i;
+	int failed = 0;
+
+	// Map (or, where mmap is unavailable, read) the whole file
+#ifndef _WIN32
+	struct stat st;
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0 || fstat(fd, &st) != 0)
+	{
+		fprintf(stderr, "Could not open file %s for reading\n", filename);
+		if (fd >= 0)
+			close(fd);
+		return 1;
+	}
+	size = (uint64_t) st.st_size;
+	contents = size > 0 ? (const unsigned char*) mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+	close(fd);
+	if (contents == NULL || contents == MAP_FAILED)
+	{
+		fprintf(stderr, "Could not map file %s\n", filename);
+		return 1;
+	}
+#else
+	FILE* file = fopen(filename, "rb");
+	unsigned char* buffer;
+	if (file == NULL)
+	{
+		fprintf(stderr, "Could not open file %s for reading\n", filename);
+		return 1;
+	}
+	fseek(file, 0, SEEK_END);
+	size = (uint64_t) ftell(file);
+	fseek(file, 0, SEEK_SET);
+	buffer = (unsigned char*) malloc(size > 0 ? size : 1);
+	size = fread(buffer, 1, size, file);
+	fclose(file);
+	contents = buffer;
+#endif
+
+	header = (const CheckpointHeader*) contents;
+	if (size < sizeof(CheckpointHeader) || memcmp(header->magic, CHECKPOINT_MAGIC, sizeof(header->magic)) != 0)
+	{
+		fprintf(stderr, "%s is not a checkpoint file\n", filename);
+		failed = 1;
+	}
+	else if (header->version != CHECKPOINT_VERSION || header->byte_order_mark != BYTE_ORDER_MARK)
+	{
+		fprintf(stderr, "Checkpoint %s has version %u, but version %d is required\n",
+			filename, (unsigned) header->version, CHECKPOINT_VERSION);
+		failed = 1;
+	}
+	else if (header->file_size != size)
+	{
+		fprintf(stderr, "Checkpoint %s is truncated\n", filename);
+		failed = 1;
+	}
+	else if (!AreSectionsValid(contents, size))
+	{
+		fprintf(stderr, "Checkpoint %s is corrupt\n", filename);
+		failed = 1;
+	}
+	else if (header->delay_slots != AreDelaySlotsOn())
+	{
+		fprintf(stderr, "Checkpoint %s was saved with the delay slots turned %s\n",
+			filename, header->delay_slots ? "on" : "off");
+		failed = 1;
+	}
+	else if (header->early_branch_resolution != IsEarlyBranchResolutionOn())
+	{
+		fprintf(stderr, "Checkpoint %s was saved with the early branch resolution turned %s\n",
+			filename, header->early_branch_resolution ? "on" : "off");
+		failed = 1;
+	}
+
+	// The state of the timing models is restored first, so that nothing else is
+	// restored if the models are configured differently
+	if (!failed)
+	{
+		models.bytes = (unsigned char*) (contents + header->models_offset);
+		models.size = header->models_size;
+		for (i = 0; i < NR_OF_MODEL_CHECKPOINTS && !failed; ++i)
+		{
+			MODEL_CHECKPOINTS[i].read(&models);
+			if (models.truncated)
+			{
+				fprintf(stderr, "Checkpoint %s is corrupt\n", filename);
+				failed = 1;
+			}
+			else if (models.failed)
+			{
+				fprintf(stderr, "Checkpoint %s was saved with another configuration of the %s\n",
+					filename, MODEL_CHECKPOINTS[i].name);
+				failed = 1;
+			}
+		}
+		if (!failed && models.position != models.size)
+		{
+			fprintf(stderr, "Checkpoint %s is corrupt\n", filename);
+			failed = 1;
+		}
+	}
+
+	if (!failed)
+	{
+		// The instruction memory must be restored before the pipeline registers,
+		// which refer to its predecoded instructions
+		InitInstrMemory(NULL);
+		instrs = (const CheckpointInstr*) (contents + header->instrs_offset);
+		for (i = 0; i < header->nr_instrs; ++i)
+		{
+			Instr instr = RestoreInstr(&instrs[i]);
+			WriteToInstrMemory(GetTextSegmentStartingAddress() + 4*i, &instr);
+		}
+
+		InitDataMemory();
+		chunks = (const CheckpointChunk*) (contents + header->chunks_offset);
+		for (i = 0; i < header->nr_chunks; ++i)
+			WriteBlockToDataMemory(chunks[i].address, contents + chunks[i].data_offset, CHUNK_SIZE);
+
+		for (i = 0; i < 32; ++i)
+			registers[i] = header->registers[i];
+		WriteAllToRegisterFile(registers);
+
+		RestoreLatches((const CheckpointLatch*) (contents + header->latches_offset));
+		SetPipelineCounters((int) header->nr_cycles, (int) header->nr_instr_retired,
+			(int) header->nr_instr_fast_forwarded);
+		stall_counts.load_use_stalls = (int) header->load_use_stalls;
+		stall_counts.branch_flushes = (int) header->branch_flushes;
+		stall_counts.jump_flushes = (int) header->jump_flushes;
+		stall_counts.jump_squashes = (int) header->jump_squashes;
+		stall_counts.branch_squashes = (int) header->branch_squashes;
+		stall_counts.fetch_stalls = (int) header->fetch_stalls;
+		stall_counts.memory_stalls = (int) header->memory_stalls;
+		stall_counts.load_miss_stalls = (int) header->load_miss_stalls;
+		stall_counts.comparator_stalls = (int) header->comparator_stalls;
+		stall_counts.early_branch_squashes = (int) header->early_branch_squashes;
+		SetDelaySlotFillingCounts(header->nr_moved_into_slots, header->nr_nops_in_slots);
+	}
+
+#ifndef _WIN32
+	munmap((void*) contents, size);
+#else
+	free(buffer);
+#endif
+	return failed;
+}
@@ -0,0 +1,71 @@
+/** @file checkpoint.h
+	Saving and restoring the complete state of the simulator: the register file, the
+	instruction and data memories, the pipeline registers, the cycle, instruction and
+	stall counters, and the state and statistics of the timing models: the caches, their
+	prefetchers, the MSHRs, the DRAM, the TLBs, the store buffer, the branch predictor,
+	the BTB and the return address stack. A restored simulation thus takes the same
+	number of cycles as the one that saved the checkpoint. The timing models, the delay
+	slots and the early branch resolution must be configured in the same way as when the
+	checkpoint was saved; checkpoints saved with another configuration are rejected.
+
+	A checkpoint file starts with a fixed-size header, followed by the instruction
+	memory, the pipeline registers, the state of the timing models and a table of data
+	memory chunks. Only the 4 KiB chunks of the data memory that contain non-zero bytes
+	are stored. The chunks are aligned to 4 KiB in the file, so the file can be
+	memory-mapped and the chunks copied straight into the data memory. The header holds
+	a version number, and files with another version are rejected. */
+
+#ifndef CHECKPOINT_H_INCL
+#define CHECKPOINT_H_INCL
+
+/** The version of the checkpoint file format. Must be increased whenever the
+	format changes. */
+#define CHECKPOINT_VERSION 13
+
+#include <stdint.h>
+#include <stddef.h>
+
+/** The state of the timing models in a checkpoint. When a checkpoint is saved, each
+	model appends its configuration and its state with PutCheckpointState(). When it is
+	restored, each model checks its configuration with CheckCheckpointConfig() and reads
+	its state back in the same order with GetCheckpointState(). */
+typedef struct CheckpointState
+{
+	unsigned char* bytes;
+	uint64_t size;
+	uint64_t capacity;
+
+	/** The offset of the next byte to read */
+	uint64_t position;
+
+	/** Set when a read runs past the end of the state, or a configuration differs */
+	int failed;
+
+	/** Set when a read runs past the end of the state */
+	int truncated;
+}
+CheckpointState;
+
+/** Append the @a size bytes at @a data to the state */
+void PutCheckpointState(CheckpointState* state, const void* data, size_t size);
+
+/** Read the next @a size bytes of the state into @a data. Nothing is read once
+	failed has been set. */
+void GetCheckpointState(CheckpointState* state, void* data, size_t size);
+
+/** Read a configuration of @a size bytes, and set failed if it differs from the
+	current configuration @a config */
+void CheckCheckpointConfig(CheckpointState* state, const void* config, size_t size);
+
+/** Save the current state of the simulator to the file @a filename. The file is
+	first written under a temporary name and then renamed, so that an existing
+	checkpoint is never left half-written.
+	@return 0 if the checkpoint was written, 1 otherwise */
+int SaveCheckpoint(const char* filename);
+
+/** Restore the state of the simulator from the file @a filename. This replaces
+	InitPipeline(); the simulation can then be continued with RunProgram().
+	@return 0 if the checkpoint was restored, 1 otherwise */
+int RestoreCheckpoint(const char* filename);
+
+#endif // ifndef CHECKPOINT_H_INCL
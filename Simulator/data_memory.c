@@ -7,6 +7,35 @@
 #include <assert.h>
 #include <string.h>
 
+// On 64-bit Linux hosts the simulated address space is mapped directly onto host
+// virtual memory, unless NO_DIRECT_MAPPING is defined
+#if defined(__linux__) && defined(__LP64__) && !defined(NO_DIRECT_MAPPING)
+#	define DIRECT_MAPPING
+#	include <sys/mman.h>
+#	include <signal.h>
+#	include <stdatomic.h>
+#	include <unistd.h>
+#endif
+
+// The byte order of the host
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#	define HOST_IS_BIG_ENDIAN 1
+#else
+#	define HOST_IS_BIG_ENDIAN 0
+#endif
+
+#if defined(__GNUC__)
+#	define BYTE_SWAP_16(x) __builtin_bswap16(x)
+#	define BYTE_SWAP_32(x) __builtin_bswap32(x)
+#elif defined(_MSC_VER)
+#	define BYTE_SWAP_16(x) _byteswap_ushort(x)
+#	define BYTE_SWAP_32(x) _byteswap_ulong(x)
+#else
+#	define BYTE_SWAP_16(x) ((uint16_t) (((x) >> 8) | ((x) << 8)))
+#	define BYTE_SWAP_32(x) ((((x) >> 24) & 0xFF) | (((x) >> 8) & 0xFF00) \
+		| (((x) << 8) & 0xFF0000) | ((x) << 24))
+#endif
+
 typedef enum Endianness { LITTLE, BIG } Endianness;
 
 //const Endianness endianness = LITTLE;
@@ -18,10 +47,295 @@ const long long DATA_SEG_START = 0x10000000LL;
 // The end address of (the lowest address not part of) the stack segment
 const long long STACK_SEG_END = 0x7FFFFFFFLL;
 
-static uint8_t* data_seg, * stack_seg;
-static long long ds_start, ss_end, ss_start;
-static long ds_buf_size, ss_buf_size;
-static long long ds_alloc[2], ss_alloc[2];
+// The memory is divided into pages, which are allocated when they are first written
+// to. The pages are found through a two-level page table: the upper bits of the page
+// number select a table, and the lower bits select the page in the table.
+#define PAGE_BITS 12
+#define PAGE_SIZE (1 << PAGE_BITS)
+#define TABLE_BITS 10
+#define TABLE_SIZE (1 << TABLE_BITS)
+#define NR_OF_TABLES (1 << (32 - PAGE_BITS - TABLE_BITS))
+
+static uint8_t** page_tables[NR_OF_TABLES];
+
+// Pages that have not been written to read as zeros
+static const uint8_t zero_page[PAGE_SIZE];
+
+// The most recently used page, which is usually the next one to be used too
+static long long last_page_nr = -1;
+static uint8_t* last_page;
+
+// Whether last_page may be written to, i.e., is not shared with the snapshot
+static int last_page_writable;
+
+// Set while a snapshot saved by SaveDataMemorySnapshot() exists
+static int snapshot_saved;
+
+// The pages written to since the snapshot was saved or last restored. These are page
+// numbers when the memory is paged, and host page indices in the accessible range
+// when it is mapped directly.
+static long* dirty_pages;
+static long nr_dirty_pages, dirty_pages_capacity;
+
+// The page tables of the snapshot when the memory is paged. A page that has not been
+// written to since the snapshot was saved is shared by the snapshot and the memory,
+// and the first write to it gives the memory a copy of its own.
+static uint8_t** snapshot_tables[NR_OF_TABLES];
+
+#ifdef DIRECT_MAPPING
+
+// When the memory is mapped directly, the byte at the simulated address a is at
+// memory_base + a on the host. Host memory is reserved for every address that fits in
+// a register, but only the data and stack segments are accessible. The rest is a
+// guard region: accesses to it raise a SIGSEGV, which is turned into a MIPS runtime
+// error. Host pages are committed by the OS when they are first touched. If the
+// memory cannot be reserved, memory_base is NULL and the pages above are used.
+static uint8_t* memory_base;
+
+// The range of simulated addresses that is reserved: all values that fit in a
+// register, plus room for an access at the highest one
+#define RESERVED_START (-(1LL << 31))
+#define RESERVED_END ((1LL << 32) + PAGE_SIZE)
+
+// The accessible part of the reserved range. Its end is the end of the stack segment
+// rounded up to a page, so accesses to the last bytes below STACK_SEG_END must be
+// checked explicitly.
+#define ACCESSIBLE_START DATA_SEG_START
+#define ACCESSIBLE_END 0x80000000LL
+
+static int reservation_failed;
+
+// The size of the host pages, which are the unit of dirty tracking for snapshots, and
+// its base 2 logarithm
+static long host_page_size;
+static int host_page_bits;
+#define NR_OF_HOST_PAGES ((long) ((ACCESSIBLE_END - ACCESSIBLE_START) / host_page_size))
+
+// While a snapshot is saved, the accessible range is write-protected, and the first
+// write to each page faults. snapshot_copies holds the host pages that had been
+// touched when the snapshot was saved, indexed by host page. If a written page
+// cannot be made writable on its own, the whole range is made writable and
+// all_pages_dirty is set, so that the whole range is restored.
+static uint8_t** snapshot_copies;
+static int all_pages_dirty;
+
+// Whether each host page in the accessible range has been written to since the
+// memory was initialized, indexed by host page
+static unsigned char* written_pages;
+
+// Set while the simulator accesses the memory, so that the SIGSEGV handler only
+// handles faults raised by those accesses. When an access hits the guard region, the
+// handler sets guard_fault and stores the address of the access.
+static volatile sig_atomic_t accessing_memory;
+static volatile sig_atomic_t guard_fault;
+static volatile long long guard_fault_address;
+
+static uint8_t* GetHostPage(long page)
+{
+	return memory_base + ACCESSIBLE_START + (long long) page * host_page_size;
+}
+
+static void HandleGuardFault(int sig, siginfo_t* info, void* context)
+{
+	long long address = (long long) ((uint8_t*) info->si_addr - memory_base);
+
+	(void) sig;
+	(void) context;
+	if (!accessing_memory || address < RESERVED_START || address >= RESERVED_END)
+	{
+		// Not an access to the simulated memory, so crash as usual when the
+		// instruction is restarted
+		signal(SIGSEGV, SIG_DFL);
+		return;
+	}
+
+	// The first write to a page since the snapshot was saved: record the page as
+	// dirty and make it writable, and the write is restarted
+	if (snapshot_saved && address >= ACCESSIBLE_START && address < ACCESSIBLE_END)
+	{
+		long page = (long) ((address - ACCESSIBLE_START) / host_page_size);
+
+		if (mprotect(GetHostPage(page), host_page_size, PROT_READ | PROT_WRITE) == 0)
+			dirty_pages[nr_dirty_pages++] = page;
+		else if (mprotect(memory_base + ACCESSIBLE_START, ACCESSIBLE_END - ACCESSIBLE_START,
+			PROT_READ | PROT_WRITE) == 0)
+			all_pages_dirty = 1;
+		else
+			signal(SIGSEGV, SIG_DFL);
+		return;
+	}
+
+	// Accesses are aligned, so they do not cross a page boundary, and each value is
+	// accessed with a single host load or store. The fault is thus at the address
+	// of the access. Reporting the error is not async-signal-safe, so the guard page
+	// is made accessible for the restarted access, and the error is reported after it.
+	guard_fault = 1;
+	guard_fault_address = address;
+	if (mprotect(memory_base + (address & ~(long long) (host_page_size - 1)), host_page_size,
+		PROT_READ | PROT_WRITE) != 0)
+		signal(SIGSEGV, SIG_DFL);
+}
+
+// Report the access that hit the guard region, after it has completed
+static void ReportGuardFault()
+{
+	uint8_t* page = memory_base + (guard_fault_address & ~(long long) (host_page_size - 1));
+
+	madvise(page, host_page_size, MADV_DONTNEED);
+	mprotect(page, host_page_size, PROT_NONE);
+	guard_fault = 0;
+
+	if (guard_fault_address < DATA_SEG_START)
+		MIPS_RUNTIME_ERROR("The address 0x%llx points below the data segment", guard_fault_address)
+	MIPS_RUNTIME_ERROR("The address 0x%llx points above the stack segment", guard_fault_address)
+}
+
+static void ReserveMemory()
+{
+	struct sigaction action;
+	uint8_t* reserved = (uint8_t*) mmap(NULL, RESERVED_END - RESERVED_START, PROT_NONE,
+		MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+	if (reserved == MAP_FAILED)
+	{
+		reservation_failed = 1;
+		return;
+	}
+	if (mprotect(reserved - RESERVED_START + ACCESSIBLE_START, ACCESSIBLE_END - ACCESSIBLE_START,
+		PROT_READ | PROT_WRITE) != 0)
+	{
+		munmap(reserved, RESERVED_END - RESERVED_START);
+		reservation_failed = 1;
+		return;
+	}
+	memory_base = reserved - RESERVED_START;
+	host_page_size = sysconf(_SC_PAGESIZE);
+	for (host_page_bits = 0; (1L << host_page_bits) < host_page_size; ++host_page_bits)
+		;
+	written_pages = (unsigned char*) calloc(NR_OF_HOST_PAGES, 1);
+
+	memset(&action, 0, sizeof(action));
+	action.sa_sigaction = HandleGuardFault;
+	action.sa_flags = SA_SIGINFO;
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGSEGV, &action, NULL);
+}
+
+// Call the visitor for each run of host pages in the accessible range that have been
+// written to
+static void VisitMappedMemory(DataMemoryVisitor visitor, void* context)
+{
+	long nr_host_pages = NR_OF_HOST_PAGES;
+	long p = 0, q;
+
+	while (p < nr_host_pages)
+	{
+		if (!written_pages[p])
+		{
+			++p;
+			continue;
+		}
+		for (q = p; q < nr_host_pages && written_pages[q]; ++q)
+			;
+		visitor(ACCESSIBLE_START + (long long) p * host_page_size,
+			memory_base + ACCESSIBLE_START + (long long) p * host_page_size,
+			(q - p) * host_page_size, context);
+		p = q;
+	}
+}
+
+static void CopyToSnapshot(long long address, const unsigned char* bytes, long nr_bytes, void* context)
+{
+	long first = (long) ((address - ACCESSIBLE_START) / host_page_size);
+	long p;
+
+	(void) context;
+	for (p = 0; p < nr_bytes / host_page_size; ++p)
+	{
+		snapshot_copies[first + p] = (uint8_t*) malloc(host_page_size);
+		memcpy(snapshot_copies[first + p], bytes + p * host_page_size, host_page_size);
+	}
+}
+
+static void SaveMappedSnapshot()
+{
+	if (snapshot_copies == NULL)
+	{
+		snapshot_copies = (uint8_t**) calloc(NR_OF_HOST_PAGES, sizeof(uint8_t*));
+
+		// Each page becomes dirty at most once, so the signal handler never has to
+		// allocate memory
+		dirty_pages = (long*) malloc(NR_OF_HOST_PAGES * sizeof(long));
+		dirty_pages_capacity = NR_OF_HOST_PAGES;
+	}
+	VisitMappedMemory(CopyToSnapshot, NULL);
+	all_pages_dirty = mprotect(memory_base + ACCESSIBLE_START, ACCESSIBLE_END - ACCESSIBLE_START, PROT_READ) != 0;
+}
+
+static void RestoreMappedPage(long page)
+{
+	if (snapshot_copies[page] != NULL)
+		memcpy(GetHostPage(page), snapshot_copies[page], host_page_size);
+	else
+		madvise(GetHostPage(page), host_page_size, MADV_DONTNEED);
+	written_pages[page] = snapshot_copies[page] != NULL;
+}
+
+static void RestoreMappedSnapshot()
+{
+	long p;
+
+	if (all_pages_dirty)
+	{
+		for (p = 0; p < NR_OF_HOST_PAGES; ++p)
+			RestoreMappedPage(p);
+		all_pages_dirty = mprotect(memory_base + ACCESSIBLE_START, ACCESSIBLE_END - ACCESSIBLE_START,
+			PROT_READ) != 0;
+		return;
+	}
+
+	for (p = 0; p < nr_dirty_pages; ++p)
+	{
+		RestoreMappedPage(dirty_pages[p]);
+		if (mprotect(GetHostPage(dirty_pages[p]), host_page_size, PROT_READ) != 0)
+			all_pages_dirty = 1;
+	}
+}
+
+static void DiscardMappedSnapshot()
+{
+	long p;
+
+	for (p = 0; p < NR_OF_HOST_PAGES; ++p)
+	{
+		free(snapshot_copies[p]);
+		snapshot_copies[p] = NULL;
+	}
+	mprotect(memory_base + ACCESSIBLE_START, ACCESSIBLE_END - ACCESSIBLE_START, PROT_READ | PROT_WRITE);
+	all_pages_dirty = 0;
+}
+
+#endif // ifdef DIRECT_MAPPING
+
+// The log of overwritten values, used to undo writes
+static int write_logging;
+static DataMemoryWrite* write_log;
+static long write_log_length, write_log_capacity;
+
+static void LogWrite(long long address, int nr_bytes)
+{
+	DataMemoryWrite* entry;
+
+	if (write_log_length == write_log_capacity)
+	{
+		write_log_capacity = 2*write_log_capacity + 64;
+		write_log = (DataMemoryWrite*) realloc(write_log, write_log_capacity * sizeof(DataMemoryWrite));
+	}
+	entry = &write_log[write_log_length++];
+	entry->address = address;
+	entry->nr_bytes = nr_bytes;
+	entry->old_value = ReadFromDataMemory(address, nr_bytes, 1);
+}
 
 static void ValidateAddress(long long address, int nr_bytes)
 {
@@ -35,111 +349,303 @@ static void ValidateAddress(long long address, int nr_bytes)
 		MIPS_RUNTIME_ERROR("Address 0x%llx is not %d-byte aligned", address, nr_bytes)
 }
 
-static void AdjustBuffers(long long address, int nr_bytes)
+static uint8_t* GetSnapshotPage(long long page_nr)
 {
-	long ds_buf_ind, ss_buf_ind;
-	long ds_incr, ss_incr;
+	uint8_t** table = snapshot_tables[page_nr >> TABLE_BITS];
+	return table != NULL ? table[page_nr & (TABLE_SIZE - 1)] : NULL;
+}
 
-	// Translate the address to indices into the data_seg and stack_seg buffers
-	ds_buf_ind = (long) (address - ds_start);
-	ss_buf_ind = (long) (address - ss_start);
+static void AddDirtyPage(long page)
+{
+	if (nr_dirty_pages == dirty_pages_capacity)
+	{
+		dirty_pages_capacity = 2*dirty_pages_capacity + 64;
+		dirty_pages = (long*) realloc(dirty_pages, dirty_pages_capacity * sizeof(long));
+	}
+	dirty_pages[nr_dirty_pages++] = page;
+}
 
-	// If a write of nr_bytes fits inside some of the two buffers,
-	// they don't need to be enlarged
-	if (ds_buf_ind + nr_bytes <= ds_buf_size || ss_buf_ind >= 0)
-		return;
+// Return the page holding the address @a address. If it has not been allocated, it
+// is allocated if @a allocate is set, otherwise NULL is returned.
+static uint8_t* GetPage(long long address, int allocate)
+{
+	long long page_nr = address >> PAGE_BITS;
+	uint8_t*** table;
+	uint8_t** page;
 
-	// One of the buffers must be enlarged - compute the amount
-	ds_incr = ds_buf_ind + nr_bytes - ds_buf_size;
-	ss_incr = -ss_buf_ind;
-
-	// Enlarge the buffer that needs to be enlarged by the least amount
-	if (ds_incr <= ss_incr)
-	{
-		// Allocate a new data_seg buffer that is twice the old size plus
-		// the extra elements
-		uint8_t* new_data_seg;
-		int prev_dsbs = ds_buf_size;
-		ds_buf_size = 2*(ds_buf_size + ds_incr);
-		new_data_seg = (uint8_t*) calloc(ds_buf_size, sizeof(uint8_t));
-		memcpy(new_data_seg, data_seg, prev_dsbs * sizeof(uint8_t));
-		free(data_seg);
-		data_seg = new_data_seg;
-		return;
+	if (page_nr == last_page_nr && (last_page_writable || !allocate))
+		return last_page;
+
+	table = &page_tables[page_nr >> TABLE_BITS];
+	if (*table == NULL)
+	{
+		if (!allocate)
+			return NULL;
+		*table = (uint8_t**) calloc(TABLE_SIZE, sizeof(uint8_t*));
 	}
-	else
+	page = &(*table)[page_nr & (TABLE_SIZE - 1)];
+	if (allocate && snapshot_saved && *page == GetSnapshotPage(page_nr))
 	{
-		// Allocate a new stack_seg buffer that is twice the old size plus
-		// the extra elements
-		uint8_t* new_stack_seg;
-		int prev_ssbs = ss_buf_size;
-		ss_buf_size = 2*(ss_buf_size + ss_incr);
-		new_stack_seg = (uint8_t*) calloc(ss_buf_size, sizeof(uint8_t));
-		memcpy(new_stack_seg + ss_incr, stack_seg, prev_ssbs * sizeof(uint8_t));
-		free(stack_seg);
-		stack_seg = new_stack_seg;
-		ss_start = STACK_SEG_END - ss_buf_size;
-		return;
+		// The first write since the snapshot was saved
+		uint8_t* copy = (uint8_t*) malloc(PAGE_SIZE);
+		memcpy(copy, *page != NULL ? *page : zero_page, PAGE_SIZE);
+		*page = copy;
+		AddDirtyPage((long) page_nr);
+	}
+	else if (*page == NULL)
+	{
+		if (!allocate)
+			return NULL;
+		*page = (uint8_t*) calloc(PAGE_SIZE, sizeof(uint8_t));
 	}
+
+	last_page_nr = page_nr;
+	last_page = *page;
+	last_page_writable = !snapshot_saved || *page != GetSnapshotPage(page_nr);
+	return *page;
 }
 
-static long long ReadFromBuffer(uint8_t* buffer, long buf_ind, int nr_bytes)
+static void SavePagedSnapshot()
 {
-	long long value = 0;
-	int b;
-	if (endianness == LITTLE)
-		for (b = nr_bytes - 1; b >= 0; --b)
+	int t;
+
+	for (t = 0; t < NR_OF_TABLES; ++t)
+		if (page_tables[t] != NULL)
 		{
-			value <<= 8;
-			value |= buffer[buf_ind + b];
+			snapshot_tables[t] = (uint8_t**) malloc(TABLE_SIZE * sizeof(uint8_t*));
+			memcpy(snapshot_tables[t], page_tables[t], TABLE_SIZE * sizeof(uint8_t*));
 		}
+}
+
+static void RestorePagedSnapshot()
+{
+	long p;
+
+	// The written pages are the memory's own copies, so they are freed and the
+	// snapshot's pages are shared again
+	for (p = 0; p < nr_dirty_pages; ++p)
+	{
+		uint8_t** page = &page_tables[dirty_pages[p] >> TABLE_BITS][dirty_pages[p] & (TABLE_SIZE - 1)];
+		free(*page);
+		*page = GetSnapshotPage(dirty_pages[p]);
+	}
+}
+
+static void DiscardPagedSnapshot()
+{
+	long p;
+	int t;
+
+	// The memory keeps the pages that it shares with the snapshot, and the snapshot's
+	// versions of the written pages are no longer needed
+	for (p = 0; p < nr_dirty_pages; ++p)
+		free(GetSnapshotPage(dirty_pages[p]));
+	for (t = 0; t < NR_OF_TABLES; ++t)
+	{
+		free(snapshot_tables[t]);
+		snapshot_tables[t] = NULL;
+	}
+}
+
+static void DiscardSnapshot()
+{
+	if (!snapshot_saved)
+		return;
+
+#ifdef DIRECT_MAPPING
+	if (memory_base != NULL)
+		DiscardMappedSnapshot();
 	else
-		for (b = 0; b < nr_bytes; ++b)
-		{
-			value <<= 8;
-			value |= buffer[buf_ind + b];
-		}
+#endif
+		DiscardPagedSnapshot();
+	snapshot_saved = 0;
+	nr_dirty_pages = 0;
+	last_page_nr = -1;
+}
+
+// Accessors for aligned 16- and 32-bit values. Each does a single host load or store
+// (a memcpy of a constant size compiles to one), and the swapped ones also swap the
+// bytes. The ones to use are selected by InitDataMemory().
+typedef struct ValueAccessors
+{
+	uint16_t (*load_16)(const uint8_t* bytes);
+	uint32_t (*load_32)(const uint8_t* bytes);
+	void (*store_16)(uint8_t* bytes, uint16_t value);
+	void (*store_32)(uint8_t* bytes, uint32_t value);
+}
+ValueAccessors;
+
+static uint16_t Load16(const uint8_t* bytes)
+{
+	uint16_t value;
+	memcpy(&value, bytes, sizeof(value));
 	return value;
 }
 
-static void WriteToBuffer(uint8_t* buffer, long buf_ind, long long value, int nr_bytes)
+static uint32_t Load32(const uint8_t* bytes)
+{
+	uint32_t value;
+	memcpy(&value, bytes, sizeof(value));
+	return value;
+}
+
+static void Store16(uint8_t* bytes, uint16_t value)
+{
+	memcpy(bytes, &value, sizeof(value));
+}
+
+static void Store32(uint8_t* bytes, uint32_t value)
+{
+	memcpy(bytes, &value, sizeof(value));
+}
+
+static uint16_t Load16Swapped(const uint8_t* bytes)
+{
+	return BYTE_SWAP_16(Load16(bytes));
+}
+
+static uint32_t Load32Swapped(const uint8_t* bytes)
+{
+	return BYTE_SWAP_32(Load32(bytes));
+}
+
+static void Store16Swapped(uint8_t* bytes, uint16_t value)
 {
-	long long mask = CreateLLMask(0, 8*nr_bytes);
-	long long inv_mask = ~mask;
-	long long most_sig_bits = value & inv_mask;
-	assert(most_sig_bits == 0ll || most_sig_bits == inv_mask);
-	if (endianness == LITTLE)
+	Store16(bytes, BYTE_SWAP_16(value));
+}
+
+static void Store32Swapped(uint8_t* bytes, uint32_t value)
+{
+	Store32(bytes, BYTE_SWAP_32(value));
+}
+
+static const ValueAccessors host_order_accessors = { Load16, Load32, Store16, Store32 };
+static const ValueAccessors swapped_accessors = { Load16Swapped, Load32Swapped, Store16Swapped, Store32Swapped };
+static const ValueAccessors* accessors = &host_order_accessors;
+
+static long long LoadValue(const uint8_t* bytes, int nr_bytes, int read_unsigned)
+{
+	switch (nr_bytes)
 	{
-		int b;
-		for (b = 0; b < nr_bytes; ++b)
-		{
-			buffer[buf_ind + b] = (uint8_t) value & mask;
-			value >>= 8;
-		}
+	case 4:
+	{
+		uint32_t value = accessors->load_32(bytes);
+		return read_unsigned ? (long long) value : (long long) (int32_t) value;
 	}
-	else
+	case 2:
 	{
-		int b;
-		for (b = nr_bytes - 1; b >= 0; --b)
-		{
-			buffer[buf_ind + b] = (uint8_t) value & mask;
-			value >>= 8;
-		}
+		uint16_t value = accessors->load_16(bytes);
+		return read_unsigned ? (long long) value : (long long) (int16_t) value;
+	}
+	default:
+		return read_unsigned ? (long long) bytes[0] : (long long) (int8_t) bytes[0];
 	}
 }
 
+static void StoreValue(uint8_t* bytes, long long value, int nr_bytes)
+{
+	// The bits that do not fit must be a sign extension, or zero
+	long long high_bits = value >> 8*nr_bytes;
+	assert(high_bits == 0 || high_bits == -1);
+
+	switch (nr_bytes)
+	{
+	case 4:
+		accessors->store_32(bytes, (uint32_t) value);
+		break;
+	case 2:
+		accessors->store_16(bytes, (uint16_t) value);
+		break;
+	default:
+		bytes[0] = (uint8_t) value;
+	}
+}
+
+#ifdef DIRECT_MAPPING
+
+// Mark the start and the end of an access to the memory. The fences keep the compiler
+// from moving the access out from between them.
+static void BeginMappedAccess()
+{
+	accessing_memory = 1;
+	atomic_signal_fence(memory_order_seq_cst);
+}
+
+static void EndMappedAccess()
+{
+	atomic_signal_fence(memory_order_seq_cst);
+	accessing_memory = 0;
+	if (guard_fault)
+		ReportGuardFault();
+}
+
+// Load a value from the memory at the address, which must be aligned
+static long long LoadMappedValue(long long address, int nr_bytes, int read_unsigned)
+{
+	long long value;
+
+	BeginMappedAccess();
+	value = LoadValue(memory_base + address, nr_bytes, read_unsigned);
+	EndMappedAccess();
+	return value;
+}
+
+// Store a value to the memory at the address, which must be aligned, and record the
+// host page as written
+static void StoreMappedValue(long long address, long long value, int nr_bytes)
+{
+	BeginMappedAccess();
+	StoreValue(memory_base + address, value, nr_bytes);
+	EndMappedAccess();
+	written_pages[(address - ACCESSIBLE_START) >> host_page_bits] = 1;
+}
+
+// Copy a block to the memory. The block must lie inside the segments.
+static void StoreMappedBlock(long long address, const unsigned char* bytes, long nr_bytes)
+{
+	long p;
+
+	BeginMappedAccess();
+	memcpy(memory_base + address, bytes, nr_bytes);
+	EndMappedAccess();
+	for (p = (long) ((address - ACCESSIBLE_START) >> host_page_bits);
+		p <= (long) ((address + nr_bytes - 1 - ACCESSIBLE_START) >> host_page_bits); ++p)
+		written_pages[p] = 1;
+}
+
+#endif // ifdef DIRECT_MAPPING
+
 // Public functions - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - 
 
 void InitDataMemory()
 {
-	ds_buf_size = 10;
-	ss_buf_size = 10;
+	int t, p;
 
-	data_seg = (uint8_t*) calloc(ds_buf_size, sizeof(uint8_t));
-	stack_seg = (uint8_t*) calloc(ss_buf_size, sizeof(uint8_t));
+	accessors = (endianness == BIG) == HOST_IS_BIG_ENDIAN ? &host_order_accessors : &swapped_accessors;
+	DiscardSnapshot();
 
-	ds_start = DATA_SEG_START;
-	ss_start = STACK_SEG_END - ss_buf_size;
+#ifdef DIRECT_MAPPING
+	if (memory_base == NULL && !reservation_failed)
+		ReserveMemory();
+	if (memory_base != NULL)
+	{
+		// Give the touched pages back to the OS, so that they read as zeros again
+		madvise(memory_base + ACCESSIBLE_START, ACCESSIBLE_END - ACCESSIBLE_START, MADV_DONTNEED);
+		memset(written_pages, 0, NR_OF_HOST_PAGES);
+		return;
+	}
+#endif
+
+	for (t = 0; t < NR_OF_TABLES; ++t)
+		if (page_tables[t] != NULL)
+		{
+			for (p = 0; p < TABLE_SIZE; ++p)
+				free(page_tables[t][p]);
+			free(page_tables[t]);
+			page_tables[t] = NULL;
+		}
+	last_page_nr = -1;
+	last_page = NULL;
 }
 
 long long GetDataSegmentStartingAddress()
@@ -147,72 +653,217 @@ long long GetDataSegmentStartingAddress()
 	return DATA_SEG_START;
 }
 
+long long GetStackSegmentEndAddress()
+{
+	return STACK_SEG_END;
+}
+
 long long ReadFromDataMemory(long long address, int nr_bytes, int read_unsigned)
 {
-	long long ds_buf_ind, ss_buf_ind, read_value;
+	const uint8_t* page;
+	const uint8_t* bytes;
 
-	ValidateAddress(address, nr_bytes);
-	if (nr_bytes < 0 || nr_bytes > 4)
+	if (nr_bytes != 1 && nr_bytes != 2 && nr_bytes != 4)
 		FAILED_ASSERTION("Cannot read %d bytes from the data memory", nr_bytes);
 
-	// Translate the address to indices into the data_seg and stack_seg buffers
-	ds_buf_ind = address - ds_start;
-	ss_buf_ind = address - ss_start;
-
-	// Read from the appropriate buffer
-	if (ds_buf_ind + nr_bytes <= ds_buf_size)
-		read_value = ReadFromBuffer(data_seg, (long) ds_buf_ind, nr_bytes);
-	else
-		read_value = ReadFromBuffer(stack_seg, (long) ss_buf_ind, nr_bytes);
-
-	// Sign extend if requested
-	if (!read_unsigned)
+#ifdef DIRECT_MAPPING
+	if (memory_base != NULL)
 	{
-		// Check if the most significant bit is a one, in which case
-		// the sign-extended value should be negative
-		long long bit_mask = 1LL << (8*nr_bytes - 1);
-		long long masked = read_value & bit_mask;
-		if (masked != 0)
-		{
-			long long ext = CreateLLMask(8*nr_bytes, 8*sizeof(long long));
-			return read_value | ext;
-		}
+		// Other accesses outside the segments hit the guard region
+		if ((address & (nr_bytes - 1)) != 0 || address >= STACK_SEG_END - 4)
+			ValidateAddress(address, nr_bytes);
+		return LoadMappedValue(address, nr_bytes, read_unsigned);
 	}
+#endif
 
-	return read_value;
+	// The address is aligned, so the value does not cross a page boundary
+	ValidateAddress(address, nr_bytes);
+	page = GetPage(address, 0);
+	bytes = (page != NULL ? page : zero_page) + (address & (PAGE_SIZE - 1));
+	return LoadValue(bytes, nr_bytes, read_unsigned);
 }
 
 void WriteToDataMemory(long long address, long long value, int nr_bytes)
 {
-	long long ds_buf_ind, ss_buf_ind;
+	if (nr_bytes != 1 && nr_bytes != 2 && nr_bytes != 4)
+		FAILED_ASSERTION("Cannot write %d bytes to the data memory", nr_bytes);
+
+#ifdef DIRECT_MAPPING
+	if (memory_base != NULL)
+	{
+		// Other accesses outside the segments hit the guard region
+		if ((address & (nr_bytes - 1)) != 0 || address >= STACK_SEG_END - 4)
+			ValidateAddress(address, nr_bytes);
+		if (write_logging)
+			LogWrite(address, nr_bytes);
+		StoreMappedValue(address, value, nr_bytes);
+		return;
+	}
+#endif
 
 	ValidateAddress(address, nr_bytes);
-	if (nr_bytes < 0 || nr_bytes > 4)
-		FAILED_ASSERTION("Cannot write %d bytes to the data memory", nr_bytes);
+	if (write_logging)
+		LogWrite(address, nr_bytes);
+	StoreValue(GetPage(address, 1) + (address & (PAGE_SIZE - 1)), value, nr_bytes);
+}
+
+void WriteBlockToDataMemory(long long address, const unsigned char* bytes, long nr_bytes)
+{
+	if (nr_bytes <= 0)
+		return;
+	ValidateAddress(address, 1);
+	ValidateAddress(address + nr_bytes - 1, 1);
+
+#ifdef DIRECT_MAPPING
+	if (memory_base != NULL)
+	{
+		StoreMappedBlock(address, bytes, nr_bytes);
+		return;
+	}
+#endif
+
+	// Copy the block one page at a time
+	while (nr_bytes > 0)
+	{
+		long offset = (long) (address & (PAGE_SIZE - 1));
+		long size = PAGE_SIZE - offset < nr_bytes ? PAGE_SIZE - offset : nr_bytes;
+
+		memcpy(GetPage(address, 1) + offset, bytes, size);
+		address += size;
+		bytes += size;
+		nr_bytes -= size;
+	}
+}
+
+void SetDataMemoryWriteLogging(int on_off)
+{
+	write_logging = on_off;
+	write_log_length = 0;
+}
+
+long GetDataMemoryWriteLogLength()
+{
+	return write_log_length;
+}
+
+void UndoDataMemoryWrites(long length)
+{
+	int logging = write_logging;
+
+	write_logging = 0;
+	while (write_log_length > length)
+	{
+		const DataMemoryWrite* entry = &write_log[--write_log_length];
+		WriteToDataMemory(entry->address, entry->old_value, entry->nr_bytes);
+	}
+	write_logging = logging;
+}
 
-	AdjustBuffers(address, nr_bytes);
-	
-	ds_buf_ind = address - ds_start;
-	ss_buf_ind = address - ss_start;
+void DiscardDataMemoryWrites(long nr_writes)
+{
+	memmove(write_log, write_log + nr_writes, (write_log_length - nr_writes) * sizeof(DataMemoryWrite));
+	write_log_length -= nr_writes;
+}
 
-	if (ds_buf_ind + nr_bytes <= ds_buf_size)
-		WriteToBuffer(data_seg, (long) ds_buf_ind, value, nr_bytes);
+void SaveDataMemorySnapshot()
+{
+	DiscardSnapshot();
+	snapshot_saved = 1;
+	last_page_nr = -1;
+
+#ifdef DIRECT_MAPPING
+	if (memory_base != NULL)
+	{
+		SaveMappedSnapshot();
+		return;
+	}
+#endif
+	SavePagedSnapshot();
+}
+
+void RestoreDataMemorySnapshot()
+{
+	assert(snapshot_saved);
+
+#ifdef DIRECT_MAPPING
+	if (memory_base != NULL)
+		RestoreMappedSnapshot();
 	else
-		WriteToBuffer(stack_seg, (long) ss_buf_ind, value, nr_bytes);
+#endif
+		RestorePagedSnapshot();
+	nr_dirty_pages = 0;
+	last_page_nr = -1;
 }
 
-void PrintDataMemory(FILE* file)
+long GetNrOfDirtyDataMemoryPages()
+{
+	return nr_dirty_pages;
+}
+
+void VisitDataMemory(DataMemoryVisitor visitor, void* context)
 {
-	long long i, a;
-	for (i = ss_buf_size - 1, a = ss_start + ss_buf_size - 1;
-		i >= 0; --i, --a)
+	long t, p;
+
+#ifdef DIRECT_MAPPING
+	if (memory_base != NULL)
 	{
-		fprintf(file, "0x%08lx:\t%u\n", (long) a, (unsigned) stack_seg[i]);
+		VisitMappedMemory(visitor, context);
+		return;
 	}
-	fprintf(file, "...\n");
-	for (i = ds_buf_size - 1, a = ds_start + ds_buf_size - 1;
-		i >= 0; --i, --a)
+#endif
+
+	for (t = 0; t < NR_OF_TABLES; ++t)
+		if (page_tables[t] != NULL)
+			for (p = 0; p < TABLE_SIZE; ++p)
+				if (page_tables[t][p] != NULL)
+					visitor((t*TABLE_SIZE + p) * (long long) PAGE_SIZE, page_tables[t][p], PAGE_SIZE, context);
+}
+
+// Used by PrintDataMemory() to collect the regions of the data memory
+typedef struct PrintedRegions
+{
+	int nr_regions;
+	int capacity;
+	long long* addresses;
+	const unsigned char** bytes;
+	long* sizes;
+}
+PrintedRegions;
+
+static void CollectPrintedRegion(long long address, const unsigned char* bytes, long nr_bytes, void* context)
+{
+	PrintedRegions* regions = (PrintedRegions*) context;
+
+	if (regions->nr_regions == regions->capacity)
+	{
+		regions->capacity = 2*regions->capacity + 16;
+		regions->addresses = (long long*) realloc(regions->addresses, regions->capacity * sizeof(long long));
+		regions->bytes = (const unsigned char**) realloc(regions->bytes, regions->capacity * sizeof(const unsigned char*));
+		regions->sizes = (long*) realloc(regions->sizes, regions->capacity * sizeof(long));
+	}
+	regions->addresses[regions->nr_regions] = address;
+	regions->bytes[regions->nr_regions] = bytes;
+	regions->sizes[regions->nr_regions] = nr_bytes;
+	++regions->nr_regions;
+}
+
+void PrintDataMemory(FILE* file)
+{
+	PrintedRegions regions = { 0, 0, NULL, NULL, NULL };
+	int r;
+	long i;
+
+	// Print the regions from the highest address down, with "..." where the
+	// memory between them is skipped
+	VisitDataMemory(CollectPrintedRegion, &regions);
+	for (r = regions.nr_regions - 1; r >= 0; --r)
 	{
-		fprintf(file, "0x%08lx:\t%u\n", (long) a, (unsigned) data_seg[i]);
+		if (r < regions.nr_regions - 1 && regions.addresses[r] + regions.sizes[r] != regions.addresses[r + 1])
+			fprintf(file, "...\n");
+		for (i = regions.sizes[r] - 1; i >= 0; --i)
+			fprintf(file, "0x%08lx:\t%u\n", (long) (regions.addresses[r] + i), (unsigned) regions.bytes[r][i]);
 	}
+	free(regions.addresses);
+	free(regions.bytes);
+	free(regions.sizes);
 }
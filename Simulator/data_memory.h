@@ -1,6 +1,8 @@
 /** @file data_memory.h
 	The data memory. For simplicity we treat the data and instruction memories as
-	distinct entities. */
+	distinct entities. The memory is sparse: it is divided into pages that are only
+	allocated when they are written to, so any address in the data and stack
+	segments can be used without allocating the memory below it. */
 
 #ifndef DATA_MEMORY_H_INCL
 #define DATA_MEMORY_H_INCL
@@ -11,13 +13,17 @@
 #include <stdio.h>
 
 /** Initialize the data memory. This should be done at program startup, before any
-	other functions in data_memory.h are called. */
+	other functions in data_memory.h are called. Calling it again clears the memory. */
 void InitDataMemory();
 
 /** Get the starting address (the lowest address) of the data segment of
 	the process's memory space */
 long long GetDataSegmentStartingAddress();
 
+/** Get the end address (the lowest address not part of) the stack segment of
+	the process's memory space */
+long long GetStackSegmentEndAddress();
+
 /** Read a value from data memory
 	@param address The memory address to read from
 	@param nr_bytes The number of bytes to read
@@ -31,6 +37,68 @@ long long ReadFromDataMemory(long long address, int nr_bytes, int read_unsigned)
 	@param nr_bytes How much of the value to write */
 void WriteToDataMemory(long long address, long long value, int nr_bytes);
 
+/** A function that is called by VisitDataMemory() for each allocated region
+	of the data memory
+	@param address The address of the first byte of the region
+	@param bytes The contents of the region
+	@param nr_bytes The size of the region in bytes
+	@param context The context pointer given to VisitDataMemory() */
+typedef void (*DataMemoryVisitor)(long long address, const unsigned char* bytes,
+	long nr_bytes, void* context);
+
+/** Call @a visitor for each allocated region of the data memory, in order of
+	increasing addresses. All bytes outside these regions are 0. */
+void VisitDataMemory(DataMemoryVisitor visitor, void* context);
+
+/** Write the block of bytes @a bytes, of size @a nr_bytes, to the data memory,
+	starting at the address @a address. Used when restoring saved memory contents. */
+void WriteBlockToDataMemory(long long address, const unsigned char* bytes, long nr_bytes);
+
+/** An entry in the write log of the data memory */
+typedef struct DataMemoryWrite
+{
+	/** The address of the first written byte */
+	long long address;
+
+	/** The value that was overwritten, read as unsigned */
+	long long old_value;
+
+	/** The number of written bytes */
+	int nr_bytes;
+}
+DataMemoryWrite;
+
+/** Turn the write log on or off, and empty it. While it is on, the value overwritten
+	by each call to WriteToDataMemory() is recorded, so that writes can be undone. */
+void SetDataMemoryWriteLogging(int on_off);
+
+/** Return the number of writes in the write log */
+long GetDataMemoryWriteLogLength();
+
+/** Undo the most recent writes in the write log, newest first, until the log holds
+	@a length writes */
+void UndoDataMemoryWrites(long length);
+
+/** Remove the @a nr_writes oldest writes from the write log. They can no longer
+	be undone. */
+void DiscardDataMemoryWrites(long nr_writes);
+
+/** Save the current contents of the data memory as a snapshot, replacing any earlier
+	snapshot. From then on the pages that are written to are tracked, so that
+	RestoreDataMemorySnapshot() only has to restore those. Calling InitDataMemory()
+	discards the snapshot. */
+void SaveDataMemorySnapshot();
+
+/** Restore the contents of the data memory saved by SaveDataMemorySnapshot(). This
+	takes time proportional to the number of pages written to since the snapshot was
+	saved or last restored.
+	@pre SaveDataMemorySnapshot() has been called */
+void RestoreDataMemorySnapshot();
+
+/** Return the number of pages that have been written to since the snapshot was saved
+	or last restored */
+long GetNrOfDirtyDataMemoryPages();
+
 /** Print a textual representation of the data memory to the file @a file */
 void PrintDataMemory(FILE* file);
 
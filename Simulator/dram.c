@@ -0,0 +1,215 @@
+#include "dram.h"
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+typedef struct DramBank
+{
+	/** The row in the row buffer, or -1 if the bank is precharged */
+	long long open_row;
+
+	/** The first cycle in which the bank can start another access */
+	long long busy_until;
+}
+DramBank;
+
+static const DramConfig DEFAULT_DRAM_CONFIG = { 8, 2048, 1, 20, 20, 20, 8 };
+
+static int enabled;
+static DramConfig config;
+static int column_bits, bank_bits;
+static DramBank banks[MAX_NR_OF_DRAM_BANKS];
+static DramStats stats;
+
+// The state saved by SaveDramState()
+static DramBank saved_banks[MAX_NR_OF_DRAM_BANKS];
+static DramStats saved_stats;
+
+static int IsPowerOf2(long long n)
+{
+	return n > 0 && (n & (n - 1)) == 0;
+}
+
+static int Log2(int n)
+{
+	int bits = 0;
+
+	while ((1 << bits) < n)
+		++bits;
+	return bits;
+}
+
+// Parse a number with an optional K suffix. Returns -1 if it is invalid.
+static long long ParseNumber(const char* text)
+{
+	char* end;
+	long long n = strtoll(text, &end, 10);
+
+	if (end == text)
+		return -1;
+	if (toupper((unsigned char) *end) == 'K')
+	{
+		n *= 1024;
+		++end;
+	}
+	return *end == '\0' ? n : -1;
+}
+
+static int ParseParameter(const char* name, const char* value, DramConfig* parsed)
+{
+	long long n = ParseNumber(value);
+
+	if (strcmp(name, "banks") == 0 && IsPowerOf2(n) && n <= MAX_NR_OF_DRAM_BANKS)
+		parsed->nr_banks = (int) n;
+	else if (strcmp(name, "row") == 0 && IsPowerOf2(n) && n >= 64 && n <= 1024 * 1024)
+		parsed->row_size = (int) n;
+	else if (strcmp(name, "page") == 0 && (strcmp(value, "open") == 0 || strcmp(value, "closed") == 0))
+		parsed->open_page = strcmp(value, "open") == 0;
+	else if (strcmp(name, "trcd") == 0 && n >= 0 && n <= 10000)
+		parsed->t_rcd = (int) n;
+	else if (strcmp(name, "trp") == 0 && n >= 0 && n <= 10000)
+		parsed->t_rp = (int) n;
+	else if (strcmp(name, "tcas") == 0 && n >= 1 && n <= 10000)
+		parsed->t_cas = (int) n;
+	else if (strcmp(name, "burst") == 0 && n >= 0 && n <= 10000)
+		parsed->t_burst = (int) n;
+	else
+		return 1;
+	return 0;
+}
+
+// Public functions -------------------------------------------------------------------
+
+void GetDefaultDramConfig(DramConfig* default_config)
+{
+	*default_config = DEFAULT_DRAM_CONFIG;
+}
+
+int ParseDramConfig(const char* description, DramConfig* dram_config)
+{
+	DramConfig parsed = *dram_config;
+	char* copy = (char*) malloc(strlen(description) + 1);
+	char* parameter;
+	int failed = 0;
+
+	strcpy(copy, description);
+	for (parameter = strtok(copy, ","); parameter != NULL && !failed; parameter = strtok(NULL, ","))
+	{
+		char* value = strchr(parameter, '=');
+		if (value == NULL)
+			failed = 1;
+		else
+		{
+			*value++ = '\0';
+			failed = ParseParameter(parameter, value, &parsed);
+		}
+	}
+	free(copy);
+
+	if (!failed)
+		*dram_config = parsed;
+	return failed;
+}
+
+void ConfigureDram(const DramConfig* dram_config)
+{
+	enabled = 1;
+	config = *dram_config;
+	column_bits = Log2(config.row_size);
+	bank_bits = Log2(config.nr_banks);
+	InitDram();
+}
+
+int IsDramEnabled()
+{
+	return enabled;
+}
+
+void InitDram()
+{
+	int b;
+
+	for (b = 0; b < MAX_NR_OF_DRAM_BANKS; ++b)
+	{
+		banks[b].open_row = -1;
+		banks[b].busy_until = 0;
+	}
+	memset(&stats, 0, sizeof(stats));
+}
+
+int AccessDram(long long address, int is_write, long long cycle)
+{
+	long long location = address & 0xFFFFFFFFLL;
+	DramBank* bank = &banks[(location >> column_bits) & (config.nr_banks - 1)];
+	long long row = location >> (column_bits + bank_bits);
+	long long start = bank->busy_until > cycle ? bank->busy_until : cycle;
+	int latency;
+
+	if (bank->open_row == row)
+	{
+		++stats.row_hits;
+		latency = config.t_cas;
+	}
+	else if (bank->open_row == -1)
+	{
+		++stats.row_empty;
+		latency = config.t_rcd + config.t_cas;
+	}
+	else
+	{
+		++stats.row_conflicts;
+		latency = config.t_rp + config.t_rcd + config.t_cas;
+	}
+	latency += config.t_burst;
+
+	if (config.open_page)
+	{
+		bank->open_row = row;
+		bank->busy_until = start + latency;
+	}
+	else
+		bank->busy_until = start + latency + config.t_rp;
+
+	latency += (int) (start - cycle);
+	if (is_write)
+		++stats.writes;
+	else
+	{
+		++stats.reads;
+		stats.read_latency += latency;
+	}
+	return latency;
+}
+
+const DramStats* GetDramStats()
+{
+	return &stats;
+}
+
+void SaveDramState()
+{
+	memcpy(saved_banks, banks, sizeof(banks));
+	saved_stats = stats;
+}
+
+void RestoreDramState()
+{
+	memcpy(banks, saved_banks, sizeof(banks));
+	stats = saved_stats;
+}
+
+void WriteDramCheckpoint(CheckpointState* state)
+{
+	PutCheckpointState(state, &enabled, sizeof(enabled));
+	PutCheckpointState(state, &config, sizeof(config));
+	PutCheckpointState(state, banks, sizeof(banks));
+	PutCheckpointState(state, &stats, sizeof(stats));
+}
+
+void ReadDramCheckpoint(CheckpointState* state)
+{
+	CheckCheckpointConfig(state, &enabled, sizeof(enabled));
+	CheckCheckpointConfig(state, &config, sizeof(config));
+	GetCheckpointState(state, banks, sizeof(banks));
+	GetCheckpointState(state, &stats, sizeof(stats));
+}
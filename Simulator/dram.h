@@ -0,0 +1,116 @@
+/** @file dram.h
+	Timing model of the main memory behind the caches as a DRAM with banks and row
+	buffers.
+
+	An address is split, from the least significant bit up, into a column within a row,
+	a bank and a row. Each bank has a row buffer that holds the row that was last
+	activated in it. With the open page policy the row is kept open after an access: an
+	access to the open row (a row-buffer hit) only takes tCAS, an access to a bank
+	without an open row takes tRCD + tCAS, and an access to another row (a conflict)
+	first has to precharge the bank, taking tRP + tRCD + tCAS. With the closed page
+	policy the bank is precharged after every access, so every access takes
+	tRCD + tCAS, and the bank is busy for tRP afterwards. Each access then transfers a
+	line in the burst time. An access to a bank that is still busy with an earlier
+	access waits for it.
+
+	The caches send both their misses and their writebacks to the DRAM. Writebacks are
+	buffered, so their latency is not seen by the pipeline, but they occupy the banks
+	and change the open rows. All times are in clock cycles of the pipeline. */
+
+#ifndef DRAM_H_INCL
+#define DRAM_H_INCL
+
+#include "checkpoint.h"
+
+/** The maximum number of banks */
+#define MAX_NR_OF_DRAM_BANKS 64
+
+/** The parameters of the DRAM */
+typedef struct DramConfig
+{
+	int nr_banks;
+
+	/** The size of a row in bytes */
+	int row_size;
+
+	/** 1 for the open page policy, 0 for the closed page policy */
+	int open_page;
+
+	/** The number of clock cycles to activate a row */
+	int t_rcd;
+
+	/** The number of clock cycles to precharge a bank */
+	int t_rp;
+
+	/** The number of clock cycles from a column access to the data */
+	int t_cas;
+
+	/** The number of clock cycles to transfer a line */
+	int t_burst;
+}
+DramConfig;
+
+/** The event counts of the DRAM */
+typedef struct DramStats
+{
+	long long reads;
+	long long writes;
+
+	/** The number of accesses to the open row of their bank */
+	long long row_hits;
+
+	/** The number of accesses to a bank without an open row */
+	long long row_empty;
+
+	/** The number of accesses to a bank with another row open */
+	long long row_conflicts;
+
+	/** The sum of the latencies of the reads, including the time they waited for a busy
+		bank */
+	long long read_latency;
+}
+DramStats;
+
+/** Set @a config to the default parameters of the DRAM: 8 banks, rows of 2 KB, the
+	open page policy, tRCD, tRP and tCAS of 20 cycles and a burst of 8 cycles */
+void GetDefaultDramConfig(DramConfig* config);
+
+/** Parse a DRAM description, a comma-separated list of parameters such as
+	"banks=8,row=2K,page=open,trcd=20,trp=20,tcas=20,burst=8", into @a config. The
+	parameters that are not given keep their values in @a config. The values of page
+	are open and closed. The number of banks and the row size must be powers of 2.
+	@return 0 if the description is valid, 1 otherwise */
+int ParseDramConfig(const char* description, DramConfig* config);
+
+/** Model the main memory as a DRAM with the parameters @a config */
+void ConfigureDram(const DramConfig* config);
+
+/** Return whether the main memory is modelled as a DRAM */
+int IsDramEnabled();
+
+/** Close all rows, make all banks idle and reset the statistics */
+void InitDram();
+
+/** Read (if @a is_write is 0) or write the line at the address @a address, starting in
+	the clock cycle @a cycle
+	@return The number of clock cycles the access takes */
+int AccessDram(long long address, int is_write, long long cycle);
+
+/** Return the event counts of the DRAM */
+const DramStats* GetDramStats();
+
+/** Save the state and the statistics of the DRAM. Used by SaveCacheState(). */
+void SaveDramState();
+
+/** Restore the state saved by SaveDramState() */
+void RestoreDramState();
+
+/** Append the configuration, the state and the statistics of the DRAM to the state
+	of a checkpoint. Used by WriteCacheCheckpoint(). */
+void WriteDramCheckpoint(CheckpointState* state);
+
+/** Restore the state written by WriteDramCheckpoint(). Sets state->failed if the
+	DRAM was configured differently. */
+void ReadDramCheckpoint(CheckpointState* state);
+
+#endif // ifndef DRAM_H_INCL
@@ -7,6 +7,7 @@
 %{
 
 #include "instructions.h"
+#include "register_file.h"
 #include "data_memory.h"
 #include "instr_memory.h"
 #include "symbol_table.h"
@@ -31,7 +32,14 @@ static int nr_instr, buf_size;
 
 static long long cur_data_addr, cur_instr_addr;
 
-static void AddParsedInstrToBack(const Instr* instr, const char* label)
+// How the delay slots are filled, and how many were filled either way
+static DelaySlotFilling delay_slot_filling;
+static int nr_moved_into_slots, nr_nops_in_slots;
+
+// The addresses of the last labelled instruction and of the last filled delay slot
+static long long last_label_addr, last_slot_addr;
+
+static void AppendParsedInstr(const Instr* instr, const char* label)
 {
 	assert(cur_segment == TEXT);
 
@@ -50,6 +58,58 @@ static void AddParsedInstrToBack(const Instr* instr, const char* label)
 	cur_instr_addr += 4;
 }
 
+// Return whether the instruction before the branch or jump that was just added can be
+// moved into its delay slot. A labelled branch can be reached without executing the
+// instruction before it, and an instruction that is already in the delay slot of an
+// earlier branch must stay there. The branch must not read the register written by the
+// instruction, and the instruction must neither read nor write the register that the
+// branch links to.
+static int CanMoveIntoDelaySlot()
+{
+	DecodedInstr branch, prev;
+	long long branch_addr = cur_instr_addr - 4;
+
+	if (nr_instr < 2 || last_label_addr == branch_addr || last_slot_addr == branch_addr - 4)
+		return 0;
+	DecodeInstr(&instr_buf[nr_instr - 1].instr, &branch);
+	DecodeInstr(&instr_buf[nr_instr - 2].instr, &prev);
+	if (IsBranchOrJump(prev.instr.type) || prev.instr.type == SYSCALL || prev.instr.type == NOP)
+		return 0;
+	if (prev.dest != DONT_CARE && (branch.read_mask & (1u << prev.dest)))
+		return 0;
+	return branch.dest == DONT_CARE
+		|| (!(prev.read_mask & (1u << branch.dest)) && prev.dest != branch.dest);
+}
+
+// Fill the delay slot of the branch or jump that was just added, either by swapping it
+// with the instruction before it or by adding a nop after it
+static void FillDelaySlot()
+{
+	if (delay_slot_filling == AUTO_DELAY_SLOT_FILLING && CanMoveIntoDelaySlot())
+	{
+		ParsedInstr branch = instr_buf[nr_instr - 1];
+		instr_buf[nr_instr - 1] = instr_buf[nr_instr - 2];
+		instr_buf[nr_instr - 2] = branch;
+		++nr_moved_into_slots;
+	}
+	else
+	{
+		Instr nop = CreateInstr_Empty(NOP, DONT_CARE);
+		AppendParsedInstr(&nop, NULL);
+		++nr_nops_in_slots;
+	}
+	last_slot_addr = cur_instr_addr - 4;
+}
+
+static void AddParsedInstrToBack(const Instr* instr, const char* label)
+{
+	AppendParsedInstr(instr, label);
+
+	// The slot is filled right away, so that the labels after it get the right addresses
+	if (delay_slot_filling != NO_DELAY_SLOT_FILLING && IsBranchOrJump(instr->type))
+		FillDelaySlot();
+}
+
 static void AddParsedDataToBack(long long data, int size)
 {
 	WriteToDataMemory(cur_data_addr, data, size);
@@ -110,7 +170,7 @@ static void mips_parser_error2(YYLTYPE* location, const char* msg)
 %token NEWLINE
 %token TEXT_DIR DATA_DIR GLOBL_DIR ENT_DIR END_DIR
 %token BYTE_DIR HALF_DIR WORD_DIR
-%token <instr_type> RRR_INSTR RR_INSTR RRI_INSTR RIR_INSTR RI_INSTR I_INSTR EMPTY_INSTR
+%token <instr_type> RRR_INSTR RR_INSTR RRI_INSTR RIR_INSTR RI_INSTR I_INSTR R_INSTR EMPTY_INSTR
 %token <integer> REGISTER INTEGER
 %token <string> LABEL
 
@@ -130,6 +190,9 @@ static void mips_parser_error2(YYLTYPE* location, const char* msg)
 	cur_segment = TEXT;
 	cur_data_addr = GetDataSegmentStartingAddress();
 	cur_instr_addr = GetTextSegmentStartingAddress();
+
+	nr_moved_into_slots = nr_nops_in_slots = 0;
+	last_label_addr = last_slot_addr = DONT_CARE;
 }
 
 %%
@@ -158,7 +221,7 @@ data_line
 	;
 
 instr_line
-	: LABEL ':' maybe_newlines { AddToSymbolTable($1, cur_instr_addr); } instr
+	: LABEL ':' maybe_newlines { AddToSymbolTable($1, cur_instr_addr); last_label_addr = cur_instr_addr; } instr
 	| instr
 	;
 
@@ -257,6 +320,23 @@ instr
 		Instr instr = CreateInstr_I($1, DONT_CARE, @$.first_line); 
 		AddParsedInstrToBack(&instr, $2);	
 	}
+	| R_INSTR REGISTER
+	{
+		// jalr links to $ra when the rd operand is left out
+		Instr instr = CreateInstr_RR($1, $1 == JALR ? RA : DONT_CARE, $2, @$.first_line);
+		AddParsedInstrToBack(&instr, NULL);
+	}
+	| R_INSTR REGISTER ',' REGISTER
+	{
+		Instr instr;
+		if ($1 != JALR)
+		{
+			mips_parser_error2(&@$, "Only jalr may use this operand syntax");
+			YYERROR;
+		}
+		instr = CreateInstr_RR($1, $2, $4, @$.first_line);
+		AddParsedInstrToBack(&instr, NULL);
+	}
 	| EMPTY_INSTR
 	{
 		Instr instr = CreateInstr_Empty($1, @$.first_line);
@@ -264,4 +344,21 @@ instr
 	}
 	;
 
-%%
\ No newline at end of file
+%%
+
+void SetDelaySlotFilling(DelaySlotFilling filling)
+{
+	delay_slot_filling = filling;
+}
+
+void GetDelaySlotFillingCounts(int* nr_moved, int* nr_nops)
+{
+	*nr_moved = nr_moved_into_slots;
+	*nr_nops = nr_nops_in_slots;
+}
+
+void SetDelaySlotFillingCounts(int nr_moved, int nr_nops)
+{
+	nr_moved_into_slots = nr_moved;
+	nr_nops_in_slots = nr_nops;
+}
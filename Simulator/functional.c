@@ -0,0 +1,129 @@
+#include "functional.h"
+#include "alu.h"
+#include "instr_memory.h"
+#include "data_memory.h"
+#include "register_file.h"
+
+// Return the address of the instruction executed after the jump or taken branch at the
+// address pc to target. With delay slots, that is the instruction in the delay slot, and
+// delayed_pc is set to target, which is continued at after it.
+static long long TakeJump(long long pc, long long target, long long* delayed_pc)
+{
+	if (!AreDelaySlotsOn())
+		return target;
+	*delayed_pc = target;
+	return pc + 4;
+}
+
+// Public functions -----------------------------------------------------
+
+int RunFunctional(long long* pc, long long* nr_retired, long long max_instr)
+{
+	long long regs[32];
+	long long cur_pc = *pc;
+	long long retired = 0;
+	long nr_instr;
+	const DecodedInstr* buf = GetDecodedInstrBuffer(&nr_instr);
+	long long text_start = GetTextSegmentStartingAddress();
+	int found_syscall = 0;
+	long long delayed_pc = DONT_CARE;
+
+	// Work on a local copy of the register file, which is written back when done
+	ReadAllFromRegisterFile(regs);
+
+	// The delay slot of the last jump or taken branch is executed even when that was the
+	// last instruction to retire, so that the execution can be continued at pc
+	while (max_instr < 0 || retired < max_instr || delayed_pc != DONT_CARE)
+	{
+		long long buf_ind = (cur_pc - text_start) >> 2;
+		const DecodedInstr* decoded;
+		const Instr* instr;
+		long long rs_value, rt_value, result;
+		long long next_pc = delayed_pc != DONT_CARE ? delayed_pc : cur_pc + 4;
+
+		delayed_pc = DONT_CARE;
+
+		// Addresses outside the buffer are validated by ReadDecodedFromInstrMemory()
+		if (buf_ind >= 0 && buf_ind < nr_instr && (cur_pc & 3) == 0)
+			decoded = &buf[buf_ind];
+		else
+			decoded = ReadDecodedFromInstrMemory(cur_pc);
+		instr = &decoded->instr;
+
+		if (instr->type == NOP)
+		{
+			cur_pc = next_pc;
+			continue;
+		}
+		if (instr->type == SYSCALL)
+		{
+			found_syscall = 1;
+			break;
+		}
+
+		++retired;
+		rs_value = instr->rs != DONT_CARE ? regs[instr->rs] : DONT_CARE;
+		rt_value = instr->rt != DONT_CARE ? regs[instr->rt] : DONT_CARE;
+
+		// A jump that links writes the return address after reading its target, which
+		// jalr may take from the register it links to
+		if (IsJump(instr->type))
+		{
+			long long target = IsIndirectJump(instr->type) ? rs_value : instr->imm;
+			if (decoded->dest > 0)
+				regs[decoded->dest] = GetFallThroughAddress(cur_pc);
+			cur_pc = TakeJump(cur_pc, target, &delayed_pc);
+			continue;
+		}
+
+		// For loads and stores, the ALU computes the memory address
+		result = ComputeALUResult(decoded->alu_op, instr, rs_value, rt_value, instr->imm);
+
+		switch (instr->type)
+		{
+		case BEQ:
+		case BNE:
+			if ((instr->type == BEQ) == (result == 0))
+				cur_pc = TakeJump(cur_pc, instr->imm, &delayed_pc);
+			else
+				cur_pc += 4;
+			continue;
+		case LW:
+			result = ReadFromDataMemory(result, 4, 0);
+			break;
+		case LH:
+			result = ReadFromDataMemory(result, 2, 0);
+			break;
+		case LHU:
+			result = ReadFromDataMemory(result, 2, 1);
+			break;
+		case LB:
+			result = ReadFromDataMemory(result, 1, 0);
+			break;
+		case LBU:
+			result = ReadFromDataMemory(result, 1, 1);
+			break;
+		case SW:
+			WriteToDataMemory(result, rt_value, 4);
+			break;
+		case SH:
+			WriteToDataMemory(result, rt_value, 2);
+			break;
+		case SB:
+			WriteToDataMemory(result, rt_value, 1);
+			break;
+		default:
+			break;
+		}
+
+		// Write back the result. Register 0 is hardwired to 0.
+		if (decoded->dest > 0)
+			regs[decoded->dest] = result;
+		cur_pc = next_pc;
+	}
+
+	WriteAllToRegisterFile(regs);
+	*pc = cur_pc;
+	*nr_retired = retired;
+	return found_syscall;
+}
@@ -0,0 +1,25 @@
+/** @file functional.h
+	Functional (instruction-set level) execution of the program in the instruction
+	memory. Instructions are executed one at a time directly against the register file
+	and the data memory, without modelling the pipeline, which makes this much faster
+	than the cycle-level simulation. The resulting architectural state (registers,
+	memory and retired instruction count) is the same as that of the pipeline. */
+
+#ifndef FUNCTIONAL_H_INCL
+#define FUNCTIONAL_H_INCL
+
+/** Execute instructions functionally, starting at the address @a pc, until
+	@a max_instr instructions have been retired or a syscall is reached. The syscall
+	itself is not executed, so that the caller can decide how to terminate the program.
+	Like in the pipeline, nops are executed but not counted as retired instructions.
+	With delay slots, the delay slot of the last jump or taken branch is also executed,
+	so one more instruction than @a max_instr may be retired.
+	@param pc In: the address of the first instruction to execute. Out: the address of
+		the next instruction to execute
+	@param nr_retired Used to return the number of retired instructions
+	@param max_instr The maximum number of instructions to retire, or a negative
+		value for no limit
+	@return 1 if execution stopped at a syscall, 0 otherwise */
+int RunFunctional(long long* pc, long long* nr_retired, long long max_instr);
+
+#endif // ifndef FUNCTIONAL_H_INCL
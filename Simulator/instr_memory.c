@@ -7,8 +7,9 @@
 
 static const long long TEXT_SEG_START = 0x00400000LL;
 
-static Instr* instrs;
+static DecodedInstr* instrs;
 static long buf_size;
+static int version;
 
 static void ValidateAddress(long long address)
 {
@@ -29,10 +30,12 @@ static void ValidateAddress(long long address)
 void InitInstrMemory(FILE* mips_file)
 {
 	int i;
+	free(instrs);
 	buf_size = 10;
-	instrs = (Instr*) calloc(buf_size, sizeof(Instr));
+	++version;
+	instrs = (DecodedInstr*) calloc(buf_size, sizeof(DecodedInstr));
 	for (i = 0; i < buf_size; ++i)
-		instrs[i] = CreateInstr_Empty(NOP, DONT_CARE);
+		instrs[i] = *GetDecodedNop();
 }
 
 long long GetTextSegmentStartingAddress()
@@ -49,7 +52,30 @@ Instr ReadFromInstrMemory(long long address)
 	if (buf_ind >= buf_size)
 		return CreateInstr_Empty(NOP, DONT_CARE);
 
-	return instrs[buf_ind];
+	return instrs[buf_ind].instr;
+}
+
+const DecodedInstr* ReadDecodedFromInstrMemory(long long address)
+{
+	long long buf_ind = (address - TEXT_SEG_START) >> 2;
+
+	// Fast path for addresses inside the program
+	if (buf_ind >= 0 && buf_ind < buf_size && (address & 3) == 0)
+		return &instrs[buf_ind];
+
+	ValidateAddress(address);
+	return GetDecodedNop();
+}
+
+const DecodedInstr* GetDecodedInstrBuffer(long* nr_instr)
+{
+	*nr_instr = buf_size;
+	return instrs;
+}
+
+int GetInstrMemoryVersion()
+{
+	return version;
 }
 
 void WriteToInstrMemory(long long address, const Instr* instr)
@@ -64,10 +90,11 @@ void WriteToInstrMemory(long long address, const Instr* instr)
 		long prev_buf_size = buf_size;
 		long i;
 		buf_size = 2*(buf_ind + 1);
-		instrs = (Instr*) realloc(instrs, buf_size * sizeof(Instr));
+		instrs = (DecodedInstr*) realloc(instrs, buf_size * sizeof(DecodedInstr));
 		for (i = prev_buf_size; i < buf_size; ++i)
-			instrs[i] = CreateInstr_Empty(NOP, DONT_CARE);
+			instrs[i] = *GetDecodedNop();
 	}
 
-	instrs[buf_ind] = *instr;
+	DecodeInstr(instr, &instrs[buf_ind]);
+	++version;
 }
\ No newline at end of file
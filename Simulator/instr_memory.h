@@ -9,7 +9,7 @@
 #include <stdio.h>
 
 /** Initialize the instruction memory. This should be called at program startup before
-	any other functions from instr_memory.h are called. */
+	any other functions from instr_memory.h are called. Calling it again clears the memory. */
 void InitInstrMemory(FILE*);
 
 /** Get the starting address of the text segment in the program's memory space */
@@ -19,7 +19,25 @@ long long GetTextSegmentStartingAddress();
 	@pre The address is word-aligned */
 Instr ReadFromInstrMemory(long long address);
 
-/** Write the instruction @a instr to the address @a address in the instruction memory
+/** Read the predecoded form of the instruction at the absolute address @a address.
+	Addresses beyond the end of the program hold nops.
+	@pre The address is word-aligned
+	@note The returned pointer is invalidated by calls to WriteToInstrMemory() */
+const DecodedInstr* ReadDecodedFromInstrMemory(long long address);
+
+/** Get direct access to the predecoded instruction buffer, which holds the
+	instruction at address GetTextSegmentStartingAddress() + 4*i at index i. Addresses
+	beyond the end of the buffer hold nops.
+	@param nr_instr Used to return the number of instructions in the buffer
+	@note The pointer is invalidated by calls to WriteToInstrMemory() */
+const DecodedInstr* GetDecodedInstrBuffer(long* nr_instr);
+
+/** Get a number that changes every time the instruction memory is written to.
+	Used by caches of translated code to detect when they must be flushed. */
+int GetInstrMemoryVersion();
+
+/** Write the instruction @a instr to the address @a address in the instruction memory.
+	The predecoded form of the instruction is computed as well.
 	@pre The address is word-aligned */
 void WriteToInstrMemory(long long address, const Instr* instr);
 
@@ -5,6 +5,9 @@
 #include <string.h>
 #include <assert.h>
 
+// Whether the instruction after a branch or jump is always executed
+static int delay_slots;
+
 static void ValidateRegisterOperand(int register_nr)
 {
 	assert(register_nr == DONT_CARE || IsValidRegisterNr(register_nr));
@@ -103,12 +106,44 @@ InstrCategory GetInstrCategory(InstrType type)
 	case SLTI:
 	case SLTIU:
 	case J:
+	case JAL:
+	case JR:
+	case JALR:
 		return PROGRAM_CONTROL;
 	default:
 		return OTHER;
 	}
 }
 
+int IsJump(InstrType type)
+{
+	return type == J || type == JAL || IsIndirectJump(type);
+}
+
+int IsIndirectJump(InstrType type)
+{
+	return type == JR || type == JALR;
+}
+
+int IsBranchOrJump(InstrType type)
+{
+	return type == BEQ || type == BNE || IsJump(type);
+}
+
+void SetDelaySlots(int on_off)
+{
+	delay_slots = on_off;
+}
+
+int AreDelaySlotsOn()
+{
+	return delay_slots;
+}
+
+long long GetFallThroughAddress(long long pc)
+{
+	return delay_slots ? pc + 8 : pc + 4;
+}
 
 int CompareInstrs(const Instr* instr1, const Instr* instr2)
 {
@@ -131,8 +166,13 @@ int GetRegWrittenByInstr(const Instr* instr)
 	case SLT:
 	case SLTU:
 	case MOV:
+	case JALR:
 		return instr->rd;
 
+	// J-type instructions that link
+	case JAL:
+		return RA;
+
 	// I-type instructions
 	case ADDI:
 	case ANDI:
@@ -196,6 +236,12 @@ void GetRegsReadByInstr(const Instr* instr, int* rs, int* rt)
 		*rs = instr->rs;
 		return;
 
+	// Jumps to the address in register rs
+	case JR:
+	case JALR:
+		*rs = instr->rs;
+		return;
+
 	case INCR:
 	case DECR:
 		*rs = instr->rt;
@@ -206,6 +252,91 @@ void GetRegsReadByInstr(const Instr* instr, int* rs, int* rt)
 	}
 }
 
+static AluOp GetAluOp(InstrType type)
+{
+	switch (type)
+	{
+	case NOP:
+	case SYSCALL:
+	case J:
+	case JAL:
+	case JR:
+	case JALR:
+		return ALU_NONE;
+	case ADD:
+		return ALU_ADD;
+	case ADDI:
+	case LW:
+	case SW:
+	case LH:
+	case LHU:
+	case SH:
+	case LB:
+	case LBU:
+	case SB:
+		return ALU_ADD_IMM;
+	case SUB:
+	case BEQ:
+	case BNE:
+		return ALU_SUB;
+	case AND:
+		return ALU_AND;
+	case ANDI:
+		return ALU_AND_IMM;
+	case OR:
+		return ALU_OR;
+	case ORI:
+		return ALU_OR_IMM;
+	case NOR:
+		return ALU_NOR;
+	case SLL:
+		return ALU_SLL;
+	case SRL:
+		return ALU_SRL;
+	case SLT:
+		return ALU_SLT;
+	case SLTI:
+		return ALU_SLT_IMM;
+	case SLTU:
+		return ALU_SLTU;
+	case SLTIU:
+		return ALU_SLTU_IMM;
+	case LUI:
+		return ALU_LUI;
+	default:
+		return ALU_INVALID;
+	}
+}
+
+void DecodeInstr(const Instr* instr, DecodedInstr* decoded)
+{
+	decoded->instr = *instr;
+	decoded->category = GetInstrCategory(instr->type);
+	decoded->alu_op = GetAluOp(instr->type);
+	GetRegsReadByInstr(instr, &decoded->src_rs, &decoded->src_rt);
+	decoded->dest = GetRegWrittenByInstr(instr);
+
+	decoded->read_mask = 0;
+	if (decoded->src_rs != DONT_CARE)
+		decoded->read_mask |= 1u << decoded->src_rs;
+	if (decoded->src_rt != DONT_CARE)
+		decoded->read_mask |= 1u << decoded->src_rt;
+}
+
+const DecodedInstr* GetDecodedNop()
+{
+	static DecodedInstr nop;
+	static int initialized = 0;
+
+	if (!initialized)
+	{
+		Instr instr = CreateInstr_Empty(NOP, DONT_CARE);
+		DecodeInstr(&instr, &nop);
+		initialized = 1;
+	}
+	return &nop;
+}
+
 const char* StringRepOfInstrType(InstrType type)
 {
 #define CASE(TYPE) case TYPE: return #TYPE;
@@ -257,6 +388,11 @@ const char* StringRepOfInstrType(InstrType type)
 	// unconditional jumps
 	case J: return "j";
 
+	// subroutine calls and returns
+	case JAL: return "jal";
+	case JR: return "jr";
+	case JALR: return "jalr";
+
 	case SYSCALL: return "syscall";
 	}
 	
@@ -288,8 +424,14 @@ void PrintInstruction(const Instr* instr, FILE* file)
 			RegNameAsString(instr->rt));
 		break;
 
+	// R-type instructions with format "opname rs"
+	case JR:
+		fprintf(file, " $%s", RegNameAsString(instr->rs));
+		break;
+
 	// R-type instructions with format "opname rd, rs"
 	case MOV:
+	case JALR:
 		fprintf(file, " $%s, $%s", 
 			RegNameAsString(instr->rd),
 			RegNameAsString(instr->rs));
@@ -343,6 +485,7 @@ void PrintInstruction(const Instr* instr, FILE* file)
 
 	// J-type instructions with format "opname address"
 	case J:
+	case JAL:
 		fprintf(file, " %lld", instr->imm);
 		break;
 	}
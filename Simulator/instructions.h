@@ -68,6 +68,11 @@ typedef enum
 	// Unconditional jumps
 	J,
 
+	// Subroutine calls and returns
+	JAL,
+	JR,
+	JALR,
+
 	// System call. Only used to terminate the simulated program.
 	SYSCALL
 }
@@ -108,6 +113,68 @@ Instr;
 	their actual value is unimportant */
 #define DONT_CARE (-1)
 
+/** The operations that the ALU can perform. Used as indices into the ALU's
+	operation table. */
+typedef enum AluOp
+{
+	/** The instruction does not use the ALU */
+	ALU_NONE,
+
+	ALU_ADD,
+	ALU_ADD_IMM,
+	ALU_SUB,
+	ALU_AND,
+	ALU_AND_IMM,
+	ALU_OR,
+	ALU_OR_IMM,
+	ALU_NOR,
+	ALU_SLL,
+	ALU_SRL,
+	ALU_SLT,
+	ALU_SLT_IMM,
+	ALU_SLTU,
+	ALU_SLTU_IMM,
+	ALU_LUI,
+
+	/** The instruction is not supported by the ALU */
+	ALU_INVALID,
+
+	NR_OF_ALU_OPS
+}
+AluOp;
+
+/** A MIPS instruction in predecoded form. This is computed once, when the
+	instruction is written to the instruction memory, so that the pipeline can
+	look up the properties of an instruction instead of recomputing them every
+	clock cycle. */
+typedef struct DecodedInstr
+{
+	/** The instruction itself */
+	Instr instr;
+
+	/** The instruction's category, as given by GetInstrCategory() */
+	InstrCategory category;
+
+	/** The operation performed by the ALU for this instruction */
+	AluOp alu_op;
+
+	/** The first register read by the instruction, as given by GetRegsReadByInstr(),
+		or DONT_CARE */
+	int src_rs;
+
+	/** The second register read by the instruction, as given by GetRegsReadByInstr(),
+		or DONT_CARE */
+	int src_rt;
+
+	/** The register written by the instruction, as given by GetRegWrittenByInstr(),
+		or DONT_CARE */
+	int dest;
+
+	/** Bit r is set if the instruction reads register r */
+	unsigned int read_mask;
+}
+DecodedInstr;
+
 /** Create an instruction that uses the rd, rs, and rt fields of the Instr struct (apart from type and line_nr).
 	The rest of the fields are set to DONT_CARE. */
 Instr CreateInstr_RRR(InstrType type, int rd, int rs, int rt, int line_nr);
@@ -134,6 +201,31 @@ Instr CreateInstr_Empty(InstrType type, int line_nr);
 /** Return the category to which an istruction type belongs to */
 InstrCategory GetInstrCategory(InstrType type);
 
+/** Return whether an instruction of type @a type is an unconditional jump: j, jal, jr
+	or jalr */
+int IsJump(InstrType type);
+
+/** Return whether an instruction of type @a type jumps to the address in register rs:
+	jr or jalr */
+int IsIndirectJump(InstrType type);
+
+/** Return whether an instruction of type @a type is a branch or a jump, which has a
+	delay slot when delay slots are on */
+int IsBranchOrJump(InstrType type);
+
+/** Turn the architectural branch delay slots on or off. With delay slots, the
+	instruction after a branch or jump, which is in its delay slot, is always executed
+	before the execution continues at the target. They are off by default. */
+void SetDelaySlots(int on_off);
+
+/** Return whether the delay slots have been turned on with SetDelaySlots() */
+int AreDelaySlotsOn();
+
+/** Return the address at which the execution continues after the branch or jump at
+	@a pc when it is not taken, which is also the return address of a call: the next
+	instruction, or the one after the delay slot when delay slots are on */
+long long GetFallThroughAddress(long long pc);
+
 /** Compare the instructions @a instr1 and @a instr2
 	@return 1 if they are exactly equal (same type and same operands), 0 otherwise */
 int CompareInstrs(const Instr* instr1, const Instr* instr2);
@@ -151,6 +243,16 @@ void GetRegsReadByInstr(const Instr* instr, int* rs, int* rt);
 	@return The register number, if @a instr updates a register, DONT_CARE otherwise */
 int GetRegWrittenByInstr(const Instr* instr);
 
+/** Compute the predecoded form of @a instr
+	@param instr The instruction to decode
+	@param decoded Used to return the predecoded instruction */
+void DecodeInstr(const Instr* instr, DecodedInstr* decoded);
+
+/** Get the predecoded form of a generated nop, which is used for the bubbles
+	in the pipeline
+	@note The returned pointer should @e not be deleted by the caller */
+const DecodedInstr* GetDecodedNop();
+
 /** Get a string representation of the instruction type @a type
 	@note The returned pointer should @e not be deleted by the caller */
 const char* StringRepOfInstrType(InstrType type);
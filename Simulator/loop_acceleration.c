@@ -0,0 +1,389 @@
+#include "loop_acceleration.h"
+#include "pipeline.h"
+#include "update.h"
+#include "translation_cache.h"
+#include <string.h>
+
+// The maximum number of instructions in a recorded iteration
+#define MAX_PATH_LENGTH 1024
+
+// The maximum number of iterations that are skipped after a failed acceleration
+#define MAX_COOLDOWN 1024
+
+typedef enum AccelerationMode
+{
+	// Looking for the start of a loop iteration
+	OBSERVING,
+
+	// Recording the instructions of an iteration
+	RECORDING,
+
+	// Simulating the pipeline in detail up to the state in which the accelerated loop was left
+	RESYNCING
+}
+AccelerationMode;
+
+// The state of the pipeline that determines its timing: the addresses of the
+// instructions in the IF, ID, Ex, Mem and WB stages
+typedef struct PipelineSignature
+{
+	long long pcs[5];
+}
+PipelineSignature;
+
+// A run of consecutive instructions in a recorded iteration
+typedef struct PathRun
+{
+	long long start_pc;
+	long long end_pc;
+
+	// The address of the instruction executed after the run
+	long long next_pc;
+
+	// The number of instructions in the run, not counting nops
+	int nr_retired;
+}
+PathRun;
+
+static int enabled;
+static AccelerationMode mode;
+static long long prev_if_pc;
+
+// The iteration being recorded: the state of the pipeline and the counters at its
+// start, and the addresses of the instructions that have left the WB stage since then
+static PipelineSignature start_signature;
+static int start_cycles, start_retired;
+static StallCounts start_stalls;
+static long long path[MAX_PATH_LENGTH];
+static int path_length;
+
+// The runs of the recorded iteration, starting with the oldest instruction in the
+// pipeline after the instruction in the WB stage
+static PathRun runs[MAX_PATH_LENGTH];
+static int nr_runs;
+
+// After a failed acceleration the next cooldown iterations are not accelerated
+static int cooldown, nr_skipped;
+
+// The counters that the pipeline should have when it reaches start_signature again
+static int target_cycles, target_retired;
+static StallCounts target_stalls;
+
+static long long nr_accelerated_iterations;
+static int nr_approximate_exits;
+
+static void GetSignature(PipelineSignature* signature)
+{
+	signature->pcs[0] = if_stage.pc;
+	signature->pcs[1] = id_stage.pc;
+	signature->pcs[2] = ex_stage.pc;
+	signature->pcs[3] = mem_stage.pc;
+	signature->pcs[4] = wb_stage.pc;
+}
+
+static int IsSignatureEqual(const PipelineSignature* a, const PipelineSignature* b)
+{
+	return memcmp(a->pcs, b->pcs, sizeof(a->pcs)) == 0;
+}
+
+// Return a + times*(b - c)
+static StallCounts AddStallDifference(const StallCounts* a, const StallCounts* b, const StallCounts* c,
+	int times)
+{
+	StallCounts result;
+	result.load_use_stalls = a->load_use_stalls + times * (b->load_use_stalls - c->load_use_stalls);
+	result.branch_flushes = a->branch_flushes + times * (b->branch_flushes - c->branch_flushes);
+	result.jump_flushes = a->jump_flushes + times * (b->jump_flushes - c->jump_flushes);
+	result.jump_squashes = a->jump_squashes + times * (b->jump_squashes - c->jump_squashes);
+	result.branch_squashes = a->branch_squashes + times * (b->branch_squashes - c->branch_squashes);
+	result.fetch_stalls = a->fetch_stalls + times * (b->fetch_stalls - c->fetch_stalls);
+	result.memory_stalls = a->memory_stalls + times * (b->memory_stalls - c->memory_stalls);
+	result.load_miss_stalls = a->load_miss_stalls + times * (b->load_miss_stalls - c->load_miss_stalls);
+	result.comparator_stalls = a->comparator_stalls + times * (b->comparator_stalls - c->comparator_stalls);
+	result.early_branch_squashes = a->early_branch_squashes
+		+ times * (b->early_branch_squashes - c->early_branch_squashes);
+	return result;
+}
+
+static void StartRecording()
+{
+	mode = RECORDING;
+	GetSignature(&start_signature);
+	start_cycles = GetElapsedCycles();
+	start_retired = GetNrOfRetiredInstructions();
+	start_stalls = stall_counts;
+	path_length = 0;
+}
+
+static int IsNop(long long pc)
+{
+	return ReadDecodedFromInstrMemory(pc)->instr.type == NOP;
+}
+
+// Split the recorded iteration into runs of consecutive instructions, starting after the
+// instruction in the WB stage at the start of the iteration. Returns 0 if the iteration
+// cannot be accelerated.
+static int BuildRuns(int nr_retired)
+{
+	long long iteration[MAX_PATH_LENGTH];
+	long long oldest_pc = if_stage.pc;
+	int first = start_signature.pcs[4] != DONT_CARE ? 1 : 0;
+	int i, total = 0;
+
+	if (path_length == 0 || nr_retired == 0)
+		return 0;
+	for (i = 0; i < path_length; ++i)
+		iteration[i] = path[(first + i) % path_length];
+
+	// The iteration must start with the oldest instruction that is in the pipeline
+	// but has not completed
+	if (mem_stage.pc != DONT_CARE)
+		oldest_pc = mem_stage.pc;
+	else if (ex_stage.pc != DONT_CARE)
+		oldest_pc = ex_stage.pc;
+	else if (id_stage.pc != DONT_CARE)
+		oldest_pc = id_stage.pc;
+	if (iteration[0] != oldest_pc)
+		return 0;
+
+	nr_runs = 0;
+	for (i = 0; i < path_length; ++i)
+	{
+		PathRun* run;
+		InstrType type = ReadDecodedFromInstrMemory(iteration[i])->instr.type;
+
+		if (type == SYSCALL)
+			return 0;
+		if (i == 0 || iteration[i] != iteration[i - 1] + 4)
+		{
+			run = &runs[nr_runs++];
+			run->start_pc = iteration[i];
+			run->nr_retired = 0;
+		}
+		run = &runs[nr_runs - 1];
+		run->end_pc = iteration[i];
+		run->next_pc = iteration[(i + 1) % path_length];
+		if (type != NOP)
+		{
+			++run->nr_retired;
+			++total;
+		}
+	}
+	return total == nr_retired;
+}
+
+// Execute one iteration functionally. Returns 0 if it left the recorded path.
+static int ExecuteIteration()
+{
+	long long pc = runs[0].start_pc;
+	int r;
+
+	for (r = 0; r < nr_runs; ++r)
+	{
+		long long nr_retired;
+
+		if (RunTranslated(&pc, &nr_retired, runs[r].nr_retired) || nr_retired != runs[r].nr_retired)
+			return 0;
+
+		// Nops at the end of the run are not executed by RunTranslated()
+		while (pc != runs[r].next_pc && pc <= runs[r].end_pc && IsNop(pc))
+			pc += 4;
+		if (pc != runs[r].next_pc)
+			return 0;
+	}
+	return 1;
+}
+
+// Execute iterations of the recorded loop functionally, and leave the pipeline and the
+// counters in the state they have at the start of the last iteration that is known to
+// take the recorded path
+static void AccelerateLoop(int max_cycles)
+{
+	// The pipeline and the counters at the start of the first accelerated iteration
+	IFStage saved_if = if_stage;
+	IDStage saved_id = id_stage;
+	ExStage saved_ex = ex_stage;
+	MemStage saved_mem = mem_stage;
+	WBStage saved_wb = wb_stage;
+	int cycles = GetElapsedCycles(), retired = GetNrOfRetiredInstructions();
+	StallCounts stalls = stall_counts;
+
+	// The cost of one iteration
+	int delta_cycles = cycles - start_cycles, delta_retired = retired - start_retired;
+	int wb_retires = wb_stage.instr.type != NOP;
+
+	// The architectural state at the starts of the current and the previous iteration
+	long long regs[32], prev_regs[32];
+	long log_length = 0;
+	int nr_iterations = 0;
+
+	if (!BuildRuns(delta_retired))
+	{
+		StartRecording();
+		return;
+	}
+
+	// Complete the instruction in the WB stage, so that the architectural state is
+	// that of the start of the iteration. Writing its result again when the pipeline
+	// is restored is harmless.
+	UpdateRegisterFile();
+	ReadAllFromRegisterFile(regs);
+	SetDataMemoryWriteLogging(1);
+
+	for (;;)
+	{
+		if (max_cycles > 0 && (long long) cycles + (long long) (nr_iterations + 1) * delta_cycles > max_cycles)
+			break;
+		if (!ExecuteIteration())
+		{
+			UndoDataMemoryWrites(log_length);
+			WriteAllToRegisterFile(regs);
+			break;
+		}
+		++nr_iterations;
+
+		// Only the current and the previous iteration can be undone, so the log
+		// starts at the start of the previous iteration
+		memcpy(prev_regs, regs, sizeof(regs));
+		ReadAllFromRegisterFile(regs);
+		DiscardDataMemoryWrites(log_length);
+		log_length = GetDataMemoryWriteLogLength();
+	}
+
+	if (nr_iterations == 0)
+	{
+		// Nothing was gained, so put the pipeline back as it was
+		SetDataMemoryWriteLogging(0);
+		if_stage = saved_if;
+		id_stage = saved_id;
+		ex_stage = saved_ex;
+		mem_stage = saved_mem;
+		wb_stage = saved_wb;
+		mode = OBSERVING;
+	}
+	else
+	{
+		// Roll back to the start of the last completed iteration, and simulate it in
+		// detail to bring the pipeline to its state at the end of that iteration
+		UndoDataMemoryWrites(0);
+		WriteAllToRegisterFile(prev_regs);
+		SetDataMemoryWriteLogging(0);
+
+		if_stage.pc = runs[0].start_pc;
+		if_stage.decoded = ReadDecodedFromInstrMemory(if_stage.pc);
+		if_stage.instr = if_stage.decoded->instr;
+		if_stage.wait_cycles = 0;
+		ClearIDStage(&id_stage);
+		ClearExStage(&ex_stage);
+		ClearMemStage(&mem_stage);
+		ClearWBStage(&wb_stage);
+
+		SetPipelineCounters(cycles + (nr_iterations - 1) * delta_cycles,
+			retired + (nr_iterations - 1) * delta_retired + wb_retires,
+			GetNrOfFastForwardedInstructions());
+		stall_counts = AddStallDifference(&stalls, &stalls, &start_stalls, nr_iterations - 1);
+
+		target_cycles = cycles + nr_iterations * delta_cycles;
+		target_retired = retired + nr_iterations * delta_retired;
+		target_stalls = AddStallDifference(&stalls, &stalls, &start_stalls, nr_iterations);
+		mode = RESYNCING;
+		nr_accelerated_iterations += nr_iterations - 1;
+	}
+
+	// Back off from loops that do not repeat
+	if (nr_iterations <= 1)
+	{
+		cooldown = cooldown == 0 ? 1 : (cooldown < MAX_COOLDOWN ? 2*cooldown : MAX_COOLDOWN);
+		nr_skipped = 0;
+	}
+	else
+		cooldown = 0;
+}
+
+// Check whether the pipeline has reached the state in which the accelerated loop was left
+static void Resync()
+{
+	PipelineSignature signature;
+	int retired = GetNrOfRetiredInstructions();
+
+	if (retired < target_retired)
+		return;
+
+	GetSignature(&signature);
+	if (retired == target_retired && !IsSignatureEqual(&signature, &start_signature))
+		return;
+	if (retired != target_retired)
+		++nr_approximate_exits;
+
+	SetPipelineCounters(target_cycles, retired, GetNrOfFastForwardedInstructions());
+	stall_counts = target_stalls;
+	mode = OBSERVING;
+}
+
+// Public functions -------------------------------------------------------------------
+
+void SetLoopAcceleration(int on_off)
+{
+	enabled = on_off;
+}
+
+int IsLoopAccelerationOn()
+{
+	return enabled;
+}
+
+void ResetLoopAcceleration()
+{
+	mode = OBSERVING;
+	prev_if_pc = if_stage.pc;
+	cooldown = nr_skipped = 0;
+}
+
+void AccelerateLoops(int max_cycles)
+{
+	long long if_pc = if_stage.pc;
+
+	if (!enabled)
+		return;
+
+	if (mode == RESYNCING)
+		Resync();
+	// A new iteration may start when fetching has just jumped backwards
+	else if (if_pc < prev_if_pc)
+	{
+		PipelineSignature signature;
+		GetSignature(&signature);
+
+		if (mode == RECORDING && IsSignatureEqual(&signature, &start_signature))
+		{
+			if (nr_skipped < cooldown)
+			{
+				++nr_skipped;
+				StartRecording();
+			}
+			else
+				AccelerateLoop(max_cycles);
+		}
+		else
+			StartRecording();
+	}
+
+	if (mode == RECORDING)
+	{
+		if (path_length == MAX_PATH_LENGTH)
+			mode = OBSERVING;
+		else if (wb_stage.pc != DONT_CARE)
+			path[path_length++] = wb_stage.pc;
+	}
+	prev_if_pc = if_stage.pc;
+}
+
+long long GetNrOfAcceleratedIterations()
+{
+	return nr_accelerated_iterations;
+}
+
+int GetNrOfApproximateLoopExits()
+{
+	return nr_approximate_exits;
+}
@@ -0,0 +1,49 @@
+/** @file loop_acceleration.h
+	Acceleration of loops whose pipeline behaviour repeats from iteration to iteration.
+
+	The timing of the pipeline depends only on which instructions are in the pipeline
+	registers and on the path that the program takes, not on the values it computes.
+	So when the pipeline is in the same state (the same instruction addresses in all
+	five pipeline registers) at the start of two consecutive loop iterations, every
+	following iteration that takes the same path through the loop takes exactly the
+	same number of cycles. Once such an iteration has been recorded, the following
+	iterations are executed functionally, checking that each one takes the recorded
+	path, while the cycle, instruction and stall counters are advanced by the recorded
+	amounts per iteration.
+
+	When an iteration leaves the recorded path (typically when the loop exits), the
+	architectural state is rolled back to the start of the iteration before it, and
+	the pipeline is restarted there and simulated in detail. When it reaches the
+	recorded pipeline state at the start of the deviating iteration, the counters are
+	set to their exact values. In the rare case that the restarted pipeline does not
+	reach that state, the counters are set when the same number of instructions have
+	retired, which makes the cycle count approximate. */
+
+#ifndef LOOP_ACCELERATION_H_INCL
+#define LOOP_ACCELERATION_H_INCL
+
+/** Turn loop acceleration on or off. It is off by default. */
+void SetLoopAcceleration(int on_off);
+
+/** Return whether loop acceleration is on */
+int IsLoopAccelerationOn();
+
+/** Forget all recorded loop iterations. Must be called whenever the pipeline is
+	restarted other than by UpdatePipelineState(). */
+void ResetLoopAcceleration();
+
+/** Called by RunProgram() at the start of each clock cycle. Looks for repeating loop
+	iterations, and when one is found, executes as many iterations of it as possible
+	functionally and leaves the pipeline and the counters in the state they would
+	have after simulating them in detail.
+	@param max_cycles The cycle counter is not advanced beyond this, unless it is 0 */
+void AccelerateLoops(int max_cycles);
+
+/** Return the number of loop iterations that have been executed functionally */
+long long GetNrOfAcceleratedIterations();
+
+/** Return the number of times that the pipeline was restarted after a loop exit
+	without reaching the recorded state, which makes the cycle count approximate */
+int GetNrOfApproximateLoopExits();
+
+#endif // ifndef LOOP_ACCELERATION_H_INCL
@@ -638,8 +638,8 @@ static void yynoreturn yy_fatal_error ( const char* msg  );
 	(yy_hold_char) = *yy_cp; \
 	*yy_cp = '\0'; \
 	(yy_c_buf_p) = yy_cp;
-#define YY_NUM_RULES 83
-#define YY_END_OF_BUFFER 84
+#define YY_NUM_RULES 86
+#define YY_END_OF_BUFFER 87
 /* This struct is not used in this scanner,
    but its presence is necessary. */
 struct yy_trans_info
@@ -647,26 +647,26 @@ struct yy_trans_info
 	flex_int32_t yy_verify;
 	flex_int32_t yy_nxt;
 	};
-static const flex_int16_t yy_accept[164] =
+static const flex_int16_t yy_accept[168] =
     {   0,
-        0,    0,    0,    0,   84,   82,    1,   81,   82,   82,
-       82,   82,   78,   78,   43,   43,   43,   43,   43,   37,
-       43,   43,   43,   43,   43,   83,    0,    2,   44,    0,
-        0,    0,    0,    0,    0,    0,    0,    0,   78,   78,
-        0,    0,    0,    0,    0,    0,    0,    0,   43,   43,
-       43,   43,   43,   43,   43,   20,   17,   40,   43,   15,
-       43,   43,   25,   22,   19,   43,   43,   43,   16,   43,
-       44,   50,   51,   52,   53,   47,   76,   74,   72,   73,
-       45,   77,   64,   65,   66,   67,   68,   69,   70,   71,
-       75,   54,   55,   56,   57,   58,   59,   60,   61,   62,
-
-       63,   48,   49,    0,    0,    0,    0,    0,    0,    0,
-        0,    0,   80,   12,   24,   31,   32,   43,   43,   21,
-       18,   23,   43,   11,   26,   28,   29,   33,   30,   13,
-       43,   45,    0,   79,    0,    0,    7,    6,    0,    0,
-        0,    0,   14,   27,   42,   41,   39,   35,   34,   43,
-       46,    8,    4,    0,    9,    3,   10,   36,   43,    5,
-       43,   38,    0
+        0,    0,    0,    0,   87,   85,    1,   84,   85,   85,
+       85,   85,   81,   81,   46,   46,   46,   46,   46,   37,
+       46,   46,   46,   46,   46,   86,    0,    2,   47,    0,
+        0,    0,    0,    0,    0,    0,    0,    0,   81,   81,
+        0,    0,    0,    0,    0,    0,    0,    0,   46,   46,
+       46,   46,   46,   46,   46,   46,   39,   20,   17,   43,
+       46,   15,   46,   46,   25,   22,   19,   46,   46,   46,
+       16,   46,   47,   53,   54,   55,   56,   50,   79,   77,
+       75,   76,   48,   80,   67,   68,   69,   70,   71,   72,
+       73,   74,   78,   57,   58,   59,   60,   61,   62,   63,
+
+       64,   65,   66,   51,   52,    0,    0,    0,    0,    0,
+        0,    0,    0,    0,   83,   12,   24,   31,   32,   46,
+       46,   38,   21,   18,   23,   46,   11,   26,   28,   29,
+       33,   30,   13,   46,   48,    0,   82,    0,    0,    7,
+        6,    0,    0,    0,    0,   14,   27,   45,   44,   40,
+       42,   35,   34,   46,   49,    8,    4,    0,    9,    3,
+       10,   36,   46,    5,   46,   41,    0
     } ;
 
 static const YY_CHAR yy_ec[256] =
@@ -710,112 +710,112 @@ static const YY_CHAR yy_meta[45] =
         3,    3,    3,    3
     } ;
 
-static const flex_int16_t yy_base[173] =
+static const flex_int16_t yy_base[177] =
     {   0,
-        0,    0,    0,    0,  201,  202,  202,  202,  197,   37,
-      191,   62,  156,    0,    0,   33,   35,  174,  164,    0,
-       37,  162,  161,  157,   84,  202,  189,  202,    0,   60,
-      157,  156,   51,  170,  120,  147,   71,  165,  145,    0,
-      143,  166,  152,  153,  163,  158,  147,    0,    0,  157,
-      155,  118,  129,  130,  129,  110,  109,    0,  120,    0,
-      106,   55,  118,    0,    0,   56,  114,  123,    0,  105,
-      202,  202,  202,  202,  202,  202,  202,  202,  202,  202,
-        0,  202,  202,  202,  202,  202,  202,  202,  202,  202,
-      202,  202,  202,  202,  202,  202,  202,  202,  202,  202,
-
-      202,  202,  202,  105,    0,  102,  101,   61,  105,  107,
-       94,   90,    0,   97,   95,    0,    0,   85,   83,    0,
-        0,    0,   95,    0,    0,    0,    0,   63,    0,    0,
-       96,  202,   83,    0,   92,   94,  202,  202,   92,   87,
-       71,   86,    0,    0,    0,    0,    0,   68,    0,   87,
-      202,  202,  202,   75,  202,  202,  202,    0,   71,  202,
-       67,    0,  202,  164,  168,   94,  171,   93,  174,   91,
-       90,   70
+        0,    0,    0,    0,  205,  206,  206,  206,  201,   37,
+      195,   62,  160,    0,    0,   33,   35,  178,  168,   40,
+       52,  166,  165,  161,   84,  206,  193,  206,    0,   60,
+      161,  160,   55,  174,  120,  147,   81,  169,  149,    0,
+      147,  170,  156,  157,  167,  162,  151,    0,    0,  161,
+      160,  146,  157,  158,  156,  123,    0,  113,  112,    0,
+      123,    0,  109,   58,  121,    0,    0,   67,  117,  126,
+        0,  108,  206,  206,  206,  206,  206,  206,  206,  206,
+      206,  206,    0,  206,  206,  206,  206,  206,  206,  206,
+      206,  206,  206,  206,  206,  206,  206,  206,  206,  206,
+
+      206,  206,  206,  206,  206,  108,    0,  105,  104,   58,
+      108,  110,   97,  102,    0,  110,  109,    0,    0,   90,
+       88,   86,    0,    0,    0,   98,    0,    0,    0,    0,
+       56,    0,    0,   98,  206,   85,    0,   94,   97,  206,
+      206,   95,   89,   74,   89,    0,    0,    0,    0,    0,
+        0,   70,    0,   89,  206,  206,  206,   77,  206,  206,
+      206,    0,   76,  206,   72,    0,  206,  164,  168,   99,
+      171,   97,  174,   84,   58,   55
     } ;
 
-static const flex_int16_t yy_def[173] =
+static const flex_int16_t yy_def[177] =
     {   0,
-      163,    1,  164,  164,  163,  163,  163,  163,  165,  163,
-      166,  163,  166,  166,  167,  167,  167,  167,  167,  167,
-      167,  167,  167,  167,  167,  163,  165,  163,  168,  163,
-      163,  163,  163,  169,  163,  163,  163,  163,  166,  166,
-      163,  163,  163,  163,  163,  163,  163,  170,  167,  167,
+      167,    1,  168,  168,  167,  167,  167,  167,  169,  167,
+      170,  167,  170,  170,  171,  171,  171,  171,  171,  171,
+      171,  171,  171,  171,  171,  167,  169,  167,  172,  167,
+      167,  167,  167,  173,  167,  167,  167,  167,  170,  170,
+      167,  167,  167,  167,  167,  167,  167,  174,  171,  171,
+      171,  171,  171,  171,  171,  171,  171,  171,  171,  171,
+      171,  171,  171,  171,  171,  171,  171,  171,  171,  171,
+      171,  171,  167,  167,  167,  167,  167,  167,  167,  167,
+      167,  167,  175,  167,  167,  167,  167,  167,  167,  167,
       167,  167,  167,  167,  167,  167,  167,  167,  167,  167,
-      167,  167,  167,  167,  167,  167,  167,  167,  167,  167,
-      163,  163,  163,  163,  163,  163,  163,  163,  163,  163,
-      171,  163,  163,  163,  163,  163,  163,  163,  163,  163,
-      163,  163,  163,  163,  163,  163,  163,  163,  163,  163,
 
-      163,  163,  163,  163,  172,  163,  163,  163,  163,  163,
-      163,  163,  170,  167,  167,  167,  167,  167,  167,  167,
-      167,  167,  167,  167,  167,  167,  167,  167,  167,  167,
-      167,  163,  163,  172,  163,  163,  163,  163,  163,  163,
-      163,  163,  167,  167,  167,  167,  167,  167,  167,  167,
-      163,  163,  163,  163,  163,  163,  163,  167,  167,  163,
-      167,  167,    0,  163,  163,  163,  163,  163,  163,  163,
-      163,  163
+      167,  167,  167,  167,  167,  167,  176,  167,  167,  167,
+      167,  167,  167,  167,  174,  171,  171,  171,  171,  171,
+      171,  171,  171,  171,  171,  171,  171,  171,  171,  171,
+      171,  171,  171,  171,  167,  167,  176,  167,  167,  167,
+      167,  167,  167,  167,  167,  171,  171,  171,  171,  171,
+      171,  171,  171,  171,  167,  167,  167,  167,  167,  167,
+      167,  171,  171,  167,  171,  171,    0,  167,  167,  167,
+      167,  167,  167,  167,  167,  167
     } ;
 
-static const flex_int16_t yy_nxt[247] =
+static const flex_int16_t yy_nxt[251] =
     {   0,
         6,    7,    8,    9,   10,   11,   12,   13,   14,   14,
        14,   14,   14,   14,   14,   14,   14,   15,   16,   17,
        15,   18,   15,   15,   15,   15,   19,   20,   15,   21,
        22,   23,   24,   15,   15,   15,   25,   15,   15,   15,
        15,   15,   15,   15,   29,   29,   29,   29,   29,   29,
-       29,   29,   29,   29,   50,   30,   56,   52,   79,   80,
-       31,   32,   57,   58,   51,   33,   53,   72,   73,   74,
-       75,  134,   34,   35,   36,   59,   37,   60,  102,  103,
-       38,   41,  137,   42,   43,  127,   44,   45,  124,  148,
-      125,  132,  113,  128,   71,   40,  162,   76,  138,   46,
-
-      161,  149,   47,   64,  160,  159,  158,  157,  156,   65,
-      155,  154,  153,   66,  152,  151,  150,  147,  146,   67,
-      145,  144,   68,  143,   69,  142,   70,   83,   84,   85,
-       86,   87,   88,   89,   90,  141,  140,  139,  136,  135,
-      133,  131,  130,  129,  126,  123,  122,  121,  120,  119,
-      118,  117,  116,   91,   92,   93,   94,   95,   96,   97,
-       98,   99,  100,  101,   26,   26,   26,   26,   27,   27,
-       27,   27,   49,   49,   49,   81,  115,   81,  114,  112,
-      111,  110,  109,  108,  107,  106,  105,  104,   82,   78,
-       77,   28,   63,   62,   61,   55,   54,   48,   39,   28,
-
-      163,    5,  163,  163,  163,  163,  163,  163,  163,  163,
-      163,  163,  163,  163,  163,  163,  163,  163,  163,  163,
-      163,  163,  163,  163,  163,  163,  163,  163,  163,  163,
-      163,  163,  163,  163,  163,  163,  163,  163,  163,  163,
-      163,  163,  163,  163,  163,  163
+       29,   29,   29,   29,   50,   30,  137,   52,   56,  135,
+       31,   32,   81,   82,   51,   33,   53,   74,   75,   76,
+       77,   58,   34,   35,   36,   57,   37,   59,   60,  140,
+       38,   41,  152,   42,   43,  115,   44,   45,  104,  105,
+       61,  127,   62,  128,  153,  141,  130,   78,   73,   46,
+
+       40,  166,   47,   66,  131,  165,  164,  163,  162,   67,
+      161,  160,  159,   68,  158,  157,  156,  155,  154,   69,
+      151,  150,   70,  149,   71,  148,   72,   85,   86,   87,
+       88,   89,   90,   91,   92,  147,  146,  145,  144,  143,
+      142,  139,  138,  136,  134,  133,  132,  129,  126,  125,
+      124,  123,  122,   93,   94,   95,   96,   97,   98,   99,
+      100,  101,  102,  103,   26,   26,   26,   26,   27,   27,
+       27,   27,   49,   49,   49,   83,  121,   83,  120,  119,
+      118,  117,  116,  114,  113,  112,  111,  110,  109,  108,
+      107,  106,   84,   80,   79,   28,   65,   64,   63,   55,
+
+       54,   48,   39,   28,  167,    5,  167,  167,  167,  167,
+      167,  167,  167,  167,  167,  167,  167,  167,  167,  167,
+      167,  167,  167,  167,  167,  167,  167,  167,  167,  167,
+      167,  167,  167,  167,  167,  167,  167,  167,  167,  167,
+      167,  167,  167,  167,  167,  167,  167,  167,  167,  167
     } ;
 
-static const flex_int16_t yy_chk[247] =
+static const flex_int16_t yy_chk[251] =
     {   0,
         1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
         1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
         1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
         1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
         1,    1,    1,    1,   10,   10,   10,   10,   10,   10,
-       10,   10,   10,   10,   16,   10,   21,   17,   33,   33,
-       10,   10,   21,   21,   16,   10,   17,   30,   30,   30,
-       30,  172,   10,   10,   10,   21,   10,   21,   37,   37,
-       10,   12,  108,   12,   12,   66,   12,   12,   62,  128,
-       62,  171,  170,   66,  168,  166,  161,   30,  108,   12,
-
-      159,  128,   12,   25,  154,  150,  148,  142,  141,   25,
-      140,  139,  136,   25,  135,  133,  131,  123,  119,   25,
-      118,  115,   25,  114,   25,  112,   25,   35,   35,   35,
-       35,   35,   35,   35,   35,  111,  110,  109,  107,  106,
-      104,   70,   68,   67,   63,   61,   59,   57,   56,   55,
-       54,   53,   52,   35,   36,   36,   36,   36,   36,   36,
-       36,   36,   36,   36,  164,  164,  164,  164,  165,  165,
-      165,  165,  167,  167,  167,  169,   51,  169,   50,   47,
-       46,   45,   44,   43,   42,   41,   39,   38,   34,   32,
-       31,   27,   24,   23,   22,   19,   18,   13,   11,    9,
-
-        5,  163,  163,  163,  163,  163,  163,  163,  163,  163,
-      163,  163,  163,  163,  163,  163,  163,  163,  163,  163,
-      163,  163,  163,  163,  163,  163,  163,  163,  163,  163,
-      163,  163,  163,  163,  163,  163,  163,  163,  163,  163,
-      163,  163,  163,  163,  163,  163
+       10,   10,   10,   10,   16,   10,  176,   17,   20,  175,
+       10,   10,   33,   33,   16,   10,   17,   30,   30,   30,
+       30,   21,   10,   10,   10,   20,   10,   21,   21,  110,
+       10,   12,  131,   12,   12,  174,   12,   12,   37,   37,
+       21,   64,   21,   64,  131,  110,   68,   30,  172,   12,
+
+      170,  165,   12,   25,   68,  163,  158,  154,  152,   25,
+      145,  144,  143,   25,  142,  139,  138,  136,  134,   25,
+      126,  122,   25,  121,   25,  120,   25,   35,   35,   35,
+       35,   35,   35,   35,   35,  117,  116,  114,  113,  112,
+      111,  109,  108,  106,   72,   70,   69,   65,   63,   61,
+       59,   58,   56,   35,   36,   36,   36,   36,   36,   36,
+       36,   36,   36,   36,  168,  168,  168,  168,  169,  169,
+      169,  169,  171,  171,  171,  173,   55,  173,   54,   53,
+       52,   51,   50,   47,   46,   45,   44,   43,   42,   41,
+       39,   38,   34,   32,   31,   27,   24,   23,   22,   19,
+
+       18,   13,   11,    9,    5,  167,  167,  167,  167,  167,
+      167,  167,  167,  167,  167,  167,  167,  167,  167,  167,
+      167,  167,  167,  167,  167,  167,  167,  167,  167,  167,
+      167,  167,  167,  167,  167,  167,  167,  167,  167,  167,
+      167,  167,  167,  167,  167,  167,  167,  167,  167,  167
     } ;
 
 static yy_state_type yy_last_accepting_state;
@@ -1140,13 +1140,13 @@ yy_match:
 			while ( yy_chk[yy_base[yy_current_state] + yy_c] != yy_current_state )
 				{
 				yy_current_state = (int) yy_def[yy_current_state];
-				if ( yy_current_state >= 164 )
+				if ( yy_current_state >= 168 )
 					yy_c = yy_meta[yy_c];
 				}
 			yy_current_state = yy_nxt[yy_base[yy_current_state] + yy_c];
 			++yy_cp;
 			}
-		while ( yy_current_state != 163 );
+		while ( yy_current_state != 167 );
 		yy_cp = (yy_last_accepting_cpos);
 		yy_current_state = (yy_last_accepting_state);
 
@@ -1356,248 +1356,263 @@ YY_RULE_SETUP
 	YY_BREAK
 case 38:
 YY_RULE_SETUP
-#line 99 "mips_lexer.l"
-{ RETURN_INSTRUCTION(SYSCALL, EMPTY_INSTR) }
+#line 98 "mips_lexer.l"
+{ RETURN_INSTRUCTION(JAL, I_INSTR) }
 	YY_BREAK
 case 39:
 YY_RULE_SETUP
-#line 101 "mips_lexer.l"
-{ RETURN_INSTRUCTION(MOV, RR_INSTR) }
+#line 99 "mips_lexer.l"
+{ RETURN_INSTRUCTION(JR, R_INSTR) }
 	YY_BREAK
 case 40:
 YY_RULE_SETUP
-#line 102 "mips_lexer.l"
-{ RETURN_INSTRUCTION(LI, RI_INSTR) }
+#line 100 "mips_lexer.l"
+{ RETURN_INSTRUCTION(JALR, R_INSTR) }
 	YY_BREAK
 case 41:
 YY_RULE_SETUP
-#line 103 "mips_lexer.l"
-{ RETURN_INSTRUCTION(INCR, RI_INSTR) }
+#line 102 "mips_lexer.l"
+{ RETURN_INSTRUCTION(SYSCALL, EMPTY_INSTR) }
 	YY_BREAK
 case 42:
 YY_RULE_SETUP
 #line 104 "mips_lexer.l"
-{ RETURN_INSTRUCTION(DECR, RI_INSTR) }
+{ RETURN_INSTRUCTION(MOV, RR_INSTR) }
 	YY_BREAK
 case 43:
 YY_RULE_SETUP
-#line 106 "mips_lexer.l"
-{
-	strncpy(yylval->string, yytext, yyleng);
-	yylval->string[yyleng] = '\0';
-	return LABEL;
-}
+#line 105 "mips_lexer.l"
+{ RETURN_INSTRUCTION(LI, RI_INSTR) }
 	YY_BREAK
 case 44:
 YY_RULE_SETUP
-#line 112 "mips_lexer.l"
-{ sscanf(yytext, "$%d", &yylval->integer); return REGISTER; }
+#line 106 "mips_lexer.l"
+{ RETURN_INSTRUCTION(INCR, RI_INSTR) }
 	YY_BREAK
 case 45:
 YY_RULE_SETUP
-#line 113 "mips_lexer.l"
-{ sscanf(yytext, "$r%d", &yylval->integer); return REGISTER; }
+#line 107 "mips_lexer.l"
+{ RETURN_INSTRUCTION(DECR, RI_INSTR) }
 	YY_BREAK
 case 46:
 YY_RULE_SETUP
-#line 115 "mips_lexer.l"
-{ RETURN_REGISTER(ZERO) }
+#line 109 "mips_lexer.l"
+{
+	strncpy(yylval->string, yytext, yyleng);
+	yylval->string[yyleng] = '\0';
+	return LABEL;
+}
 	YY_BREAK
 case 47:
 YY_RULE_SETUP
-#line 116 "mips_lexer.l"
-{ RETURN_REGISTER(AT) }
+#line 115 "mips_lexer.l"
+{ sscanf(yytext, "$%d", &yylval->integer); return REGISTER; }
 	YY_BREAK
 case 48:
 YY_RULE_SETUP
-#line 117 "mips_lexer.l"
-{ RETURN_REGISTER(V0) }
+#line 116 "mips_lexer.l"
+{ sscanf(yytext, "$r%d", &yylval->integer); return REGISTER; }
 	YY_BREAK
 case 49:
 YY_RULE_SETUP
 #line 118 "mips_lexer.l"
-{ RETURN_REGISTER(V1) }
+{ RETURN_REGISTER(ZERO) }
 	YY_BREAK
 case 50:
 YY_RULE_SETUP
 #line 119 "mips_lexer.l"
-{ RETURN_REGISTER(A0) }
+{ RETURN_REGISTER(AT) }
 	YY_BREAK
 case 51:
 YY_RULE_SETUP
 #line 120 "mips_lexer.l"
-{ RETURN_REGISTER(A1) }
+{ RETURN_REGISTER(V0) }
 	YY_BREAK
 case 52:
 YY_RULE_SETUP
 #line 121 "mips_lexer.l"
-{ RETURN_REGISTER(A2) }
+{ RETURN_REGISTER(V1) }
 	YY_BREAK
 case 53:
 YY_RULE_SETUP
 #line 122 "mips_lexer.l"
-{ RETURN_REGISTER(A3) }
+{ RETURN_REGISTER(A0) }
 	YY_BREAK
 case 54:
 YY_RULE_SETUP
 #line 123 "mips_lexer.l"
-{ RETURN_REGISTER(T0) }
+{ RETURN_REGISTER(A1) }
 	YY_BREAK
 case 55:
 YY_RULE_SETUP
 #line 124 "mips_lexer.l"
-{ RETURN_REGISTER(T1) }
+{ RETURN_REGISTER(A2) }
 	YY_BREAK
 case 56:
 YY_RULE_SETUP
 #line 125 "mips_lexer.l"
-{ RETURN_REGISTER(T2) }
+{ RETURN_REGISTER(A3) }
 	YY_BREAK
 case 57:
 YY_RULE_SETUP
 #line 126 "mips_lexer.l"
-{ RETURN_REGISTER(T3) }
+{ RETURN_REGISTER(T0) }
 	YY_BREAK
 case 58:
 YY_RULE_SETUP
 #line 127 "mips_lexer.l"
-{ RETURN_REGISTER(T4) }
+{ RETURN_REGISTER(T1) }
 	YY_BREAK
 case 59:
 YY_RULE_SETUP
 #line 128 "mips_lexer.l"
-{ RETURN_REGISTER(T5) }
+{ RETURN_REGISTER(T2) }
 	YY_BREAK
 case 60:
 YY_RULE_SETUP
 #line 129 "mips_lexer.l"
-{ RETURN_REGISTER(T6) }
+{ RETURN_REGISTER(T3) }
 	YY_BREAK
 case 61:
 YY_RULE_SETUP
 #line 130 "mips_lexer.l"
-{ RETURN_REGISTER(T7) }
+{ RETURN_REGISTER(T4) }
 	YY_BREAK
 case 62:
 YY_RULE_SETUP
 #line 131 "mips_lexer.l"
-{ RETURN_REGISTER(T8) }
+{ RETURN_REGISTER(T5) }
 	YY_BREAK
 case 63:
 YY_RULE_SETUP
 #line 132 "mips_lexer.l"
-{ RETURN_REGISTER(T9) }
+{ RETURN_REGISTER(T6) }
 	YY_BREAK
 case 64:
 YY_RULE_SETUP
 #line 133 "mips_lexer.l"
-{ RETURN_REGISTER(S0) }
+{ RETURN_REGISTER(T7) }
 	YY_BREAK
 case 65:
 YY_RULE_SETUP
 #line 134 "mips_lexer.l"
-{ RETURN_REGISTER(S1) }
+{ RETURN_REGISTER(T8) }
 	YY_BREAK
 case 66:
 YY_RULE_SETUP
 #line 135 "mips_lexer.l"
-{ RETURN_REGISTER(S2) }
+{ RETURN_REGISTER(T9) }
 	YY_BREAK
 case 67:
 YY_RULE_SETUP
 #line 136 "mips_lexer.l"
-{ RETURN_REGISTER(S3) }
+{ RETURN_REGISTER(S0) }
 	YY_BREAK
 case 68:
 YY_RULE_SETUP
 #line 137 "mips_lexer.l"
-{ RETURN_REGISTER(S4) }
+{ RETURN_REGISTER(S1) }
 	YY_BREAK
 case 69:
 YY_RULE_SETUP
 #line 138 "mips_lexer.l"
-{ RETURN_REGISTER(S5) }
+{ RETURN_REGISTER(S2) }
 	YY_BREAK
 case 70:
 YY_RULE_SETUP
 #line 139 "mips_lexer.l"
-{ RETURN_REGISTER(S6) }
+{ RETURN_REGISTER(S3) }
 	YY_BREAK
 case 71:
 YY_RULE_SETUP
 #line 140 "mips_lexer.l"
-{ RETURN_REGISTER(S7) }
+{ RETURN_REGISTER(S4) }
 	YY_BREAK
 case 72:
 YY_RULE_SETUP
 #line 141 "mips_lexer.l"
-{ RETURN_REGISTER(K0) }
+{ RETURN_REGISTER(S5) }
 	YY_BREAK
 case 73:
 YY_RULE_SETUP
 #line 142 "mips_lexer.l"
-{ RETURN_REGISTER(K1) }
+{ RETURN_REGISTER(S6) }
 	YY_BREAK
 case 74:
 YY_RULE_SETUP
 #line 143 "mips_lexer.l"
-{ RETURN_REGISTER(GP) }
+{ RETURN_REGISTER(S7) }
 	YY_BREAK
 case 75:
 YY_RULE_SETUP
 #line 144 "mips_lexer.l"
-{ RETURN_REGISTER(SP) }
+{ RETURN_REGISTER(K0) }
 	YY_BREAK
 case 76:
 YY_RULE_SETUP
 #line 145 "mips_lexer.l"
-{ RETURN_REGISTER(FP) }
+{ RETURN_REGISTER(K1) }
 	YY_BREAK
 case 77:
 YY_RULE_SETUP
 #line 146 "mips_lexer.l"
-{ RETURN_REGISTER(RA) }
+{ RETURN_REGISTER(GP) }
 	YY_BREAK
 case 78:
 YY_RULE_SETUP
+#line 147 "mips_lexer.l"
+{ RETURN_REGISTER(SP) }
+	YY_BREAK
+case 79:
+YY_RULE_SETUP
 #line 148 "mips_lexer.l"
+{ RETURN_REGISTER(FP) }
+	YY_BREAK
+case 80:
+YY_RULE_SETUP
+#line 149 "mips_lexer.l"
+{ RETURN_REGISTER(RA) }
+	YY_BREAK
+case 81:
+YY_RULE_SETUP
+#line 151 "mips_lexer.l"
 { sscanf(yytext, "%d", &yylval->integer); return INTEGER; }
 	YY_BREAK
-case 79:
+case 82:
 YY_RULE_SETUP
-#line 150 "mips_lexer.l"
+#line 153 "mips_lexer.l"
 { sscanf(yytext, "-0x%x", &yylval->integer); yylval->integer *= -1; return INTEGER; }
 	YY_BREAK
-case 80:
+case 83:
 YY_RULE_SETUP
-#line 152 "mips_lexer.l"
+#line 155 "mips_lexer.l"
 { sscanf(yytext, "0x%x", &yylval->integer); return INTEGER; }
 	YY_BREAK
-case 81:
-/* rule 81 can match eol */
+case 84:
+/* rule 84 can match eol */
 YY_RULE_SETUP
-#line 154 "mips_lexer.l"
+#line 157 "mips_lexer.l"
 { return NEWLINE; }
 	YY_BREAK
-case 82:
+case 85:
 YY_RULE_SETUP
-#line 156 "mips_lexer.l"
+#line 159 "mips_lexer.l"
 { return *yytext; }
 	YY_BREAK
 case YY_STATE_EOF(INITIAL):
-#line 158 "mips_lexer.l"
+#line 161 "mips_lexer.l"
 { BEGIN(READ_EOF_ONCE); return NEWLINE; }
 	YY_BREAK
 case YY_STATE_EOF(READ_EOF_ONCE):
-#line 159 "mips_lexer.l"
+#line 162 "mips_lexer.l"
 { BEGIN(INITIAL); yyterminate(); }
 	YY_BREAK
-case 83:
+case 86:
 YY_RULE_SETUP
-#line 161 "mips_lexer.l"
+#line 164 "mips_lexer.l"
 ECHO;
 	YY_BREAK
-#line 1600 "mips_lexer.c"
+#line 1615 "mips_lexer.c"
 
 	case YY_END_OF_BUFFER:
 		{
@@ -1893,7 +1908,7 @@ static int yy_get_next_buffer (void)
 		while ( yy_chk[yy_base[yy_current_state] + yy_c] != yy_current_state )
 			{
 			yy_current_state = (int) yy_def[yy_current_state];
-			if ( yy_current_state >= 164 )
+			if ( yy_current_state >= 168 )
 				yy_c = yy_meta[yy_c];
 			}
 		yy_current_state = yy_nxt[yy_base[yy_current_state] + yy_c];
@@ -1921,11 +1936,11 @@ static int yy_get_next_buffer (void)
 	while ( yy_chk[yy_base[yy_current_state] + yy_c] != yy_current_state )
 		{
 		yy_current_state = (int) yy_def[yy_current_state];
-		if ( yy_current_state >= 164 )
+		if ( yy_current_state >= 168 )
 			yy_c = yy_meta[yy_c];
 		}
 	yy_current_state = yy_nxt[yy_base[yy_current_state] + yy_c];
-	yy_is_jam = (yy_current_state == 163);
+	yy_is_jam = (yy_current_state == 167);
 
 		return yy_is_jam ? 0 : yy_current_state;
 }
@@ -2601,5 +2616,5 @@ void yyfree (void * ptr )
 
 #define YYTABLES_NAME "yytables"
 
-#line 161 "mips_lexer.l"
+#line 164 "mips_lexer.l"
 
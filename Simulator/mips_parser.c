@@ -78,6 +78,7 @@
 
 
 #include "instructions.h"
+#include "register_file.h"
 #include "data_memory.h"
 #include "instr_memory.h"
 #include "symbol_table.h"
@@ -102,7 +103,14 @@ static int nr_instr, buf_size;
 
 static long long cur_data_addr, cur_instr_addr;
 
-static void AddParsedInstrToBack(const Instr* instr, const char* label)
+// How the delay slots are filled, and how many were filled either way
+static DelaySlotFilling delay_slot_filling;
+static int nr_moved_into_slots, nr_nops_in_slots;
+
+// The addresses of the last labelled instruction and of the last filled delay slot
+static long long last_label_addr, last_slot_addr;
+
+static void AppendParsedInstr(const Instr* instr, const char* label)
 {
 	assert(cur_segment == TEXT);
 
@@ -121,6 +129,58 @@ static void AddParsedInstrToBack(const Instr* instr, const char* label)
 	cur_instr_addr += 4;
 }
 
+// Return whether the instruction before the branch or jump that was just added can be
+// moved into its delay slot. A labelled branch can be reached without executing the
+// instruction before it, and an instruction that is already in the delay slot of an
+// earlier branch must stay there. The branch must not read the register written by the
+// instruction, and the instruction must neither read nor write the register that the
+// branch links to.
+static int CanMoveIntoDelaySlot()
+{
+	DecodedInstr branch, prev;
+	long long branch_addr = cur_instr_addr - 4;
+
+	if (nr_instr < 2 || last_label_addr == branch_addr || last_slot_addr == branch_addr - 4)
+		return 0;
+	DecodeInstr(&instr_buf[nr_instr - 1].instr, &branch);
+	DecodeInstr(&instr_buf[nr_instr - 2].instr, &prev);
+	if (IsBranchOrJump(prev.instr.type) || prev.instr.type == SYSCALL || prev.instr.type == NOP)
+		return 0;
+	if (prev.dest != DONT_CARE && (branch.read_mask & (1u << prev.dest)))
+		return 0;
+	return branch.dest == DONT_CARE
+		|| (!(prev.read_mask & (1u << branch.dest)) && prev.dest != branch.dest);
+}
+
+// Fill the delay slot of the branch or jump that was just added, either by swapping it
+// with the instruction before it or by adding a nop after it
+static void FillDelaySlot()
+{
+	if (delay_slot_filling == AUTO_DELAY_SLOT_FILLING && CanMoveIntoDelaySlot())
+	{
+		ParsedInstr branch = instr_buf[nr_instr - 1];
+		instr_buf[nr_instr - 1] = instr_buf[nr_instr - 2];
+		instr_buf[nr_instr - 2] = branch;
+		++nr_moved_into_slots;
+	}
+	else
+	{
+		Instr nop = CreateInstr_Empty(NOP, DONT_CARE);
+		AppendParsedInstr(&nop, NULL);
+		++nr_nops_in_slots;
+	}
+	last_slot_addr = cur_instr_addr - 4;
+}
+
+static void AddParsedInstrToBack(const Instr* instr, const char* label)
+{
+	AppendParsedInstr(instr, label);
+
+	// The slot is filled right away, so that the labels after it get the right addresses
+	if (delay_slot_filling != NO_DELAY_SLOT_FILLING && IsBranchOrJump(instr->type))
+		FillDelaySlot();
+}
+
 static void AddParsedDataToBack(long long data, int size)
 {
 	WriteToDataMemory(cur_data_addr, data, size);
@@ -169,7 +229,7 @@ static void mips_parser_error2(YYLTYPE* location, const char* msg)
 }
 
 
-#line 173 "mips_parser.c"
+#line 233 "mips_parser.c"
 
 # ifndef YY_CAST
 #  ifdef __cplusplus
@@ -215,29 +275,30 @@ enum yysymbol_kind_t
   YYSYMBOL_RIR_INSTR = 15,                 /* RIR_INSTR  */
   YYSYMBOL_RI_INSTR = 16,                  /* RI_INSTR  */
   YYSYMBOL_I_INSTR = 17,                   /* I_INSTR  */
-  YYSYMBOL_EMPTY_INSTR = 18,               /* EMPTY_INSTR  */
-  YYSYMBOL_REGISTER = 19,                  /* REGISTER  */
-  YYSYMBOL_INTEGER = 20,                   /* INTEGER  */
-  YYSYMBOL_LABEL = 21,                     /* LABEL  */
-  YYSYMBOL_22_ = 22,                       /* ':'  */
-  YYSYMBOL_23_ = 23,                       /* ','  */
-  YYSYMBOL_24_ = 24,                       /* '('  */
-  YYSYMBOL_25_ = 25,                       /* ')'  */
-  YYSYMBOL_YYACCEPT = 26,                  /* $accept  */
-  YYSYMBOL_start = 27,                     /* start  */
-  YYSYMBOL_prog = 28,                      /* prog  */
-  YYSYMBOL_line = 29,                      /* line  */
-  YYSYMBOL_data_line = 30,                 /* data_line  */
-  YYSYMBOL_31_1 = 31,                      /* $@1  */
-  YYSYMBOL_instr_line = 32,                /* instr_line  */
-  YYSYMBOL_33_2 = 33,                      /* $@2  */
-  YYSYMBOL_maybe_newlines = 34,            /* maybe_newlines  */
-  YYSYMBOL_directive = 35,                 /* directive  */
-  YYSYMBOL_data = 36,                      /* data  */
-  YYSYMBOL_byte_constants = 37,            /* byte_constants  */
-  YYSYMBOL_half_constants = 38,            /* half_constants  */
-  YYSYMBOL_word_constants = 39,            /* word_constants  */
-  YYSYMBOL_instr = 40                      /* instr  */
+  YYSYMBOL_R_INSTR = 18,                   /* R_INSTR  */
+  YYSYMBOL_EMPTY_INSTR = 19,               /* EMPTY_INSTR  */
+  YYSYMBOL_REGISTER = 20,                  /* REGISTER  */
+  YYSYMBOL_INTEGER = 21,                   /* INTEGER  */
+  YYSYMBOL_LABEL = 22,                     /* LABEL  */
+  YYSYMBOL_23_ = 23,                       /* ':'  */
+  YYSYMBOL_24_ = 24,                       /* ','  */
+  YYSYMBOL_25_ = 25,                       /* '('  */
+  YYSYMBOL_26_ = 26,                       /* ')'  */
+  YYSYMBOL_YYACCEPT = 27,                  /* $accept  */
+  YYSYMBOL_start = 28,                     /* start  */
+  YYSYMBOL_prog = 29,                      /* prog  */
+  YYSYMBOL_line = 30,                      /* line  */
+  YYSYMBOL_data_line = 31,                 /* data_line  */
+  YYSYMBOL_32_1 = 32,                      /* $@1  */
+  YYSYMBOL_instr_line = 33,                /* instr_line  */
+  YYSYMBOL_34_2 = 34,                      /* $@2  */
+  YYSYMBOL_maybe_newlines = 35,            /* maybe_newlines  */
+  YYSYMBOL_directive = 36,                 /* directive  */
+  YYSYMBOL_data = 37,                      /* data  */
+  YYSYMBOL_byte_constants = 38,            /* byte_constants  */
+  YYSYMBOL_half_constants = 39,            /* half_constants  */
+  YYSYMBOL_word_constants = 40,            /* word_constants  */
+  YYSYMBOL_instr = 41                      /* instr  */
 };
 typedef enum yysymbol_kind_t yysymbol_kind_t;
 
@@ -568,19 +629,19 @@ union yyalloc
 /* YYFINAL -- State number of the termination state.  */
 #define YYFINAL  3
 /* YYLAST -- Last index in YYTABLE.  */
-#define YYLAST   74
+#define YYLAST   81
 
 /* YYNTOKENS -- Number of terminals.  */
-#define YYNTOKENS  26
+#define YYNTOKENS  27
 /* YYNNTS -- Number of nonterminals.  */
 #define YYNNTS  15
 /* YYNRULES -- Number of rules.  */
-#define YYNRULES  41
+#define YYNRULES  43
 /* YYNSTATES -- Number of states.  */
-#define YYNSTATES  73
+#define YYNSTATES  77
 
 /* YYMAXUTOK -- Last valid token kind.  */
-#define YYMAXUTOK   276
+#define YYMAXUTOK   277
 
 
 /* YYTRANSLATE(TOKEN-NUM) -- Symbol number corresponding to TOKEN-NUM
@@ -598,8 +659,8 @@ static const yytype_int8 yytranslate[] =
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
-      24,    25,     2,     2,    23,     2,     2,     2,     2,     2,
-       2,     2,     2,     2,     2,     2,     2,     2,    22,     2,
+      25,    26,     2,     2,    24,     2,     2,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,    23,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
@@ -621,18 +682,18 @@ static const yytype_int8 yytranslate[] =
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     1,     2,     3,     4,
        5,     6,     7,     8,     9,    10,    11,    12,    13,    14,
-      15,    16,    17,    18,    19,    20,    21
+      15,    16,    17,    18,    19,    20,    21,    22
 };
 
 #if MIPS_PARSER_DEBUG
 /* YYRLINE[YYN] -- Source line where rule number YYN was defined.  */
 static const yytype_int16 yyrline[] =
 {
-       0,   137,   137,   145,   145,   148,   149,   150,   151,   152,
-     156,   156,   157,   161,   161,   162,   165,   165,   168,   169,
-     170,   171,   172,   176,   177,   178,   182,   183,   187,   188,
-     192,   193,   197,   202,   207,   216,   227,   232,   237,   250,
-     255,   260
+       0,   200,   200,   208,   208,   211,   212,   213,   214,   215,
+     219,   219,   220,   224,   224,   225,   228,   228,   231,   232,
+     233,   234,   235,   239,   240,   241,   245,   246,   250,   251,
+     255,   256,   260,   265,   270,   279,   290,   295,   300,   313,
+     318,   323,   329,   340
 };
 #endif
 
@@ -651,8 +712,8 @@ static const char *const yytname[] =
   "\"end of file\"", "error", "\"invalid token\"", "NEWLINE", "TEXT_DIR",
   "DATA_DIR", "GLOBL_DIR", "ENT_DIR", "END_DIR", "BYTE_DIR", "HALF_DIR",
   "WORD_DIR", "RRR_INSTR", "RR_INSTR", "RRI_INSTR", "RIR_INSTR",
-  "RI_INSTR", "I_INSTR", "EMPTY_INSTR", "REGISTER", "INTEGER", "LABEL",
-  "':'", "','", "'('", "')'", "$accept", "start", "prog", "line",
+  "RI_INSTR", "I_INSTR", "R_INSTR", "EMPTY_INSTR", "REGISTER", "INTEGER",
+  "LABEL", "':'", "','", "'('", "')'", "$accept", "start", "prog", "line",
   "data_line", "$@1", "instr_line", "$@2", "maybe_newlines", "directive",
   "data", "byte_constants", "half_constants", "word_constants", "instr", YY_NULLPTR
 };
@@ -664,7 +725,7 @@ yysymbol_name (yysymbol_kind_t yysymbol)
 }
 #endif
 
-#define YYPACT_NINF (-9)
+#define YYPACT_NINF (-11)
 
 #define yypact_value_is_default(Yyn) \
   ((Yyn) == YYPACT_NINF)
@@ -678,14 +739,14 @@ yysymbol_name (yysymbol_kind_t yysymbol)
    STATE-NUM.  */
 static const yytype_int8 yypact[] =
 {
-      -9,     2,     0,    -9,    -9,    -9,    -9,    -1,     7,    15,
-      24,    25,    26,    28,    29,    30,    31,    32,    18,    -9,
-      33,    34,    -9,    -9,    -9,    -9,    -9,    -9,    -9,    -9,
-      -9,    36,    -9,    37,    -9,    38,    39,    40,    41,    42,
-      43,    -9,    -9,    -9,    -9,    -9,    -9,    -9,    35,    48,
-      49,    20,    50,    16,    46,    -9,    51,    47,    -9,    -9,
-      -9,    13,    17,    53,    22,    54,    -9,    -9,    -9,    -9,
-      -9,    27,    -9
+     -11,     2,     0,   -11,   -11,   -11,   -11,    -1,     7,    16,
+      25,    26,    27,    29,    30,    31,    32,    33,    19,    34,
+     -11,    35,    36,   -11,   -11,   -11,   -11,   -11,   -11,   -11,
+     -11,   -11,    38,   -11,    39,   -11,    40,    41,    42,    43,
+      44,    45,   -11,   -11,    46,   -11,   -11,   -11,   -11,   -11,
+      37,    51,    52,    21,    53,    55,    17,    49,   -11,    54,
+      56,   -11,   -11,   -11,   -11,    14,    18,    57,    23,    59,
+     -11,   -11,   -11,   -11,   -11,    50,   -11
 };
 
 /* YYDEFACT[STATE-NUM] -- Default reduction number in state STATE-NUM.
@@ -694,27 +755,27 @@ static const yytype_int8 yypact[] =
 static const yytype_int8 yydefact[] =
 {
        3,     0,     0,     1,     9,    18,    19,     0,     0,     0,
-       0,     0,     0,     0,     0,     0,     0,     0,     0,    41,
-       0,     0,     7,     8,     6,    12,    15,    20,    21,    22,
-      26,    23,    28,    24,    30,    25,     0,     0,     0,     0,
-       0,    39,    40,    16,     4,    27,    29,    31,     0,     0,
-       0,     0,     0,    13,     0,    33,     0,     0,    37,    38,
-      17,     0,     0,     0,     0,     0,    11,    14,    32,    34,
-      35,     0,    36
+       0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+      43,     0,     0,     7,     8,     6,    12,    15,    20,    21,
+      22,    26,    23,    28,    24,    30,    25,     0,     0,     0,
+       0,     0,    39,    40,    41,    16,     4,    27,    29,    31,
+       0,     0,     0,     0,     0,     0,    13,     0,    33,     0,
+       0,    37,    38,    42,    17,     0,     0,     0,     0,     0,
+      11,    14,    32,    34,    35,     0,    36
 };
 
 /* YYPGOTO[NTERM-NUM].  */
 static const yytype_int8 yypgoto[] =
 {
-      -9,    -9,    -9,    -9,    -9,    -9,    -9,    -9,    -9,    -9,
-      -8,    -9,    -9,    -9,    -3
+     -11,   -11,   -11,   -11,   -11,   -11,   -11,   -11,   -11,   -11,
+     -10,   -11,   -11,   -11,    -4
 };
 
 /* YYDEFGOTO[NTERM-NUM].  */
 static const yytype_int8 yydefgoto[] =
 {
-       0,     1,     2,    21,    22,    61,    23,    62,    53,    24,
-      25,    31,    33,    35,    26
+       0,     1,     2,    22,    23,    65,    24,    66,    56,    25,
+      26,    32,    34,    36,    27
 };
 
 /* YYTABLE[YYPACT[STATE-NUM]] -- What to do in state STATE-NUM.  If
@@ -723,49 +784,51 @@ static const yytype_int8 yydefgoto[] =
 static const yytype_int8 yytable[] =
 {
       -2,     4,     3,    -5,     5,     6,     7,     8,     9,    10,
-      11,    12,    13,    14,    15,    16,    17,    18,    19,    60,
-      27,    20,    10,    11,    12,   -10,   -10,   -10,    28,    13,
-      14,    15,    16,    17,    18,    19,    29,    44,    41,    42,
-      57,    58,    69,    70,    30,    32,    34,    36,    37,    38,
-      39,    40,    72,    66,    54,    43,    45,    46,    47,    67,
-       0,     0,    48,    49,    50,    51,    52,    55,    56,    63,
-      59,    65,    68,    71,    64
+      11,    12,    13,    14,    15,    16,    17,    18,    19,    20,
+      64,    28,    21,    10,    11,    12,   -10,   -10,   -10,    29,
+      13,    14,    15,    16,    17,    18,    19,    20,    30,    46,
+      42,    43,    60,    61,    73,    74,    31,    33,    35,    37,
+      38,    39,    40,    41,    44,    70,     0,    57,    45,    47,
+      48,    49,    71,     0,     0,    50,    51,    52,    53,    54,
+      55,    58,    59,    67,    62,    63,    76,    72,    68,    75,
+       0,    69
 };
 
 static const yytype_int8 yycheck[] =
 {
        0,     1,     0,     3,     4,     5,     6,     7,     8,     9,
-      10,    11,    12,    13,    14,    15,    16,    17,    18,     3,
-      21,    21,     9,    10,    11,     9,    10,    11,    21,    12,
-      13,    14,    15,    16,    17,    18,    21,     3,    20,    21,
-      20,    21,    20,    21,    20,    20,    20,    19,    19,    19,
-      19,    19,    25,    61,    19,    22,    20,    20,    20,    62,
-      -1,    -1,    23,    23,    23,    23,    23,    19,    19,    23,
-      20,    24,    19,    19,    23
+      10,    11,    12,    13,    14,    15,    16,    17,    18,    19,
+       3,    22,    22,     9,    10,    11,     9,    10,    11,    22,
+      12,    13,    14,    15,    16,    17,    18,    19,    22,     3,
+      21,    22,    21,    22,    21,    22,    21,    21,    21,    20,
+      20,    20,    20,    20,    20,    65,    -1,    20,    23,    21,
+      21,    21,    66,    -1,    -1,    24,    24,    24,    24,    24,
+      24,    20,    20,    24,    21,    20,    26,    20,    24,    20,
+      -1,    25
 };
 
 /* YYSTOS[STATE-NUM] -- The symbol kind of the accessing symbol of
    state STATE-NUM.  */
 static const yytype_int8 yystos[] =
 {
-       0,    27,    28,     0,     1,     4,     5,     6,     7,     8,
+       0,    28,    29,     0,     1,     4,     5,     6,     7,     8,
        9,    10,    11,    12,    13,    14,    15,    16,    17,    18,
-      21,    29,    30,    32,    35,    36,    40,    21,    21,    21,
-      20,    37,    20,    38,    20,    39,    19,    19,    19,    19,
-      19,    20,    21,    22,     3,    20,    20,    20,    23,    23,
-      23,    23,    23,    34,    19,    19,    19,    20,    21,    20,
-       3,    31,    33,    23,    23,    24,    36,    40,    19,    20,
-      21,    19,    25
+      19,    22,    30,    31,    33,    36,    37,    41,    22,    22,
+      22,    21,    38,    21,    39,    21,    40,    20,    20,    20,
+      20,    20,    21,    22,    20,    23,     3,    21,    21,    21,
+      24,    24,    24,    24,    24,    24,    35,    20,    20,    20,
+      21,    22,    21,    20,     3,    32,    34,    24,    24,    25,
+      37,    41,    20,    21,    22,    20,    26
 };
 
 /* YYR1[RULE-NUM] -- Symbol kind of the left-hand side of rule RULE-NUM.  */
 static const yytype_int8 yyr1[] =
 {
-       0,    26,    27,    28,    28,    29,    29,    29,    29,    29,
-      31,    30,    30,    33,    32,    32,    34,    34,    35,    35,
-      35,    35,    35,    36,    36,    36,    37,    37,    38,    38,
-      39,    39,    40,    40,    40,    40,    40,    40,    40,    40,
-      40,    40
+       0,    27,    28,    29,    29,    30,    30,    30,    30,    30,
+      32,    31,    31,    34,    33,    33,    35,    35,    36,    36,
+      36,    36,    36,    37,    37,    37,    38,    38,    39,    39,
+      40,    40,    41,    41,    41,    41,    41,    41,    41,    41,
+      41,    41,    41,    41
 };
 
 /* YYR2[RULE-NUM] -- Number of symbols on the right-hand side of rule RULE-NUM.  */
@@ -775,7 +838,7 @@ static const yytype_int8 yyr2[] =
        0,     5,     1,     0,     5,     1,     0,     2,     1,     1,
        2,     2,     2,     2,     2,     2,     1,     2,     1,     2,
        1,     2,     6,     4,     6,     6,     7,     4,     4,     2,
-       2,     1
+       2,     2,     4,     1
 };
 
 
@@ -1430,7 +1493,7 @@ YYLTYPE yylloc = yyloc_default;
 
 
 /* User initialization code.  */
-#line 122 "mips_parser.y"
+#line 182 "mips_parser.y"
 {
 	extern FILE* mips_lexer_in;
 	mips_lexer_in = mips_file;
@@ -1442,9 +1505,12 @@ YYLTYPE yylloc = yyloc_default;
 	cur_segment = TEXT;
 	cur_data_addr = GetDataSegmentStartingAddress();
 	cur_instr_addr = GetTextSegmentStartingAddress();
+
+	nr_moved_into_slots = nr_nops_in_slots = 0;
+	last_label_addr = last_slot_addr = DONT_CARE;
 }
 
-#line 1448 "mips_parser.c"
+#line 1514 "mips_parser.c"
 
   yylsp[0] = yylloc;
   goto yysetstate;
@@ -1655,102 +1721,102 @@ yyreduce:
   switch (yyn)
     {
   case 2: /* start: prog  */
-#line 138 "mips_parser.y"
+#line 201 "mips_parser.y"
 {
 	*instr_list = instr_buf;
 	*nr_instr_out = nr_instr;
 	if (mips_parser_nerrs > 0) 
 		YYABORT;
 }
-#line 1666 "mips_parser.c"
+#line 1732 "mips_parser.c"
     break;
 
   case 9: /* line: error  */
-#line 152 "mips_parser.y"
+#line 215 "mips_parser.y"
                 { ++mips_parser_nerrs; yyerrok; }
-#line 1672 "mips_parser.c"
+#line 1738 "mips_parser.c"
     break;
 
   case 10: /* $@1: %empty  */
-#line 156 "mips_parser.y"
+#line 219 "mips_parser.y"
                                    { AddToSymbolTable((yyvsp[-2].string), cur_data_addr); }
-#line 1678 "mips_parser.c"
+#line 1744 "mips_parser.c"
     break;
 
   case 13: /* $@2: %empty  */
-#line 161 "mips_parser.y"
-                                   { AddToSymbolTable((yyvsp[-2].string), cur_instr_addr); }
-#line 1684 "mips_parser.c"
+#line 224 "mips_parser.y"
+                                   { AddToSymbolTable((yyvsp[-2].string), cur_instr_addr); last_label_addr = cur_instr_addr; }
+#line 1750 "mips_parser.c"
     break;
 
   case 18: /* directive: TEXT_DIR  */
-#line 168 "mips_parser.y"
+#line 231 "mips_parser.y"
                    { cur_segment = TEXT; }
-#line 1690 "mips_parser.c"
+#line 1756 "mips_parser.c"
     break;
 
   case 19: /* directive: DATA_DIR  */
-#line 169 "mips_parser.y"
+#line 232 "mips_parser.y"
                    { cur_segment = DATA; }
-#line 1696 "mips_parser.c"
+#line 1762 "mips_parser.c"
     break;
 
   case 26: /* byte_constants: INTEGER  */
-#line 182 "mips_parser.y"
+#line 245 "mips_parser.y"
                   { AddParsedDataToBack((yyvsp[0].integer), 1); }
-#line 1702 "mips_parser.c"
+#line 1768 "mips_parser.c"
     break;
 
   case 27: /* byte_constants: byte_constants INTEGER  */
-#line 183 "mips_parser.y"
+#line 246 "mips_parser.y"
                                  { AddParsedDataToBack((yyvsp[0].integer), 1); }
-#line 1708 "mips_parser.c"
+#line 1774 "mips_parser.c"
     break;
 
   case 28: /* half_constants: INTEGER  */
-#line 187 "mips_parser.y"
+#line 250 "mips_parser.y"
                   { AddParsedDataToBack((yyvsp[0].integer), 2); }
-#line 1714 "mips_parser.c"
+#line 1780 "mips_parser.c"
     break;
 
   case 29: /* half_constants: half_constants INTEGER  */
-#line 188 "mips_parser.y"
+#line 251 "mips_parser.y"
                                  { AddParsedDataToBack((yyvsp[0].integer), 2); }
-#line 1720 "mips_parser.c"
+#line 1786 "mips_parser.c"
     break;
 
   case 30: /* word_constants: INTEGER  */
-#line 192 "mips_parser.y"
+#line 255 "mips_parser.y"
                   { AddParsedDataToBack((yyvsp[0].integer), 4); }
-#line 1726 "mips_parser.c"
+#line 1792 "mips_parser.c"
     break;
 
   case 31: /* word_constants: word_constants INTEGER  */
-#line 193 "mips_parser.y"
+#line 256 "mips_parser.y"
                                  { AddParsedDataToBack((yyvsp[0].integer), 4); }
-#line 1732 "mips_parser.c"
+#line 1798 "mips_parser.c"
     break;
 
   case 32: /* instr: RRR_INSTR REGISTER ',' REGISTER ',' REGISTER  */
-#line 198 "mips_parser.y"
+#line 261 "mips_parser.y"
         {
 		Instr instr = CreateInstr_RRR((yyvsp[-5].instr_type), (yyvsp[-4].integer), (yyvsp[-2].integer), (yyvsp[0].integer), (yyloc).first_line);
 		AddParsedInstrToBack(&instr, NULL);
 	}
-#line 1741 "mips_parser.c"
+#line 1807 "mips_parser.c"
     break;
 
   case 33: /* instr: RR_INSTR REGISTER ',' REGISTER  */
-#line 203 "mips_parser.y"
+#line 266 "mips_parser.y"
         {
 		Instr instr = CreateInstr_RR((yyvsp[-3].instr_type), (yyvsp[-2].integer), (yyvsp[0].integer), (yyloc).first_line);
 		AddParsedInstrToBack(&instr, NULL);
 	}
-#line 1750 "mips_parser.c"
+#line 1816 "mips_parser.c"
     break;
 
   case 34: /* instr: RRI_INSTR REGISTER ',' REGISTER ',' INTEGER  */
-#line 208 "mips_parser.y"
+#line 271 "mips_parser.y"
         {
 		Instr instr;
 		if ((yyvsp[-5].instr_type) == BEQ || (yyvsp[-5].instr_type) == BNE)
@@ -1759,11 +1825,11 @@ yyreduce:
 			instr = CreateInstr_RRI((yyvsp[-5].instr_type), (yyvsp[-2].integer), (yyvsp[-4].integer), (yyvsp[0].integer), (yyloc).first_line);
 		AddParsedInstrToBack(&instr, NULL);
 	}
-#line 1763 "mips_parser.c"
+#line 1829 "mips_parser.c"
     break;
 
   case 35: /* instr: RRI_INSTR REGISTER ',' REGISTER ',' LABEL  */
-#line 217 "mips_parser.y"
+#line 280 "mips_parser.y"
         {
 		Instr instr;
 		if (!((yyvsp[-5].instr_type) == BEQ || (yyvsp[-5].instr_type) == BNE))
@@ -1774,29 +1840,29 @@ yyreduce:
 		instr = CreateInstr_RRI((yyvsp[-5].instr_type), (yyvsp[-4].integer), (yyvsp[-2].integer), DONT_CARE, (yyloc).first_line);
 		AddParsedInstrToBack(&instr, (yyvsp[0].string));
 	}
-#line 1778 "mips_parser.c"
+#line 1844 "mips_parser.c"
     break;
 
   case 36: /* instr: RIR_INSTR REGISTER ',' INTEGER '(' REGISTER ')'  */
-#line 228 "mips_parser.y"
+#line 291 "mips_parser.y"
         { 
 		Instr instr = CreateInstr_RRI((yyvsp[-6].instr_type), (yyvsp[-1].integer), (yyvsp[-5].integer), (yyvsp[-3].integer), (yyloc).first_line); 
 		AddParsedInstrToBack(&instr, NULL);
 	}
-#line 1787 "mips_parser.c"
+#line 1853 "mips_parser.c"
     break;
 
   case 37: /* instr: RIR_INSTR REGISTER ',' LABEL  */
-#line 233 "mips_parser.y"
+#line 296 "mips_parser.y"
         {
 		Instr instr = CreateInstr_RRI((yyvsp[-3].instr_type), DONT_CARE, (yyvsp[-2].integer), DONT_CARE, (yyloc).first_line); 
 		AddParsedInstrToBack(&instr, (yyvsp[0].string));	
 	}
-#line 1796 "mips_parser.c"
+#line 1862 "mips_parser.c"
     break;
 
   case 38: /* instr: RI_INSTR REGISTER ',' INTEGER  */
-#line 238 "mips_parser.y"
+#line 301 "mips_parser.y"
         {
 		Instr instr = CreateInstr_RI((yyvsp[-3].instr_type), (yyvsp[-2].integer), (yyvsp[0].integer), (yyloc).first_line);
 		if ((yyvsp[-3].instr_type) == LUI)
@@ -1809,38 +1875,63 @@ yyreduce:
 		}
 		AddParsedInstrToBack(&instr, NULL);	
 	}
-#line 1813 "mips_parser.c"
+#line 1879 "mips_parser.c"
     break;
 
   case 39: /* instr: I_INSTR INTEGER  */
-#line 251 "mips_parser.y"
+#line 314 "mips_parser.y"
         {
 		Instr instr = CreateInstr_I((yyvsp[-1].instr_type), (yyvsp[0].integer), (yyloc).first_line); 
 		AddParsedInstrToBack(&instr, NULL);
 	}
-#line 1822 "mips_parser.c"
+#line 1888 "mips_parser.c"
     break;
 
   case 40: /* instr: I_INSTR LABEL  */
-#line 256 "mips_parser.y"
+#line 319 "mips_parser.y"
         {
 		Instr instr = CreateInstr_I((yyvsp[-1].instr_type), DONT_CARE, (yyloc).first_line); 
 		AddParsedInstrToBack(&instr, (yyvsp[0].string));	
 	}
-#line 1831 "mips_parser.c"
+#line 1897 "mips_parser.c"
     break;
 
-  case 41: /* instr: EMPTY_INSTR  */
-#line 261 "mips_parser.y"
+  case 41: /* instr: R_INSTR REGISTER  */
+#line 324 "mips_parser.y"
+        {
+		// jalr links to $ra when the rd operand is left out
+		Instr instr = CreateInstr_RR((yyvsp[-1].instr_type), (yyvsp[-1].instr_type) == JALR ? RA : DONT_CARE, (yyvsp[0].integer), (yyloc).first_line);
+		AddParsedInstrToBack(&instr, NULL);
+	}
+#line 1907 "mips_parser.c"
+    break;
+
+  case 42: /* instr: R_INSTR REGISTER ',' REGISTER  */
+#line 330 "mips_parser.y"
+        {
+		Instr instr;
+		if ((yyvsp[-3].instr_type) != JALR)
+		{
+			mips_parser_error2(&(yyloc), "Only jalr may use this operand syntax");
+			YYERROR;
+		}
+		instr = CreateInstr_RR((yyvsp[-3].instr_type), (yyvsp[-2].integer), (yyvsp[0].integer), (yyloc).first_line);
+		AddParsedInstrToBack(&instr, NULL);
+	}
+#line 1922 "mips_parser.c"
+    break;
+
+  case 43: /* instr: EMPTY_INSTR  */
+#line 341 "mips_parser.y"
         {
 		Instr instr = CreateInstr_Empty((yyvsp[0].instr_type), (yyloc).first_line);
 		AddParsedInstrToBack(&instr, NULL);
 	}
-#line 1840 "mips_parser.c"
+#line 1931 "mips_parser.c"
     break;
 
 
-#line 1844 "mips_parser.c"
+#line 1935 "mips_parser.c"
 
       default: break;
     }
@@ -2069,4 +2160,22 @@ yyreturnlab:
   return yyresult;
 }
 
-#line 267 "mips_parser.y"
+#line 347 "mips_parser.y"
+
+
+void SetDelaySlotFilling(DelaySlotFilling filling)
+{
+	delay_slot_filling = filling;
+}
+
+void GetDelaySlotFillingCounts(int* nr_moved, int* nr_nops)
+{
+	*nr_moved = nr_moved_into_slots;
+	*nr_nops = nr_nops_in_slots;
+}
+
+void SetDelaySlotFillingCounts(int nr_moved, int nr_nops)
+{
+	nr_moved_into_slots = nr_moved;
+	nr_nops_in_slots = nr_nops;
+}
@@ -18,6 +18,36 @@ typedef struct ParsedInstr
 }
 ParsedInstr;
 
+/** How the assembler fills the delay slots of branches and jumps */
+typedef enum DelaySlotFilling
+{
+	/** The program is assembled as it is written, with its own delay slots */
+	NO_DELAY_SLOT_FILLING,
+
+	/** A nop is inserted after every branch and jump */
+	NOP_DELAY_SLOT_FILLING,
+
+	/** The instruction before a branch or jump is moved into its delay slot when that
+		does not change what the program computes, and a nop is inserted otherwise */
+	AUTO_DELAY_SLOT_FILLING
+}
+DelaySlotFilling;
+
+/** Set how the delay slots are filled in the programs that are parsed after the call.
+	The default is NO_DELAY_SLOT_FILLING. The addresses of the labels take the inserted
+	nops into account, but numeric branch and jump targets, and code addresses that the
+	program computes itself, are not adjusted. */
+void SetDelaySlotFilling(DelaySlotFilling filling);
+
+/** Get the number of delay slots that were filled in the last parsed program
+	@param nr_moved Used to return the number of slots that an instruction was moved into
+	@param nr_nops Used to return the number of slots that a nop was inserted into */
+void GetDelaySlotFillingCounts(int* nr_moved, int* nr_nops);
+
+/** Set the counts returned by GetDelaySlotFillingCounts(), for a program that is
+	restored from a checkpoint instead of parsed */
+void SetDelaySlotFillingCounts(int nr_moved, int nr_nops);
+
 /** Parse the MIPS program in @a mips_file
 	@post After the call, @a instr_list will point to a dynamically allocated array that
 		holds all the instructions of the program, and @a nr_instr_out will hold the
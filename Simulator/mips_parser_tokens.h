@@ -77,10 +77,11 @@ extern int mips_parser_debug;
     RIR_INSTR = 270,               /* RIR_INSTR  */
     RI_INSTR = 271,                /* RI_INSTR  */
     I_INSTR = 272,                 /* I_INSTR  */
-    EMPTY_INSTR = 273,             /* EMPTY_INSTR  */
-    REGISTER = 274,                /* REGISTER  */
-    INTEGER = 275,                 /* INTEGER  */
-    LABEL = 276                    /* LABEL  */
+    R_INSTR = 273,                 /* R_INSTR  */
+    EMPTY_INSTR = 274,             /* EMPTY_INSTR  */
+    REGISTER = 275,                /* REGISTER  */
+    INTEGER = 276,                 /* INTEGER  */
+    LABEL = 277                    /* LABEL  */
   };
   typedef enum mips_parser_tokentype mips_parser_token_kind_t;
 #endif
@@ -89,14 +90,14 @@ extern int mips_parser_debug;
 #if ! defined MIPS_PARSER_STYPE && ! defined MIPS_PARSER_STYPE_IS_DECLARED
 union MIPS_PARSER_STYPE
 {
-#line 103 "mips_parser.y"
+#line 163 "mips_parser.y"
 
 	InstrType instr_type;
 	int integer;
 	char string[100];
 	Instr instr;
 
-#line 100 "mips_parser_tokens.h"
+#line 101 "mips_parser_tokens.h"
 
 };
 typedef union MIPS_PARSER_STYPE MIPS_PARSER_STYPE;
@@ -1,5 +1,19 @@
 #define _CRT_SECURE_NO_WARNINGS
 #include "pipeline.h"
+#include "mips_parser.h"
+#include "checkpoint.h"
+#include "snapshot.h"
+#include "parallel.h"
+#include "loop_acceleration.h"
+#include "update.h"
+#include "batch.h"
+#include "cache.h"
+#include "dram.h"
+#include "tlb.h"
+#include "store_buffer.h"
+#include "branch_predictor.h"
+#include "btb.h"
+#include "ras.h"
 #include "utils.h"
 #include <stdio.h>
 #include <string.h>
@@ -7,38 +21,744 @@
 
 static void Usage(const char* cmd)
 {
-	fprintf(stderr, "Usage: %s <name of MIPS assembly file>\n", cmd);
+	fprintf(stderr, "Usage: %s [options] <name of MIPS assembly file>\n", cmd);
+	fprintf(stderr, "       %s [options] -restore <checkpoint file>\n", cmd);
+	fprintf(stderr,
+		"Options:\n"
+		"  -functional   Run the program functionally, without modelling the pipeline\n"
+		"  -native <exe> Translate the program to C and compile it into the native executable <exe>\n"
+		"  -ff <n>       Fast-forward <n> instructions functionally before the detailed simulation\n"
+		"  -notrace      Do not write an HTML trace of the pipeline\n"
+		"  -regs         Print the contents of the register file when the program has terminated\n"
+		"  -accelerate   Execute repeating loop iterations functionally (only without a trace)\n"
+		"  -runs <n>     Run the program <n> times, each time from its initial state\n"
+		"  -max-cycles <n>\n"
+		"                Stop the simulation after <n> clock cycles\n"
+		"  -checkpoint <file> <n>\n"
+		"                Save a checkpoint to <file> every <n> clock cycles\n"
+		"  -restore <file>\n"
+		"                Continue the simulation from the checkpoint <file>\n"
+		"  -sample <period> <warmup> <window>\n"
+		"                Estimate the CPI by simulating a window of <window> instructions in\n"
+		"                detail every <period> instructions, each after <warmup> detailed\n"
+		"                instructions, and running the rest of the program functionally\n"
+		"  -target-error <percent>\n"
+		"                With -sample, rerun with more samples until the 95%% confidence\n"
+		"                interval of the CPI is within <percent> of the estimate\n"
+		"  -select-simpoints <interval> <max k> <file>\n"
+		"                Profile the basic-block vectors of intervals of <interval> instructions,\n"
+		"                and write up to <max k> representative simulation points to <file>\n"
+		"  -simpoints <file> <warmup>\n"
+		"                Estimate the CPI by simulating only the simulation points in <file>,\n"
+		"                each after <warmup> detailed instructions\n"
+		"  -parallel <interval> <warmup> <workers>\n"
+		"                Simulate intervals of <interval> instructions in parallel in <workers>\n"
+		"                worker processes, each after <warmup> detailed instructions\n"
+		"  -batch <file> Simulate the program once for each input data set in <file>, in lock-step\n"
+		"  -l1i <config> Model an L1 instruction cache (default size=8K,line=32,assoc=2,latency=1)\n"
+		"  -l1d <config> Model an L1 data cache (default size=8K,line=32,assoc=2,latency=1)\n"
+		"  -l2 <config>  Model a unified L2 cache (default size=256K,line=64,assoc=8,latency=10)\n"
+		"                <config> is a comma-separated list of the parameters size, line, assoc,\n"
+		"                repl (lru, fifo or random), write (back or through), alloc (yes or no)\n"
+		"                and latency, e.g. size=16K,assoc=4,write=through\n"
+		"  -mshrs <n>    Make the L1 data cache non-blocking, with <n> miss status holding\n"
+		"                registers (at most 64)\n"
+		"  -l1i-prefetch <config>\n"
+		"  -l1d-prefetch <config>\n"
+		"                Give the L1 instruction or data cache a prefetcher. <config> is next-line,\n"
+		"                stride (data cache only) or stream, followed by the parameters degree\n"
+		"                (default 1), table (default 64), buffers (default 4) and depth (default 4),\n"
+		"                e.g. stride,degree=2 or stream,buffers=8\n"
+		"  -memory-latency <n>\n"
+		"                Make a main memory access behind the caches take <n> clock cycles\n"
+		"                (default 100)\n"
+		"  -dram <config>\n"
+		"                Model the main memory behind the caches as a DRAM instead. <config> is a\n"
+		"                comma-separated list of the parameters banks, row, page (open or closed),\n"
+		"                trcd, trp, tcas and burst, e.g. banks=4,page=closed (default\n"
+		"                banks=8,row=2K,page=open,trcd=20,trp=20,tcas=20,burst=8)\n"
+		"  -itlb <config>\n"
+		"  -dtlb <config>\n"
+		"                Model an instruction or data TLB. <config> is a comma-separated list of\n"
+		"                the parameters entries and assoc, which may be full (default entries=32,\n"
+		"                assoc=4 for the instruction TLB and entries=64,assoc=4 for the data TLB)\n"
+		"  -page-walk <config>\n"
+		"                Set the page table and its walker. <config> is a comma-separated list of\n"
+		"                the parameters page, levels (1 to 4), walker (hardware or software) and\n"
+		"                trap, the extra cycles of the software walker (default\n"
+		"                page=4K,levels=2,walker=hardware,trap=30)\n"
+		"  -store-buffer <n>\n"
+		"                Let stores drain to the data cache through a store buffer of <n> stores\n"
+		"                (at most 64), which forwards their data to loads\n"
+		"  -branch-predictor <config>\n"
+		"                Predict the direction of branches with not-taken (the default), btfn,\n"
+		"                1-bit, bimodal, gshare or tournament, followed by the parameters entries\n"
+		"                and history, e.g. gshare,entries=1024,history=10 (default\n"
+		"                entries=4096,history=12)\n"
+		"  -btb <config> Redirect the fetch after jumps and taken branches with a branch target\n"
+		"                buffer. <config> is a comma-separated list of the parameters entries\n"
+		"                and assoc, which may be full (default entries=64,assoc=4)\n"
+		"  -ras <n>      Predict the targets of returns (jr $ra) with a return address stack\n"
+		"                of <n> return addresses (at most 64)\n"
+		"  -early-branches\n"
+		"                Resolve beq and bne in the ID stage with a comparator that results are\n"
+		"                forwarded to, instead of in the Mem stage\n"
+		"  -delay-slots  Always execute the instruction after a branch or jump, in its delay slot\n"
+		"  -fill-delay-slots <fill>\n"
+		"                Turn on the delay slots, and let the assembler insert them after every\n"
+		"                branch and jump, with a nop (nop) or with the instruction before it if\n"
+		"                that is independent of the branch, and a nop otherwise (auto)\n");
 	EXIT_APPL(EXIT_FAILURE);
 }
 
+// Parse the configuration of the cache @a cache, and add the cache
+static void ConfigureCacheFromCommandLine(CacheId cache, const char* description, const char* cmd)
+{
+	CacheConfig config;
+
+	GetDefaultCacheConfig(cache, &config);
+	if (ParseCacheConfig(description, &config) != 0)
+	{
+		fprintf(stderr, "Invalid configuration of the %s: %s\n", GetCacheName(cache), description);
+		Usage(cmd);
+	}
+	ConfigureCache(cache, &config);
+}
+
+// Parse the configuration of the TLB @a tlb, and add the TLB
+static void ConfigureTLBFromCommandLine(TLBId tlb, const char* description, const char* cmd)
+{
+	TLBConfig config;
+
+	GetDefaultTLBConfig(tlb, &config);
+	if (ParseTLBConfig(description, &config) != 0)
+	{
+		fprintf(stderr, "Invalid configuration of the %s: %s\n", GetTLBName(tlb), description);
+		Usage(cmd);
+	}
+	ConfigureTLB(tlb, &config);
+}
+
+// Parse the configuration of the prefetcher of the cache @a cache, and add the prefetcher
+static void ConfigurePrefetcherFromCommandLine(CacheId cache, const char* description, const char* cmd)
+{
+	PrefetcherConfig config;
+
+	GetDefaultPrefetcherConfig(&config);
+	if (ParsePrefetcherConfig(description, &config) != 0
+		|| (cache == L1_INSTRUCTION_CACHE && config.kind == STRIDE_PREFETCHER))
+	{
+		fprintf(stderr, "Invalid prefetcher of the %s: %s\n", GetCacheName(cache), description);
+		Usage(cmd);
+	}
+	ConfigurePrefetcher(cache, &config);
+}
+
+// Return the number of cycles lost to the flush after a mispredicted branch or jump. With
+// delay slots, the instruction after it is not flushed.
+static int GetFlushPenalty()
+{
+	return AreDelaySlotsOn() ? 2 : 3;
+}
+
+static void PrintBranchPredictionStatistics()
+{
+	if (IsBranchPredictorConfigured())
+	{
+		const BranchPredictorStats* stats = GetBranchPredictorStats();
+
+		printf("Branch predictor (%s): %lld branches, %lld taken, %lld mispredictions (accuracy %.2f%%)\n",
+			GetBranchPredictorName(GetBranchPredictorConfig()->kind), stats->branches, stats->taken,
+			stats->mispredictions,
+			stats->branches > 0 ? 100.0 * (stats->branches - stats->mispredictions) / stats->branches : 0.0);
+		printf("Cycles lost to mispredictions: %d\n", GetFlushPenalty() * stall_counts.branch_flushes);
+	}
+	if (IsBTBConfigured())
+	{
+		const BTBStats* stats = GetBTBStats();
+		long long lookups = stats->hits + stats->misses;
+
+		printf("BTB: %lld hits, %lld misses (hit rate %.2f%%), %lld fetch redirects\n", stats->hits,
+			stats->misses, lookups > 0 ? 100.0 * stats->hits / lookups : 0.0, stats->redirects);
+		printf("Bubbles eliminated by the BTB: %lld\n", stats->bubbles_eliminated);
+	}
+	if (GetRASDepth() > 0)
+	{
+		const RASStats* stats = GetRASStats();
+
+		printf("Return address stack: %lld returns, %lld hits (hit rate %.2f%%), %lld overflows, %lld underflows\n",
+			stats->returns, stats->hits, stats->returns > 0 ? 100.0 * stats->hits / stats->returns : 0.0,
+			stats->overflows, stats->underflows);
+	}
+	if (IsBTBConfigured() || GetRASDepth() > 0)
+		printf("Number of jump squashes: %d\n", stall_counts.jump_squashes);
+	printf("Cycles lost to squashes after predicted-taken branches: %d\n", stall_counts.branch_squashes);
+	printf("Cycles lost to mispredicted jr and jalr targets: %d\n", GetFlushPenalty() * stall_counts.jump_flushes);
+}
+
+static void PrintEarlyBranchResolutionStatistics()
+{
+	printf("Cycles lost to squashes after branches resolved in ID: %d\n", stall_counts.early_branch_squashes);
+	printf("Number of branch comparator stall cycles: %d\n", stall_counts.comparator_stalls);
+}
+
+static void PrintDelaySlotStatistics()
+{
+	int nr_moved, nr_nops;
+
+	GetDelaySlotFillingCounts(&nr_moved, &nr_nops);
+	if (nr_moved + nr_nops > 0)
+		printf("Delay slots filled by the assembler: %d with an instruction, %d with a nop\n",
+			nr_moved, nr_nops);
+}
+
+// Return whether the timing of the memory accesses is modelled
+static int IsMemoryTimingModelled()
+{
+	return AreCachesEnabled() || AreTLBsEnabled() || GetStoreBufferDepth() > 0;
+}
+
+static void PrintCacheStatistics()
+{
+	int c;
+
+	for (c = 0; c < NR_OF_CACHES; ++c)
+		if (IsCacheConfigured((CacheId) c))
+		{
+			const CacheStats* stats = GetCacheStats((CacheId) c);
+			long long accesses = stats->hits + stats->misses;
+
+			printf("%s: %lld hits, %lld misses (%.2f%%), %lld writebacks\n", GetCacheName((CacheId) c),
+				stats->hits, stats->misses, accesses > 0 ? 100.0 * stats->misses / accesses : 0.0,
+				stats->writebacks);
+		}
+	for (c = 0; c < NR_OF_CACHES; ++c)
+		if (IsCacheConfigured((CacheId) c) && GetPrefetcherConfig((CacheId) c)->kind != NO_PREFETCHER)
+		{
+			const PrefetchStats* stats = GetPrefetchStats((CacheId) c);
+
+			printf("%s prefetcher (%s): %lld issued, %lld useful (%.2f%%), %lld late, %lld polluting\n",
+				GetCacheName((CacheId) c), GetPrefetcherName(GetPrefetcherConfig((CacheId) c)->kind),
+				stats->issued, stats->useful, stats->issued > 0 ? 100.0 * stats->useful / stats->issued : 0.0,
+				stats->late, stats->polluting);
+		}
+	for (c = 0; c < NR_OF_TLBS; ++c)
+		if (IsTLBConfigured((TLBId) c))
+		{
+			const TLBStats* stats = GetTLBStats((TLBId) c);
+			long long accesses = stats->hits + stats->misses;
+
+			printf("%s: %lld hits, %lld misses (%.2f%%), %lld page walk cycles\n", GetTLBName((TLBId) c),
+				stats->hits, stats->misses, accesses > 0 ? 100.0 * stats->misses / accesses : 0.0,
+				stats->walk_cycles);
+		}
+	printf("Number of instruction fetch stall cycles: %d\n", stall_counts.fetch_stalls);
+	printf("Number of data memory stall cycles: %d\n", stall_counts.memory_stalls);
+
+	if (GetNrOfMSHRs() > 0)
+	{
+		const MSHRStats* stats = GetMSHRStats();
+
+		printf("MSHRs: %lld primary misses, %lld secondary misses, %lld cycles waiting for a free MSHR\n",
+			stats->primary_misses, stats->secondary_misses, stats->full_stall_cycles);
+		printf("Memory-level parallelism: %f\n",
+			stats->busy_cycles > 0 ? (double) stats->outstanding_cycles / stats->busy_cycles : 0.0);
+		printf("Number of load miss stall cycles: %d\n", stall_counts.load_miss_stalls);
+		printf("Stall cycles saved versus a blocking data cache: %lld\n",
+			stats->blocking_stall_cycles - stats->full_stall_cycles - stall_counts.load_miss_stalls);
+	}
+
+	if (GetStoreBufferDepth() > 0)
+	{
+		const StoreBufferStats* stats = GetStoreBufferStats();
+
+		printf("Store buffer: %lld stores, %lld full stalls (%lld cycles)\n", stats->stores,
+			stats->full_stalls, stats->full_stall_cycles);
+		printf("Store-to-load forwarding: %lld of %lld loads forwarded (%.2f%%)\n", stats->forwarded_loads,
+			stats->loads, stats->loads > 0 ? 100.0 * stats->forwarded_loads / stats->loads : 0.0);
+		printf("Partial store-to-load overlaps: %lld (%lld cycles waiting for the store to drain)\n",
+			stats->partial_overlaps, stats->partial_overlap_cycles);
+	}
+
+	if (IsDramEnabled())
+	{
+		const DramStats* stats = GetDramStats();
+		long long accesses = stats->row_hits + stats->row_empty + stats->row_conflicts;
+
+		printf("DRAM: %lld reads, %lld writes, %lld row-buffer hits, %lld empty rows, %lld row conflicts\n",
+			stats->reads, stats->writes, stats->row_hits, stats->row_empty, stats->row_conflicts);
+		printf("Row-buffer hit rate: %.2f%%\n", accesses > 0 ? 100.0 * stats->row_hits / accesses : 0.0);
+		printf("Average memory latency: %f\n",
+			stats->reads > 0 ? (double) stats->read_latency / stats->reads : 0.0);
+	}
+}
+
+// Run the program with RunProgramSampled(). If target_error > 0, the program is rerun
+// from its initial state, saved as a snapshot, with shorter sampling periods until the
+// error bound is met.
+static void RunSampled(SamplingConfig* config, double target_error)
+{
+	static const int MAX_NR_OF_RUNS = 4;
+	int run;
+
+	if (target_error > 0.0)
+		SaveSnapshot();
+
+	for (run = 1; ; ++run)
+	{
+		int period;
+
+		RunProgramSampled(config);
+		if (target_error <= 0.0)
+			return;
+
+		printf("Sampling period %d: %d samples, error bound %.2f%%\n", config->period,
+			GetNrOfSamples(), 100.0 * GetCPIErrorBound());
+		if ((GetCPIErrorBound() >= 0.0 && GetCPIErrorBound() <= target_error) || run == MAX_NR_OF_RUNS)
+			break;
+
+		// Nothing more can be gained once every period is simulated in detail
+		period = GetSamplingPeriodForErrorBound(config, target_error);
+		if (period >= config->period)
+			break;
+		config->period = period;
+		RestoreSnapshot();
+	}
+
+	if (GetCPIErrorBound() < 0.0 || GetCPIErrorBound() > target_error)
+		printf("The target error bound of %.2f%% was not reached\n", 100.0 * target_error);
+}
+
 int main(int cmd_line_length, const char* cmd_line[])
 {
 	FILE* mips_file;
+	const char* mips_filename = NULL;
+	int functional = 0, tracing = 1, print_regs = 0;
+	int nr_fast_forward = 0;
+	const char* native_filename = NULL;
+	const char* checkpoint_filename = NULL;
+	const char* restore_filename = NULL;
+	int checkpoint_interval = 0, max_cycles = 0, nr_runs = 1;
+	SamplingConfig sampling_config = { 0, 0, 0 };
+	double target_error = 0.0;
+	const char* select_simpoints_filename = NULL;
+	const char* simpoints_filename = NULL;
+	int simpoint_interval = 0, simpoint_max_k = 0, simpoint_warmup = 0;
+	int parallel_interval = 0, parallel_warmup = 0, nr_workers = 0;
+	const char* batch_filename = NULL;
+	int a;
 
-	if (cmd_line_length != 2)
+	for (a = 1; a < cmd_line_length; ++a)
+	{
+		if (strcmp(cmd_line[a], "-functional") == 0)
+			functional = 1;
+		else if (strcmp(cmd_line[a], "-native") == 0 && a + 1 < cmd_line_length)
+			native_filename = cmd_line[++a];
+		else if (strcmp(cmd_line[a], "-ff") == 0 && a + 1 < cmd_line_length)
+			nr_fast_forward = atoi(cmd_line[++a]);
+		else if (strcmp(cmd_line[a], "-notrace") == 0)
+			tracing = 0;
+		else if (strcmp(cmd_line[a], "-regs") == 0)
+			print_regs = 1;
+		else if (strcmp(cmd_line[a], "-accelerate") == 0)
+			SetLoopAcceleration(1);
+		else if (strcmp(cmd_line[a], "-runs") == 0 && a + 1 < cmd_line_length)
+		{
+			nr_runs = atoi(cmd_line[++a]);
+			if (nr_runs <= 0)
+				Usage(cmd_line[0]);
+		}
+		else if (strcmp(cmd_line[a], "-max-cycles") == 0 && a + 1 < cmd_line_length)
+			max_cycles = atoi(cmd_line[++a]);
+		else if (strcmp(cmd_line[a], "-checkpoint") == 0 && a + 2 < cmd_line_length)
+		{
+			checkpoint_filename = cmd_line[++a];
+			checkpoint_interval = atoi(cmd_line[++a]);
+			if (checkpoint_interval <= 0)
+				Usage(cmd_line[0]);
+		}
+		else if (strcmp(cmd_line[a], "-restore") == 0 && a + 1 < cmd_line_length)
+			restore_filename = cmd_line[++a];
+		else if (strcmp(cmd_line[a], "-sample") == 0 && a + 3 < cmd_line_length)
+		{
+			sampling_config.period = atoi(cmd_line[++a]);
+			sampling_config.warmup = atoi(cmd_line[++a]);
+			sampling_config.window = atoi(cmd_line[++a]);
+			if (sampling_config.window <= 0 || sampling_config.warmup < 0
+				|| sampling_config.period < sampling_config.warmup + sampling_config.window)
+				Usage(cmd_line[0]);
+		}
+		else if (strcmp(cmd_line[a], "-target-error") == 0 && a + 1 < cmd_line_length)
+			target_error = atof(cmd_line[++a]) / 100.0;
+		else if (strcmp(cmd_line[a], "-select-simpoints") == 0 && a + 3 < cmd_line_length)
+		{
+			simpoint_interval = atoi(cmd_line[++a]);
+			simpoint_max_k = atoi(cmd_line[++a]);
+			select_simpoints_filename = cmd_line[++a];
+			if (simpoint_interval <= 0 || simpoint_max_k <= 0)
+				Usage(cmd_line[0]);
+		}
+		else if (strcmp(cmd_line[a], "-simpoints") == 0 && a + 2 < cmd_line_length)
+		{
+			simpoints_filename = cmd_line[++a];
+			simpoint_warmup = atoi(cmd_line[++a]);
+		}
+		else if (strcmp(cmd_line[a], "-parallel") == 0 && a + 3 < cmd_line_length)
+		{
+			parallel_interval = atoi(cmd_line[++a]);
+			parallel_warmup = atoi(cmd_line[++a]);
+			nr_workers = atoi(cmd_line[++a]);
+			if (parallel_interval <= 0 || parallel_warmup < 0 || nr_workers <= 0)
+				Usage(cmd_line[0]);
+		}
+		else if (strcmp(cmd_line[a], "-batch") == 0 && a + 1 < cmd_line_length)
+			batch_filename = cmd_line[++a];
+		else if (strcmp(cmd_line[a], "-l1i") == 0 && a + 1 < cmd_line_length)
+			ConfigureCacheFromCommandLine(L1_INSTRUCTION_CACHE, cmd_line[++a], cmd_line[0]);
+		else if (strcmp(cmd_line[a], "-l1d") == 0 && a + 1 < cmd_line_length)
+			ConfigureCacheFromCommandLine(L1_DATA_CACHE, cmd_line[++a], cmd_line[0]);
+		else if (strcmp(cmd_line[a], "-l2") == 0 && a + 1 < cmd_line_length)
+			ConfigureCacheFromCommandLine(L2_CACHE, cmd_line[++a], cmd_line[0]);
+		else if (strcmp(cmd_line[a], "-mshrs") == 0 && a + 1 < cmd_line_length)
+		{
+			int nr_mshrs = atoi(cmd_line[++a]);
+			if (nr_mshrs < 0 || nr_mshrs > MAX_NR_OF_MSHRS)
+				Usage(cmd_line[0]);
+			SetNrOfMSHRs(nr_mshrs);
+		}
+		else if (strcmp(cmd_line[a], "-l1i-prefetch") == 0 && a + 1 < cmd_line_length)
+			ConfigurePrefetcherFromCommandLine(L1_INSTRUCTION_CACHE, cmd_line[++a], cmd_line[0]);
+		else if (strcmp(cmd_line[a], "-l1d-prefetch") == 0 && a + 1 < cmd_line_length)
+			ConfigurePrefetcherFromCommandLine(L1_DATA_CACHE, cmd_line[++a], cmd_line[0]);
+		else if (strcmp(cmd_line[a], "-memory-latency") == 0 && a + 1 < cmd_line_length)
+		{
+			int latency = atoi(cmd_line[++a]);
+			if (latency <= 0)
+				Usage(cmd_line[0]);
+			SetMemoryLatency(latency);
+		}
+		else if (strcmp(cmd_line[a], "-itlb") == 0 && a + 1 < cmd_line_length)
+			ConfigureTLBFromCommandLine(INSTRUCTION_TLB, cmd_line[++a], cmd_line[0]);
+		else if (strcmp(cmd_line[a], "-dtlb") == 0 && a + 1 < cmd_line_length)
+			ConfigureTLBFromCommandLine(DATA_TLB, cmd_line[++a], cmd_line[0]);
+		else if (strcmp(cmd_line[a], "-page-walk") == 0 && a + 1 < cmd_line_length)
+		{
+			PageWalkConfig config;
+
+			GetDefaultPageWalkConfig(&config);
+			if (ParsePageWalkConfig(cmd_line[++a], &config) != 0)
+			{
+				fprintf(stderr, "Invalid configuration of the page-table walker: %s\n", cmd_line[a]);
+				Usage(cmd_line[0]);
+			}
+			ConfigurePageWalk(&config);
+		}
+		else if (strcmp(cmd_line[a], "-store-buffer") == 0 && a + 1 < cmd_line_length)
+		{
+			int depth = atoi(cmd_line[++a]);
+			if (depth < 0 || depth > MAX_STORE_BUFFER_DEPTH)
+				Usage(cmd_line[0]);
+			SetStoreBufferDepth(depth);
+		}
+		else if (strcmp(cmd_line[a], "-dram") == 0 && a + 1 < cmd_line_length)
+		{
+			DramConfig config;
+
+			GetDefaultDramConfig(&config);
+			if (ParseDramConfig(cmd_line[++a], &config) != 0)
+			{
+				fprintf(stderr, "Invalid configuration of the DRAM: %s\n", cmd_line[a]);
+				Usage(cmd_line[0]);
+			}
+			ConfigureDram(&config);
+		}
+		else if (strcmp(cmd_line[a], "-branch-predictor") == 0 && a + 1 < cmd_line_length)
+		{
+			BranchPredictorConfig config;
+
+			GetDefaultBranchPredictorConfig(&config);
+			if (ParseBranchPredictorConfig(cmd_line[++a], &config) != 0)
+			{
+				fprintf(stderr, "Invalid branch predictor: %s\n", cmd_line[a]);
+				Usage(cmd_line[0]);
+			}
+			ConfigureBranchPredictor(&config);
+		}
+		else if (strcmp(cmd_line[a], "-btb") == 0 && a + 1 < cmd_line_length)
+		{
+			BTBConfig config;
+
+			GetDefaultBTBConfig(&config);
+			if (ParseBTBConfig(cmd_line[++a], &config) != 0)
+			{
+				fprintf(stderr, "Invalid configuration of the BTB: %s\n", cmd_line[a]);
+				Usage(cmd_line[0]);
+			}
+			ConfigureBTB(&config);
+		}
+		else if (strcmp(cmd_line[a], "-ras") == 0 && a + 1 < cmd_line_length)
+		{
+			int depth = atoi(cmd_line[++a]);
+			if (depth < 0 || depth > MAX_RAS_DEPTH)
+				Usage(cmd_line[0]);
+			SetRASDepth(depth);
+		}
+		else if (strcmp(cmd_line[a], "-early-branches") == 0)
+			SetEarlyBranchResolution(1);
+		else if (strcmp(cmd_line[a], "-delay-slots") == 0)
+			SetDelaySlots(1);
+		else if (strcmp(cmd_line[a], "-fill-delay-slots") == 0 && a + 1 < cmd_line_length)
+		{
+			if (strcmp(cmd_line[++a], "nop") == 0)
+				SetDelaySlotFilling(NOP_DELAY_SLOT_FILLING);
+			else if (strcmp(cmd_line[a], "auto") == 0)
+				SetDelaySlotFilling(AUTO_DELAY_SLOT_FILLING);
+			else
+				Usage(cmd_line[0]);
+			SetDelaySlots(1);
+		}
+		else if (cmd_line[a][0] != '-' && mips_filename == NULL)
+			mips_filename = cmd_line[a];
+		else
+			Usage(cmd_line[0]);
+	}
+	for (a = L1_INSTRUCTION_CACHE; a <= L1_DATA_CACHE; ++a)
+		if (GetPrefetcherConfig((CacheId) a)->kind != NO_PREFETCHER && !IsCacheConfigured((CacheId) a))
+		{
+			fprintf(stderr, "A prefetcher needs the %s to be modelled\n", GetCacheName((CacheId) a));
+			Usage(cmd_line[0]);
+		}
+	if (IsDramEnabled() && !AreCachesEnabled() && !AreTLBsEnabled())
+	{
+		fprintf(stderr, "The DRAM model needs a cache or a TLB in front of it\n");
+		Usage(cmd_line[0]);
+	}
+	if (AreDelaySlotsOn() && (IsBTBConfigured() || native_filename != NULL || sampling_config.period > 0
+		|| select_simpoints_filename != NULL || simpoints_filename != NULL || parallel_interval > 0
+		|| batch_filename != NULL))
+	{
+		fprintf(stderr, "Delay slots can not be combined with -btb, -native, -sample, -select-simpoints,\n"
+			"-simpoints, -parallel or -batch\n");
 		Usage(cmd_line[0]);
+	}
+	if (restore_filename != NULL)
+	{
+		// The trace is named after the checkpoint unless an assembly file is given
+		if (mips_filename == NULL)
+			mips_filename = restore_filename;
+		if (RestoreCheckpoint(restore_filename) != 0)
+		{
+			EXIT_APPL(EXIT_FAILURE);
+		}
+	}
+	else
+	{
+		if (mips_filename == NULL)
+			Usage(cmd_line[0]);
+
+		// Open and parse the MIPS file
+		mips_file = fopen(mips_filename, "r");
+		if (mips_file == 0)
+		{
+			fprintf(stderr, "Could not open file %s for reading\n", mips_filename);
+			EXIT_APPL(EXIT_FAILURE);
+		}
+		InitPipeline(mips_file);
+		fclose(mips_file);
+	}
+
+	if (native_filename != NULL)
+	{
+		if (nr_fast_forward > 0)
+			printf("Number of fast-forwarded instructions: %d\n", FastForward(nr_fast_forward));
+		if (CompileProgram(native_filename) != 0)
+		{
+			fprintf(stderr, "Compilation of %s failed\n", native_filename);
+			EXIT_APPL(EXIT_FAILURE);
+		}
+		printf("Native executable written to %s\n", native_filename);
+		EXIT_APPL(EXIT_SUCCESS);
+	}
+
+	if (select_simpoints_filename != NULL)
+	{
+		SimulationPoints points;
+		int i;
+
+		SelectSimulationPoints(simpoint_interval, simpoint_max_k, &points);
+		if (WriteSimulationPoints(select_simpoints_filename, &points) != 0)
+		{
+			EXIT_APPL(EXIT_FAILURE);
+		}
+		printf("Number of retired instructions: %lld\n", points.nr_instr);
+		printf("Number of simulation points: %d\n", points.nr_points);
+		for (i = 0; i < points.nr_points; ++i)
+			printf("Interval %lld: weight %f\n", points.points[i].interval, points.points[i].weight);
+		FreeSimulationPoints(&points);
+		EXIT_APPL(EXIT_SUCCESS);
+	}
+
+	if (simpoints_filename != NULL)
+	{
+		SimulationPoints points;
+
+		if (ReadSimulationPoints(simpoints_filename, &points) != 0)
+		{
+			EXIT_APPL(EXIT_FAILURE);
+		}
+		RunProgramAtSimulationPoints(&points, simpoint_warmup);
+		FreeSimulationPoints(&points);
+		printf("Number of simulated intervals: %d\n", GetNrOfSamples());
+		printf("Number of simulated cycles: %d\n", GetElapsedCycles());
+		printf("Number of functionally executed instructions: %d\n", GetNrOfFastForwardedInstructions());
+		printf("Number of retired instructions: %d\n", GetNrOfRetiredInstructions());
+		printf("Estimated number of cycles: %lld\n", GetEstimatedCycles());
+		printf("Estimated CPI: %f\n", GetCPI());
+		if (print_regs)
+			PrintRegisterFile(stdout);
+		EXIT_APPL(EXIT_SUCCESS);
+	}
+
+	if (batch_filename != NULL)
+	{
+		int lane;
+
+		if (InitBatch(batch_filename) != 0)
+		{
+			EXIT_APPL(EXIT_FAILURE);
+		}
+		RunBatch(max_cycles);
+		printf("Number of lanes: %d\n", GetNrOfLanes());
+		printf("Number of lane groups: %d\n", GetNrOfLaneGroups());
+		for (lane = 0; lane < GetNrOfLanes(); ++lane)
+		{
+			printf("Lane %d: %lld cycles, %lld retired instructions", lane,
+				GetLaneCycles(lane), GetLaneRetiredInstructions(lane));
+			if (GetLaneStatus(lane) == LANE_FAILED)
+				printf(", MIPS runtime error: %s", GetLaneError(lane));
+			else if (GetLaneStatus(lane) == LANE_STOPPED)
+				printf(", stopped before the program terminated");
+			printf("\n");
+			if (print_regs)
+			{
+				long long values[32];
+				ReadAllFromLaneRegisters(lane, values);
+				WriteAllToRegisterFile(values);
+				PrintRegisterFile(stdout);
+			}
+		}
+		EXIT_APPL(EXIT_SUCCESS);
+	}
+
+	if (parallel_interval > 0)
+	{
+		printf("Number of intervals: %d\n", RunProgramTimeParallel(parallel_interval, parallel_warmup, nr_workers));
+		printf("Number of cycles: %d\n", GetElapsedCycles());
+		printf("Number of retired instructions: %d\n", GetNrOfRetiredInstructions());
+		printf("Average CPI: %f\n", GetCPI());
+		printf("Number of load-use stall cycles: %d\n", stall_counts.load_use_stalls);
+		printf("Number of taken branch flushes: %d\n", stall_counts.branch_flushes);
+		if (stall_counts.jump_flushes > 0)
+			printf("Number of jr and jalr target flushes: %d\n", stall_counts.jump_flushes);
+		printf("Number of jump squashes: %d\n", stall_counts.jump_squashes);
+		if (IsBranchPredictorConfigured() || IsBTBConfigured())
+			printf("Number of predicted-taken branch squashes: %d\n", stall_counts.branch_squashes);
+		if (IsEarlyBranchResolutionOn())
+			PrintEarlyBranchResolutionStatistics();
+		if (IsMemoryTimingModelled())
+		{
+			printf("Number of instruction fetch stall cycles: %d\n", stall_counts.fetch_stalls);
+			printf("Number of data memory stall cycles: %d\n", stall_counts.memory_stalls);
+		}
+		if (print_regs)
+			PrintRegisterFile(stdout);
+		EXIT_APPL(EXIT_SUCCESS);
+	}
+
+	if (functional)
+	{
+		RunProgramFunctional();
+		printf("Number of retired instructions: %d\n", GetNrOfRetiredInstructions());
+	}
+	else
+	{
+		int pos = 0;
+		for (int i = 0; mips_filename[i] != '\0'; ++i)
+			if (mips_filename[i] == '.') pos = i;
+		char out_filename[1024]; //it should be enough long
+		strncpy(out_filename, mips_filename, pos);
+		strcpy(out_filename+pos, ".html");
+
+		if (nr_fast_forward > 0)
+			printf("Number of fast-forwarded instructions: %d\n", FastForward(nr_fast_forward));
+
+		if (sampling_config.period > 0)
+		{
+			RunSampled(&sampling_config, target_error);
+			printf("Number of samples: %d\n", GetNrOfSamples());
+			printf("Number of simulated cycles: %d\n", GetElapsedCycles());
+			printf("Number of functionally executed instructions: %d\n", GetNrOfFastForwardedInstructions());
+			printf("Number of retired instructions: %d\n", GetNrOfRetiredInstructions());
+			printf("Estimated number of cycles: %lld\n", GetEstimatedCycles());
+			printf("Estimated CPI: %f\n", GetCPI());
+			if (GetCPIErrorBound() >= 0.0)
+				printf("95%% confidence interval of the CPI: %f - %f (+/- %.2f%%)\n",
+					GetCPI() * (1.0 - GetCPIErrorBound()), GetCPI() * (1.0 + GetCPIErrorBound()),
+					100.0 * GetCPIErrorBound());
+			else
+				printf("95%% confidence interval of the CPI: unbounded (fewer than two samples)\n");
+			if (print_regs)
+				PrintRegisterFile(stdout);
+			EXIT_APPL(EXIT_SUCCESS);
+		}
+
+		SetTracing(tracing);
+		SetCycleLimit(max_cycles);
+		SetCheckpointing(checkpoint_filename, checkpoint_interval);
+		if (nr_runs > 1)
+		{
+			// Every run starts from the same state, and the results of the last
+			// one are reported
+			int run;
+
+			SaveSnapshot();
+			for (run = 1; run < nr_runs; ++run)
+			{
+				RunProgram(out_filename);
+				RestoreSnapshot();
+			}
+			printf("Number of runs: %d\n", nr_runs);
+		}
+		RunProgram(out_filename);
+		if (!HasProgramTerminated())
+		{
+			printf("Simulation stopped before the program terminated\n");
+			if (checkpoint_filename != NULL && SaveCheckpoint(checkpoint_filename) != 0)
+			{
+				EXIT_APPL(EXIT_FAILURE);
+			}
+		}
+		printf("Number of cycles: %d\n", GetElapsedCycles());
+		printf("Number of retired instructions: %d\n", GetNrOfRetiredInstructions());
+		printf("Average CPI: %f\n", GetCPI());
+		if (IsMemoryTimingModelled())
+			PrintCacheStatistics();
+		if (IsBranchPredictorConfigured() || IsBTBConfigured() || GetRASDepth() > 0)
+			PrintBranchPredictionStatistics();
+		if (IsEarlyBranchResolutionOn())
+			PrintEarlyBranchResolutionStatistics();
+		if (AreDelaySlotsOn())
+			PrintDelaySlotStatistics();
+		if (IsLoopAccelerationOn())
+		{
+			printf("Number of accelerated loop iterations: %lld\n", GetNrOfAcceleratedIterations());
+			if (GetNrOfApproximateLoopExits() > 0)
+				printf("Number of approximate loop exits: %d\n", GetNrOfApproximateLoopExits());
+		}
+	}
+
+	if (print_regs)
+		PrintRegisterFile(stdout);
 
-	// Open and parse the MIPS file
-	mips_file = fopen(cmd_line[1], "r");
-	if (mips_file == 0)
-	{
-		fprintf(stderr, "Could not open file %s for reading\n", cmd_line[1]);
-		EXIT_APPL(EXIT_FAILURE);
-	}
-	InitPipeline(mips_file);
-	fclose(mips_file);
-
-	int pos = 0;
-	for (int i = 0; cmd_line[1][i] != '\0'; ++i)
-		if (cmd_line[1][i] == '.') pos = i;
-	char out_filename[1024]; //it should be enough long
-	strncpy(out_filename, cmd_line[1], pos);
-	strcpy(out_filename+pos, ".html");
-	SetTracing(1);
-	RunProgram(out_filename);
-	printf("Number of cycles: %d\n", GetElapsedCycles());
-	printf("Number of retired instructions: %d\n", GetNrOfRetiredInstructions());
-	printf("Average CPI: %f\n", GetCPI());
-	
 	EXIT_APPL(EXIT_SUCCESS);
 }
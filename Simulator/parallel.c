@@ -0,0 +1,176 @@
+#include "parallel.h"
+#include "pipeline.h"
+#include "utils.h"
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#ifndef _WIN32
+#	include <unistd.h>
+#	include <sys/types.h>
+#	include <sys/wait.h>
+#endif
+
+// The counts that a worker reports for its interval
+typedef struct IntervalResult
+{
+	long long nr_cycles;
+	long long nr_retired;
+	StallCounts stalls;
+}
+IntervalResult;
+
+#ifndef _WIN32
+
+// A running worker, and the read end of the pipe that it reports its result through
+typedef struct Worker
+{
+	pid_t pid;
+	int fd;
+}
+Worker;
+
+// Simulate an interval in a forked worker, and write the result to fd
+static void RunWorker(int fd, int warmup, int interval_size)
+{
+	IntervalResult result;
+
+	memset(&result, 0, sizeof(result));
+
+	// If the program terminates during the warm-up, the previous interval has already
+	// covered the rest of it
+	if (!RunInstructions(warmup))
+	{
+		int start_cycles = GetElapsedCycles();
+		int start_retired = GetNrOfRetiredInstructions();
+		StallCounts start_stalls = stall_counts;
+
+		RunInstructions(interval_size);
+		result.nr_cycles = GetElapsedCycles() - start_cycles;
+		result.nr_retired = GetNrOfRetiredInstructions() - start_retired;
+		result.stalls.load_use_stalls = stall_counts.load_use_stalls - start_stalls.load_use_stalls;
+		result.stalls.branch_flushes = stall_counts.branch_flushes - start_stalls.branch_flushes;
+		result.stalls.jump_flushes = stall_counts.jump_flushes - start_stalls.jump_flushes;
+		result.stalls.jump_squashes = stall_counts.jump_squashes - start_stalls.jump_squashes;
+		result.stalls.branch_squashes = stall_counts.branch_squashes - start_stalls.branch_squashes;
+		result.stalls.fetch_stalls = stall_counts.fetch_stalls - start_stalls.fetch_stalls;
+		result.stalls.memory_stalls = stall_counts.memory_stalls - start_stalls.memory_stalls;
+		result.stalls.load_miss_stalls = stall_counts.load_miss_stalls - start_stalls.load_miss_stalls;
+		result.stalls.comparator_stalls = stall_counts.comparator_stalls - start_stalls.comparator_stalls;
+		result.stalls.early_branch_squashes = stall_counts.early_branch_squashes
+			- start_stalls.early_branch_squashes;
+	}
+
+	if (write(fd, &result, sizeof(result)) != sizeof(result))
+		_exit(EXIT_FAILURE);
+	close(fd);
+	_exit(EXIT_SUCCESS);
+}
+
+// Wait for the worker to finish, and add its result to total
+static void CollectResult(const Worker* worker, IntervalResult* total)
+{
+	IntervalResult result;
+	int status;
+
+	if (read(worker->fd, &result, sizeof(result)) != sizeof(result)
+		|| waitpid(worker->pid, &status, 0) != worker->pid
+		|| !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS)
+	{
+		fprintf(stderr, "A simulation worker failed\n");
+		EXIT_APPL(EXIT_FAILURE)
+	}
+	close(worker->fd);
+
+	total->nr_cycles += result.nr_cycles;
+	total->nr_retired += result.nr_retired;
+	total->stalls.load_use_stalls += result.stalls.load_use_stalls;
+	total->stalls.branch_flushes += result.stalls.branch_flushes;
+	total->stalls.jump_flushes += result.stalls.jump_flushes;
+	total->stalls.jump_squashes += result.stalls.jump_squashes;
+	total->stalls.branch_squashes += result.stalls.branch_squashes;
+	total->stalls.fetch_stalls += result.stalls.fetch_stalls;
+	total->stalls.memory_stalls += result.stalls.memory_stalls;
+	total->stalls.load_miss_stalls += result.stalls.load_miss_stalls;
+	total->stalls.comparator_stalls += result.stalls.comparator_stalls;
+	total->stalls.early_branch_squashes += result.stalls.early_branch_squashes;
+}
+
+#endif // ifndef _WIN32
+
+// Public functions -------------------------------------------------------------------
+
+int RunProgramTimeParallel(int interval_size, int warmup, int nr_workers)
+{
+#ifdef _WIN32
+	SetTracing(0);
+	RunProgram(NULL);
+	return 1;
+#else
+	Worker* workers = (Worker*) malloc(nr_workers * sizeof(Worker));
+	IntervalResult total;
+	long long position = 0;
+	int nr_running = 0, nr_intervals = 0;
+
+	memset(&total, 0, sizeof(total));
+
+	for (;;)
+	{
+		long long start = (long long) nr_intervals * interval_size;
+		int interval_warmup = start < warmup ? (int) start : warmup;
+		long long fork_at = start - interval_warmup;
+		int fds[2];
+		pid_t pid;
+
+		// Run functionally to the start of the warm-up. FastForward() stops before the
+		// syscall, so falling short means that the program ends before this interval.
+		if (fork_at > position)
+		{
+			position += FastForward((int) (fork_at - position));
+			if (position < fork_at)
+				break;
+		}
+
+		// Wait for the oldest worker if all are busy
+		if (nr_running == nr_workers)
+		{
+			CollectResult(&workers[0], &total);
+			memmove(workers, workers + 1, (nr_workers - 1) * sizeof(Worker));
+			--nr_running;
+		}
+
+		// Buffered output would otherwise be written by both processes
+		fflush(NULL);
+		if (pipe(fds) != 0 || (pid = fork()) < 0)
+		{
+			perror("Could not start a simulation worker");
+			EXIT_APPL(EXIT_FAILURE)
+		}
+		if (pid == 0)
+		{
+			close(fds[0]);
+			RunWorker(fds[1], interval_warmup, interval_size);
+		}
+		close(fds[1]);
+		workers[nr_running].pid = pid;
+		workers[nr_running].fd = fds[0];
+		++nr_running;
+		++nr_intervals;
+	}
+
+	while (nr_running > 0)
+	{
+		CollectResult(&workers[0], &total);
+		memmove(workers, workers + 1, (nr_running - 1) * sizeof(Worker));
+		--nr_running;
+	}
+	free(workers);
+
+	// Complete the program, which the functional pass has left just before its syscall,
+	// and report the combined counts of the intervals
+	RunInstructions(INT_MAX);
+	SetPipelineCounters((int) total.nr_cycles, (int) total.nr_retired, 0);
+	stall_counts = total.stalls;
+	return nr_intervals;
+#endif
+}
@@ -0,0 +1,30 @@
+/** @file parallel.h
+	Time-parallel simulation of a single program on several host cores.
+
+	A functional pass runs through the program and stops at the start of each
+	interval of a fixed number of instructions (less a warm-up). There, a worker
+	process is forked, which inherits a copy of the complete simulator state, i.e., an
+	architectural checkpoint. The worker simulates the warm-up and the interval in
+	detail and reports the cycle and stall counts of the interval back, while the
+	functional pass continues to the next interval. Finally the counts of all intervals
+	are added up. Since every worker starts with an empty pipeline, the result can
+	differ slightly from that of RunProgram() if the warm-up is too short.
+
+	Processes are used rather than threads, since the state of the simulator is held
+	in global variables. */
+
+#ifndef PARALLEL_H_INCL
+#define PARALLEL_H_INCL
+
+/** Run the program until it terminates, simulating intervals of @a interval_size
+	instructions in parallel in up to @a nr_workers worker processes. Each interval is
+	preceded by @a warmup instructions of detailed simulation that are not counted.
+	Afterwards, GetElapsedCycles(), GetNrOfRetiredInstructions(), GetCPI() and
+	stall_counts hold the totals of all intervals, and the register file and memories
+	hold the final state of the program. No trace is written. On hosts without fork(),
+	the program is simulated sequentially with RunProgram().
+	@pre InitPipeline() has been called, and the pipeline has not been run
+	@return The number of intervals */
+int RunProgramTimeParallel(int interval_size, int warmup, int nr_workers);
+
+#endif // ifndef PARALLEL_H_INCL
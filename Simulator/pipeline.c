@@ -4,15 +4,40 @@
 #include "error_handling.h"
 #include "utils.h"
 #include "update.h"
+#include "translation_cache.h"
+#include "aot.h"
+#include "checkpoint.h"
+#include "statistics.h"
+#include "loop_acceleration.h"
+#include "cache.h"
+#include "tlb.h"
+#include "store_buffer.h"
+#include "branch_predictor.h"
+#include "btb.h"
+#include "ras.h"
 #include <assert.h>
 #include <stdlib.h>
+#include <limits.h>
+#include <string.h>
 
 // Private variables and functions -------------------------------------
 
 static int nr_instr_retired;
 static int nr_cycles;
+static int nr_instr_fast_forwarded;
 static int trace;
 static FILE* trace_out;
+static int max_cycles;
+static const char* checkpoint_filename;
+static int checkpoint_interval;
+static int terminated;
+
+// Sampled simulation. When sampling, parts of the program are executed functionally,
+// and the CPI is estimated from the parts that are simulated in detail.
+static int sampling;
+static SampleStatistics cpi_samples;
+static int cpi_estimated;
+static double cpi_estimate;
 
 static void LinkMIPSProgram(ParsedInstr* instr_list, int nr_instr)
 {
@@ -25,6 +50,23 @@ static void LinkMIPSProgram(ParsedInstr* instr_list, int nr_instr)
 	a = GetTextSegmentStartingAddress();
 	for (i = 0; i < nr_instr; ++i)
 	{
+		// The delay slot of a branch or jump is executed before the execution continues
+		// at the target, which is not defined for another branch, jump or syscall
+		if (AreDelaySlotsOn() && i > 0 && IsBranchOrJump(instr_list[i - 1].instr.type)
+			&& (IsBranchOrJump(instr_list[i].instr.type) || instr_list[i].instr.type == SYSCALL))
+		{
+			STATIC_MIPS_ERROR("The %s on line %d is in the delay slot of a branch or jump",
+				StringRepOfInstrType(instr_list[i].instr.type), instr_list[i].instr.line_nr)
+		}
+
+		// Only instructions with label operands need to be linked
+		if (instr_list[i].label == NULL)
+		{
+			WriteToInstrMemory(a, &instr_list[i].instr);
+			a += 4;
+			continue;
+		}
+
 		switch (instr_list[i].instr.type)
 		{
 		// Data transfer instructions
@@ -52,6 +94,7 @@ static void LinkMIPSProgram(ParsedInstr* instr_list, int nr_instr)
 			break;
 		// Jump instructions
 		case J:
+		case JAL:
 			{
 				long long addr = LookupInSymbolTable(instr_list[i].label);
 				instr_list[i].instr.imm = addr;
@@ -251,6 +294,84 @@ static void FinalizeTraceFile()
 	fclose(trace_out);
 }
 
+// Functions for running the pipeline -------------------------------------------------
+
+// Simulate one clock cycle. Returns 1 if the syscall left the WB stage, i.e., if the
+// program has terminated.
+static int SimulateCycle()
+{
+	int found_syscall;
+
+	if (trace)
+		PrintPipelineInfo_HTML();
+
+	// Check if the instruction now leaving the WB stage is a syscall,
+	// in which case the simulation should be terminated
+	found_syscall = (wb_stage.instr.type == SYSCALL);
+	
+	// If the instruction now leaving the WB stage is not a nop,
+	// we count this as a retired instruction
+	if (wb_stage.instr.type != NOP)
+		++nr_instr_retired;
+
+	UpdatePipelineState();
+	++nr_cycles;
+	return found_syscall;
+}
+
+// Simulate clock cycles until nr_instr more instructions have retired. Returns 1 if
+// the program terminated before that.
+static int SimulateInstructions(int nr_instr)
+{
+	long long end = (long long) nr_instr_retired + nr_instr;
+
+	while (nr_instr_retired < end)
+		if (SimulateCycle())
+			return 1;
+	return 0;
+}
+
+// Restart the IF stage at the address pc, with empty pipeline registers
+static void RestartPipeline(long long pc)
+{
+	int walk_cycles = TranslateAddress(INSTRUCTION_TLB, pc, GetElapsedCycles());
+
+	if_stage.pc = pc;
+	if_stage.decoded = ReadDecodedFromInstrMemory(pc);
+	if_stage.instr = if_stage.decoded->instr;
+	if_stage.wait_cycles = walk_cycles + AccessInstructionCache(pc, GetElapsedCycles() + walk_cycles) - 1;
+	if_stage.btb_target = LookupBTB(pc);
+	if_stage.after_slot_pc = DONT_CARE;
+	ClearIDStage(&id_stage);
+	ClearExStage(&ex_stage);
+	ClearMemStage(&mem_stage);
+	ClearWBStage(&wb_stage);
+}
+
+// Empty the pipeline, so that execution can continue functionally. The instruction in
+// the WB stage is completed, since it has already accessed the memory. All younger
+// instructions have not yet changed any state, so they are discarded and the pipeline
+// is restarted at the oldest of them. Returns 1 if the program terminated.
+static int DrainPipeline()
+{
+	long long pc = if_stage.pc;
+
+	if (wb_stage.instr.type != NOP)
+		++nr_instr_retired;
+	if (wb_stage.instr.type == SYSCALL)
+		return 1;
+	UpdateRegisterFile();
+
+	if (mem_stage.pc != DONT_CARE)
+		pc = mem_stage.pc;
+	else if (ex_stage.pc != DONT_CARE)
+		pc = ex_stage.pc;
+	else if (id_stage.pc != DONT_CARE)
+		pc = id_stage.pc;
+	RestartPipeline(pc);
+	return 0;
+}
+
 // Exported stuff ---------------------------------------------------
 
 // The current states of all the state elements in the pipeline
@@ -260,20 +381,31 @@ ExStage ex_stage;
 MemStage mem_stage;
 WBStage wb_stage;
 
+StallCounts stall_counts;
+
 void ClearIFStage(IFStage* to_clear)
 {
 	to_clear->pc = 0;
 	to_clear->instr = CreateInstr_Empty(NOP, DONT_CARE);
+	to_clear->decoded = GetDecodedNop();
+	to_clear->wait_cycles = 0;
+	to_clear->btb_target = to_clear->after_slot_pc = DONT_CARE;
 }
 
 void ClearIDStage(IDStage* to_clear)
 {
 	to_clear->instr = CreateInstr_Empty(NOP, DONT_CARE);
+	to_clear->decoded = GetDecodedNop();
+	to_clear->pc = to_clear->predicted_pc = DONT_CARE;
+	to_clear->redirected = 0;
 }
 
 void ClearExStage(ExStage* to_clear)
 {
 	to_clear->instr = CreateInstr_Empty(NOP, DONT_CARE);
+	to_clear->decoded = GetDecodedNop();
+	to_clear->pc = to_clear->predicted_pc = DONT_CARE;
+	to_clear->redirected = 0;
 	to_clear->rs_value = to_clear->rt_value
 		= to_clear->imm_value = DONT_CARE;
 }
@@ -281,26 +413,59 @@ void ClearExStage(ExStage* to_clear)
 void ClearMemStage(MemStage* to_clear)
 {
 	to_clear->instr = CreateInstr_Empty(NOP, DONT_CARE);
+	to_clear->decoded = GetDecodedNop();
+	to_clear->pc = to_clear->predicted_pc = DONT_CARE;
 	to_clear->rt_value = to_clear->alu_result = to_clear->branch_target = DONT_CARE;
-	to_clear->zero = 0;
+	to_clear->zero = to_clear->redirected = 0;
+	to_clear->wait_cycles = 0;
 }
 
 void ClearWBStage(WBStage* to_clear)
 {
 	to_clear->instr = CreateInstr_Empty(NOP, DONT_CARE);
+	to_clear->decoded = GetDecodedNop();
+	to_clear->pc = DONT_CARE;
 	to_clear->result = DONT_CARE;
 }
 
 void InitPipeline(FILE* mips_file)
 {
 	InitMemory(mips_file);
+	InitCaches();
+	InitTLBs();
+	InitStoreBuffer();
+	InitBranchPredictor();
+	InitBTB();
+	InitRAS();
+	RestartPipeline(LookupInSymbolTable("__start"));
+
+	nr_cycles = nr_instr_retired = nr_instr_fast_forwarded = 0;
+	memset(&stall_counts, 0, sizeof(stall_counts));
+	terminated = 0;
+	sampling = cpi_estimated = 0;
+}
 
-	if_stage.pc = LookupInSymbolTable("__start");
-	if_stage.instr = ReadFromInstrMemory(if_stage.pc);
-	ClearIDStage(&id_stage);
-	ClearExStage(&ex_stage);
-	ClearMemStage(&mem_stage);
-	ClearWBStage(&wb_stage);
+void SetPipelineCounters(int cycles, int instr_retired, int instr_fast_forwarded)
+{
+	nr_cycles = cycles;
+	nr_instr_retired = instr_retired;
+	nr_instr_fast_forwarded = instr_fast_forwarded;
+}
+
+void SetCycleLimit(int limit)
+{
+	max_cycles = limit;
+}
+
+void SetCheckpointing(const char* filename, int interval)
+{
+	checkpoint_filename = filename;
+	checkpoint_interval = interval;
+}
+
+int HasProgramTerminated()
+{
+	return terminated;
 }
 
 void SetTracing(int on_off)
@@ -314,28 +479,204 @@ void RunProgram(const char* filename)
 
 	if (trace)
 		InitTraceFile(filename);
+	ResetLoopAcceleration();
 
-	for (nr_cycles = 0, nr_instr_retired = 0; !found_syscall; ++nr_cycles)
+	// The counters are not reset, so that a simulation restored from a checkpoint
+	// or stopped by the cycle limit continues where it was
+	while (!found_syscall)
 	{
-		if (trace)
-			PrintPipelineInfo_HTML();
-
-		// Check if the instruction now leaving the WB stage is a syscall,
-		// in which case the simulation should be terminated
-		found_syscall = (wb_stage.instr.type == SYSCALL);
-		
-		// If the instruction now leaving the WB stage is not a nop,
-		// we count this as a retired instruction
-		if (wb_stage.instr.type != NOP)
-			++nr_instr_retired;
-
-		UpdatePipelineState();
+		if (max_cycles > 0 && nr_cycles >= max_cycles)
+			break;
+
+		// The checkpoint is taken at the start of a cycle, so that restoring it and
+		// calling RunProgram() again repeats exactly the same cycles
+		if (checkpoint_filename != NULL && nr_cycles > 0 && nr_cycles % checkpoint_interval == 0
+			&& SaveCheckpoint(checkpoint_filename) != 0)
+		{
+			EXIT_APPL(EXIT_FAILURE)
+		}
+
+		// Loops can not be accelerated when every cycle must be traced or checkpointed,
+		// or when the timing depends on the contents of the caches, TLBs, store buffer,
+		// branch predictor, BTB or return address stack. Neither can they with early
+		// branch resolution, where the branch that ends an iteration can wait for an
+		// instruction of the iteration before, so that the restarted pipeline does not
+		// reach the recorded state, or with delay slots, where the oldest instruction in
+		// flight can be a delay slot that the pipeline can not be restarted at.
+		if (!trace && checkpoint_filename == NULL && !AreCachesEnabled() && !AreTLBsEnabled()
+			&& GetStoreBufferDepth() == 0 && !IsBranchPredictorConfigured() && !IsBTBConfigured()
+			&& GetRASDepth() == 0 && !IsEarlyBranchResolutionOn() && !AreDelaySlotsOn())
+			AccelerateLoops(max_cycles);
+
+		found_syscall = SimulateCycle();
 	}
+	terminated = found_syscall;
 
 	if (trace)
 		FinalizeTraceFile();
 }
 
+int RunInstructions(int nr_instr)
+{
+	if (SimulateInstructions(nr_instr))
+		terminated = 1;
+	return terminated;
+}
+
+void RunProgramFunctional()
+{
+	long long pc = if_stage.pc;
+	long long nr_retired;
+
+	RunTranslated(&pc, &nr_retired, -1);
+
+	// The terminating syscall also counts as a retired instruction
+	nr_instr_retired = (int) nr_retired + 1;
+	nr_cycles = 0;
+	terminated = 1;
+}
+
+int FastForward(int nr_instr)
+{
+	long long pc = if_stage.pc;
+	long long nr_retired;
+
+	RunTranslated(&pc, &nr_retired, nr_instr);
+	nr_instr_fast_forwarded += (int) nr_retired;
+
+	// Restart the pipeline with the next instruction in the IF stage
+	RestartPipeline(pc);
+
+	return (int) nr_retired;
+}
+
+void RunProgramSampled(const SamplingConfig* config)
+{
+	int nr_skipped = config->period - config->warmup - config->window;
+
+	sampling = 1;
+	ClearSampleStatistics(&cpi_samples);
+
+	for (;;)
+	{
+		int start_cycles, start_retired;
+
+		if (nr_skipped > 0)
+			FastForward(nr_skipped);
+
+		// The warm-up fills the pipeline, which is empty after the functional
+		// execution, so that the measurement starts in a steady state
+		if (SimulateInstructions(config->warmup))
+			break;
+
+		// A window that is cut short by the end of the program is not used as a sample
+		start_cycles = nr_cycles;
+		start_retired = nr_instr_retired;
+		if (SimulateInstructions(config->window))
+			break;
+		AddSample(&cpi_samples, (double) (nr_cycles - start_cycles) / (nr_instr_retired - start_retired));
+
+		if (DrainPipeline())
+			break;
+	}
+	terminated = 1;
+
+	cpi_estimated = cpi_samples.nr_samples > 0;
+	cpi_estimate = cpi_samples.mean;
+}
+
+void RunProgramAtSimulationPoints(const SimulationPoints* points, int warmup)
+{
+	double weighted_cpi = 0.0, total_weight = 0.0;
+	int p;
+
+	sampling = 1;
+	terminated = 0;
+	ClearSampleStatistics(&cpi_samples);
+
+	for (p = 0; p < points->nr_points && !terminated; ++p)
+	{
+		long long start = points->points[p].interval * points->interval_size;
+		long long position = (long long) nr_instr_retired + nr_instr_fast_forwarded;
+		int start_cycles, start_retired;
+
+		// Skip to the start of the warm-up. Overlapping intervals are not possible,
+		// since the points are sorted and each is followed by a drained pipeline.
+		if (start - warmup > position)
+			FastForward((int) (start - warmup - position));
+		position = (long long) nr_instr_retired + nr_instr_fast_forwarded;
+		if (start > position && SimulateInstructions((int) (start - position)))
+			terminated = 1;
+
+		// An interval that is cut short by the end of the program is still used
+		start_cycles = nr_cycles;
+		start_retired = nr_instr_retired;
+		if (!terminated && SimulateInstructions(points->interval_size))
+			terminated = 1;
+		if (nr_instr_retired > start_retired)
+		{
+			double cpi = (double) (nr_cycles - start_cycles) / (nr_instr_retired - start_retired);
+			AddSample(&cpi_samples, cpi);
+			weighted_cpi += points->points[p].weight * cpi;
+			total_weight += points->points[p].weight;
+		}
+
+		if (!terminated && DrainPipeline())
+			terminated = 1;
+	}
+
+	// Run the rest of the program functionally. The syscall is always executed in
+	// the pipeline.
+	while (!terminated)
+	{
+		FastForward(INT_MAX);
+		terminated = SimulateInstructions(INT_MAX);
+	}
+
+	cpi_estimated = total_weight > 0.0;
+	cpi_estimate = cpi_estimated ? weighted_cpi / total_weight : 0.0;
+}
+
+int GetNrOfSamples()
+{
+	return cpi_samples.nr_samples;
+}
+
+double GetCPIErrorBound()
+{
+	double half_width = GetConfidenceHalfWidth(&cpi_samples);
+
+	if (half_width < 0.0 || cpi_samples.mean <= 0.0)
+		return -1.0;
+	return half_width / cpi_samples.mean;
+}
+
+int GetSamplingPeriodForErrorBound(const SamplingConfig* config, double relative_error)
+{
+	long long nr_instr = (long long) nr_instr_retired + nr_instr_fast_forwarded;
+	int nr_required, min_period = config->warmup + config->window;
+
+	// Without a variance estimate, take twice as many samples
+	if (cpi_samples.nr_samples < 2)
+		nr_required = 2 * (cpi_samples.nr_samples + 1);
+	else
+		nr_required = GetRequiredNrOfSamples(&cpi_samples, relative_error);
+
+	if (nr_instr / nr_required < min_period)
+		return min_period;
+	return (int) (nr_instr / nr_required);
+}
+
+int GetNrOfFastForwardedInstructions()
+{
+	return nr_instr_fast_forwarded;
+}
+
+int CompileProgram(const char* exe_filename)
+{
+	return CompileProgramToNative(exe_filename, if_stage.pc);
+}
+
 int GetElapsedCycles()
 {
 	return nr_cycles;
@@ -346,7 +687,17 @@ int GetNrOfRetiredInstructions()
 	return nr_instr_retired;
 }
 
+long long GetEstimatedCycles()
+{
+	if (sampling)
+		return (long long) (GetCPI() * ((long long) nr_instr_retired + nr_instr_fast_forwarded) + 0.5);
+	return nr_cycles;
+}
+
 float GetCPI()
 {
+	// Without any complete samples, the CPI of the detailed execution is the best estimate
+	if (sampling && cpi_estimated)
+		return (float) cpi_estimate;
 	return ((float) nr_cycles) / ((float) nr_instr_retired);
 }
\ No newline at end of file
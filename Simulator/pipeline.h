@@ -7,6 +7,7 @@
 #include "instr_memory.h"
 #include "data_memory.h"
 #include "register_file.h"
+#include "simpoint.h"
 #include <stdio.h>
 
 /** State of the IF stage */
@@ -17,6 +18,22 @@ typedef struct IFStage
 
 	/** The instruction being fetched in the IF stage */
 	Instr instr;
+
+	/** The predecoded form of instr */
+	const DecodedInstr* decoded;
+
+	/** The number of clock cycles until the instruction arrives from the instruction
+		cache. Until then the ID stage receives bubbles. */
+	int wait_cycles;
+
+	/** The address that the BTB redirects the fetch to after the instruction, or
+		DONT_CARE if the fetch continues with the next instruction */
+	long long btb_target;
+
+	/** With delay slots, the address that the fetch continues at once the instruction
+		has arrived, if it is the delay slot of a jump or branch that redirected the
+		fetch while it was still being fetched, and DONT_CARE otherwise */
+	long long after_slot_pc;
 }
 IFStage;
 
@@ -25,6 +42,19 @@ typedef struct IDStage
 {
 	/** The instruction currently residing in the ID stage */
 	Instr instr;	
+
+	/** The predecoded form of instr */
+	const DecodedInstr* decoded;
+
+	/** The address of the instruction, or DONT_CARE for bubbles */
+	long long pc;
+
+	/** For a branch, the address that the branch predictor chose to fetch after it */
+	long long predicted_pc;
+
+	/** For a branch or jump, whether the BTB already redirected the fetch to
+		predicted_pc, or to the jump target */
+	int redirected;
 }
 IDStage;
 
@@ -35,6 +65,18 @@ typedef struct ExStage
 	/** The instruction currently in the Ex stage */
 	Instr instr;
 
+	/** The predecoded form of instr */
+	const DecodedInstr* decoded;
+
+	/** The address of the instruction, or DONT_CARE for bubbles */
+	long long pc;
+
+	/** For a branch, the address that the branch predictor chose to fetch after it */
+	long long predicted_pc;
+
+	/** For a branch or jump, whether the BTB redirected the fetch after it */
+	int redirected;
+
 	/** The value read from the register given by rs in the ID stage */
 	long long rs_value;
 
@@ -53,6 +95,18 @@ typedef struct MemStage
 	/** The instruction currently in the Mem stage */
 	Instr instr;
 
+	/** The predecoded form of instr */
+	const DecodedInstr* decoded;
+
+	/** The address of the instruction, or DONT_CARE for bubbles */
+	long long pc;
+
+	/** For a branch, the address that the branch predictor chose to fetch after it */
+	long long predicted_pc;
+
+	/** For a branch or jump, whether the BTB redirected the fetch after it */
+	int redirected;
+
 	/** The value previously read from the rt register in the
 		ID stage */
 	long long rt_value;
@@ -66,6 +120,11 @@ typedef struct MemStage
 	/** The branch target computed by the extra ALU in the
 		Ex stage */
 	long long branch_target;
+
+	/** The number of clock cycles until the data cache access of a load or store
+		completes. Until then the pipeline is frozen and the WB stage receives
+		bubbles. */
+	int wait_cycles;
 }
 MemStage;
 
@@ -75,6 +134,12 @@ typedef struct WBStage
 	/** The instruction currently residing in the WB stage */
 	Instr instr;
 
+	/** The predecoded form of instr */
+	const DecodedInstr* decoded;
+
+	/** The address of the instruction, or DONT_CARE for bubbles */
+	long long pc;
+
 	/** The result being written back to the register file */
 	long long result;
 }
@@ -97,6 +162,53 @@ extern MemStage mem_stage;
 /** The current state of the WB stage */
 extern WBStage wb_stage;
 
+/** Counts of the events that make the pipeline lose cycles */
+typedef struct StallCounts
+{
+	/** The number of cycles the ID stage was stalled by a load in the Ex stage */
+	int load_use_stalls;
+
+	/** The number of mispredicted branches, each of which flushed the ID, Ex and Mem
+		stages. With the default not-taken prediction, these are the taken branches. */
+	int branch_flushes;
+
+	/** The number of jr and jalr whose target was mispredicted, each of which flushed
+		the ID, Ex and Mem stages */
+	int jump_flushes;
+
+	/** The number of jumps that missed in the BTB, each of which squashed the
+		instruction fetched after it */
+	int jump_squashes;
+
+	/** The number of branches predicted taken that missed in the BTB, each of which
+		squashed the instruction fetched after it */
+	int branch_squashes;
+
+	/** The number of bubbles that entered the ID stage while an instruction was being
+		fetched from the instruction cache */
+	int fetch_stalls;
+
+	/** The number of cycles the pipeline was frozen by a data cache access */
+	int memory_stalls;
+
+	/** The number of cycles the ID stage waited for the data of a load that missed in
+		the non-blocking data cache */
+	int load_miss_stalls;
+
+	/** With early branch resolution, the number of cycles a branch waited in the ID
+		stage for an operand of its comparator */
+	int comparator_stalls;
+
+	/** With early branch resolution, the number of branches that did not continue where
+		the fetch went after them, each of which squashed the instruction fetched after
+		it */
+	int early_branch_squashes;
+}
+StallCounts;
+
+/** The stall counts since the start of the program */
+extern StallCounts stall_counts;
+
 // --------------------------------------------------------------------------------------
 
 // Functions for clearing the pipeline registers ----------------------------------------
@@ -118,7 +230,7 @@ void ClearWBStage(WBStage* to_clear);
 
 // --------------------------------------------------------------------------------------
 
-/** Initialize all components of the pipeline: the memory and all the pipeline
+/** Initialize all components of the pipeline: the memory, the caches and all the pipeline
 	stages. This should be called at program startup. */
 void InitPipeline(FILE* mips_file);
 
@@ -128,9 +240,108 @@ void InitPipeline(FILE* mips_file);
 	@param on_off Should be != 0 to turn tracing on, and == 0 to turn tracing off */
 void SetTracing(int on_off);
 
-/** Run the simulation until the program terminates */
+/** Run the simulation until the program terminates, or until the cycle limit set
+	with SetCycleLimit() is reached. The cycle and instruction counters continue from
+	their current values, so a simulation that was stopped or restored from a
+	checkpoint can be continued by calling RunProgram() again. */
 void RunProgram(const char* filename);
 
+/** Make RunProgram() stop when @a max_cycles clock cycles have elapsed, even if the
+	program has not terminated. A limit of 0 means no limit. */
+void SetCycleLimit(int max_cycles);
+
+/** Make RunProgram() save a checkpoint to the file @a filename every @a interval
+	clock cycles. Each checkpoint replaces the previous one. Passing NULL turns
+	checkpointing off. See checkpoint.h. */
+void SetCheckpointing(const char* filename, int interval);
+
+/** Return 1 if the program has terminated, i.e., its syscall has retired, and 0 if the
+	simulation was stopped before that */
+int HasProgramTerminated();
+
+/** Set the clock cycle and instruction counters. Used when restoring a checkpoint, and
+	to report the combined counts of a time-parallel simulation. */
+void SetPipelineCounters(int nr_cycles, int nr_instr_retired, int nr_instr_fast_forwarded);
+
+/** Simulate clock cycles until @a nr_instr more instructions have retired, or until
+	the program terminates. No trace is written.
+	@return 1 if the program terminated, 0 otherwise */
+int RunInstructions(int nr_instr);
+
+/** Run the program until it terminates using functional (instruction-set level)
+	execution only, i.e., without modelling the pipeline. The resulting architectural
+	state and retired instruction count are the same as for RunProgram(), but no
+	clock cycles are counted and no trace is written.
+	@pre InitPipeline() has been called, and the pipeline has not been run */
+void RunProgramFunctional();
+
+/** Execute up to @a nr_instr instructions functionally, and then restart the
+	pipeline at the next instruction. This is used to quickly skip past the
+	initialization phase of a program before starting the detailed simulation with
+	RunProgram(). A syscall is never executed functionally, so the program always
+	terminates in the pipeline.
+	@pre InitPipeline() has been called, and the pipeline has not been run
+	@return The number of instructions that were executed */
+int FastForward(int nr_instr);
+
+/** Parameters of a sampled simulation. The program is divided into periods of
+	@a period instructions. Each period starts with functional execution, followed by
+	@a warmup instructions of detailed simulation that fill the pipeline, and ends with
+	a measured window of @a window instructions of detailed simulation. */
+typedef struct SamplingConfig
+{
+	/** The number of instructions in a sampling period */
+	int period;
+
+	/** The number of detailed, unmeasured instructions before each measurement */
+	int warmup;
+
+	/** The number of measured instructions in each sample */
+	int window;
+}
+SamplingConfig;
+
+/** Run the program until it terminates, simulating only a sample of it in detail
+	as described by @a config. Afterwards, GetCPI() returns the mean CPI of the samples,
+	which is an estimate of the CPI of the whole program, and GetCPIErrorBound() tells
+	how accurate the estimate is. No trace is written.
+	@pre InitPipeline() has been called, and the pipeline has not been run */
+void RunProgramSampled(const SamplingConfig* config);
+
+/** Run the program until it terminates, simulating only the intervals given by
+	@a points in detail, each after a detailed warm-up of @a warmup instructions. The
+	rest of the program is executed functionally. Afterwards, GetCPI() returns the
+	weighted mean of the CPIs of the intervals, which is an estimate of the CPI of
+	the whole program. No trace is written. See simpoint.h.
+	@pre InitPipeline() has been called, and the pipeline has not been run */
+void RunProgramAtSimulationPoints(const SimulationPoints* points, int warmup);
+
+/** Return the number of samples taken by RunProgramSampled(), or the number of
+	intervals simulated by RunProgramAtSimulationPoints() */
+int GetNrOfSamples();
+
+/** Return the half-width of the 95% confidence interval of the CPI estimate
+	from RunProgramSampled(), relative to the estimate. For example, 0.02 means that
+	the CPI of the whole program lies within 2% of GetCPI() with 95% confidence.
+	Returns a negative value if there were fewer than two samples. */
+double GetCPIErrorBound();
+
+/** Return the sampling period that RunProgramSampled() with @a config should use to
+	reach a relative error bound of @a relative_error, based on the samples of the
+	previous run. The period is never shorter than the warm-up and window together. */
+int GetSamplingPeriodForErrorBound(const SamplingConfig* config, double relative_error);
+
+/** Return the number of instructions executed by FastForward(). These are not
+	included in GetNrOfRetiredInstructions(). */
+int GetNrOfFastForwardedInstructions();
+
+/** Instead of simulating the program, translate it to C and compile it into a
+	native executable named @a exe_filename, which starts at the current instruction
+	of the IF stage. See aot.h.
+	@pre InitPipeline() has been called, and the pipeline has not been run
+	@return 0 if the compilation went fine, 1 otherwise */
+int CompileProgram(const char* exe_filename);
+
 /** Return the number of elapsed clock cycles. Can be called after a simulation has
 	been completed. */
 int GetElapsedCycles();
@@ -139,7 +350,13 @@ int GetElapsedCycles();
 	a simulation has been completed. */
 int GetNrOfRetiredInstructions();
 
-/** Return the average CPI. Can be called after a simulation has been completed. */
+/** Return the number of clock cycles needed to run the whole program. This is
+	GetElapsedCycles(), except after RunProgramSampled(), where it is estimated from
+	the CPI of the samples and includes the functionally executed instructions. */
+long long GetEstimatedCycles();
+
+/** Return the average CPI. Can be called after a simulation has been completed.
+	After RunProgramSampled(), this is the CPI estimated from the samples. */
 float GetCPI();
 
 #endif // ifndef PIPELINE_H_INCL
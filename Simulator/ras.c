@@ -0,0 +1,145 @@
+#include "ras.h"
+#include "instructions.h"
+#include <string.h>
+
+// The state of the return address stack
+typedef struct RASState
+{
+	// A circular buffer of the last depth return addresses, with the top one at top
+	long long addresses[MAX_RAS_DEPTH];
+	int top;
+
+	// The number of return addresses on the stack, at most depth
+	int count;
+
+	RASStats stats;
+}
+RASState;
+
+// What the last push or pop changed, so that it can be undone
+typedef struct RASUpdate
+{
+	int top, count;
+
+	// The slot that a push wrote, and the address it held before
+	int slot;
+	long long overwritten;
+
+	// The counts that the update incremented
+	int pushes, overflows, underflows;
+}
+RASUpdate;
+
+static int depth;
+static RASState state, saved_state;
+static RASUpdate last_update, saved_last_update;
+
+static void RecordUpdate(int slot)
+{
+	last_update.top = state.top;
+	last_update.count = state.count;
+	last_update.slot = slot;
+	last_update.overwritten = state.addresses[slot];
+	last_update.pushes = last_update.overflows = last_update.underflows = 0;
+}
+
+// Public functions -------------------------------------------------------------------
+
+void SetRASDepth(int new_depth)
+{
+	depth = new_depth < MAX_RAS_DEPTH ? new_depth : MAX_RAS_DEPTH;
+	InitRAS();
+}
+
+int GetRASDepth()
+{
+	return depth;
+}
+
+void InitRAS()
+{
+	memset(&state, 0, sizeof(state));
+	memset(&last_update, 0, sizeof(last_update));
+}
+
+long long PeekReturnAddress()
+{
+	return state.count > 0 ? state.addresses[state.top] : DONT_CARE;
+}
+
+void PushReturnAddress(long long address)
+{
+	int slot = (state.top + 1) % depth;
+
+	RecordUpdate(slot);
+	last_update.pushes = 1;
+	last_update.overflows = state.count == depth;
+	if (state.count == depth)
+		++state.stats.overflows;
+	else
+		++state.count;
+	++state.stats.pushes;
+	state.addresses[slot] = address;
+	state.top = slot;
+}
+
+void PopReturnAddress()
+{
+	RecordUpdate(state.top);
+	last_update.underflows = state.count == 0;
+	if (state.count == 0)
+		++state.stats.underflows;
+	else
+	{
+		--state.count;
+		state.top = (state.top + depth - 1) % depth;
+	}
+}
+
+void UndoRASUpdate()
+{
+	state.addresses[last_update.slot] = last_update.overwritten;
+	state.top = last_update.top;
+	state.count = last_update.count;
+	state.stats.pushes -= last_update.pushes;
+	state.stats.overflows -= last_update.overflows;
+	state.stats.underflows -= last_update.underflows;
+}
+
+void ResolveReturn(int mispredicted)
+{
+	++state.stats.returns;
+	if (!mispredicted)
+		++state.stats.hits;
+}
+
+const RASStats* GetRASStats()
+{
+	return &state.stats;
+}
+
+void SaveRASState()
+{
+	saved_state = state;
+	saved_last_update = last_update;
+}
+
+void RestoreRASState()
+{
+	state = saved_state;
+	last_update = saved_last_update;
+}
+
+void WriteRASCheckpoint(CheckpointState* checkpoint)
+{
+	PutCheckpointState(checkpoint, &depth, sizeof(depth));
+	PutCheckpointState(checkpoint, &state, sizeof(state));
+	PutCheckpointState(checkpoint, &last_update, sizeof(last_update));
+}
+
+void ReadRASCheckpoint(CheckpointState* checkpoint)
+{
+	CheckCheckpointConfig(checkpoint, &depth, sizeof(depth));
+	GetCheckpointState(checkpoint, &state, sizeof(state));
+	GetCheckpointState(checkpoint, &last_update, sizeof(last_update));
+}
@@ -0,0 +1,85 @@
+/** @file ras.h
+	A return address stack, which predicts the targets of subroutine returns.
+
+	The target of jr and jalr is the value of a register, so it is only known when the
+	jump is resolved in the Mem stage, like the outcome of a branch. Without a return
+	address stack, the fetch continues after the jump, and the ID, Ex and Mem stages are
+	flushed unless the target is the next instruction. With it, jal and jalr push their
+	return address when they leave the ID stage, and jr $ra pops it. While jr $ra is in
+	the ID stage, it redirects the fetch to the address on top of the stack, so a
+	correctly predicted return only squashes the instruction fetched after it.
+
+	The stack is updated speculatively: a call or return that is flushed from the Ex
+	stage has its update undone. When a call finds the stack full, the oldest return
+	address is overwritten, and the return that would have used it is mispredicted. */
+
+#ifndef RAS_H_INCL
+#define RAS_H_INCL
+
+#include "checkpoint.h"
+
+/** The maximum number of return addresses in the return address stack */
+#define MAX_RAS_DEPTH 64
+
+/** The event counts of the return address stack */
+typedef struct RASStats
+{
+	long long pushes;
+
+	/** The number of pushes that overwrote the oldest return address */
+	long long overflows;
+
+	/** The number of pops that found the stack empty */
+	long long underflows;
+
+	/** The number of returns that were resolved, and the number of those whose target
+		was predicted correctly */
+	long long returns;
+	long long hits;
+}
+RASStats;
+
+/** Give the pipeline a return address stack of @a depth return addresses, at most
+	MAX_RAS_DEPTH. With a depth of 0, which is the default, returns are not predicted. */
+void SetRASDepth(int depth);
+
+/** Return the number of return addresses that the return address stack can hold */
+int GetRASDepth();
+
+/** Empty the return address stack and reset its statistics */
+void InitRAS();
+
+/** Return the address on top of the stack, or DONT_CARE if it is empty */
+long long PeekReturnAddress();
+
+/** Push the return address @a address of a call */
+void PushReturnAddress(long long address);
+
+/** Pop the return address of a return */
+void PopReturnAddress();
+
+/** Undo the last push or pop, whose call or return was flushed */
+void UndoRASUpdate();
+
+/** Record that a return was resolved, and whether its target was @a mispredicted */
+void ResolveReturn(int mispredicted);
+
+/** Return the event counts of the return address stack */
+const RASStats* GetRASStats();
+
+/** Save the contents and the statistics of the return address stack. Used by
+	SaveSnapshot(). */
+void SaveRASState();
+
+/** Restore the state saved by SaveRASState() */
+void RestoreRASState();
+
+/** Append the depth, the contents and the statistics of the return address stack to
+	the state of a checkpoint. Used by SaveCheckpoint(). */
+void WriteRASCheckpoint(CheckpointState* state);
+
+/** Restore the state written by WriteRASCheckpoint(). Sets state->failed if the
+	stack has another depth. */
+void ReadRASCheckpoint(CheckpointState* state);
+
+#endif // ifndef RAS_H_INCL
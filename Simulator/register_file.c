@@ -47,6 +47,21 @@ long long ReadFromRegisterFile(int register_nr)
 	return contents[register_nr];
 }
 
+void ReadAllFromRegisterFile(long long values[32])
+{
+	int r;
+	for (r = 0; r < 32; ++r)
+		values[r] = contents[r];
+	values[ZERO] = 0;
+}
+
+void WriteAllToRegisterFile(const long long values[32])
+{
+	int r;
+	for (r = 1; r < 32; ++r)
+		contents[r] = values[r];
+}
+
 int IsValidRegisterNr(int register_nr)
 {
 	return 0 <= register_nr && register_nr < 32;
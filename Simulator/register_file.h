@@ -59,6 +59,13 @@ void WriteToRegisterFile(int register_nr, long long value);
 /** Read the value in register nr @a register_nr */
 long long ReadFromRegisterFile(int register_nr);
 
+/** Copy the contents of all 32 registers into @a values */
+void ReadAllFromRegisterFile(long long values[32]);
+
+/** Overwrite the contents of all 32 registers with @a values. Register 0 is
+	always kept at 0. */
+void WriteAllToRegisterFile(const long long values[32]);
+
 /** Check if @a register_nr is a valid register number
 	@return 1 if it is, 0 otherwise */
 int IsValidRegisterNr(int register_nr);
@@ -0,0 +1,469 @@
+#include "simpoint.h"
+#include "translation_cache.h"
+#include "instr_memory.h"
+#include "instructions.h"
+#include "pipeline.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+// The number of dimensions that the basic-block vectors are projected to
+#define NR_DIMENSIONS 15
+
+// The maximum number of k-means iterations for each k
+#define MAX_ITERATIONS 100
+
+// The smallest k is chosen whose BIC score is at least this fraction of the way from
+// the worst to the best score of all k
+#define BIC_THRESHOLD 0.9
+
+#ifndef M_PI
+#	define M_PI 3.14159265358979323846
+#endif
+
+// Variances below this are treated as this, to keep the BIC finite
+#define MIN_VARIANCE 1e-12
+
+typedef struct ProjectedVector
+{
+	double v[NR_DIMENSIONS];
+}
+ProjectedVector;
+
+// The projected basic-block vectors of all intervals
+typedef struct Profile
+{
+	long nr_intervals;
+	long capacity;
+	ProjectedVector* vectors;
+}
+Profile;
+
+// A simple, deterministic pseudo-random generator, so that the selected simulation
+// points are the same every time
+static unsigned int random_state;
+
+static unsigned int NextRandom()
+{
+	random_state = random_state * 1103515245u + 12345u;
+	return (random_state >> 8) & 0xFFFFFF;
+}
+
+// The element of the random projection matrix for the basic block with the given
+// index and the given dimension, uniformly distributed in [-1, 1]. It is computed by
+// hashing instead of being stored, since the number of basic blocks is not known
+// in advance.
+static double GetProjectionWeight(long block, int dimension)
+{
+	unsigned int h = (unsigned int) block * 2654435761u ^ (unsigned int) (dimension + 1) * 40503u;
+	h ^= h >> 15;
+	h *= 2246822519u;
+	h ^= h >> 13;
+	return (h & 0xFFFF) / 32767.5 - 1.0;
+}
+
+static double GetDistance2(const ProjectedVector* a, const ProjectedVector* b)
+{
+	double sum = 0.0;
+	int d;
+
+	for (d = 0; d < NR_DIMENSIONS; ++d)
+		sum += (a->v[d] - b->v[d]) * (a->v[d] - b->v[d]);
+	return sum;
+}
+
+// Profiling ------------------------------------------------------------------------
+
+// For each instruction, compute the number of instructions that are retired when
+// execution starts there and continues to the end of the basic block, i.e., up to and
+// including the next branch, jump or syscall
+static void ComputeBlockLengths(const DecodedInstr* instrs, long nr_instrs, int* lengths)
+{
+	long i;
+
+	for (i = nr_instrs - 1; i >= 0; --i)
+	{
+		InstrType type = instrs[i].instr.type;
+		int retired = type != NOP;
+
+		if (type == BEQ || type == BNE || IsJump(type) || type == SYSCALL || i == nr_instrs - 1)
+			lengths[i] = retired;
+		else
+			lengths[i] = lengths[i + 1] + retired;
+	}
+	for (i = 0; i < nr_instrs; ++i)
+		if (lengths[i] == 0)
+			lengths[i] = 1;
+}
+
+// Normalize the basic-block vector in counts, project it and add it to the profile.
+// The counts of the touched blocks are reset.
+static void AddInterval(Profile* profile, long long* counts, long* touched, long nr_touched,
+	long long nr_retired)
+{
+	ProjectedVector* vector;
+	long i;
+	int d;
+
+	if (profile->nr_intervals == profile->capacity)
+	{
+		profile->capacity = 2*profile->capacity + 64;
+		profile->vectors = (ProjectedVector*) realloc(profile->vectors,
+			profile->capacity * sizeof(ProjectedVector));
+	}
+	vector = &profile->vectors[profile->nr_intervals++];
+	memset(vector, 0, sizeof(ProjectedVector));
+
+	for (i = 0; i < nr_touched; ++i)
+	{
+		double fraction = (double) counts[touched[i]] / nr_retired;
+		for (d = 0; d < NR_DIMENSIONS; ++d)
+			vector->v[d] += fraction * GetProjectionWeight(touched[i], d);
+		counts[touched[i]] = 0;
+	}
+}
+
+// Run the program functionally, one basic block at a time, and record the projected
+// basic-block vector of each interval. Returns the number of retired instructions.
+static long long ProfileProgram(int interval_size, Profile* profile)
+{
+	long nr_instrs;
+	const DecodedInstr* instrs = GetDecodedInstrBuffer(&nr_instrs);
+	long long text_start = GetTextSegmentStartingAddress();
+	int* lengths = (int*) malloc((nr_instrs + 1) * sizeof(int));
+	long long* counts = (long long*) calloc(nr_instrs + 1, sizeof(long long));
+	long* touched = (long*) malloc((nr_instrs + 1) * sizeof(long));
+	long nr_touched = 0;
+	long long pc = if_stage.pc, total = 0, in_interval = 0;
+	long leader = -1;
+	int block_remaining = 0, found_syscall = 0;
+
+	ComputeBlockLengths(instrs, nr_instrs, lengths);
+
+	while (!found_syscall)
+	{
+		long index = (long) ((pc - text_start) / 4);
+		long long nr_retired, budget;
+
+		// Execution outside the program is left to RunTranslated() to report
+		if (index < 0 || index >= nr_instrs)
+		{
+			RunTranslated(&pc, &nr_retired, 1);
+			continue;
+		}
+
+		// A new basic block starts unless the previous one was cut by the end of an interval
+		if (block_remaining == 0)
+		{
+			leader = index;
+			block_remaining = lengths[index];
+		}
+		budget = block_remaining;
+		if (budget > interval_size - in_interval)
+			budget = interval_size - in_interval;
+
+		found_syscall = RunTranslated(&pc, &nr_retired, budget);
+		block_remaining -= (int) nr_retired;
+		if (found_syscall)
+		{
+			// The syscall is retired as well
+			++nr_retired;
+			block_remaining = 0;
+		}
+		else if (nr_retired < budget)
+			block_remaining = 0;
+
+		if (counts[leader] == 0 && nr_retired > 0)
+			touched[nr_touched++] = leader;
+		counts[leader] += nr_retired;
+		in_interval += nr_retired;
+		total += nr_retired;
+
+		// A final, partial interval is only used if there is no complete one
+		if (in_interval == interval_size || (found_syscall && profile->nr_intervals == 0))
+		{
+			AddInterval(profile, counts, touched, nr_touched, in_interval);
+			nr_touched = 0;
+			in_interval = 0;
+		}
+	}
+
+	free(lengths);
+	free(counts);
+	free(touched);
+	return total;
+}
+
+// Clustering -----------------------------------------------------------------------
+
+// Choose k initial centres with k-means++ seeding: each centre is a point chosen with a
+// probability proportional to its squared distance to the closest centre so far
+static void SeedCentres(const Profile* profile, int k, ProjectedVector* centres)
+{
+	long n = profile->nr_intervals, i;
+	double* distances = (double*) malloc(n * sizeof(double));
+	int c;
+
+	centres[0] = profile->vectors[NextRandom() % n];
+	for (i = 0; i < n; ++i)
+		distances[i] = GetDistance2(&profile->vectors[i], &centres[0]);
+
+	for (c = 1; c < k; ++c)
+	{
+		double sum = 0.0, target;
+		long chosen = n - 1;
+
+		for (i = 0; i < n; ++i)
+			sum += distances[i];
+		target = sum * NextRandom() / (double) 0x1000000;
+		for (i = 0; i < n; ++i)
+		{
+			target -= distances[i];
+			if (target < 0.0)
+			{
+				chosen = i;
+				break;
+			}
+		}
+		if (sum == 0.0)
+			chosen = NextRandom() % n;
+
+		centres[c] = profile->vectors[chosen];
+		for (i = 0; i < n; ++i)
+		{
+			double d = GetDistance2(&profile->vectors[i], &centres[c]);
+			if (d < distances[i])
+				distances[i] = d;
+		}
+	}
+	free(distances);
+}
+
+// Cluster the intervals into k clusters. Returns the total squared distance of the
+// intervals to their centres.
+static double RunKMeans(const Profile* profile, int k, ProjectedVector* centres, int* assignment)
+{
+	long n = profile->nr_intervals, i;
+	int* sizes = (int*) malloc(k * sizeof(int));
+	double total = 0.0;
+	int iteration, changed = 1, c, d;
+
+	random_state = 12345u + k;
+	SeedCentres(profile, k, centres);
+	for (i = 0; i < n; ++i)
+		assignment[i] = -1;
+
+	for (iteration = 0; iteration < MAX_ITERATIONS && changed; ++iteration)
+	{
+		changed = 0;
+		for (i = 0; i < n; ++i)
+		{
+			int best = 0;
+			double best_distance = GetDistance2(&profile->vectors[i], &centres[0]);
+			for (c = 1; c < k; ++c)
+			{
+				double distance = GetDistance2(&profile->vectors[i], &centres[c]);
+				if (distance < best_distance)
+				{
+					best = c;
+					best_distance = distance;
+				}
+			}
+			if (assignment[i] != best)
+			{
+				assignment[i] = best;
+				changed = 1;
+			}
+		}
+
+		// Move the centres to the means of their clusters. Empty clusters keep their centres.
+		memset(sizes, 0, k * sizeof(int));
+		for (i = 0; i < n; ++i)
+			++sizes[assignment[i]];
+		for (c = 0; c < k; ++c)
+			if (sizes[c] > 0)
+				memset(&centres[c], 0, sizeof(ProjectedVector));
+		for (i = 0; i < n; ++i)
+			for (d = 0; d < NR_DIMENSIONS; ++d)
+				centres[assignment[i]].v[d] += profile->vectors[i].v[d] / sizes[assignment[i]];
+	}
+
+	for (i = 0; i < n; ++i)
+		total += GetDistance2(&profile->vectors[i], &centres[assignment[i]]);
+	free(sizes);
+	return total;
+}
+
+// The Bayesian information criterion of a clustering, assuming spherical Gaussian
+// clusters with a shared variance (as in X-means). Higher is better.
+static double ComputeBIC(long n, int k, const int* assignment, double total_distance)
+{
+	int* sizes = (int*) calloc(k, sizeof(int));
+	double variance, likelihood = 0.0;
+	long i;
+	int c;
+
+	for (i = 0; i < n; ++i)
+		++sizes[assignment[i]];
+
+	variance = n > k ? total_distance / (n - k) : 0.0;
+	if (variance < MIN_VARIANCE)
+		variance = MIN_VARIANCE;
+
+	for (c = 0; c < k; ++c)
+	{
+		double size = sizes[c];
+		if (size == 0)
+			continue;
+		likelihood += -size / 2.0 * log(2.0 * M_PI) - size * NR_DIMENSIONS / 2.0 * log(variance)
+			- (size - k) / 2.0 + size * log(size) - size * log((double) n);
+	}
+	free(sizes);
+
+	return likelihood - k * (NR_DIMENSIONS + 1) / 2.0 * log((double) n);
+}
+
+static int CompareSimulationPoints(const void* a, const void* b)
+{
+	long long interval_a = ((const SimulationPoint*) a)->interval;
+	long long interval_b = ((const SimulationPoint*) b)->interval;
+	return interval_a < interval_b ? -1 : interval_a > interval_b;
+}
+
+// Public functions -------------------------------------------------------------------
+
+void SelectSimulationPoints(int interval_size, int max_k, SimulationPoints* result)
+{
+	Profile profile = { 0, 0, NULL };
+	ProjectedVector* centres;
+	int* assignment;
+	double* bic;
+	double min_bic, max_bic;
+	long n, i;
+	int k, best_k;
+
+	result->interval_size = interval_size;
+	result->nr_instr = ProfileProgram(interval_size, &profile);
+	n = profile.nr_intervals;
+	if (max_k > n)
+		max_k = (int) n;
+
+	centres = (ProjectedVector*) malloc(max_k * sizeof(ProjectedVector));
+	assignment = (int*) malloc(n * sizeof(int));
+	bic = (double*) malloc((max_k + 1) * sizeof(double));
+
+	// Score every k, and choose the smallest one that scores almost as well as the best
+	for (k = 1; k <= max_k; ++k)
+	{
+		double distance = RunKMeans(&profile, k, centres, assignment);
+		bic[k] = ComputeBIC(n, k, assignment, distance);
+	}
+	min_bic = max_bic = bic[1];
+	for (k = 2; k <= max_k; ++k)
+	{
+		if (bic[k] < min_bic)
+			min_bic = bic[k];
+		if (bic[k] > max_bic)
+			max_bic = bic[k];
+	}
+	for (best_k = 1; best_k < max_k; ++best_k)
+		if (bic[best_k] >= min_bic + BIC_THRESHOLD * (max_bic - min_bic))
+			break;
+
+	// The simulation point of each cluster is the interval closest to its centre
+	RunKMeans(&profile, best_k, centres, assignment);
+	result->points = (SimulationPoint*) malloc(best_k * sizeof(SimulationPoint));
+	result->nr_points = 0;
+	for (k = 0; k < best_k; ++k)
+	{
+		long closest = -1, size = 0;
+		double closest_distance = 0.0;
+
+		for (i = 0; i < n; ++i)
+		{
+			double distance;
+			if (assignment[i] != k)
+				continue;
+			++size;
+			distance = GetDistance2(&profile.vectors[i], &centres[k]);
+			if (closest < 0 || distance < closest_distance)
+			{
+				closest = i;
+				closest_distance = distance;
+			}
+		}
+		if (closest >= 0)
+		{
+			result->points[result->nr_points].interval = closest;
+			result->points[result->nr_points].weight = (double) size / n;
+			++result->nr_points;
+		}
+	}
+	qsort(result->points, result->nr_points, sizeof(SimulationPoint), CompareSimulationPoints);
+
+	free(centres);
+	free(assignment);
+	free(bic);
+	free(profile.vectors);
+}
+
+int WriteSimulationPoints(const char* filename, const SimulationPoints* points)
+{
+	FILE* file = fopen(filename, "w");
+	int i;
+
+	if (file == NULL)
+	{
+		fprintf(stderr, "Could not open file %s for writing\n", filename);
+		return 1;
+	}
+	fprintf(file, "interval_size %d\n", points->interval_size);
+	fprintf(file, "nr_instr %lld\n", points->nr_instr);
+	for (i = 0; i < points->nr_points; ++i)
+		fprintf(file, "point %lld %.9f\n", points->points[i].interval, points->points[i].weight);
+	return fclose(file) != 0;
+}
+
+int ReadSimulationPoints(const char* filename, SimulationPoints* points)
+{
+	FILE* file = fopen(filename, "r");
+	SimulationPoint point;
+	int capacity = 0;
+
+	if (file == NULL)
+	{
+		fprintf(stderr, "Could not open file %s for reading\n", filename);
+		return 1;
+	}
+
+	points->nr_points = 0;
+	points->points = NULL;
+	if (fscanf(file, " interval_size %d nr_instr %lld", &points->interval_size, &points->nr_instr) != 2
+		|| points->interval_size <= 0)
+	{
+		fprintf(stderr, "%s is not a simulation point file\n", filename);
+		fclose(file);
+		return 1;
+	}
+	while (fscanf(file, " point %lld %lf", &point.interval, &point.weight) == 2)
+	{
+		if (points->nr_points == capacity)
+		{
+			capacity = 2*capacity + 16;
+			points->points = (SimulationPoint*) realloc(points->points, capacity * sizeof(SimulationPoint));
+		}
+		points->points[points->nr_points++] = point;
+	}
+	fclose(file);
+
+	qsort(points->points, points->nr_points, sizeof(SimulationPoint), CompareSimulationPoints);
+	return 0;
+}
+
+void FreeSimulationPoints(SimulationPoints* points)
+{
+	free(points->points);
+	points->points = NULL;
+	points->nr_points = 0;
+}
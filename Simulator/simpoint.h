@@ -0,0 +1,68 @@
+/** @file simpoint.h
+	Selection of simulation points from basic-block vectors.
+
+	A profiling pass executes the program functionally and divides it into intervals
+	of a fixed number of retired instructions. For each interval it records a
+	basic-block vector: how many instructions were executed in each basic block,
+	where a basic block is identified by the address of its first instruction. The
+	vectors are normalized, randomly projected to a few dimensions and clustered with
+	k-means, where the number of clusters is chosen with the Bayesian information
+	criterion. The interval closest to the centre of each cluster becomes a
+	simulation point, weighted by the fraction of all intervals in its cluster.
+
+	Simulating only the simulation points in detail and weighting their CPIs gives an
+	estimate of the CPI of the whole program (see RunProgramAtSimulationPoints()). */
+
+#ifndef SIMPOINT_H_INCL
+#define SIMPOINT_H_INCL
+
+/** A representative interval of the program */
+typedef struct SimulationPoint
+{
+	/** The index of the interval. Interval i starts after i times the interval size
+		retired instructions. */
+	long long interval;
+
+	/** The fraction of the program's intervals that this one represents */
+	double weight;
+}
+SimulationPoint;
+
+/** The simulation points of a program */
+typedef struct SimulationPoints
+{
+	/** The number of retired instructions in an interval */
+	int interval_size;
+
+	/** The total number of retired instructions in the program */
+	long long nr_instr;
+
+	/** The number of simulation points */
+	int nr_points;
+
+	/** The simulation points, sorted by interval */
+	SimulationPoint* points;
+}
+SimulationPoints;
+
+/** Run the program functionally until it terminates, recording the basic-block
+	vector of each interval of @a interval_size retired instructions, and select up to
+	@a max_k simulation points from them
+	@pre InitPipeline() has been called, and the pipeline has not been run
+	@param result Used to return the simulation points. Free them with
+		FreeSimulationPoints(). */
+void SelectSimulationPoints(int interval_size, int max_k, SimulationPoints* result);
+
+/** Write @a points to the text file @a filename
+	@return 0 if the file was written, 1 otherwise */
+int WriteSimulationPoints(const char* filename, const SimulationPoints* points);
+
+/** Read simulation points written by WriteSimulationPoints() from the file
+	@a filename
+	@return 0 if the file was read, 1 otherwise */
+int ReadSimulationPoints(const char* filename, SimulationPoints* points);
+
+/** Free the memory held by @a points */
+void FreeSimulationPoints(SimulationPoints* points);
+
+#endif // ifndef SIMPOINT_H_INCL
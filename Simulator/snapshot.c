@@ -0,0 +1,63 @@
+#include "snapshot.h"
+#include "pipeline.h"
+#include "data_memory.h"
+#include "register_file.h"
+#include "cache.h"
+#include "tlb.h"
+#include "store_buffer.h"
+#include "branch_predictor.h"
+#include "btb.h"
+#include "ras.h"
+
+// The saved state. The pipeline registers can be copied as they are, since the
+// predecoded instructions they point to stay in the instruction memory.
+static IFStage saved_if;
+static IDStage saved_id;
+static ExStage saved_ex;
+static MemStage saved_mem;
+static WBStage saved_wb;
+static long long saved_registers[32];
+static int saved_cycles, saved_retired, saved_fast_forwarded;
+static StallCounts saved_stall_counts;
+
+// Public functions -------------------------------------------------------------------
+
+void SaveSnapshot()
+{
+	saved_if = if_stage;
+	saved_id = id_stage;
+	saved_ex = ex_stage;
+	saved_mem = mem_stage;
+	saved_wb = wb_stage;
+	ReadAllFromRegisterFile(saved_registers);
+	saved_cycles = GetElapsedCycles();
+	saved_retired = GetNrOfRetiredInstructions();
+	saved_fast_forwarded = GetNrOfFastForwardedInstructions();
+	saved_stall_counts = stall_counts;
+	SaveDataMemorySnapshot();
+	SaveCacheState();
+	SaveTLBState();
+	SaveStoreBufferState();
+	SaveBranchPredictorState();
+	SaveBTBState();
+	SaveRASState();
+}
+
+void RestoreSnapshot()
+{
+	if_stage = saved_if;
+	id_stage = saved_id;
+	ex_stage = saved_ex;
+	mem_stage = saved_mem;
+	wb_stage = saved_wb;
+	WriteAllToRegisterFile(saved_registers);
+	SetPipelineCounters(saved_cycles, saved_retired, saved_fast_forwarded);
+	stall_counts = saved_stall_counts;
+	RestoreDataMemorySnapshot();
+	RestoreCacheState();
+	RestoreTLBState();
+	RestoreStoreBufferState();
+	RestoreBranchPredictorState();
+	RestoreBTBState();
+	RestoreRASState();
+}
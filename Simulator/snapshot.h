@@ -0,0 +1,23 @@
+/** @file snapshot.h
+	Saving the state of the simulator in memory, and resetting it to the saved state.
+
+	A snapshot holds the same state as a checkpoint (see checkpoint.h) apart from the
+	instruction memory, which a program never changes. Nothing is written to a file,
+	and the data memory is restored copy-on-write: only the pages that have been
+	written to since the snapshot was saved are restored (see
+	SaveDataMemorySnapshot()). This makes it cheap to run a program many times from
+	the state right after it was loaded, without parsing and linking it again. */
+
+#ifndef SNAPSHOT_H_INCL
+#define SNAPSHOT_H_INCL
+
+/** Save the current state of the simulator as the snapshot, replacing any earlier
+	snapshot */
+void SaveSnapshot();
+
+/** Reset the simulator to the state saved by SaveSnapshot(). The simulation can then
+	be started again with RunProgram() or one of the other run functions.
+	@pre SaveSnapshot() has been called, and InitPipeline() has not been called since */
+void RestoreSnapshot();
+
+#endif // ifndef SNAPSHOT_H_INCL
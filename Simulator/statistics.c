@@ -0,0 +1,63 @@
+#include "statistics.h"
+#include <math.h>
+
+// The two-sided 97.5% quantiles of Student's t distribution for 1 to 30 degrees of
+// freedom. For more degrees of freedom the normal quantile 1.96 is used.
+static const double T_QUANTILES[30] =
+{
+	12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+	2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+	2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+};
+
+static const double NORMAL_QUANTILE = 1.96;
+
+static double GetTQuantile(int degrees_of_freedom)
+{
+	if (degrees_of_freedom <= 30)
+		return T_QUANTILES[degrees_of_freedom - 1];
+	return NORMAL_QUANTILE;
+}
+
+// Public functions ----------------------------------------------------------------
+
+void ClearSampleStatistics(SampleStatistics* stats)
+{
+	stats->nr_samples = 0;
+	stats->mean = 0.0;
+	stats->sum_sq_dev = 0.0;
+}
+
+void AddSample(SampleStatistics* stats, double value)
+{
+	double delta = value - stats->mean;
+
+	++stats->nr_samples;
+	stats->mean += delta / stats->nr_samples;
+	stats->sum_sq_dev += delta * (value - stats->mean);
+}
+
+double GetSampleStdDev(const SampleStatistics* stats)
+{
+	if (stats->nr_samples < 2)
+		return 0.0;
+	return sqrt(stats->sum_sq_dev / (stats->nr_samples - 1));
+}
+
+double GetConfidenceHalfWidth(const SampleStatistics* stats)
+{
+	if (stats->nr_samples < 2)
+		return -1.0;
+	return GetTQuantile(stats->nr_samples - 1) * GetSampleStdDev(stats) / sqrt((double) stats->nr_samples);
+}
+
+int GetRequiredNrOfSamples(const SampleStatistics* stats, double relative_error)
+{
+	double variation = GetSampleStdDev(stats) / stats->mean;
+	double required = NORMAL_QUANTILE * variation / relative_error;
+
+	required *= required;
+	if (required < 2.0)
+		return 2;
+	return (int) ceil(required);
+}
@@ -0,0 +1,44 @@
+/** @file statistics.h
+	Running statistics over a series of samples, used to estimate the CPI of a program
+	from sampled measurements and to bound the error of the estimate */
+
+#ifndef STATISTICS_H_INCL
+#define STATISTICS_H_INCL
+
+/** Running mean and variance of a series of samples, updated one sample at a time
+	(Welford's method) */
+typedef struct SampleStatistics
+{
+	/** The number of samples added so far */
+	int nr_samples;
+
+	/** The mean of the samples */
+	double mean;
+
+	/** The sum of the squared deviations from the mean */
+	double sum_sq_dev;
+}
+SampleStatistics;
+
+/** Remove all samples from @a stats */
+void ClearSampleStatistics(SampleStatistics* stats);
+
+/** Add the sample @a value to @a stats */
+void AddSample(SampleStatistics* stats, double value);
+
+/** Return the standard deviation of the samples in @a stats, or 0 if there are
+	fewer than two samples */
+double GetSampleStdDev(const SampleStatistics* stats);
+
+/** Return the half-width of the 95% confidence interval of the mean of the samples
+	in @a stats, using Student's t distribution. Returns a negative value if there are
+	fewer than two samples, in which case the interval is unbounded. */
+double GetConfidenceHalfWidth(const SampleStatistics* stats);
+
+/** Return the number of samples needed for the half-width of the 95% confidence
+	interval to be at most @a relative_error times the mean, assuming the samples
+	keep their current coefficient of variation
+	@pre @a stats holds at least two samples */
+int GetRequiredNrOfSamples(const SampleStatistics* stats, double relative_error);
+
+#endif // ifndef STATISTICS_H_INCL
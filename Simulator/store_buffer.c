@@ -0,0 +1,158 @@
+#include "store_buffer.h"
+#include "cache.h"
+#include <string.h>
+
+typedef struct BufferedStore
+{
+	long long address;
+	int nr_bytes;
+
+	/** The first cycle in which the store has drained to the data cache */
+	long long drained_cycle;
+}
+BufferedStore;
+
+static int depth;
+
+// The last depth stores, in a circular buffer. The oldest of them is at next_slot.
+// Stores drain in order, so the ones that have not drained yet are the youngest.
+static BufferedStore stores[MAX_STORE_BUFFER_DEPTH];
+static int next_slot;
+static StoreBufferStats stats;
+
+// The state saved by SaveStoreBufferState()
+static BufferedStore saved_stores[MAX_STORE_BUFFER_DEPTH];
+static int saved_next_slot;
+static StoreBufferStats saved_stats;
+
+// Return the youngest store that has not drained in the cycle @a cycle and writes any
+// of the @a nr_bytes bytes at the address @a address, or NULL if there is none
+static const BufferedStore* FindOverlappingStore(long long address, int nr_bytes, long long cycle)
+{
+	int i;
+
+	for (i = 1; i <= depth; ++i)
+	{
+		const BufferedStore* store = &stores[(next_slot + depth - i) % depth];
+
+		if (store->drained_cycle <= cycle)
+			break;
+		if (store->address < address + nr_bytes && address < store->address + store->nr_bytes)
+			return store;
+	}
+	return NULL;
+}
+
+// Public functions -------------------------------------------------------------------
+
+void SetStoreBufferDepth(int new_depth)
+{
+	depth = new_depth < MAX_STORE_BUFFER_DEPTH ? new_depth : MAX_STORE_BUFFER_DEPTH;
+	InitStoreBuffer();
+}
+
+int GetStoreBufferDepth()
+{
+	return depth;
+}
+
+void InitStoreBuffer()
+{
+	memset(stores, 0, sizeof(stores));
+	next_slot = 0;
+	memset(&stats, 0, sizeof(stats));
+}
+
+int StartStore(long long pc, long long address, int nr_bytes, long long cycle)
+{
+	BufferedStore* store;
+	long long drain_start;
+	int wait = 0;
+
+	if (depth == 0)
+		return AccessDataCache(pc, address, 1, cycle) - 1;
+
+	// The store enters the buffer at the end of its last cycle in Mem, in the slot of
+	// the oldest store, which must have drained by then
+	store = &stores[next_slot];
+	++stats.stores;
+	if (store->drained_cycle > cycle + 1)
+	{
+		wait = (int) (store->drained_cycle - cycle - 1);
+		++stats.full_stalls;
+		stats.full_stall_cycles += wait;
+	}
+
+	// It starts to drain when the store before it has drained
+	drain_start = cycle + wait + 1;
+	if (stores[(next_slot + depth - 1) % depth].drained_cycle > drain_start)
+		drain_start = stores[(next_slot + depth - 1) % depth].drained_cycle;
+
+	store->address = address & 0xFFFFFFFFLL;
+	store->nr_bytes = nr_bytes;
+	store->drained_cycle = drain_start + AccessDataCache(pc, address, 1, drain_start);
+	next_slot = (next_slot + 1) % depth;
+	return wait;
+}
+
+int StartLoad(long long pc, long long address, int nr_bytes, int dest, long long cycle)
+{
+	const BufferedStore* store;
+	int wait;
+
+	if (depth == 0)
+		return StartDataCacheLoad(pc, address, dest, cycle);
+
+	++stats.loads;
+	address &= 0xFFFFFFFFLL;
+	store = FindOverlappingStore(address, nr_bytes, cycle);
+	if (store == NULL)
+		return StartDataCacheLoad(pc, address, dest, cycle);
+	if (store->address <= address && address + nr_bytes <= store->address + store->nr_bytes)
+	{
+		++stats.forwarded_loads;
+		return 0;
+	}
+
+	// The bytes come from both the store and the cache, so the load waits until the
+	// store has drained. Older overlapping stores have drained by then as well.
+	wait = (int) (store->drained_cycle - cycle);
+	++stats.partial_overlaps;
+	stats.partial_overlap_cycles += wait;
+	return wait + StartDataCacheLoad(pc, address, dest, store->drained_cycle);
+}
+
+const StoreBufferStats* GetStoreBufferStats()
+{
+	return &stats;
+}
+
+void SaveStoreBufferState()
+{
+	memcpy(saved_stores, stores, sizeof(stores));
+	saved_next_slot = next_slot;
+	saved_stats = stats;
+}
+
+void RestoreStoreBufferState()
+{
+	memcpy(stores, saved_stores, sizeof(stores));
+	next_slot = saved_next_slot;
+	stats = saved_stats;
+}
+
+void WriteStoreBufferCheckpoint(CheckpointState* state)
+{
+	PutCheckpointState(state, &depth, sizeof(depth));
+	PutCheckpointState(state, stores, sizeof(stores));
+	PutCheckpointState(state, &next_slot, sizeof(next_slot));
+	PutCheckpointState(state, &stats, sizeof(stats));
+}
+
+void ReadStoreBufferCheckpoint(CheckpointState* state)
+{
+	CheckCheckpointConfig(state, &depth, sizeof(depth));
+	GetCheckpointState(state, stores, sizeof(stores));
+	GetCheckpointState(state, &next_slot, sizeof(next_slot));
+	GetCheckpointState(state, &stats, sizeof(stats));
+}
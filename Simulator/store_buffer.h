@@ -0,0 +1,90 @@
+/** @file store_buffer.h
+	Timing model of a store buffer between the Mem stage and the L1 data cache.
+
+	Without a store buffer, a store waits in the Mem stage until the data cache has
+	completed it. With a store buffer, a store only takes its cycle in the Mem stage and
+	is then written into the buffer, which drains to the data cache in the background,
+	one store after the other. When the buffer is full, a store waits in the Mem stage
+	until the oldest store in it has drained.
+
+	A load checks the buffer for stores to any of the bytes it reads that have not
+	drained yet. If the youngest such store wrote all of these bytes, its data is
+	forwarded to the load, which then takes a single cycle and does not access the
+	cache. If it wrote only some of them, for example a byte store followed by a word
+	load, the load waits until that store has drained, and then accesses the cache.
+
+	Like the caches, the store buffer only models timing: the data memory is written in
+	program order when a store leaves the Mem stage, so the values that loads read are
+	the same with and without the buffer. */
+
+#ifndef STORE_BUFFER_H_INCL
+#define STORE_BUFFER_H_INCL
+
+#include "checkpoint.h"
+
+/** The maximum number of stores in the store buffer */
+#define MAX_STORE_BUFFER_DEPTH 64
+
+/** The event counts of the store buffer */
+typedef struct StoreBufferStats
+{
+	long long stores;
+
+	/** The number of stores that found the buffer full, and the number of cycles they
+		waited in the Mem stage */
+	long long full_stalls;
+	long long full_stall_cycles;
+
+	long long loads;
+
+	/** The number of loads that got their data from the buffer */
+	long long forwarded_loads;
+
+	/** The number of loads that overlapped a store in the buffer only partially, and the
+		number of cycles they waited for it to drain */
+	long long partial_overlaps;
+	long long partial_overlap_cycles;
+}
+StoreBufferStats;
+
+/** Give the pipeline a store buffer of @a depth stores, at most
+	MAX_STORE_BUFFER_DEPTH. With a depth of 0, which is the default, stores write to the
+	data cache directly. */
+void SetStoreBufferDepth(int depth);
+
+/** Return the number of stores that the store buffer can hold */
+int GetStoreBufferDepth();
+
+/** Empty the store buffer and reset its statistics */
+void InitStoreBuffer();
+
+/** Start the store of @a nr_bytes bytes at the address @a address by the instruction
+	at the address @a pc in the clock cycle @a cycle
+	@return The number of cycles the store has to wait in the Mem stage after its first
+		cycle there */
+int StartStore(long long pc, long long address, int nr_bytes, long long cycle);
+
+/** Start the load of @a nr_bytes bytes into the register @a dest from the address
+	@a address by the instruction at the address @a pc in the clock cycle @a cycle
+	@return The number of cycles the load has to wait in the Mem stage after its first
+		cycle there */
+int StartLoad(long long pc, long long address, int nr_bytes, int dest, long long cycle);
+
+/** Return the event counts of the store buffer */
+const StoreBufferStats* GetStoreBufferStats();
+
+/** Save the contents and the statistics of the store buffer. Used by SaveSnapshot(). */
+void SaveStoreBufferState();
+
+/** Restore the state saved by SaveStoreBufferState() */
+void RestoreStoreBufferState();
+
+/** Append the depth, the contents and the statistics of the store buffer to the
+	state of a checkpoint. Used by SaveCheckpoint(). */
+void WriteStoreBufferCheckpoint(CheckpointState* state);
+
+/** Restore the state written by WriteStoreBufferCheckpoint(). Sets state->failed if
+	the store buffer has another depth. */
+void ReadStoreBufferCheckpoint(CheckpointState* state);
+
+#endif // ifndef STORE_BUFFER_H_INCL
@@ -0,0 +1,351 @@
+#include "tlb.h"
+#include "cache.h"
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+// The address of the page table. Level l of the table starts at
+// PAGE_TABLE_BASE + l*PAGE_TABLE_LEVEL_SIZE.
+#define PAGE_TABLE_BASE 0x80000000LL
+#define PAGE_TABLE_LEVEL_SIZE 0x01000000LL
+
+// The size of a page table entry in bytes
+#define PTE_SIZE 4
+
+typedef struct TLBEntry
+{
+	int valid;
+
+	/** The virtual page number */
+	long long page_nr;
+
+	/** When the entry was last used */
+	long long stamp;
+}
+TLBEntry;
+
+typedef struct TLB
+{
+	int configured;
+	TLBConfig config;
+	int nr_sets;
+
+	// The entries of set s are entries[s*associativity] to entries[(s + 1)*associativity - 1]
+	TLBEntry entries[MAX_TLB_SIZE];
+	long long clock;
+	TLBStats stats;
+
+	// The state saved by SaveTLBState()
+	TLBEntry saved_entries[MAX_TLB_SIZE];
+	long long saved_clock;
+	TLBStats saved_stats;
+}
+TLB;
+
+static const char* const TLB_NAMES[NR_OF_TLBS] = { "Instruction TLB", "Data TLB" };
+
+static const TLBConfig DEFAULT_ITLB_CONFIG = { 32, 4 };
+static const TLBConfig DEFAULT_DTLB_CONFIG = { 64, 4 };
+static const PageWalkConfig DEFAULT_PAGE_WALK_CONFIG = { 4096, 2, 0, 30 };
+
+static TLB tlbs[NR_OF_TLBS];
+static PageWalkConfig page_walk = { 4096, 2, 0, 30 };
+static int page_bits = 12;
+
+static int IsPowerOf2(long long n)
+{
+	return n > 0 && (n & (n - 1)) == 0;
+}
+
+// Parse a number with an optional K or M suffix. Returns -1 if it is invalid.
+static long long ParseSize(const char* text)
+{
+	char* end;
+	long long n = strtoll(text, &end, 10);
+
+	if (end == text)
+		return -1;
+	if (toupper((unsigned char) *end) == 'K')
+	{
+		n *= 1024;
+		++end;
+	}
+	else if (toupper((unsigned char) *end) == 'M')
+	{
+		n *= 1024 * 1024;
+		++end;
+	}
+	return *end == '\0' ? n : -1;
+}
+
+// Call parse_parameter for each name=value pair of the comma-separated list
+// @a description. Returns 0 if all of them were valid.
+static int ParseParameters(const char* description, void* config,
+	int (*parse_parameter)(const char* name, const char* value, void* config))
+{
+	char* copy = (char*) malloc(strlen(description) + 1);
+	char* parameter;
+	int failed = 0;
+
+	strcpy(copy, description);
+	for (parameter = strtok(copy, ","); parameter != NULL && !failed; parameter = strtok(NULL, ","))
+	{
+		char* value = strchr(parameter, '=');
+		if (value == NULL)
+			failed = 1;
+		else
+		{
+			*value++ = '\0';
+			failed = parse_parameter(parameter, value, config);
+		}
+	}
+	free(copy);
+	return failed;
+}
+
+static int ParseTLBParameter(const char* name, const char* value, void* config)
+{
+	TLBConfig* tlb_config = (TLBConfig*) config;
+	long long n = ParseSize(value);
+
+	if (strcmp(name, "entries") == 0 && IsPowerOf2(n) && n <= MAX_TLB_SIZE)
+		tlb_config->nr_entries = (int) n;
+	else if (strcmp(name, "assoc") == 0 && strcmp(value, "full") == 0)
+		tlb_config->associativity = 0;
+	else if (strcmp(name, "assoc") == 0 && IsPowerOf2(n) && n <= MAX_TLB_SIZE)
+		tlb_config->associativity = (int) n;
+	else
+		return 1;
+	return 0;
+}
+
+static int ParsePageWalkParameter(const char* name, const char* value, void* config)
+{
+	PageWalkConfig* walk_config = (PageWalkConfig*) config;
+	long long n = ParseSize(value);
+
+	if (strcmp(name, "page") == 0 && IsPowerOf2(n) && n >= 1024 && n <= 16 * 1024 * 1024)
+		walk_config->page_size = (int) n;
+	else if (strcmp(name, "levels") == 0 && n >= 1 && n <= 4)
+		walk_config->nr_levels = (int) n;
+	else if (strcmp(name, "walker") == 0 && (strcmp(value, "hardware") == 0 || strcmp(value, "software") == 0))
+		walk_config->software = strcmp(value, "software") == 0;
+	else if (strcmp(name, "trap") == 0 && n >= 0 && n <= 10000)
+		walk_config->trap_cycles = (int) n;
+	else
+		return 1;
+	return 0;
+}
+
+static void EmptyTLB(TLB* tlb)
+{
+	memset(tlb->entries, 0, sizeof(tlb->entries));
+	memset(&tlb->stats, 0, sizeof(tlb->stats));
+	tlb->clock = 0;
+}
+
+// Walk the page table for the page @a page_nr, starting in the clock cycle @a cycle,
+// and return the number of clock cycles the walk takes
+static int WalkPageTable(long long page_nr, long long cycle)
+{
+	int page_nr_bits = 32 - page_bits;
+	int bits_per_level = (page_nr_bits + page_walk.nr_levels - 1) / page_walk.nr_levels;
+	int walk_cycles = page_walk.software ? page_walk.trap_cycles : 0;
+	int level;
+
+	// Each level is indexed by the bits of the page number that the levels above it
+	// have used, and its own bits
+	for (level = 0; level < page_walk.nr_levels; ++level)
+	{
+		int lower_bits = bits_per_level * (page_walk.nr_levels - 1 - level);
+		long long prefix = lower_bits < page_nr_bits ? page_nr >> lower_bits : 0;
+		long long entry_address = PAGE_TABLE_BASE + level * PAGE_TABLE_LEVEL_SIZE
+			+ ((prefix * PTE_SIZE) & (PAGE_TABLE_LEVEL_SIZE - 1));
+
+		walk_cycles += AccessPageTableEntry(entry_address, cycle + walk_cycles);
+	}
+	return walk_cycles;
+}
+
+// Public functions -------------------------------------------------------------------
+
+void GetDefaultTLBConfig(TLBId tlb, TLBConfig* config)
+{
+	*config = tlb == INSTRUCTION_TLB ? DEFAULT_ITLB_CONFIG : DEFAULT_DTLB_CONFIG;
+}
+
+int ParseTLBConfig(const char* description, TLBConfig* config)
+{
+	TLBConfig parsed = *config;
+
+	if (ParseParameters(description, &parsed, ParseTLBParameter) != 0)
+		return 1;
+	if (parsed.associativity == 0 || parsed.associativity > parsed.nr_entries)
+		parsed.associativity = parsed.nr_entries;
+	*config = parsed;
+	return 0;
+}
+
+void ConfigureTLB(TLBId id, const TLBConfig* config)
+{
+	TLB* tlb = &tlbs[id];
+
+	tlb->configured = 1;
+	tlb->config = *config;
+	tlb->nr_sets = config->nr_entries / config->associativity;
+	EmptyTLB(tlb);
+}
+
+void GetDefaultPageWalkConfig(PageWalkConfig* config)
+{
+	*config = DEFAULT_PAGE_WALK_CONFIG;
+}
+
+int ParsePageWalkConfig(const char* description, PageWalkConfig* config)
+{
+	PageWalkConfig parsed = *config;
+
+	if (ParseParameters(description, &parsed, ParsePageWalkParameter) != 0)
+		return 1;
+	*config = parsed;
+	return 0;
+}
+
+void ConfigurePageWalk(const PageWalkConfig* config)
+{
+	page_walk = *config;
+	for (page_bits = 0; (1 << page_bits) < config->page_size; ++page_bits)
+		;
+	InitTLBs();
+}
+
+const PageWalkConfig* GetPageWalkConfig()
+{
+	return &page_walk;
+}
+
+int AreTLBsEnabled()
+{
+	return tlbs[INSTRUCTION_TLB].configured || tlbs[DATA_TLB].configured;
+}
+
+int IsTLBConfigured(TLBId tlb)
+{
+	return tlbs[tlb].configured;
+}
+
+void InitTLBs()
+{
+	int t;
+
+	for (t = 0; t < NR_OF_TLBS; ++t)
+		if (tlbs[t].configured)
+			EmptyTLB(&tlbs[t]);
+}
+
+int TranslateAddress(TLBId id, long long address, long long cycle)
+{
+	TLB* tlb = &tlbs[id];
+	long long page_nr = (address & 0xFFFFFFFFLL) >> page_bits;
+	TLBEntry* set;
+	TLBEntry* victim;
+	int walk_cycles, e;
+
+	if (!tlb->configured)
+		return 0;
+
+	++tlb->clock;
+	set = &tlb->entries[(page_nr & (tlb->nr_sets - 1)) * tlb->config.associativity];
+	victim = set;
+	for (e = 0; e < tlb->config.associativity; ++e)
+	{
+		if (set[e].valid && set[e].page_nr == page_nr)
+		{
+			++tlb->stats.hits;
+			set[e].stamp = tlb->clock;
+			return 0;
+		}
+		if (!set[e].valid || (victim->valid && set[e].stamp < victim->stamp))
+			victim = &set[e];
+	}
+
+	++tlb->stats.misses;
+	walk_cycles = WalkPageTable(page_nr, cycle);
+	tlb->stats.walk_cycles += walk_cycles;
+	victim->valid = 1;
+	victim->page_nr = page_nr;
+	victim->stamp = tlb->clock;
+	return walk_cycles;
+}
+
+const TLBStats* GetTLBStats(TLBId tlb)
+{
+	return &tlbs[tlb].stats;
+}
+
+const char* GetTLBName(TLBId tlb)
+{
+	return TLB_NAMES[tlb];
+}
+
+void SaveTLBState()
+{
+	int t;
+
+	for (t = 0; t < NR_OF_TLBS; ++t)
+	{
+		TLB* tlb = &tlbs[t];
+
+		memcpy(tlb->saved_entries, tlb->entries, sizeof(tlb->entries));
+		tlb->saved_clock = tlb->clock;
+		tlb->saved_stats = tlb->stats;
+	}
+}
+
+void RestoreTLBState()
+{
+	int t;
+
+	for (t = 0; t < NR_OF_TLBS; ++t)
+	{
+		TLB* tlb = &tlbs[t];
+
+		memcpy(tlb->entries, tlb->saved_entries, sizeof(tlb->entries));
+		tlb->clock = tlb->saved_clock;
+		tlb->stats = tlb->saved_stats;
+	}
+}
+
+void WriteTLBCheckpoint(CheckpointState* state)
+{
+	int t;
+
+	PutCheckpointState(state, &page_walk, sizeof(page_walk));
+	for (t = 0; t < NR_OF_TLBS; ++t)
+	{
+		TLB* tlb = &tlbs[t];
+
+		PutCheckpointState(state, &tlb->configured, sizeof(tlb->configured));
+		PutCheckpointState(state, &tlb->config, sizeof(tlb->config));
+		PutCheckpointState(state, tlb->entries, sizeof(tlb->entries));
+		PutCheckpointState(state, &tlb->clock, sizeof(tlb->clock));
+		PutCheckpointState(state, &tlb->stats, sizeof(tlb->stats));
+	}
+}
+
+void ReadTLBCheckpoint(CheckpointState* state)
+{
+	int t;
+
+	CheckCheckpointConfig(state, &page_walk, sizeof(page_walk));
+	for (t = 0; t < NR_OF_TLBS; ++t)
+	{
+		TLB* tlb = &tlbs[t];
+
+		CheckCheckpointConfig(state, &tlb->configured, sizeof(tlb->configured));
+		CheckCheckpointConfig(state, &tlb->config, sizeof(tlb->config));
+		GetCheckpointState(state, tlb->entries, sizeof(tlb->entries));
+		GetCheckpointState(state, &tlb->clock, sizeof(tlb->clock));
+		GetCheckpointState(state, &tlb->stats, sizeof(tlb->stats));
+	}
+}
@@ -0,0 +1,142 @@
+/** @file tlb.h
+	Timing models of an instruction TLB and a data TLB, with a page-table walker that
+	handles their misses.
+
+	The simulated programs run in a single address space that is mapped onto the
+	instruction and data memories one to one, so translation never changes an address
+	and never faults. The TLBs only add the time of the page-table walks to the
+	instruction fetches and the data accesses that miss in them. A TLB is looked up in
+	parallel with the L1 cache, so a hit takes no extra time.
+
+	The page table is a radix tree with one to four levels over the virtual page
+	number, placed in the kernel segment above 0x80000000, where the programs have no
+	data. A walk reads one entry per level through the L2 cache, or from the main
+	memory if there is no L2 cache, one after the other. The hardware walker only takes
+	the time of these reads. The software walker, like the TLB refill handler of a MIPS
+	operating system, also takes a fixed number of cycles for the exception, the
+	handler's instructions and the return. */
+
+#ifndef TLB_H_INCL
+#define TLB_H_INCL
+
+#include "checkpoint.h"
+
+/** The TLBs */
+typedef enum TLBId
+{
+	INSTRUCTION_TLB,
+	DATA_TLB,
+	NR_OF_TLBS
+}
+TLBId;
+
+/** The maximum number of entries in a TLB */
+#define MAX_TLB_SIZE 4096
+
+/** The parameters of a TLB */
+typedef struct TLBConfig
+{
+	/** The number of entries */
+	int nr_entries;
+
+	/** The number of entries in a set */
+	int associativity;
+}
+TLBConfig;
+
+/** The parameters of the page table and its walker, shared by both TLBs */
+typedef struct PageWalkConfig
+{
+	/** The size of a page in bytes */
+	int page_size;
+
+	/** The number of levels of the page table */
+	int nr_levels;
+
+	/** 1 for the software walker, 0 for the hardware walker */
+	int software;
+
+	/** The number of clock cycles that the software walker takes in addition to the
+		reads of the page table */
+	int trap_cycles;
+}
+PageWalkConfig;
+
+/** The event counts of a TLB */
+typedef struct TLBStats
+{
+	long long hits;
+	long long misses;
+
+	/** The number of clock cycles of the page-table walks of the misses */
+	long long walk_cycles;
+}
+TLBStats;
+
+/** Set @a config to the default parameters of the TLB @a tlb: 32 entries that are
+	4-way set associative for the instruction TLB, 64 for the data TLB */
+void GetDefaultTLBConfig(TLBId tlb, TLBConfig* config);
+
+/** Parse a TLB description, a comma-separated list of parameters such as
+	"entries=64,assoc=4", into @a config. The parameters that are not given keep their
+	values in @a config. Both must be powers of 2, and assoc=full makes the TLB fully
+	associative.
+	@return 0 if the description is valid, 1 otherwise */
+int ParseTLBConfig(const char* description, TLBConfig* config);
+
+/** Add the TLB @a tlb, with the parameters @a config. The TLB starts out empty. */
+void ConfigureTLB(TLBId tlb, const TLBConfig* config);
+
+/** Set @a config to the default parameters of the page table and its walker: 4 KB
+	pages, 2 levels and the hardware walker, or a trap of 30 cycles for the software
+	walker */
+void GetDefaultPageWalkConfig(PageWalkConfig* config);
+
+/** Parse a description of the page table and its walker, a comma-separated list of
+	parameters such as "walker=software,levels=2,trap=30,page=4K", into @a config. The
+	values of walker are hardware and software. The page size must be a power of 2.
+	@return 0 if the description is valid, 1 otherwise */
+int ParsePageWalkConfig(const char* description, PageWalkConfig* config);
+
+/** Use the page table and walker @a config. The TLBs are emptied. */
+void ConfigurePageWalk(const PageWalkConfig* config);
+
+/** Return the parameters of the page table and its walker */
+const PageWalkConfig* GetPageWalkConfig();
+
+/** Return whether any TLB has been configured */
+int AreTLBsEnabled();
+
+/** Return whether the TLB @a tlb has been configured */
+int IsTLBConfigured(TLBId tlb);
+
+/** Empty all TLBs and reset their statistics */
+void InitTLBs();
+
+/** Translate the address @a address with the TLB @a tlb, starting in the clock cycle
+	@a cycle
+	@return The number of clock cycles of the page-table walk, or 0 if the TLB hit or
+		has not been configured */
+int TranslateAddress(TLBId tlb, long long address, long long cycle);
+
+/** Return the event counts of the TLB @a tlb */
+const TLBStats* GetTLBStats(TLBId tlb);
+
+/** Return the name of the TLB @a tlb, e.g. "Data TLB" */
+const char* GetTLBName(TLBId tlb);
+
+/** Save the contents and the statistics of the TLBs. Used by SaveSnapshot(). */
+void SaveTLBState();
+
+/** Restore the state saved by SaveTLBState() */
+void RestoreTLBState();
+
+/** Append the configuration, the contents and the statistics of the TLBs to the
+	state of a checkpoint. Used by SaveCheckpoint(). */
+void WriteTLBCheckpoint(CheckpointState* state);
+
+/** Restore the state written by WriteTLBCheckpoint(). Sets state->failed if the TLBs
+	or the page-table walker were configured differently. */
+void ReadTLBCheckpoint(CheckpointState* state);
+
+#endif // ifndef TLB_H_INCL
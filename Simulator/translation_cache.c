@@ -0,0 +1,485 @@
+#include "translation_cache.h"
+#include "functional.h"
+#include "alu.h"
+#include "instr_memory.h"
+#include "data_memory.h"
+#include "register_file.h"
+#include "utils.h"
+#include <stdlib.h>
+
+// The number of buckets in the hash table that maps start addresses to blocks.
+// Must be a power of two.
+#define NR_BUCKETS 4096
+
+// The maximum number of instructions in a translated block
+#define MAX_BLOCK_LENGTH 64
+
+// The translated code works on an array of register values where, in addition to
+// the 32 registers, there is a slot that absorbs writes to $zero, a slot that
+// holds the value used for operands that are DONT_CARE, and a slot that receives
+// the target of jr and jalr
+#define REG_SINK 32
+#define REG_DONT_CARE 33
+#define REG_TARGET 34
+#define NR_REG_SLOTS 35
+
+typedef struct TranslatedOp TranslatedOp;
+
+// A handler executes one translated operation on the register array. Handlers for
+// branches return 1 if the branch is taken, all other handlers return 0.
+typedef int (*OpHandler)(const TranslatedOp* op, long long* regs);
+
+// A translated instruction, or a fused pair of instructions
+struct TranslatedOp
+{
+	OpHandler handler;
+
+	// The operands of the (first) instruction, as indices into the register array
+	int rd, rs, rt;
+	long long imm;
+
+	// The operands of the second instruction of a fused pair
+	int rd2, rs2, rt2;
+	long long imm2;
+
+	// Used by the generic ALU handler
+	AluOp alu_op;
+	const Instr* instr;
+
+	// Used by loads and stores
+	int nr_bytes;
+	int read_unsigned;
+
+	// Used by branches: 1 for beq, 0 for bne
+	int branch_if_zero;
+};
+
+// How a translated block ends
+typedef enum BlockEnd
+{
+	END_BRANCH,
+	END_JUMP,
+	END_INDIRECT_JUMP,
+	END_SYSCALL,
+	END_FALL_THROUGH
+}
+BlockEnd;
+
+typedef struct TranslatedBlock
+{
+	// The address of the first instruction in the block
+	long long start_pc;
+
+	// The target address of the branch or jump ending the block
+	long long taken_pc;
+
+	// The address to continue at when the block ends with a non-taken branch or
+	// just falls through. For blocks ending with a syscall, this is the syscall's address.
+	long long fall_through_pc;
+
+	BlockEnd end;
+	int nr_ops;
+
+	// The number of non-nop instructions in the block
+	int nr_retired;
+	TranslatedOp* ops;
+
+	// The successor blocks. These are filled in the first time the block is left
+	// in the corresponding direction. For blocks ending with jr or jalr, taken is
+	// the block at the last target.
+	struct TranslatedBlock* taken;
+	struct TranslatedBlock* fall_through;
+
+	struct TranslatedBlock* next_in_bucket;
+}
+TranslatedBlock;
+
+static TranslatedBlock* buckets[NR_BUCKETS];
+static int nr_translated_blocks;
+static int cache_version = -1;
+
+// Handlers ----------------------------------------------------------------------
+
+static int HandleAlu(const TranslatedOp* op, long long* regs)
+{
+	regs[op->rd] = ComputeALUResult(op->alu_op, op->instr, regs[op->rs], regs[op->rt], op->imm);
+	return 0;
+}
+
+static int HandleAdd(const TranslatedOp* op, long long* regs)
+{
+	long long result = regs[op->rs] + regs[op->rt];
+	ValidateALUResult(result);
+	regs[op->rd] = result;
+	return 0;
+}
+
+static int HandleAddImm(const TranslatedOp* op, long long* regs)
+{
+	long long result = regs[op->rs] + op->imm;
+	ValidateALUResult(result);
+	regs[op->rd] = result;
+	return 0;
+}
+
+static int HandleSub(const TranslatedOp* op, long long* regs)
+{
+	long long result = regs[op->rs] - regs[op->rt];
+	ValidateALUResult(result);
+	regs[op->rd] = result;
+	return 0;
+}
+
+static int HandleSlt(const TranslatedOp* op, long long* regs)
+{
+	regs[op->rd] = regs[op->rs] < regs[op->rt];
+	return 0;
+}
+
+static int HandleConst(const TranslatedOp* op, long long* regs)
+{
+	regs[op->rd] = op->imm;
+	return 0;
+}
+
+static int HandleLoad(const TranslatedOp* op, long long* regs)
+{
+	long long address = regs[op->rs] + op->imm;
+	ValidateALUResult(address);
+	regs[op->rd] = ReadFromDataMemory(address, op->nr_bytes, op->read_unsigned);
+	return 0;
+}
+
+static int HandleStore(const TranslatedOp* op, long long* regs)
+{
+	long long address = regs[op->rs] + op->imm;
+	ValidateALUResult(address);
+	WriteToDataMemory(address, regs[op->rt], op->nr_bytes);
+	return 0;
+}
+
+static int HandleBranch(const TranslatedOp* op, long long* regs)
+{
+	long long diff = regs[op->rs] - regs[op->rt];
+	ValidateALUResult(diff);
+	return (diff == 0) == op->branch_if_zero;
+}
+
+// jr and jalr, which read the target before jalr writes the return address
+static int HandleIndirectJump(const TranslatedOp* op, long long* regs)
+{
+	regs[REG_TARGET] = regs[op->rs];
+	regs[op->rd] = op->imm;
+	return 0;
+}
+
+// Fused lui+ori, where both results are constants
+static int HandleConstPair(const TranslatedOp* op, long long* regs)
+{
+	regs[op->rd] = op->imm;
+	regs[op->rd2] = op->imm2;
+	return 0;
+}
+
+// Fused slt+beq/bne
+static int HandleSltBranch(const TranslatedOp* op, long long* regs)
+{
+	long long diff;
+	regs[op->rd] = regs[op->rs] < regs[op->rt];
+	diff = regs[op->rs2] - regs[op->rt2];
+	ValidateALUResult(diff);
+	return (diff == 0) == op->branch_if_zero;
+}
+
+// Fused addi+beq/bne
+static int HandleAddImmBranch(const TranslatedOp* op, long long* regs)
+{
+	long long result = regs[op->rs] + op->imm, diff;
+	ValidateALUResult(result);
+	regs[op->rd] = result;
+	diff = regs[op->rs2] - regs[op->rt2];
+	ValidateALUResult(diff);
+	return (diff == 0) == op->branch_if_zero;
+}
+
+// Translation -------------------------------------------------------------------
+
+static int DestIndex(int reg)
+{
+	return (reg == DONT_CARE || reg == ZERO) ? REG_SINK : reg;
+}
+
+static int SrcIndex(int reg)
+{
+	return reg == DONT_CARE ? REG_DONT_CARE : reg;
+}
+
+static void TranslateInstr(const DecodedInstr* decoded, long long pc, TranslatedOp* op)
+{
+	const Instr* instr = &decoded->instr;
+
+	op->instr = instr;
+	op->alu_op = decoded->alu_op;
+	op->rd = DestIndex(decoded->dest);
+	op->rs = SrcIndex(instr->rs);
+	op->rt = SrcIndex(instr->rt);
+	op->imm = instr->imm;
+	op->rd2 = op->rs2 = op->rt2 = REG_SINK;
+	op->imm2 = 0;
+	op->nr_bytes = op->read_unsigned = 0;
+	op->branch_if_zero = instr->type == BEQ;
+
+	switch (instr->type)
+	{
+	case ADD:
+		op->handler = HandleAdd;
+		break;
+	case ADDI:
+		op->handler = HandleAddImm;
+		break;
+	case SUB:
+		op->handler = HandleSub;
+		break;
+	case SLT:
+		op->handler = HandleSlt;
+		break;
+	case LUI:
+		op->handler = HandleConst;
+		op->imm = ComputeALUResult(ALU_LUI, instr, DONT_CARE, DONT_CARE, instr->imm);
+		break;
+	case LW:
+	case LH:
+	case LHU:
+	case LB:
+	case LBU:
+		op->handler = HandleLoad;
+		op->nr_bytes = (instr->type == LW) ? 4 : (instr->type == LH || instr->type == LHU) ? 2 : 1;
+		op->read_unsigned = instr->type == LHU || instr->type == LBU;
+		break;
+	case SW:
+	case SH:
+	case SB:
+		op->handler = HandleStore;
+		op->nr_bytes = (instr->type == SW) ? 4 : (instr->type == SH) ? 2 : 1;
+		break;
+	case BEQ:
+	case BNE:
+		op->handler = HandleBranch;
+		break;
+	case JAL:
+		op->handler = HandleConst;
+		op->imm = pc + 4;
+		break;
+	case JR:
+	case JALR:
+		op->handler = HandleIndirectJump;
+		op->imm = pc + 4;
+		break;
+	default:
+		op->handler = HandleAlu;
+	}
+}
+
+// Try to fuse the translated instruction prev (of type prev_type) with the
+// following instruction cur. Returns 1 and updates prev if successful.
+static int TryToFuse(TranslatedOp* prev, InstrType prev_type, const DecodedInstr* cur)
+{
+	const Instr* instr = &cur->instr;
+
+	if (prev_type == LUI && instr->type == ORI && prev->rd != REG_SINK && instr->rs == prev->rd)
+	{
+		long long result = prev->imm | instr->imm;
+		if (!ValueFitsInPrecision(result, 32))
+			return 0;
+		prev->handler = HandleConstPair;
+		prev->rd2 = DestIndex(cur->dest);
+		prev->imm2 = result;
+		return 1;
+	}
+
+	if ((prev_type == SLT || prev_type == ADDI) && (instr->type == BEQ || instr->type == BNE))
+	{
+		prev->handler = prev_type == SLT ? HandleSltBranch : HandleAddImmBranch;
+		prev->rs2 = SrcIndex(instr->rs);
+		prev->rt2 = SrcIndex(instr->rt);
+		prev->branch_if_zero = instr->type == BEQ;
+		return 1;
+	}
+
+	return 0;
+}
+
+static TranslatedBlock* TranslateBlock(long long start_pc)
+{
+	TranslatedBlock* block = (TranslatedBlock*) calloc(1, sizeof(TranslatedBlock));
+	long long pc = start_pc;
+	InstrType prev_type = NOP;
+	int prev_fusable = 0;
+	int len;
+
+	block->start_pc = start_pc;
+	block->ops = (TranslatedOp*) malloc(MAX_BLOCK_LENGTH * sizeof(TranslatedOp));
+	block->end = END_FALL_THROUGH;
+
+	for (len = 0; len < MAX_BLOCK_LENGTH; ++len, pc += 4)
+	{
+		const DecodedInstr* decoded = ReadDecodedFromInstrMemory(pc);
+		InstrType type = decoded->instr.type;
+
+		if (type == NOP)
+			continue;
+
+		if (type == SYSCALL)
+		{
+			block->end = END_SYSCALL;
+			break;
+		}
+
+		++block->nr_retired;
+
+		if (type == J)
+		{
+			block->end = END_JUMP;
+			block->taken_pc = decoded->instr.imm;
+			break;
+		}
+
+		if (!(prev_fusable && TryToFuse(&block->ops[block->nr_ops - 1], prev_type, decoded)))
+		{
+			TranslateInstr(decoded, pc, &block->ops[block->nr_ops]);
+			++block->nr_ops;
+			prev_type = type;
+			prev_fusable = 1;
+		}
+		else
+			prev_fusable = 0;
+
+		if (type == BEQ || type == BNE || type == JAL || IsIndirectJump(type))
+		{
+			block->end = type == JAL ? END_JUMP : IsIndirectJump(type) ? END_INDIRECT_JUMP : END_BRANCH;
+			block->taken_pc = decoded->instr.imm;
+			pc += 4;
+			break;
+		}
+	}
+	block->fall_through_pc = pc;
+
+	++nr_translated_blocks;
+	return block;
+}
+
+static TranslatedBlock* LookupBlock(long long pc)
+{
+	TranslatedBlock** bucket = &buckets[(pc >> 2) & (NR_BUCKETS - 1)];
+	TranslatedBlock* block;
+
+	for (block = *bucket; block != NULL; block = block->next_in_bucket)
+		if (block->start_pc == pc)
+			return block;
+
+	block = TranslateBlock(pc);
+	block->next_in_bucket = *bucket;
+	*bucket = block;
+	return block;
+}
+
+// Public functions --------------------------------------------------------------
+
+int RunTranslated(long long* pc, long long* nr_retired, long long max_instr)
+{
+	long long regs[NR_REG_SLOTS];
+	long long retired = 0;
+	int found_syscall = 0;
+	TranslatedBlock* block;
+
+	// The blocks end with their branch or jump, without its delay slot
+	if (AreDelaySlotsOn())
+		return RunFunctional(pc, nr_retired, max_instr);
+
+	if (cache_version != GetInstrMemoryVersion())
+	{
+		ClearTranslationCache();
+		cache_version = GetInstrMemoryVersion();
+	}
+
+	ReadAllFromRegisterFile(regs);
+	regs[REG_SINK] = 0;
+	regs[REG_DONT_CARE] = DONT_CARE;
+
+	block = LookupBlock(*pc);
+	for (;;)
+	{
+		const TranslatedOp* op, * end;
+		int taken = 0;
+
+		// Leave the rest to the interpreter if the block would exceed the limit
+		if (max_instr >= 0 && (retired == max_instr || retired + block->nr_retired > max_instr))
+			break;
+
+		for (op = block->ops, end = op + block->nr_ops; op != end; ++op)
+			taken = op->handler(op, regs);
+		retired += block->nr_retired;
+
+		if (block->end == END_SYSCALL)
+		{
+			found_syscall = 1;
+			break;
+		}
+
+		if (block->end == END_INDIRECT_JUMP)
+		{
+			if (block->taken == NULL || block->taken->start_pc != regs[REG_TARGET])
+				block->taken = LookupBlock(regs[REG_TARGET]);
+			block = block->taken;
+		}
+		else if (block->end == END_JUMP || taken)
+		{
+			if (block->taken == NULL)
+				block->taken = LookupBlock(block->taken_pc);
+			block = block->taken;
+		}
+		else
+		{
+			if (block->fall_through == NULL)
+				block->fall_through = LookupBlock(block->fall_through_pc);
+			block = block->fall_through;
+		}
+	}
+
+	WriteAllToRegisterFile(regs);
+
+	if (found_syscall)
+		*pc = block->fall_through_pc;
+	else
+	{
+		// Execute the remaining instructions one by one
+		long long tail_retired;
+		*pc = block->start_pc;
+		found_syscall = RunFunctional(pc, &tail_retired, max_instr - retired);
+		retired += tail_retired;
+	}
+
+	*nr_retired = retired;
+	return found_syscall;
+}
+
+void ClearTranslationCache()
+{
+	int b;
+	for (b = 0; b < NR_BUCKETS; ++b)
+	{
+		while (buckets[b] != NULL)
+		{
+			TranslatedBlock* next = buckets[b]->next_in_bucket;
+			free(buckets[b]->ops);
+			free(buckets[b]);
+			buckets[b] = next;
+		}
+	}
+	nr_translated_blocks = 0;
+}
+
+int GetNrOfTranslatedBlocks()
+{
+	return nr_translated_blocks;
+}
@@ -0,0 +1,32 @@
+/** @file translation_cache.h
+	A cache of translated basic blocks, used to speed up functional execution.
+	A basic block is a run of instructions that ends with a beq, bne, j or syscall.
+	When a block is first executed, it is translated into an array of handlers with
+	their register operands already resolved, where common instruction pairs (lui+ori,
+	slt+beq/bne and addi+beq/bne) are fused into single handlers. Each block is linked
+	directly to its successors once they have been executed, so that a loop runs
+	from block to block without looking anything up in the cache. */
+
+#ifndef TRANSLATION_CACHE_H_INCL
+#define TRANSLATION_CACHE_H_INCL
+
+/** Does the same as RunFunctional(), but executes translated basic blocks from the
+	translation cache. Blocks are translated when they are first executed, and the
+	cache is flushed automatically if the instruction memory changes. With delay slots,
+	the instructions are executed by RunFunctional() instead.
+	@param pc In: the address of the first instruction to execute. Out: the address of
+		the next instruction to execute
+	@param nr_retired Used to return the number of retired instructions
+	@param max_instr The maximum number of instructions to retire, or a negative
+		value for no limit
+	@return 1 if execution stopped at a syscall, 0 otherwise */
+int RunTranslated(long long* pc, long long* nr_retired, long long max_instr);
+
+/** Remove all translated blocks from the translation cache */
+void ClearTranslationCache();
+
+/** Return the number of basic blocks that have been translated since the
+	translation cache was last cleared */
+int GetNrOfTranslatedBlocks();
+
+#endif // ifndef TRANSLATION_CACHE_H_INCL
@@ -2,6 +2,13 @@
 #pragma warning(disable : 26453)
 
 #include "update.h"
+#include "alu.h"
+#include "cache.h"
+#include "tlb.h"
+#include "store_buffer.h"
+#include "branch_predictor.h"
+#include "btb.h"
+#include "ras.h"
 #include "utils.h"
 #include "error_handling.h"
 #include <assert.h>
@@ -10,25 +17,165 @@
 #define ENABLE_TASK2_SOLUTION
 #define ENABLE_TASK3_SOLUTION
 
+// Whether beq and bne are resolved in the ID stage rather than in the Mem stage
+static int early_branch_resolution;
+
  // Functions for computing the next states of the pipeline stages -------------------------
 
+// Return whether the instruction in the Mem stage is a branch, jr or jalr that was
+// mispredicted, and set next_pc to the address of the instruction that really follows it
+static int IsBranchMispredicted(long long* next_pc)
+{
+	int taken = (mem_stage.instr.type == BEQ && mem_stage.zero)
+		|| (mem_stage.instr.type == BNE && !mem_stage.zero);
+
+	if (IsIndirectJump(mem_stage.instr.type))
+		*next_pc = mem_stage.branch_target;
+	else if ((mem_stage.instr.type == BEQ || mem_stage.instr.type == BNE) && !early_branch_resolution)
+		*next_pc = taken ? mem_stage.branch_target : GetFallThroughAddress(mem_stage.pc);
+	else
+		return 0;
+	return *next_pc != mem_stage.predicted_pc;
+}
+
+// Return whether the instruction is a subroutine return, whose target is predicted by
+// the return address stack
+static int IsReturn(const Instr* instr)
+{
+	return GetRASDepth() > 0 && instr->type == JR && instr->rs == RA;
+}
+
+// Return whether the instruction in the ID stage is a jump to the address in its
+// immediate field, and the BTB has not already redirected the fetch to it
+static int IsDirectJumpInIDStage()
+{
+	return (id_stage.instr.type == J || id_stage.instr.type == JAL) && !id_stage.redirected;
+}
+
+// Return whether the instruction in the ID stage is a return that the return address
+// stack predicts to continue elsewhere than after it
+static int IsReturnPredicted()
+{
+	return IsReturn(&id_stage.instr) && id_stage.predicted_pc != GetFallThroughAddress(id_stage.pc);
+}
+
+// Return whether the instruction in the ID stage is a branch that is predicted taken,
+// and the BTB has not already redirected the fetch to its target
+static int IsBranchPredictedTaken()
+{
+	return (id_stage.instr.type == BEQ || id_stage.instr.type == BNE) && !early_branch_resolution
+		&& id_stage.predicted_pc != GetFallThroughAddress(id_stage.pc) && !id_stage.redirected;
+}
+
+// Read the register reg for the comparator in the ID stage into value. The result of
+// the instruction in Mem is forwarded, unless it is loaded. Return whether the value is
+// available, which it is not while the instruction in Ex computes it, or while a load
+// in Mem reads it from the memory.
+static int ReadComparatorOperand(int reg, long long* value)
+{
+	if (ex_stage.decoded->dest == reg)
+		return 0;
+	if (mem_stage.decoded->dest == reg)
+	{
+		if (mem_stage.decoded->category == LOAD)
+			return 0;
+		*value = mem_stage.alu_result;
+	}
+	else
+		*value = ReadFromRegisterFile(reg);
+	return 1;
+}
+
+// With early branch resolution, return whether the instruction in the ID stage is a
+// branch whose operands are available to the comparator, and set next_pc to the address
+// of the instruction that really follows it
+static int IsBranchResolvedInIDStage(long long* next_pc)
+{
+	long long rs_value, rt_value;
+
+	if (!early_branch_resolution || (id_stage.instr.type != BEQ && id_stage.instr.type != BNE))
+		return 0;
+	if (!ReadComparatorOperand(id_stage.instr.rs, &rs_value)
+		|| !ReadComparatorOperand(id_stage.instr.rt, &rt_value))
+		return 0;
+	*next_pc = (rs_value == rt_value) == (id_stage.instr.type == BEQ)
+		? id_stage.instr.imm : GetFallThroughAddress(id_stage.pc);
+	return 1;
+}
+
+// Return whether the branch in the ID stage is resolved there, and does not continue
+// where the fetch went after it. next_pc is set to where it really continues.
+static int IsBranchRedirectedFromIDStage(long long* next_pc)
+{
+	long long fetched_pc = id_stage.redirected ? id_stage.predicted_pc : GetFallThroughAddress(id_stage.pc);
+	return IsBranchResolvedInIDStage(next_pc) && *next_pc != fetched_pc;
+}
+
+// Return whether the instruction in the ID stage is a branch that must wait for the
+// operands of the comparator
+static int IsComparatorStalled()
+{
+	long long next_pc;
+	return early_branch_resolution && (id_stage.instr.type == BEQ || id_stage.instr.type == BNE)
+		&& !IsBranchResolvedInIDStage(&next_pc);
+}
+
+// Continue the fetch at target after the jump or branch at the address branch_pc. With
+// delay slots, the instruction in the IF stage is its delay slot. If that has not
+// arrived from the instruction cache yet, it is still fetched, and the fetch continues
+// at target after it.
+static void RedirectFetch(long long branch_pc, long long target, IFStage* next_if)
+{
+	if (AreDelaySlotsOn() && if_stage.pc == branch_pc + 4 && if_stage.wait_cycles > 0)
+	{
+		next_if->pc = if_stage.pc;
+		next_if->after_slot_pc = target;
+	}
+	else
+		next_if->pc = target;
+}
+
  // Based on the current state of the pipeline, compute a new state for the IF
  // stage to use in the next clock cycle. next_if is an output parameter for the computed state.
 static void ComputeNextIFStage(IFStage* next_if)
 {
-	// If there is a jump instruction in the ID stage select the jump target as the next PC
-	if(id_stage.instr.type == J)
+	long long resolved_pc;
+
+	next_if->after_slot_pc = DONT_CARE;
+
+	// If the branch instruction in the Mem stage was mispredicted, continue after it on
+	// the right path. The instructions after it, including a jump in ID, are flushed.
+	if (IsBranchMispredicted(&resolved_pc))
 	{
-		next_if->pc = id_stage.instr.imm;
+		RedirectFetch(mem_stage.pc, resolved_pc, next_if);
+	}
+	// If there is a jump instruction in the ID stage select the jump target as the next PC,
+	// unless the BTB already did
+	else if (IsDirectJumpInIDStage())
+	{
+		RedirectFetch(id_stage.pc, id_stage.instr.imm, next_if);
 
 	}
-	// If there is a branch instruction in the Mem stage, and the branch condition
-	// is true, select the branch target as the next PC
-	else if ((mem_stage.instr.type == BEQ && mem_stage.zero)
-		|| (mem_stage.instr.type == BNE && !mem_stage.zero))
+	// If the branch instruction in the ID stage was resolved there, and the fetch went
+	// elsewhere, continue after it on the right path
+	else if (IsBranchRedirectedFromIDStage(&resolved_pc))
+		RedirectFetch(id_stage.pc, resolved_pc, next_if);
+	// If there is a branch instruction in the ID stage that is predicted taken, or a
+	// return with a predicted target, select the predicted target as the next PC
+	else if (IsBranchPredictedTaken() || IsReturnPredicted())
+		RedirectFetch(id_stage.pc, id_stage.predicted_pc, next_if);
+	// Keep fetching the same instruction until it has arrived from the instruction cache
+	else if (if_stage.wait_cycles > 0)
 	{
-		next_if->pc = mem_stage.branch_target;
+		next_if->pc = if_stage.pc;
+		next_if->after_slot_pc = if_stage.after_slot_pc;
 	}
+	// Continue at the target of the jump or branch whose delay slot has arrived
+	else if (if_stage.after_slot_pc != DONT_CARE)
+		next_if->pc = if_stage.after_slot_pc;
+	// Follow the BTB if it found the fetched instruction to be a jump or taken branch
+	else if (if_stage.btb_target != DONT_CARE)
+		next_if->pc = if_stage.btb_target;
 	// Otherwise just select the succeeding instruction to fetch
 	else
 		next_if->pc = if_stage.pc + 4;
@@ -36,21 +183,70 @@ static void ComputeNextIFStage(IFStage* next_if)
 	// Fetch the instruction from memory, although in a real CPU this would be done
 	// in the next clock cycle. This is just to be able to show the instruction
 	// in the trace output.
-	next_if->instr = ReadFromInstrMemory(next_if->pc);
+	next_if->decoded = ReadDecodedFromInstrMemory(next_if->pc);
+	next_if->instr = next_if->decoded->instr;
 }
 
 // Based on the current state of the pipeline, compute a new state for the ID
 // stage to use in the next clock cycle. next_id is an output parameter for the computed state.
 static void ComputeNextIDStage(IDStage* next_id)
 {
-	if(id_stage.instr.type == J) 
+	long long resolved_pc;
+
+	// With delay slots, the instruction after a jump or branch is its delay slot, which
+	// is never squashed
+	int squash = !AreDelaySlotsOn();
+
+	if (squash && IsDirectJumpInIDStage())
 	{
 		// we cancel the instruction in the next_id, because it is the one just after the jump
 		ClearIDStage(next_id);
+		++stall_counts.jump_squashes;
+		UpdateBTB(id_stage.pc, id_stage.instr.imm, 0);
+	}
+	// Likewise for the instruction after a return that is predicted
+	else if (squash && IsReturnPredicted())
+	{
+		ClearIDStage(next_id);
+		++stall_counts.jump_squashes;
+	}
+	// Likewise for the instruction after a branch resolved in ID that was fetched on the
+	// wrong path. It is counted in ResolveBranchInIDStage().
+	else if (squash && IsBranchRedirectedFromIDStage(&resolved_pc))
+		ClearIDStage(next_id);
+	// Likewise for the instruction after a branch that is predicted taken
+	else if (squash && IsBranchPredictedTaken())
+	{
+		ClearIDStage(next_id);
+		++stall_counts.branch_squashes;
+	}
+	// The instruction in the IF stage has not arrived from the instruction cache yet
+	else if (if_stage.wait_cycles > 0)
+	{
+		ClearIDStage(next_id);
+		++stall_counts.fetch_stalls;
 	}
 	// Update the ID stage with the instruction fetched in the IF stage
 	else 
-		next_id->instr = ReadFromInstrMemory(if_stage.pc);
+	{
+		next_id->instr = if_stage.instr;
+		next_id->decoded = if_stage.decoded;
+		next_id->pc = if_stage.pc;
+		next_id->redirected = if_stage.btb_target != DONT_CARE;
+
+		// Look up the branch predictor for a branch, unless the BTB already did. The
+		// target of jr and jalr is predicted to be the next instruction, unless the
+		// return address stack predicts a return in PredictReturn().
+		if (next_id->redirected)
+			next_id->predicted_pc = if_stage.btb_target;
+		else if (if_stage.instr.type == BEQ || if_stage.instr.type == BNE)
+			next_id->predicted_pc = PredictBranch(if_stage.pc, if_stage.instr.imm)
+				? if_stage.instr.imm : GetFallThroughAddress(if_stage.pc);
+		else if (IsIndirectJump(if_stage.instr.type))
+			next_id->predicted_pc = GetFallThroughAddress(if_stage.pc);
+		else
+			next_id->predicted_pc = DONT_CARE;
+	}
 }
 
 // Based on the current state of the pipeline, compute a new state for the Ex 
@@ -59,6 +255,10 @@ static void ComputeNextExStage(ExStage* next_ex)
 {
 	// Read the right registers
 	next_ex->instr = id_stage.instr;
+	next_ex->decoded = id_stage.decoded;
+	next_ex->pc = id_stage.pc;
+	next_ex->predicted_pc = id_stage.predicted_pc;
+	next_ex->redirected = id_stage.redirected;
 	if (id_stage.instr.rs != DONT_CARE)
 		next_ex->rs_value = ReadFromRegisterFile(id_stage.instr.rs);
 	else
@@ -74,106 +274,26 @@ static void ComputeNextExStage(ExStage* next_ex)
 // stage to use in the next clock cycle. next_mem is an output parameter for the computed state.
 static void ComputeNextMemStage(MemStage* next_mem)
 {
-	// A mask used to convert signed values to unsigned
-	long long mask = CreateLLMask(0, 32);
-
 	// Set some default values
 	ClearMemStage(next_mem);
 	next_mem->instr = ex_stage.instr;
+	next_mem->decoded = ex_stage.decoded;
+	next_mem->pc = ex_stage.pc;
+	next_mem->predicted_pc = ex_stage.predicted_pc;
+	next_mem->redirected = ex_stage.redirected;
 	next_mem->rt_value = ex_stage.rt_value;
 
-	// Note that since we store the complete target address for jumps and
-	// branches, no address computation needs to be done in this stage (this
-	// is what is done by the extra ALU described in the course book)
-
-	// Select an operation for the ALU
-	switch (ex_stage.instr.type)
-	{
-	case NOP:
-	case SYSCALL:
-	case J:
-		break;
-	case ADD:
-		next_mem->alu_result = ex_stage.rs_value + ex_stage.rt_value;
-		break;
-	case ADDI:
-	case LW:
-	case SW:
-	case LH:
-	case LHU:
-	case SH:
-	case LB:
-	case LBU:
-	case SB:
-		next_mem->alu_result = ex_stage.rs_value + ex_stage.imm_value;
-		break;
-	case SUB:
-		next_mem->alu_result = ex_stage.rs_value - ex_stage.rt_value;
-		break;
-	case AND:
-		next_mem->alu_result = ex_stage.rs_value & ex_stage.rt_value;
-		break;
-	case ANDI:
-		next_mem->alu_result = ex_stage.rs_value & ex_stage.imm_value;
-		break;
-	case OR:
-		next_mem->alu_result = ex_stage.rs_value | ex_stage.rt_value;
-		break;
-	case ORI:
-		next_mem->alu_result = ex_stage.rs_value | ex_stage.instr.imm;
-		break;
-	case NOR:
-		next_mem->alu_result = ~(ex_stage.rs_value | ex_stage.rt_value);
-		break;
-	case SLL:
-	{
-		long long sign_bit_mask = 1LL << 31;
-
-		next_mem->alu_result = ex_stage.rs_value << ex_stage.imm_value;
-
-		// Remove the shifted-out bits, while trying to preserve the sign in the result.
-		// This means that if the left operand was negative, and the result from the shift
-		// also has its sign bit set, we copy the sign into the result
-		if (ex_stage.rs_value < 0 && (next_mem->alu_result & sign_bit_mask) != 0)
-			next_mem->alu_result |= ~mask;
-		else
-			next_mem->alu_result &= mask;
-		break;
-	}
-	case SRL:
-		if (ex_stage.imm_value != 0)
-			next_mem->alu_result = (ex_stage.rs_value & mask) >> ex_stage.imm_value;
-		break;
-	case BEQ:
-	case BNE:
-		next_mem->alu_result = ex_stage.rs_value - ex_stage.rt_value;
+	next_mem->alu_result = ComputeALUResult(ex_stage.decoded->alu_op, &ex_stage.instr,
+		ex_stage.rs_value, ex_stage.rt_value, ex_stage.imm_value);
+	if (ex_stage.instr.type == BEQ || ex_stage.instr.type == BNE)
 		next_mem->branch_target = ex_stage.imm_value;
-		break;
-	case SLT:
-		next_mem->alu_result = ex_stage.rs_value < ex_stage.rt_value;
-		break;
-	case SLTI:
-		next_mem->alu_result = ex_stage.rs_value < ex_stage.imm_value;
-		break;
-	case SLTU:
-		next_mem->alu_result = (ex_stage.rs_value & mask) < (ex_stage.rt_value & mask);
-		break;
-	case SLTIU:
-		next_mem->alu_result = (ex_stage.rs_value & mask) < (ex_stage.imm_value & mask);
-		break;
-	case LUI:
-		next_mem->alu_result = ex_stage.imm_value << 16;
-		break;
-	default:
-		STATIC_MIPS_ERROR("ComputeNextMemStage(): unhandled instruction in current EX stage from program line %d: %s", ex_stage.instr.line_nr, StringRepOfInstrType(ex_stage.instr.type));
-	}
+	else if (IsIndirectJump(ex_stage.instr.type))
+		next_mem->branch_target = ex_stage.rs_value;
 
-	// Do some error checking. In a real CPU, arithmetic underflow or overflow would cause an exception,
-	// but we just terminate the simulator with an error message.
-	if (next_mem->alu_result < MIN_32_BIT_REGVALUE)
-		MIPS_RUNTIME_ERROR("Arithmetic underflow: %lld (value does not fit in 32 bits)", next_mem->alu_result);
-	if (next_mem->alu_result >= (1LL << 32))
-		MIPS_RUNTIME_ERROR("Arithmetic overflow: %lld (value does not fit in 32 bits)", next_mem->alu_result);
+	// Calls write their return address like the ALU result of other instructions, so
+	// that it is forwarded to the instructions after them
+	if (ex_stage.decoded->dest != DONT_CARE && IsJump(ex_stage.instr.type))
+		next_mem->alu_result = GetFallThroughAddress(ex_stage.pc);
 
 	next_mem->zero = next_mem->alu_result == 0 ? 1 : 0;
 
@@ -186,6 +306,8 @@ static void ComputeNextWBStage(WBStage* next_wb)
 	// Set some default values
 	ClearWBStage(next_wb);
 	next_wb->instr = mem_stage.instr;
+	next_wb->decoded = mem_stage.decoded;
+	next_wb->pc = mem_stage.pc;
 
 	switch (mem_stage.instr.type)
 	{
@@ -221,63 +343,247 @@ static void ComputeNextWBStage(WBStage* next_wb)
 static void HandleHazards(IFStage* next_if, IDStage* next_id, ExStage* next_ex,
 	MemStage* next_mem, WBStage* next_wb)
 {
-	int rs, rt;
-	
-	// If there is taken branch in the mem stage, the instruction fetched in the
-	// IF stage (which is from the non-taken branch) should be zeroed out
-	if ((mem_stage.instr.type == BEQ && mem_stage.zero) ||
-		(mem_stage.instr.type == BNE && !mem_stage.zero))
+	// The register(s) read by the instruction in ID, and the registers written
+	// by the instructions in Ex and Mem, are all looked up in the predecoded instructions
+	int rs = id_stage.decoded->src_rs;
+	int ex_dest = ex_stage.decoded->dest, mem_dest = mem_stage.decoded->dest;
+	unsigned int read_mask = id_stage.decoded->read_mask;
+	long long resolved_pc;
+	int mispredicted = IsBranchMispredicted(&resolved_pc);
+	int comparator_stalled = !mispredicted && IsComparatorStalled();
+
+	// With delay slots, the delay slot of a mispredicted branch or jump is not flushed,
+	// wherever it is in the pipeline
+	int slot_in_ex = mispredicted && AreDelaySlotsOn() && ex_stage.pc == mem_stage.pc + 4;
+	int slot_in_id = mispredicted && AreDelaySlotsOn() && id_stage.pc == mem_stage.pc + 4;
+
+	// The branch in the Mem stage is resolved, and trains the branch predictor. A taken
+	// branch is added to the BTB.
+	if ((mem_stage.instr.type == BEQ || mem_stage.instr.type == BNE) && !early_branch_resolution)
 	{
-		ClearIDStage(next_id);
-		ClearExStage(next_ex);
-		ClearMemStage(next_mem);
+		ResolveBranch(mem_stage.pc, resolved_pc != GetFallThroughAddress(mem_stage.pc), mispredicted);
+		if (resolved_pc != GetFallThroughAddress(mem_stage.pc))
+			UpdateBTB(mem_stage.pc, resolved_pc, 1);
 	}
 
-	// Get the register(s) read by the instruction in ID
-	GetRegsReadByInstr(&id_stage.instr, &rs, &rt);
+	// A return in the Mem stage is resolved
+	if (IsReturn(&mem_stage.instr))
+		ResolveReturn(mispredicted);
+
+	// A jump or correctly predicted branch in the Mem stage that the BTB redirected the
+	// fetch for saved the bubble of a redirect from ID. Younger instructions may still
+	// be flushed, but not this one.
+	if (mem_stage.redirected && !mispredicted)
+		CountEliminatedBubble();
+
+	// If the branch in the mem stage was mispredicted, the instructions fetched
+	// after it (which are from the wrong path) should be zeroed out. The call or return
+	// in Ex, if any, has already updated the return address stack.
+	if (mispredicted)
+	{
+		if (GetRASDepth() > 0 && (ex_stage.instr.type == JAL || ex_stage.instr.type == JALR
+			|| IsReturn(&ex_stage.instr)))
+			UndoRASUpdate();
+		if (!AreDelaySlotsOn())
+		{
+			ClearIDStage(next_id);
+			ClearExStage(next_ex);
+			ClearMemStage(next_mem);
+		}
+		else if (slot_in_ex)
+		{
+			ClearIDStage(next_id);
+			ClearExStage(next_ex);
+		}
+		else if (slot_in_id)
+			ClearIDStage(next_id);
+		if (IsIndirectJump(mem_stage.instr.type))
+			++stall_counts.jump_flushes;
+		else
+			++stall_counts.branch_flushes;
+	}
 
 	// Check if the instruction in Mem has any of the registers read by the
 	// instruction in ID as destination register
-	if (rs != DONT_CARE && GetRegWrittenByInstr(&mem_stage.instr) == rs)
-		next_ex->rs_value = next_wb->result;
-	else if (rt != DONT_CARE && GetRegWrittenByInstr(&mem_stage.instr) == rt)
-		next_ex->rt_value = next_wb->result;
+	if (mem_dest != DONT_CARE && (read_mask & (1u << mem_dest)))
+	{
+		if (mem_dest == rs)
+			next_ex->rs_value = next_wb->result;
+		else
+			next_ex->rt_value = next_wb->result;
+	}
 
+	// A branch that is resolved in ID waits until the operands of its comparator are
+	// available, which covers the load-use stall
+	if (comparator_stalled)
+	{
+		*next_if = if_stage;
+		*next_id = id_stage;
+		ClearExStage(next_ex);
+		++stall_counts.comparator_stalls;
+	}
 	// Check if the instruction in Ex has any of the registers read by the
 	// instruction in ID as destination register
-	if ((rs != DONT_CARE && GetRegWrittenByInstr(&ex_stage.instr) == rs) ||
-		(rt != DONT_CARE && GetRegWrittenByInstr(&ex_stage.instr) == rt))
+	else if (ex_dest != DONT_CARE && (read_mask & (1u << ex_dest)))
 	{
-
-		if(GetInstrCategory(ex_stage.instr.type)==LOAD)
+		// The load-use stall must not undo the flush after a mispredicted branch
+		if (ex_stage.decoded->category == LOAD && !mispredicted)
 		{
 			// Reset the future IF and ID stages to the same states as in the current clock cycle,
 			// and make the future Ex stage a bubble
 			*next_if = if_stage;
 			*next_id = id_stage;
 			ClearExStage(next_ex);
+			++stall_counts.load_use_stalls;
 		}
 		else 
 		{
-			if(rs != DONT_CARE && GetRegWrittenByInstr(&ex_stage.instr) == rs) 
+			if (ex_dest == rs) 
 				next_ex->rs_value = next_mem->alu_result;
 			else 
 				next_ex->rt_value = next_mem->alu_result;
 		}
 	}
+
+	// With a non-blocking data cache, the instruction in ID waits while a register it
+	// reads or writes is waiting for the data of a load miss, unless it is flushed or
+	// already waits for its comparator. The delay slot of a mispredicted branch waits
+	// while the fetch continues on the right path.
+	if ((!mispredicted || slot_in_id) && !comparator_stalled)
+	{
+		unsigned int used_mask = read_mask;
+		if (id_stage.decoded->dest != DONT_CARE)
+			used_mask |= 1u << id_stage.decoded->dest;
+		if (used_mask & GetPendingLoadRegisters(GetElapsedCycles()))
+		{
+			if (!mispredicted)
+				*next_if = if_stage;
+			*next_id = id_stage;
+			ClearExStage(next_ex);
+			++stall_counts.load_miss_stalls;
+		}
+	}
 }
 
-static void UpdateRegisterFile()
+// Predict the target of a return in the ID stage with the return address stack. This is
+// done while the return is in ID rather than when it enters it, so that the call or
+// return that leaves ID in the same cycle has updated the stack.
+static void PredictReturn()
 {
-	int written_reg = GetRegWrittenByInstr(&wb_stage.instr);
-	if (written_reg != DONT_CARE)
+	if (IsReturn(&id_stage.instr))
 	{
-		WriteToRegisterFile(written_reg, wb_stage.result);
+		long long target = PeekReturnAddress();
+		id_stage.predicted_pc = target != DONT_CARE ? target : GetFallThroughAddress(id_stage.pc);
+	}
+}
+
+// Update the return address stack with the call or return that leaves the ID stage,
+// unless it stalls or is flushed
+static void UpdateRAS(const ExStage* next_ex)
+{
+	if (next_ex->pc != id_stage.pc || id_stage.pc == DONT_CARE)
+		return;
+	if (id_stage.instr.type == JAL || id_stage.instr.type == JALR)
+		PushReturnAddress(GetFallThroughAddress(id_stage.pc));
+	else if (IsReturn(&id_stage.instr))
+		PopReturnAddress();
+}
+
+// Resolve the branch that leaves the ID stage with early branch resolution, unless it
+// stalls or is flushed. It trains the branch predictor, and a taken branch is added to
+// the BTB. If the fetch went elsewhere, the instruction after it was squashed, unless it
+// is the delay slot, and the BTB redirect, if any, did not save a bubble.
+static void ResolveBranchInIDStage(ExStage* next_ex)
+{
+	long long resolved_pc;
+
+	if (next_ex->pc != id_stage.pc || id_stage.pc == DONT_CARE || !IsBranchResolvedInIDStage(&resolved_pc))
+		return;
+	ResolveBranch(id_stage.pc, resolved_pc != GetFallThroughAddress(id_stage.pc),
+		resolved_pc != id_stage.predicted_pc);
+	if (resolved_pc != GetFallThroughAddress(id_stage.pc))
+		UpdateBTB(id_stage.pc, resolved_pc, 1);
+	if (IsBranchRedirectedFromIDStage(&resolved_pc) && !AreDelaySlotsOn())
+	{
+		next_ex->redirected = 0;
+		++stall_counts.early_branch_squashes;
+	}
+}
+
+// Start the instruction cache access of the instruction entering the IF stage, and the
+// data cache access of the load or store entering the Mem stage. An access takes one
+// cycle in its stage, and the stage waits for the remaining cycles. A TLB miss delays
+// the cache access by the page-table walk. The BTB is looked up along with the
+// instruction cache.
+static void StartCacheAccesses(IFStage* next_if, MemStage* next_mem)
+{
+	// The accesses start in the next cycle
+	long long cycle = GetElapsedCycles() + 1;
+	int walk_cycles, nr_bytes;
+
+	if (next_if->pc != if_stage.pc)
+	{
+		walk_cycles = TranslateAddress(INSTRUCTION_TLB, next_if->pc, cycle);
+		next_if->wait_cycles = walk_cycles + AccessInstructionCache(next_if->pc, cycle + walk_cycles) - 1;
+		next_if->btb_target = LookupBTB(next_if->pc);
+	}
+	else
+	{
+		next_if->wait_cycles = if_stage.wait_cycles > 0 ? if_stage.wait_cycles - 1 : 0;
+		next_if->btb_target = if_stage.btb_target;
+	}
+
+	switch (next_mem->instr.type)
+	{
+	case LW:
+	case SW:
+		nr_bytes = 4;
+		break;
+	case LH:
+	case LHU:
+	case SH:
+		nr_bytes = 2;
+		break;
+	case LB:
+	case LBU:
+	case SB:
+		nr_bytes = 1;
+		break;
+	default:
+		next_mem->wait_cycles = 0;
+		return;
 	}
+
+	walk_cycles = TranslateAddress(DATA_TLB, next_mem->alu_result, cycle);
+	if (next_mem->decoded->category == LOAD)
+		next_mem->wait_cycles = walk_cycles + StartLoad(next_mem->pc, next_mem->alu_result, nr_bytes,
+			next_mem->decoded->dest, cycle + walk_cycles);
+	else
+		next_mem->wait_cycles = walk_cycles
+			+ StartStore(next_mem->pc, next_mem->alu_result, nr_bytes, cycle + walk_cycles);
 }
 
 // Exported functions ----------------------------------------------------------
 
+void SetEarlyBranchResolution(int on_off)
+{
+	early_branch_resolution = on_off;
+}
+
+int IsEarlyBranchResolutionOn()
+{
+	return early_branch_resolution;
+}
+
+void UpdateRegisterFile()
+{
+	int written_reg = wb_stage.decoded->dest;
+	if (written_reg != DONT_CARE)
+	{
+		WriteToRegisterFile(written_reg, wb_stage.result);
+	}
+}
+
 void UpdatePipelineState()
 {
 	// The next states of all state elements
@@ -292,7 +598,21 @@ void UpdatePipelineState()
 	// reading the registers in the ID stage)
 	UpdateRegisterFile();
 
+	// While the data cache access of the instruction in Mem is in progress, the
+	// pipeline is frozen and a bubble enters WB. The instruction fetch continues.
+	if (mem_stage.wait_cycles > 0)
+	{
+		--mem_stage.wait_cycles;
+		if (if_stage.wait_cycles > 0)
+			--if_stage.wait_cycles;
+		ClearWBStage(&wb_stage);
+		++stall_counts.memory_stalls;
+		return;
+	}
+
 	// Compute the next state elements for the pipeline
+	if (GetRASDepth() > 0)
+		PredictReturn();
 	ComputeNextIFStage(&next_if);
 	ComputeNextIDStage(&next_id);
 	ComputeNextExStage(&next_ex);
@@ -300,6 +620,11 @@ void UpdatePipelineState()
 	ComputeNextWBStage(&next_wb);
 
 	HandleHazards(&next_if, &next_id, &next_ex, &next_mem, &next_wb);
+	if (early_branch_resolution)
+		ResolveBranchInIDStage(&next_ex);
+	if (GetRASDepth() > 0)
+		UpdateRAS(&next_ex);
+	StartCacheAccesses(&next_if, &next_mem);
 
 	// Update the pipeline's state
 	if_stage = next_if;
@@ -10,4 +10,22 @@
 	five pipeline stages to use in the next clock cycle */
 void UpdatePipelineState();
 
+/** Write the result of the instruction in the WB stage to the register file. This is
+	the first step of UpdatePipelineState(), and is also used to complete the
+	instruction when the pipeline is drained. */
+void UpdateRegisterFile();
+
+/** Turn early branch resolution on or off. It is off by default, and beq and bne are
+	resolved in the Mem stage, so a mispredicted branch flushes the ID, Ex and Mem
+	stages. When it is on, a comparator in the ID stage resolves them, and a branch that
+	does not continue where the fetch went after it only squashes the instruction in IF.
+	The result of the instruction in Mem is forwarded to the comparator, but the branch
+	waits in ID for one cycle when an operand is computed by the instruction in Ex, for
+	two when it is loaded by that instruction, and for one when it is loaded by the
+	instruction in Mem. */
+void SetEarlyBranchResolution(int on_off);
+
+/** Return whether early branch resolution is on */
+int IsEarlyBranchResolutionOn();
+
 #endif	// ifndef UPDATE_H_INCL
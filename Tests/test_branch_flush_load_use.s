@@ -0,0 +1,14 @@
+.data
+VALUE: .word 5
+.text
+__start:
+addi $t1, $t1, 9
+nop
+nop
+bne $t1, $zero, L1
+lw $t2, VALUE
+add $t3, $t2, $t2
+addi $t4, $t4, 7
+L1:
+addi $v0, $v0, 10
+syscall
@@ -0,0 +1,20 @@
+# An inner loop of four iterations and a branch that is taken every other
+# iteration of the outer loop, which a global history predictor learns
+.text
+__start:
+	addi $t9, $zero, 64
+	addi $v1, $zero, 0
+outer:
+	addi $t1, $zero, 4
+inner:
+	addi $v1, $v1, 1
+	addi $t1, $t1, -1
+	bne $t1, $zero, inner
+	andi $t2, $t9, 1
+	beq $t2, $zero, even
+	addi $v1, $v1, 3
+even:
+	addi $t9, $t9, -1
+	bne $t9, $zero, outer
+	addi $v0, $zero, 10
+	syscall
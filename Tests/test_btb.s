@@ -0,0 +1,15 @@
+# A loop that jumps over an instruction, so that the BTB learns the targets of
+# the jump and of the taken branch
+.text
+__start:
+	addi $t9, $zero, 32
+	addi $v1, $zero, 0
+loop:
+	addi $v1, $v1, 1
+	j skip
+	addi $v1, $v1, 100
+skip:
+	addi $t9, $t9, -1
+	bne $t9, $zero, loop
+	addi $v0, $zero, 10
+	syscall
@@ -0,0 +1,20 @@
+# Sums an array of 512 words twice, so that the second pass misses in a 1 KiB
+# L1 data cache but hits in the L2
+.text
+__start:
+	addi $t9, $zero, 2
+	addi $v1, $zero, 0
+pass:
+	lui $t0, 4096
+	addi $t1, $zero, 512
+sum:
+	lw $t2, 0($t0)
+	add $v1, $v1, $t2
+	sw $v1, 0($t0)
+	addi $t0, $t0, 4
+	addi $t1, $t1, -1
+	bne $t1, $zero, sum
+	addi $t9, $t9, -1
+	bne $t9, $zero, pass
+	addi $v0, $zero, 10
+	syscall
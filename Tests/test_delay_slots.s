@@ -0,0 +1,23 @@
+# Written for the architectural delay slots: the instruction after each branch and
+# jump is always executed, whether the branch is taken or not
+.text
+__start:
+	addi $t9, $zero, 4
+	addi $v1, $zero, 0
+loop:
+	addi $t9, $t9, -1
+	bne $t9, $zero, loop
+	addi $v1, $v1, 3
+	beq $v1, $zero, __start
+	addi $t0, $v1, 1
+	jal leaf
+	addi $t1, $zero, 7
+	j done
+	addi $t3, $t2, 1
+	addi $t4, $zero, 1
+done:
+	addi $v0, $zero, 10
+	syscall
+leaf:
+	jr $ra
+	add $t2, $v1, $t1
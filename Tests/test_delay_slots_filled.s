@@ -0,0 +1,25 @@
+# Assembled with the delay slots filled automatically. The addi before the first
+# bne and the add before the jr are independent of them and are moved into their
+# slots. The labelled beq can be reached without the addi before it, and the last
+# bne depends on the addi before it, so their slots get a nop, and so does the
+# slot of the jal, which follows a branch.
+.text
+__start:
+	addi $t9, $zero, 3
+	addi $v1, $zero, 0
+loop:
+	addi $v1, $v1, 2
+	bne $t9, $zero, count
+	addi $t1, $t1, 5
+count:
+	addi $t0, $t0, 1
+check:
+	beq $t0, $zero, loop
+	addi $t9, $t9, -1
+	bne $t9, $zero, loop
+	jal leaf
+	addi $v0, $zero, 10
+	syscall
+leaf:
+	add $t2, $v1, $t0
+	jr $ra
@@ -0,0 +1,22 @@
+# Alternates between two rows of the same DRAM bank, and then streams through
+# one row, so that both row conflicts and row hits occur
+.text
+__start:
+	lui $t0, 4096
+	lui $t1, 4097
+	addi $t9, $zero, 16
+conflict:
+	lw $t2, 0($t0)
+	lw $t3, 0($t1)
+	addi $t0, $t0, 64
+	addi $t1, $t1, 64
+	addi $t9, $t9, -1
+	bne $t9, $zero, conflict
+	addi $t9, $zero, 16
+stream:
+	lw $t2, 0($t0)
+	addi $t0, $t0, 64
+	addi $t9, $t9, -1
+	bne $t9, $zero, stream
+	addi $v0, $zero, 10
+	syscall
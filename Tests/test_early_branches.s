@@ -0,0 +1,17 @@
+# Branches on the result of a load, of an slt and of an addi right before them, so
+# that the comparator in ID waits for each of them to be forwarded
+.text
+__start:
+	addi $t9, $zero, 20
+	addi $t3, $zero, 5
+	lui $t0, 4096
+loop:
+	lw $t1, 0($t0)
+	bne $t1, $zero, done
+	slt $t2, $t1, $t3
+	beq $t2, $zero, done
+	addi $t9, $t9, -1
+	bne $t9, $zero, loop
+done:
+	addi $v0, $zero, 10
+	syscall
@@ -0,0 +1,21 @@
+# Loads from four cache lines before using any of the loaded values, so that
+# a non-blocking data cache overlaps the misses in its MSHRs
+.text
+__start:
+	lui $t0, 4096
+	addi $t9, $zero, 16
+	addi $v1, $zero, 0
+loop:
+	lw $t1, 0($t0)
+	lw $t2, 32($t0)
+	lw $t3, 64($t0)
+	lw $t4, 96($t0)
+	add $v1, $v1, $t1
+	add $v1, $v1, $t2
+	add $v1, $v1, $t3
+	add $v1, $v1, $t4
+	addi $t0, $t0, 128
+	addi $t9, $t9, -1
+	bne $t9, $zero, loop
+	addi $v0, $zero, 10
+	syscall
@@ -0,0 +1,14 @@
+# Loads every other cache line of a 4 KiB array, a constant stride that a
+# stride prefetcher follows
+.text
+__start:
+	lui $t0, 4096
+	addi $t9, $zero, 64
+loop:
+	lw $t1, 0($t0)
+	lw $t2, 4($t0)
+	addi $t0, $t0, 64
+	addi $t9, $t9, -1
+	bne $t9, $zero, loop
+	addi $v0, $zero, 10
+	syscall
@@ -0,0 +1,24 @@
+# Calls two subroutines from a loop, one of them through a nested call, so that
+# the return address stack predicts the targets of the returns
+.text
+__start:
+	addi $t9, $zero, 32
+	addi $v1, $zero, 0
+	lui $sp, 32767
+loop:
+	jal outer
+	jal leaf
+	addi $t9, $t9, -1
+	bne $t9, $zero, loop
+	addi $v0, $zero, 10
+	syscall
+outer:
+	addi $sp, $sp, -4
+	sw $ra, 0($sp)
+	jal leaf
+	lw $ra, 0($sp)
+	addi $sp, $sp, 4
+	jr $ra
+leaf:
+	addi $v1, $v1, 1
+	jr $ra
@@ -0,0 +1,31 @@
+# Calls a chain of three nested subroutines from a loop. With a return address
+# stack of one entry, the nested calls overflow it, and only the returns from the
+# innermost subroutine are predicted.
+.text
+__start:
+	addi $t9, $zero, 16
+	addi $v1, $zero, 0
+	lui $sp, 32767
+loop:
+	jal outer
+	addi $t9, $t9, -1
+	bne $t9, $zero, loop
+	addi $v0, $zero, 10
+	syscall
+outer:
+	addi $sp, $sp, -4
+	sw $ra, 0($sp)
+	jal middle
+	lw $ra, 0($sp)
+	addi $sp, $sp, 4
+	jr $ra
+middle:
+	addi $sp, $sp, -4
+	sw $ra, 0($sp)
+	jal leaf
+	lw $ra, 0($sp)
+	addi $sp, $sp, 4
+	jr $ra
+leaf:
+	addi $v1, $v1, 1
+	jr $ra
@@ -0,0 +1,19 @@
+# Stores words and reads them back while they are still in the store buffer,
+# including a byte load from a word store and a word load after byte stores
+.text
+__start:
+	lui $t0, 4096
+	addi $t9, $zero, 32
+loop:
+	sw $t9, 0($t0)
+	sw $t9, 4($t0)
+	sw $t9, 8($t0)
+	lw $t1, 4($t0)
+	lbu $t2, 0($t0)
+	sb $t9, 13($t0)
+	lw $t3, 12($t0)
+	addi $t0, $t0, 16
+	addi $t9, $t9, -1
+	bne $t9, $zero, loop
+	addi $v0, $zero, 10
+	syscall
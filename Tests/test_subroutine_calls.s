@@ -0,0 +1,14 @@
+__start:
+jal leaf
+add $t1, $v0, $zero
+jal get_ra
+addi $t3, $t2, 16
+jalr $t3
+addi $v0, $zero, 10
+syscall
+leaf:
+addi $v0, $zero, 7
+jr $ra
+get_ra:
+add $t2, $ra, $zero
+jr $ra
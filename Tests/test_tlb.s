@@ -0,0 +1,20 @@
+# Touches eight pages in turn, four times, so that they do not fit in a data
+# TLB of four entries
+.text
+__start:
+	addi $t9, $zero, 4
+	addi $v1, $zero, 0
+pass:
+	lui $t0, 4096
+	addi $t1, $zero, 8
+pages:
+	lw $t2, 0($t0)
+	add $v1, $v1, $t2
+	sw $v1, 4($t0)
+	addi $t0, $t0, 4096
+	addi $t1, $t1, -1
+	bne $t1, $zero, pages
+	addi $t9, $t9, -1
+	bne $t9, $zero, pass
+	addi $v0, $zero, 10
+	syscall